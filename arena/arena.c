@@ -0,0 +1,243 @@
+/*
+ *  arena.c
+ *
+ *  DESCRIPTION:
+ *
+ *  Arena allocator backed by huge pages, for the large buffers of the DQN
+ *  (the replay memory and the minibatch staging buffers of
+ *  TransitionTable), used by arena/arena.lua through Lua FFI.
+ *
+ *  The replay memory is gathered from at random, so with 4 KB pages
+ *  nearly every frame read misses the TLB; and on a board with swap, parts
+ *  of it could be paged out. An arena is 1 anonymous mapping, which is
+ *  backed by:
+ *
+ *    ARENA_HUGETLB - explicit huge pages (MAP_HUGETLB, from the pool in
+ *                    /proc/sys/vm/nr_hugepages); if there are not enough
+ *                    of them, it falls back to ARENA_THP
+ *    ARENA_THP     - transparent huge pages: the mapping is aligned to
+ *                    2 MB and advised MADV_HUGEPAGE
+ *
+ *  and with ARENA_LOCK it is also mlock'd (and so populated up front),
+ *  so it is never swapped out. A failed mlock (RLIMIT_MEMLOCK) is
+ *  reported on stderr and in the stats, and the arena is still usable.
+ *
+ *  Memory is handed out by bumping a pointer, aligned to ARENA_ALIGN (or
+ *  more) bytes, and only freed all at once (arena_reset/arena_destroy).
+ *  arena_stats() reports how much of the arena is resident (mincore) and
+ *  backed by huge pages (/proc/self/smaps), and the page faults of the
+ *  process so far.
+ *
+ *  PROCESS:
+ *
+ *  struct arena *arena_create(size_t size, int flags);
+ *  void *arena_alloc(a, size_t size, size_t align);
+ *  void  arena_reset(a);
+ *  int   arena_stats(a, struct arena_stats *s);
+ *  void  arena_destroy(a);
+ *
+ *  GLOBALS: none
+ *
+ *  REFERENCE:
+ *
+ *  1. Documentation/admin-guide/mm/transhuge.rst, hugetlbpage.rst
+ *
+ *  LIMITATIONS:
+ *
+ *  1. An arena is not thread-safe: it should be allocated from by 1
+ *     thread (the memory could be used by any).
+ *  2. Huge pages are assumed to be 2 MB.
+ *
+ *  REVISION HISTORY:
+ *
+ *    Date             Description                                   Author
+ *    2026-10-18       initial coding                                agent
+ *
+ *  TARGET: Linux C
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include "arena.h"
+
+struct arena {
+        unsigned char *base;
+        size_t         size;
+        size_t         used;
+        int            hugetlb;
+        int            locked;
+};
+
+static size_t round_up(size_t n, size_t to)
+{
+        return (n + to - 1) / to * to;
+}
+
+/* an anonymous mapping of 'size' bytes aligned to ARENA_HUGE_SIZE */
+static void *map_aligned(size_t size)
+{
+        size_t len = size + ARENA_HUGE_SIZE;
+        unsigned char *p, *q;
+
+        p = mmap(NULL, len, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (MAP_FAILED == p)
+                return NULL;
+        q = (unsigned char *) round_up((uintptr_t) p, ARENA_HUGE_SIZE);
+        if (q > p)
+                munmap(p, q - p);
+        if (p + len > q + size)
+                munmap(q + size, p + len - (q + size));
+        return q;
+}
+
+struct arena *arena_create(size_t size, int flags)
+{
+        struct arena *a;
+        void *p = NULL;
+
+        if (0 == size)
+                return NULL;
+        a = calloc(1, sizeof(*a));
+        if (NULL == a)
+                return NULL;
+        a->size = round_up(size, ARENA_HUGE_SIZE);
+
+        if (flags & ARENA_HUGETLB) {
+                p = mmap(NULL, a->size, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+                if (MAP_FAILED == p)
+                        p = NULL;  /* not enough huge pages reserved */
+                else
+                        a->hugetlb = 1;
+        }
+        if (NULL == p) {
+                p = map_aligned(a->size);
+                if (NULL == p) {
+                        free(a);
+                        return NULL;
+                }
+#ifdef MADV_HUGEPAGE
+                if (flags & (ARENA_THP | ARENA_HUGETLB))
+                        madvise(p, a->size, MADV_HUGEPAGE);
+#endif
+        }
+        a->base = p;
+
+        if (flags & ARENA_LOCK) {
+                if (mlock(a->base, a->size) == 0)
+                        a->locked = 1;
+                else
+                        fprintf(stderr, "arena: mlock of %zu MB failed: %s "
+                                "(see ulimit -l)\n", a->size >> 20, strerror(errno));
+        }
+        return a;
+}
+
+/*
+ * 'size' bytes aligned to 'align' (a power of 2; 0 for ARENA_ALIGN), or
+ * NULL if the arena is full.
+ */
+void *arena_alloc(struct arena *a, size_t size, size_t align)
+{
+        size_t off;
+
+        if (align < ARENA_ALIGN)
+                align = ARENA_ALIGN;
+        if (align & (align - 1))
+                return NULL;
+        off = round_up(a->used, align);
+        if (off > a->size || size > a->size - off)
+                return NULL;
+        a->used = off + size;
+        return a->base + off;
+}
+
+/* free all allocations at once (the memory stays mapped and locked) */
+void arena_reset(struct arena *a)
+{
+        a->used = 0;
+}
+
+/* kB of the 'field's of the smaps entry starting at 'start' */
+static long smaps_kb(const void *start, const char *const *fields, int n)
+{
+        FILE *fp = fopen("/proc/self/smaps", "r");
+        char line[256], name[64];
+        unsigned long lo, hi;
+        long kb, total = 0;
+        int in = 0, i;
+
+        if (NULL == fp)
+                return -1;
+        while (fgets(line, sizeof(line), fp)) {
+                if (sscanf(line, "%lx-%lx ", &lo, &hi) == 2) {
+                        if (in)
+                                break;  /* past the entry */
+                        in = (lo == (uintptr_t) start);
+                        continue;
+                }
+                if (in && sscanf(line, "%63[^:]: %ld kB", name, &kb) == 2)
+                        for (i = 0; i < n; i++)
+                                if (strcmp(name, fields[i]) == 0)
+                                        total += kb;
+        }
+        fclose(fp);
+        return total;
+}
+
+int arena_stats(struct arena *a, struct arena_stats *s)
+{
+        static const char *const huge_fields[] = {
+                "AnonHugePages", "Private_Hugetlb", "Shared_Hugetlb"
+        };
+        struct rusage ru;
+        size_t page = sysconf(_SC_PAGESIZE), len, i;
+        unsigned char *vec;
+        long kb;
+
+        memset(s, 0, sizeof(*s));
+        s->size = a->size;
+        s->used = a->used;
+        s->hugetlb = a->hugetlb;
+        s->locked = a->locked;
+
+        /* resident part of what is allocated */
+        len = round_up(a->used, a->hugetlb ? ARENA_HUGE_SIZE : page);
+        if (len > 0 && (vec = malloc(len / page + 1)) != NULL) {
+                if (mincore(a->base, len, vec) == 0) {
+                        for (i = 0; i < len / page; i++)
+                                if (vec[i] & 1)
+                                        s->resident += page;
+                        if (s->resident > a->used)
+                                s->resident = a->used;
+                }
+                free(vec);
+        }
+        kb = smaps_kb(a->base, huge_fields, 3);
+        if (kb > 0)
+                s->huge = (size_t) kb << 10;
+
+        if (getrusage(RUSAGE_SELF, &ru) == 0) {
+                s->minor_faults = ru.ru_minflt;
+                s->major_faults = ru.ru_majflt;
+        }
+        return 0;
+}
+
+void arena_destroy(struct arena *a)
+{
+        if (NULL == a)
+                return;
+        if (a->locked)
+                munlock(a->base, a->size);
+        munmap(a->base, a->size);
+        free(a);
+}
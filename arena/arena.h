@@ -0,0 +1,45 @@
+/*
+ * arena.h
+ */
+
+#ifndef ARENA_H_
+#define ARENA_H_
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ARENA_ALIGN     64              /* default alignment (cache line, AVX-512) */
+#define ARENA_HUGE_SIZE (2UL << 20)     /* huge page size assumed */
+
+/* flags of arena_create() */
+#define ARENA_THP       1       /* transparent huge pages (madvise) */
+#define ARENA_HUGETLB   2       /* explicit huge pages (falls back to THP) */
+#define ARENA_LOCK      4       /* mlock the whole arena */
+
+struct arena;
+
+struct arena_stats {
+        size_t  size;           /* bytes mapped */
+        size_t  used;           /* bytes allocated */
+        size_t  resident;       /* bytes in memory (of the used part) */
+        size_t  huge;           /* bytes backed by huge pages */
+        int     hugetlb;        /* 1 if explicit huge pages are used */
+        int     locked;         /* 1 if mlock'd */
+        long    minor_faults;   /* of the process */
+        long    major_faults;   /* of the process */
+};
+
+extern struct arena *arena_create(size_t size, int flags);
+extern void         *arena_alloc(struct arena *a, size_t size, size_t align);
+extern void          arena_reset(struct arena *a);
+extern int           arena_stats(struct arena *a, struct arena_stats *s);
+extern void          arena_destroy(struct arena *a);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARENA_H_ */
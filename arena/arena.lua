@@ -0,0 +1,111 @@
+--------------------------------------------------------------------------------
+--
+-- "arena" module
+--
+-- This module exposes the huge page arena allocator (libarena.so) through
+-- FFI. Torch tensors could be allocated in an arena, so that large buffers
+-- (the replay memory of dqn.TransitionTable) are backed by huge pages, and
+-- optionally locked in memory. See arena.c for details.
+--
+-- Usage:
+--
+--   local arena = require 'arena/arena'
+--   local a = arena.create(800 * 2^20, {huge = 'thp', lock = true})
+--   local s = a:tensor('torch.ByteTensor', 100000, 7056)
+--   print(a:stats().huge)
+--
+-- Tensors allocated in an arena must not be used after the arena is
+-- destroyed (or garbage collected), so keep a reference to it.
+--
+--------------------------------------------------------------------------------
+-- agent, 2026-10-18
+--------------------------------------------------------------------------------
+
+require 'torch'
+
+local ffi = require 'ffi'
+local arena = {}
+local lib = ffi.load(paths.cwd() .. '/arena/libarena.so')
+
+-- Function prototype definition
+ffi.cdef [[
+    struct arena;
+    struct arena_stats {
+        size_t  size;
+        size_t  used;
+        size_t  resident;
+        size_t  huge;
+        int     hugetlb;
+        int     locked;
+        long    minor_faults;
+        long    major_faults;
+    };
+    struct arena *arena_create(size_t size, int flags);
+    void *arena_alloc(struct arena *a, size_t size, size_t align);
+    void  arena_reset(struct arena *a);
+    int   arena_stats(struct arena *a, struct arena_stats *s);
+    void  arena_destroy(struct arena *a);
+]]
+
+local THP, HUGETLB, LOCK = 1, 2, 4
+local huge_flags = { none = 0, thp = THP, hugetlb = HUGETLB }
+
+local Arena = {}
+Arena.__index = Arena
+
+-- Create an arena of 'size' bytes (rounded up to 2 MB). 'opt.huge' is
+-- 'thp' (transparent huge pages, the default), 'hugetlb' (explicit huge
+-- pages, falling back to thp) or 'none'; 'opt.lock' locks it in memory.
+function arena.create(size, opt)
+    opt = opt or {}
+    local flags = huge_flags[opt.huge or 'thp']
+    assert(flags, 'arena: unknown huge page mode ' .. tostring(opt.huge))
+    if opt.lock then flags = flags + LOCK end
+    local a = lib.arena_create(size, flags)
+    assert(a ~= nil, 'arena: could not map ' .. size .. ' bytes')
+    local self = setmetatable({}, Arena)
+    self.a = ffi.gc(a, lib.arena_destroy)
+    return self
+end
+
+-- Allocate a tensor of 'tensor_type' (e.g. 'torch.ByteTensor') and the
+-- given sizes in the arena, aligned to 64 bytes.
+function Arena:tensor(tensor_type, ...)
+    local name = tensor_type:match('^torch%.(%a+)Tensor$')
+    assert(name and torch[name .. 'Storage'],
+           'arena: unknown tensor type ' .. tostring(tensor_type))
+    local Storage = torch[name .. 'Storage']
+    local sizes = torch.LongStorage({...})
+    local n = 1
+    for i = 1, #sizes do n = n * sizes[i] end
+    local p = lib.arena_alloc(self.a, math.max(n, 1) * Storage():elementSize(), 0)
+    assert(p ~= nil, 'arena: out of space for ' .. n .. ' elements')
+    -- the storage does not own (and so never frees) the memory
+    local storage = Storage(n, tonumber(ffi.cast('intptr_t', p)))
+    return torch[name .. 'Tensor'](storage, 1, sizes)
+end
+
+-- Free all tensors of the arena at once.
+function Arena:reset()
+    lib.arena_reset(self.a)
+end
+
+-- Return the stats of the arena: size, used, resident and huge (bytes),
+-- hugetlb and locked (booleans), and the minor_faults and major_faults
+-- of the process.
+function Arena:stats()
+    local s = ffi.new('struct arena_stats')
+    lib.arena_stats(self.a, s)
+    return {size = tonumber(s.size), used = tonumber(s.used),
+            resident = tonumber(s.resident), huge = tonumber(s.huge),
+            hugetlb = s.hugetlb ~= 0, locked = s.locked ~= 0,
+            minor_faults = tonumber(s.minor_faults),
+            major_faults = tonumber(s.major_faults)}
+end
+
+function Arena:destroy()
+    lib.arena_destroy(ffi.gc(self.a, nil))
+    self.a = nil
+end
+
+return arena
@@ -0,0 +1,326 @@
+/*
+ *  bench.c
+ *
+ *  DESCRIPTION:
+ *
+ *  Micro-benchmarks of the native libraries, so that a change of a hot
+ *  path could be judged with numbers:
+ *
+ *    vidcap_uyvy_to_gray - the UYVY 1280x720 to gray 640x360 conversion
+ *                          of video0_cap.c, on a fixture frame
+ *    vidcap_uyvy_pair_max - the same of 2 frames pooled by max (60 fps
+ *                          mode of video0_cap.c)
+ *    vidcap_uyvy_rois    - the conversion of only the regions of interest
+ *                          of Galaga (vidcap_set_roi)
+ *    device_turnaround   - device.c dequeue + requeue of a frame, on a
+ *                          vivid (or replay, e.g. v4l2loopback) device
+ *    gpio_set_*          - GPIO writes, on a mock sysfs directory
+ *    imshow_display      - imshow_display() in headless mode
+ *    shmpub_frame        - shmpub_frame(), publishing a frame to shared
+ *                          memory for a viewer process
+ *
+ *  Fixture data are generated from a fixed seed (-s), so every run works
+ *  on the same data. Every benchmark is calibrated to run at least -t
+ *  seconds per repetition, then repeated -r times; the mean, median,
+ *  standard deviation and minimum of the time per operation, and the
+ *  throughput, are printed and written as CSV (-o). If a baseline CSV
+ *  (-b, a previous output) is given, the medians are compared against
+ *  it, and the exit status is 1 if any is slower than the baseline by
+ *  more than the tolerance (-T) and by more than twice the standard
+ *  deviation (of either run), i.e. beyond the noise.
+ *
+ *  PROCESS:
+ *
+ *  $ bench [-s seed] [-r reps] [-t seconds] [-d /dev/videoN] [-f filter]
+ *          [-o results.csv] [-b baseline.csv] [-T tolerance]
+ *
+ *  GLOBALS:
+ *
+ *  bench_opt, and the results so far.
+ *
+ *  REFERENCE:
+ *
+ *  LIMITATIONS:
+ *
+ *  1. Baselines are only comparable on the same machine (and the same
+ *     device, for device_turnaround).
+ *
+ *  REVISION HISTORY:
+ *
+ *    Date             Description                                   Author
+ *    2026-10-18       initial coding                                agent
+ *
+ *  TARGET: Linux C
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include "bench.h"
+
+#define MAX_RESULTS 64
+#define MAX_REPS    100
+
+struct result {
+        char    name[BENCH_NAME_LEN];
+        int     skipped;
+        long    iters;          /* per repetition */
+        int     reps;
+        double  ns, median, stddev, min;        /* per operation */
+        double  throughput;
+        const char *unit;
+};
+
+struct bench_opts bench_opt = {
+        .seed = 1, .reps = 10, .min_time = 0.1, .device = NULL, .filter = NULL
+};
+
+static struct result results[MAX_RESULTS];
+static int nresults;
+
+static int cmp_double(const void *a, const void *b)
+{
+        double x = *(const double *) a, y = *(const double *) b;
+
+        return (x > y) - (x < y);
+}
+
+static double now(void)
+{
+        struct timespec ts;
+
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static struct result *new_result(const char *name)
+{
+        struct result *r;
+
+        if (nresults >= MAX_RESULTS)
+                return NULL;
+        r = &results[nresults++];
+        memset(r, 0, sizeof(*r));
+        snprintf(r->name, sizeof(r->name), "%s", name);
+        return r;
+}
+
+/*
+ * API for the benchmarks
+ */
+int bench_selected(const char *name)
+{
+        return NULL == bench_opt.filter || strstr(name, bench_opt.filter) != NULL;
+}
+
+/* xorshift32, for fixture data */
+unsigned int bench_rand(unsigned int *state)
+{
+        unsigned int x = *state ? *state : 1;
+
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        return *state = x;
+}
+
+/*
+ * Time 'fn'. 'bytes_per_op' (0 if not meaningful) gives the throughput
+ * in MB/s, otherwise it is in operations per second.
+ */
+void bench_run(const char *name, bench_fn fn, void *ctx, double bytes_per_op)
+{
+        double t, ns[MAX_REPS], sum = 0, var = 0;
+        long iters = 1;
+        int i, reps = bench_opt.reps;
+        struct result *r;
+
+        if (!bench_selected(name) || (r = new_result(name)) == NULL)
+                return;
+        if (reps > MAX_REPS)
+                reps = MAX_REPS;
+
+        /* calibrate (this also warms up the caches) */
+        while (1) {
+                t = now();
+                fn(ctx, iters);
+                t = now() - t;
+                if (t >= bench_opt.min_time || iters >= (1L << 30))
+                        break;
+                iters *= (t > 0 && bench_opt.min_time / t < 2) ? 2 :
+                         (t > 0 && bench_opt.min_time / t < 100) ?
+                         (long) (bench_opt.min_time / t) + 1 : 100;
+        }
+
+        r->min = HUGE_VAL;
+        for (i = 0; i < reps; i++) {
+                t = now();
+                fn(ctx, iters);
+                ns[i] = (now() - t) * 1e9 / iters;
+                sum += ns[i];
+                if (ns[i] < r->min)
+                        r->min = ns[i];
+        }
+        r->iters = iters;
+        r->reps = reps;
+        r->ns = sum / reps;
+        for (i = 0; i < reps; i++)
+                var += (ns[i] - r->ns) * (ns[i] - r->ns);
+        r->stddev = (reps > 1) ? sqrt(var / (reps - 1)) : 0;
+        qsort(ns, reps, sizeof(double), cmp_double);
+        r->median = (reps % 2) ? ns[reps / 2] : (ns[reps / 2 - 1] + ns[reps / 2]) / 2;
+        if (bytes_per_op > 0) {
+                r->throughput = bytes_per_op / r->ns * 1e3;
+                r->unit = "MB/s";
+        } else {
+                r->throughput = 1e9 / r->ns;
+                r->unit = "op/s";
+        }
+        printf("%-28s %12.1f ns/op  +- %5.1f%%  (median %10.1f, min %10.1f)  %12.1f %s\n",
+               r->name, r->ns, 100 * r->stddev / r->ns, r->median, r->min,
+               r->throughput, r->unit);
+        fflush(stdout);
+}
+
+void bench_skip(const char *name, const char *why)
+{
+        struct result *r;
+
+        if (!bench_selected(name) || (r = new_result(name)) == NULL)
+                return;
+        r->skipped = 1;
+        printf("%-28s skipped: %s\n", name, why);
+}
+
+/*
+ * output
+ */
+static int write_csv(const char *path)
+{
+        FILE *fp = fopen(path, "w");
+        int i;
+
+        if (NULL == fp)
+                return -1;
+        fprintf(fp, "name,iters,reps,ns_per_op,median_ns,stddev_ns,cv_pct,min_ns,"
+                    "throughput,unit,status\n");
+        for (i = 0; i < nresults; i++) {
+                struct result *r = &results[i];
+
+                if (r->skipped)
+                        fprintf(fp, "%s,0,0,,,,,,,,skipped\n", r->name);
+                else
+                        fprintf(fp, "%s,%ld,%d,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%s,ok\n",
+                                r->name, r->iters, r->reps, r->ns, r->median,
+                                r->stddev, 100 * r->stddev / r->ns, r->min,
+                                r->throughput, r->unit);
+        }
+        return fclose(fp) == 0 ? 0 : -1;
+}
+
+/* the median and stddev of 'name' in baseline CSV 'path'; -1 if absent */
+static int baseline_of(const char *path, const char *name,
+                       double *median, double *stddev)
+{
+        FILE *fp = fopen(path, "r");
+        char line[512], n[BENCH_NAME_LEN];
+        long iters;
+        int reps, found = -1;
+        double ns;
+
+        if (NULL == fp)
+                return -1;
+        while (fgets(line, sizeof(line), fp)) {
+                if (sscanf(line, "%47[^,],%ld,%d,%lf,%lf,%lf", n, &iters, &reps,
+                           &ns, median, stddev) == 6 && strcmp(n, name) == 0) {
+                        found = 0;
+                        break;
+                }
+        }
+        fclose(fp);
+        return found;
+}
+
+/* returns the number of regressions */
+static int compare(const char *path, double tolerance)
+{
+        int i, slower = 0;
+
+        if (access(path, R_OK) != 0) {
+                printf("\nno baseline (%s)\n", path);
+                return 0;
+        }
+        printf("\ncompared with %s (tolerance %.0f%%):\n", path, tolerance * 100);
+        for (i = 0; i < nresults; i++) {
+                struct result *r = &results[i];
+                double base, base_sd, noise;
+                int regression;
+
+                if (r->skipped)
+                        continue;
+                if (baseline_of(path, r->name, &base, &base_sd) < 0 || base <= 0) {
+                        printf("%-28s not in baseline\n", r->name);
+                        continue;
+                }
+                noise = 2 * (r->stddev > base_sd ? r->stddev : base_sd);
+                regression = r->median > base * (1 + tolerance) &&
+                             r->median - base > noise;
+                printf("%-28s %+7.1f%%  (noise +-%.1f%%)%s\n", r->name,
+                       100 * (r->median / base - 1), 100 * noise / base,
+                       regression ? "  REGRESSION" : "");
+                slower += regression;
+        }
+        return slower;
+}
+
+static void usage(const char *prog)
+{
+        fprintf(stderr,
+                "usage: %s [-s seed] [-r reps] [-t seconds] [-d /dev/videoN]\n"
+                "          [-f filter] [-o results.csv] [-b baseline.csv] [-T tolerance]\n",
+                prog);
+        exit(2);
+}
+
+int main(int argc, char **argv)
+{
+        const char *out = NULL, *baseline = NULL;
+        double tolerance = 0.1;
+        int c;
+
+        while ((c = getopt(argc, argv, "s:r:t:d:f:o:b:T:")) != -1) {
+                switch (c) {
+                case 's': bench_opt.seed = strtoul(optarg, NULL, 0); break;
+                case 'r': bench_opt.reps = atoi(optarg); break;
+                case 't': bench_opt.min_time = atof(optarg); break;
+                case 'd': bench_opt.device = optarg; break;
+                case 'f': bench_opt.filter = optarg; break;
+                case 'o': out = optarg; break;
+                case 'b': baseline = optarg; break;
+                case 'T': tolerance = atof(optarg); break;
+                default:  usage(argv[0]);
+                }
+        }
+        if (bench_opt.reps < 1 || bench_opt.min_time <= 0)
+                usage(argv[0]);
+
+        printf("seed %u, %d repetitions of >= %.2f s\n\n",
+               bench_opt.seed, bench_opt.reps, bench_opt.min_time);
+        bench_vidcap();
+        bench_device();
+        bench_gpio();
+        bench_imshow();
+        bench_shmpub();
+
+        if (out && write_csv(out) != 0) {
+                perror(out);
+                return 2;
+        }
+        if (baseline && compare(baseline, tolerance) > 0)
+                return 1;
+        return 0;
+}
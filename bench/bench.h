@@ -0,0 +1,36 @@
+/*
+ * bench.h
+ */
+
+#ifndef BENCH_H_
+#define BENCH_H_
+
+#define BENCH_NAME_LEN  48
+
+/* the benchmarked operation, run 'iters' times on 'ctx' */
+typedef void (*bench_fn)(void *ctx, long iters);
+
+struct bench_opts {
+        unsigned int  seed;             /* of the fixture data */
+        int           reps;             /* timed repetitions per benchmark */
+        double        min_time;         /* seconds per repetition, at least */
+        const char   *device;           /* V4L2 device, NULL to look for vivid */
+        const char   *filter;           /* run only benchmarks containing it */
+};
+
+extern struct bench_opts bench_opt;
+
+extern int          bench_selected(const char *name);
+extern void         bench_run(const char *name, bench_fn fn, void *ctx,
+                              double bytes_per_op);
+extern void         bench_skip(const char *name, const char *why);
+extern unsigned int bench_rand(unsigned int *state);
+
+/* the benchmarks */
+extern void bench_vidcap(void);
+extern void bench_device(void);
+extern void bench_gpio(void);
+extern void bench_imshow(void);
+extern void bench_shmpub(void);
+
+#endif /* BENCH_H_ */
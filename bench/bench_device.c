@@ -0,0 +1,91 @@
+/*
+ *  bench_device.c
+ *
+ *  DESCRIPTION:
+ *
+ *  Benchmark of the frame turnaround of vidcap/device.c: waiting for,
+ *  dequeuing and requeuing 1 frame (device_get_next_frame() and
+ *  device_free_frame()), i.e. the frame interval of the device plus the
+ *  overhead of device.c. The throughput is of the raw video, assuming 2
+ *  bytes per pixel.
+ *
+ *  It runs on the device given by -d, e.g. a v4l2loopback device fed by a
+ *  recording of the game video (a replay device), or else on the first
+ *  vivid (virtual video test driver) device found; the device is used
+ *  in its current format. It is skipped if there is no such device.
+ *
+ *  REVISION HISTORY:
+ *
+ *    Date             Description                                   Author
+ *    2026-10-18       initial coding                                agent
+ *
+ *  TARGET: Linux C
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "bench.h"
+#include "../vidcap/device.h"
+
+/* the first /dev/videoN whose driver name contains "vivid", or NULL */
+static const char *find_vivid(void)
+{
+        static char dev[32];
+        char path[64], name[64];
+        int i;
+
+        for (i = 0; i < 64; i++) {
+                FILE *fp;
+
+                snprintf(path, sizeof(path), "/sys/class/video4linux/video%d/name", i);
+                if ((fp = fopen(path, "r")) == NULL)
+                        continue;
+                name[0] = '\0';
+                if (fgets(name, sizeof(name), fp) == NULL)
+                        name[0] = '\0';
+                fclose(fp);
+                if (strstr(name, "vivid")) {
+                        snprintf(dev, sizeof(dev), "/dev/video%d", i);
+                        return dev;
+                }
+        }
+        return NULL;
+}
+
+static void run_turnaround(void *arg, long iters)
+{
+        long i;
+
+        for (i = 0; i < iters; i++) {
+                void *p = device_get_next_frame(1000000);
+
+                if (p)
+                        device_free_frame(p);
+        }
+}
+
+void bench_device(void)
+{
+        const char *dev = bench_opt.device ? bench_opt.device : find_vivid();
+        char format[8] = "";
+        int w = 0, h = 0;
+
+        if (!bench_selected("device_turnaround"))
+                return;
+        if (NULL == dev) {
+                bench_skip("device_turnaround", "no vivid device (or -d)");
+                return;
+        }
+        if (device_initialize_keep_format((char *) dev) < 0 ||
+            device_start_capturing() < 0) {
+                device_cleanup();
+                bench_skip("device_turnaround", "could not capture from the device");
+                return;
+        }
+        device_get_format(&w, &h, format);
+        printf("(%s: %dx%d %s)\n", dev, w, h, format);
+        bench_run("device_turnaround", run_turnaround, NULL, (double) w * h * 2);
+        device_stop_capturing();
+        device_cleanup();
+}
@@ -0,0 +1,141 @@
+/*
+ *  bench_gpio.c
+ *
+ *  DESCRIPTION:
+ *
+ *  Benchmark of GPIO writes (gpio/gpio.c), on a mock sysfs directory
+ *  (GPIO_SYSFS_DIR, see jetsonGPIO.c) made of plain files, so it runs
+ *  without the GPIO hardware. It measures the open/write/close path of
+ *  the library, not the latency of the real sysfs driver.
+ *
+ *    gpio_set_high - 1 pin
+ *    gpio_set_mask - the 6 pins of take_action(), with a random action
+ *                    (from bench_opt.seed) each time
+ *
+ *  REVISION HISTORY:
+ *
+ *    Date             Description                                   Author
+ *    2026-10-18       initial coding                                agent
+ *
+ *  TARGET: Linux C
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "bench.h"
+
+extern void gpio_export(int pin);
+extern void gpio_set_high(int pin);
+extern void gpio_set_mask(const int *pins, int n, unsigned int mask);
+
+static const int pins[] = { 36, 37, 184, 219, 38, 63 };
+#define NPINS   ((int) (sizeof(pins) / sizeof(pins[0])))
+
+/* masks of the 6 Galaga actions, as in gameenv */
+static const unsigned int action_masks[] = { 1, 0, 2, 1 + 16, 16, 2 + 16 };
+
+struct gpio_ctx {
+        unsigned int masks[256];
+};
+
+static int touch(const char *dir, const char *name)
+{
+        char path[256];
+        FILE *fp;
+
+        snprintf(path, sizeof(path), "%s/%s", dir, name);
+        if ((fp = fopen(path, "w")) == NULL)
+                return -1;
+        return fclose(fp);
+}
+
+/* a mock /sys/class/gpio in 'dir', with the pins already exported */
+static int make_mock(char *dir)
+{
+        char sub[256], name[64];
+        int i;
+
+        if (mkdtemp(dir) == NULL)
+                return -1;
+        if (touch(dir, "export") < 0 || touch(dir, "unexport") < 0)
+                return -1;
+        for (i = 0; i < NPINS; i++) {
+                snprintf(sub, sizeof(sub), "%s/gpio%d", dir, pins[i]);
+                if (mkdir(sub, 0700) < 0)
+                        return -1;
+                snprintf(name, sizeof(name), "gpio%d/direction", pins[i]);
+                if (touch(dir, name) < 0)
+                        return -1;
+                snprintf(name, sizeof(name), "gpio%d/value", pins[i]);
+                if (touch(dir, name) < 0)
+                        return -1;
+        }
+        return 0;
+}
+
+static void remove_mock(const char *dir)
+{
+        char path[256];
+        int i;
+
+        for (i = 0; i < NPINS; i++) {
+                snprintf(path, sizeof(path), "%s/gpio%d/direction", dir, pins[i]);
+                unlink(path);
+                snprintf(path, sizeof(path), "%s/gpio%d/value", dir, pins[i]);
+                unlink(path);
+                snprintf(path, sizeof(path), "%s/gpio%d", dir, pins[i]);
+                rmdir(path);
+        }
+        snprintf(path, sizeof(path), "%s/export", dir);
+        unlink(path);
+        snprintf(path, sizeof(path), "%s/unexport", dir);
+        unlink(path);
+        rmdir(dir);
+}
+
+static void run_set_high(void *arg, long iters)
+{
+        long i;
+
+        for (i = 0; i < iters; i++)
+                gpio_set_high(pins[0]);
+}
+
+static void run_set_mask(void *arg, long iters)
+{
+        struct gpio_ctx *c = arg;
+        long i;
+
+        for (i = 0; i < iters; i++)
+                gpio_set_mask(pins, NPINS, c->masks[i & 255]);
+}
+
+void bench_gpio(void)
+{
+        char dir[] = "/tmp/bench_gpio_XXXXXX";
+        struct gpio_ctx c;
+        unsigned int seed = bench_opt.seed;
+        int i;
+
+        if (!bench_selected("gpio_set_high") && !bench_selected("gpio_set_mask"))
+                return;
+        if (make_mock(dir) < 0) {
+                bench_skip("gpio_set_mask", "could not make the mock sysfs directory");
+                return;
+        }
+        setenv("GPIO_SYSFS_DIR", dir, 1);
+        for (i = 0; i < NPINS; i++)
+                gpio_export(pins[i]);
+        for (i = 0; i < 256; i++)
+                c.masks[i] = action_masks[bench_rand(&seed) % 6];
+
+        bench_run("gpio_set_high", run_set_high, NULL, 0);
+        bench_run("gpio_set_mask", run_set_mask, &c, 0);
+
+        unsetenv("GPIO_SYSFS_DIR");
+        remove_mock(dir);
+}
@@ -0,0 +1,69 @@
+/*
+ *  bench_imshow.c
+ *
+ *  DESCRIPTION:
+ *
+ *  Benchmark of imshow_display() (imshow/imshow.c) in headless mode, on
+ *  a 640x360 gray fixture frame (from bench_opt.seed), i.e. the cost of
+ *  the display path when training on a machine without a screen.
+ *
+ *  It needs OpenCV to build (HAVE_OPENCV), and is skipped otherwise.
+ *
+ *  REVISION HISTORY:
+ *
+ *    Date             Description                                   Author
+ *    2026-10-18       initial coding                                agent
+ *
+ *  TARGET: Linux C
+ *
+ */
+
+#include <stdlib.h>
+#include "bench.h"
+
+#define W 640
+#define H 360
+
+#ifdef HAVE_OPENCV
+
+extern int  imshow_init(const char *name, int len);
+extern void imshow_display(unsigned char *buf, int w, int h);
+extern void imshow_cleanup();
+
+static void run_display(void *arg, long iters)
+{
+        long i;
+
+        for (i = 0; i < iters; i++)
+                imshow_display((unsigned char *) arg, W, H);
+}
+
+void bench_imshow(void)
+{
+        unsigned char *frame;
+        unsigned int seed = bench_opt.seed;
+        int i;
+
+        if (!bench_selected("imshow_display"))
+                return;
+        if ((frame = malloc(W * H)) == NULL) {
+                bench_skip("imshow_display", "out of memory");
+                return;
+        }
+        for (i = 0; i < W * H; i++)
+                frame[i] = bench_rand(&seed) & 0xff;
+        setenv("IMSHOW_HEADLESS", "1", 1);
+        imshow_init("bench", 5);
+        bench_run("imshow_display", run_display, frame, W * H);
+        imshow_cleanup();
+        free(frame);
+}
+
+#else
+
+void bench_imshow(void)
+{
+        bench_skip("imshow_display", "built without OpenCV");
+}
+
+#endif /* HAVE_OPENCV */
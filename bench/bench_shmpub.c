@@ -0,0 +1,61 @@
+/*
+ *  bench_shmpub.c
+ *
+ *  DESCRIPTION:
+ *
+ *  Benchmark of shmpub_frame() (shmpub/shmpub.c) on a 640x360 gray
+ *  fixture frame (from bench_opt.seed), i.e. the cost of the display path
+ *  of the training process when frames are published to shared memory
+ *  for a viewer process (compare imshow_display).
+ *
+ *  REVISION HISTORY:
+ *
+ *    Date             Description                                   Author
+ *    2026-10-18       initial coding                                agent
+ *
+ *  TARGET: Linux C
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "bench.h"
+#include "../shmpub/shmpub.h"
+
+#define W 640
+#define H 360
+
+static void run_frame(void *arg, long iters)
+{
+        long i;
+
+        for (i = 0; i < iters; i++)
+                shmpub_frame((unsigned char *) arg, W, H);
+}
+
+void bench_shmpub(void)
+{
+        unsigned char *frame;
+        unsigned int seed = bench_opt.seed;
+        char name[64];
+        int i;
+
+        if (!bench_selected("shmpub_frame"))
+                return;
+        if ((frame = malloc(W * H)) == NULL) {
+                bench_skip("shmpub_frame", "out of memory");
+                return;
+        }
+        for (i = 0; i < W * H; i++)
+                frame[i] = bench_rand(&seed) & 0xff;
+        snprintf(name, sizeof(name), "/dqn_bench_%d", (int) getpid());
+        if (shmpub_open(name, "bench", W * H) != 0) {
+                bench_skip("shmpub_frame", "no POSIX shared memory");
+                free(frame);
+                return;
+        }
+        bench_run("shmpub_frame", run_frame, frame, W * H);
+        shmpub_close();
+        free(frame);
+}
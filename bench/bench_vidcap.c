@@ -0,0 +1,144 @@
+/*
+ *  bench_vidcap.c
+ *
+ *  DESCRIPTION:
+ *
+ *  Benchmarks of the UYVY 1280x720 to gray 640x360 conversion of
+ *  vidcap/video0_cap.c, of 1 frame and of 2 frames pooled by max (the
+ *  60 fps mode), and of the conversion of only the regions of interest
+ *  of Galaga (the playfield and the HUD rectangles, as gameenv-threaded
+ *  registers them). The source is included here, so that the (static)
+ *  functions which libvidcap.so really runs are measured.
+ *
+ *  The fixture is a UYVY frame of mostly black background (as Galaga's
+ *  is) with random sprites, generated from bench_opt.seed.
+ *
+ *  REVISION HISTORY:
+ *
+ *    Date             Description                                   Author
+ *    2026-10-18       initial coding                                agent
+ *    2026-10-18       pooled conversion of frame pairs              agent
+ *    2026-10-18       regions of interest                           agent
+ *
+ *  TARGET: Linux C
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "bench.h"
+#include "../vidcap/video0_cap.c"
+
+#define RAW_W   1280
+#define RAW_H   720
+
+struct vidcap_ctx {
+        unsigned char *uyvy;
+        unsigned char *uyvy2;   /* the other frame of a pair */
+        unsigned char *gray;
+};
+
+/* the locs of galaga/galaga_image.t7 (h1, h2, w1, w2), 1 column wider */
+static const int galaga_rois[][4] = {
+        {  13, 348, 110, 446 },         /* raw_loc, the playfield */
+        {  37,  46, 445, 495 },         /* high_loc */
+        { 109, 118, 444, 524 },         /* score_loc, the 6 digits */
+        { 202, 213, 450, 517 },         /* fighter_loc, the 3 fighters */
+        { 271, 287, 443, 455 },         /* flag_loc */
+        { 133, 142, 256, 306 },         /* result_loc */
+};
+#define N_GALAGA_ROIS  (int) (sizeof(galaga_rois) / sizeof(galaga_rois[0]))
+
+static void make_fixture(unsigned char *uyvy, unsigned int seed)
+{
+        int i, x, y, k;
+
+        for (i = 0; i < RAW_W * RAW_H * 2; i += 2) {
+                uyvy[i] = 128;                  /* U or V: no color */
+                uyvy[i + 1] = 16;               /* Y: black */
+        }
+        /* 200 sprites of 16x16 random pixels */
+        for (k = 0; k < 200; k++) {
+                int x0 = bench_rand(&seed) % (RAW_W - 16);
+                int y0 = bench_rand(&seed) % (RAW_H - 16);
+
+                for (y = y0; y < y0 + 16; y++)
+                        for (x = x0; x < x0 + 16; x++)
+                                uyvy[(y * RAW_W + x) * 2 + 1] = 16 + bench_rand(&seed) % 220;
+        }
+}
+
+static void run_convert(void *arg, long iters)
+{
+        struct vidcap_ctx *c = arg;
+        long i;
+
+        for (i = 0; i < iters; i++)
+                packed_2x(c->uyvy + 1, NULL, RAW_W * 2, VIDCAP_POOL_DROP,
+                          OUT_W, OUT_H, c->gray, OUT_W);
+        /* keep the result live */
+        __asm__ __volatile__("" : : "r"(c->gray) : "memory");
+}
+
+static void run_convert_pair(void *arg, long iters)
+{
+        struct vidcap_ctx *c = arg;
+        long i;
+
+        for (i = 0; i < iters; i++)
+                packed_2x(c->uyvy + 1, c->uyvy2 + 1, RAW_W * 2,
+                          VIDCAP_POOL_MAX, OUT_W, OUT_H, c->gray, OUT_W);
+        __asm__ __volatile__("" : : "r"(c->gray) : "memory");
+}
+
+static void run_convert_rois(void *arg, long iters)
+{
+        struct vidcap_ctx *c = arg;
+        long i;
+
+        for (i = 0; i < iters; i++)
+                convert_rois(c->uyvy + 1, NULL);
+        __asm__ __volatile__("" : : "r"(c->gray) : "memory");
+}
+
+void bench_vidcap(void)
+{
+        struct vidcap_ctx c;
+
+        int i;
+        long bytes = 0;
+
+        if (!bench_selected("vidcap_uyvy_to_gray") &&
+            !bench_selected("vidcap_uyvy_pair_max") &&
+            !bench_selected("vidcap_uyvy_rois"))
+                return;
+        c.uyvy = malloc(RAW_W * RAW_H * 2);
+        c.uyvy2 = malloc(RAW_W * RAW_H * 2);
+        c.gray = malloc(RAW_W / 2 * RAW_H / 2);
+        if (NULL == c.uyvy || NULL == c.uyvy2 || NULL == c.gray) {
+                bench_skip("vidcap_uyvy_to_gray", "out of memory");
+                bench_skip("vidcap_uyvy_pair_max", "out of memory");
+                bench_skip("vidcap_uyvy_rois", "out of memory");
+        } else {
+                make_fixture(c.uyvy, bench_opt.seed);
+                make_fixture(c.uyvy2, bench_opt.seed + 1);
+                bench_run("vidcap_uyvy_to_gray", run_convert, &c, RAW_W * RAW_H * 2);
+                bench_run("vidcap_uyvy_pair_max", run_convert_pair, &c,
+                          2 * RAW_W * RAW_H * 2);
+
+                /* each region at its place in the frame, as in gameenv */
+                for (i = 0; i < N_GALAGA_ROIS; i++) {
+                        const int *r = galaga_rois[i];
+
+                        vidcap_set_roi(i, r[0], r[1], r[2], r[3], 1,
+                                       c.gray + (r[0] - 1) * OUT_W + r[2] - 1, OUT_W);
+                        bytes += (r[1] - r[0] + 1) * 2 * (r[3] - r[2] + 1) * 2 * 2;
+                }
+                /* the source bytes of the regions (8 per output pixel) */
+                bench_run("vidcap_uyvy_rois", run_convert_rois, &c, bytes);
+                vidcap_clear_rois();
+        }
+        free(c.uyvy);
+        free(c.uyvy2);
+        free(c.gray);
+}
@@ -0,0 +1,243 @@
+/*
+ *  ckpt.c
+ *
+ *  DESCRIPTION:
+ *
+ *  Asynchronous checkpoint writer for the DQN parameters, used by
+ *  ckpt/ckpt.lua through Lua FFI.
+ *
+ *  ckpt_save() only copies the parameters into a buffer preallocated by
+ *  ckpt_create(), and hands it to a background thread, which writes the
+ *  checkpoint to "<path>.tmp", syncs it to disk and renames it to <path>.
+ *  So the caller (the training loop) is held up only by a memcpy, and a
+ *  checkpoint file is either complete or absent, never half written.
+ *
+ *  A checkpoint file holds the flat parameter vector (as returned by
+ *  getParameters() in Torch) after a small header (struct ckpt_header in
+ *  ckpt.h), which names the file with the structure of the network.
+ *
+ *  PROCESS:
+ *
+ *  struct ckpt *ckpt_create(long count);
+ *  int   ckpt_save(c, const float *params, long long steps,
+ *                  const char *path, const char *model);
+ *  int   ckpt_wait(c);
+ *  void  ckpt_destroy(c);
+ *  int   ckpt_read_header(const char *path, struct ckpt_header *h);
+ *  int   ckpt_load(const char *path, float *params, long count);
+ *
+ *  GLOBALS: none
+ *
+ *  REFERENCE:
+ *
+ *  LIMITATIONS:
+ *
+ *  1. Only 1 checkpoint is written at a time. ckpt_save() waits for the
+ *     previous one to finish.
+ *  2. The parameters are stored in host byte order.
+ *
+ *  REVISION HISTORY:
+ *
+ *    Date             Description                                   Author
+ *    2026-10-18       initial coding                                agent
+ *
+ *  TARGET: Linux C
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "ckpt.h"
+#include "../metrics/metrics.h"
+
+#define PATH_LEN 1024
+
+struct ckpt {
+        long                count;
+        float              *buf;        /* snapshot of the parameters */
+        struct ckpt_header  header;
+        char                path[PATH_LEN];
+
+        pthread_t           thread;
+        pthread_mutex_t     lock;
+        pthread_cond_t      cond;
+        int                 pending;    /* a snapshot is waiting to be written */
+        int                 quit;
+        int                 result;     /* of the last write, 0 or -1 */
+        int                 m_write;    /* checkpoint_write histogram */
+};
+
+/* write the snapshot to "<path>.tmp", then rename it to <path> */
+static int write_file(struct ckpt *c)
+{
+        char tmp[PATH_LEN + 8];
+        FILE *fp;
+        int ok;
+
+        snprintf(tmp, sizeof(tmp), "%s.tmp", c->path);
+        fp = fopen(tmp, "wb");
+        if (NULL == fp)
+                return -1;
+        ok = fwrite(&c->header, sizeof(c->header), 1, fp) == 1 &&
+             fwrite(c->buf, sizeof(float), c->count, fp) == (size_t) c->count &&
+             fflush(fp) == 0 && fsync(fileno(fp)) == 0;
+        if (fclose(fp) != 0)
+                ok = 0;
+        if (!ok || rename(tmp, c->path) != 0) {
+                unlink(tmp);
+                return -1;
+        }
+        return 0;
+}
+
+static void *writer_thread(void *arg)
+{
+        struct ckpt *c = arg;
+        double t;
+        int r;
+
+        pthread_mutex_lock(&c->lock);
+        while (1) {
+                while (!c->pending && !c->quit)
+                        pthread_cond_wait(&c->cond, &c->lock);
+                if (!c->pending)
+                        break;  /* quit, with nothing left to write */
+                /* the snapshot is not touched by ckpt_save() while pending */
+                pthread_mutex_unlock(&c->lock);
+                t = metrics_now();
+                r = write_file(c);
+                metrics_record(c->m_write, metrics_now() - t);
+                pthread_mutex_lock(&c->lock);
+                c->result = r;
+                c->pending = 0;
+                pthread_cond_broadcast(&c->cond);
+        }
+        pthread_mutex_unlock(&c->lock);
+        return NULL;
+}
+
+/*
+ * API
+ */
+struct ckpt *ckpt_create(long count)
+{
+        struct ckpt *c;
+
+        if (count <= 0)
+                return NULL;
+        c = calloc(1, sizeof(*c));
+        if (NULL == c)
+                return NULL;
+        c->count = count;
+        c->m_write = metrics_histogram("checkpoint_write");
+        c->buf = malloc(count * sizeof(float));
+        if (NULL == c->buf) {
+                free(c);
+                return NULL;
+        }
+        pthread_mutex_init(&c->lock, NULL);
+        pthread_cond_init(&c->cond, NULL);
+        if (pthread_create(&c->thread, NULL, writer_thread, c) != 0) {
+                pthread_cond_destroy(&c->cond);
+                pthread_mutex_destroy(&c->lock);
+                free(c->buf);
+                free(c);
+                return NULL;
+        }
+        return c;
+}
+
+/*
+ * Snapshot 'count' parameters and queue them to be written to 'path'.
+ * 'model' names the file with the network structure (stored in the
+ * header). Returns -1 if the result of the previous write was a failure
+ * (the new snapshot is queued anyway).
+ */
+int ckpt_save(struct ckpt *c, const float *params, long long steps,
+              const char *path, const char *model)
+{
+        int r;
+
+        if (strlen(path) >= PATH_LEN || strlen(model) >= CKPT_MODEL_LEN)
+                return -1;
+        pthread_mutex_lock(&c->lock);
+        while (c->pending)
+                pthread_cond_wait(&c->cond, &c->lock);
+        r = c->result;
+        memcpy(c->buf, params, c->count * sizeof(float));
+        memset(&c->header, 0, sizeof(c->header));
+        memcpy(c->header.magic, CKPT_MAGIC, sizeof(c->header.magic));
+        c->header.count = c->count;
+        c->header.steps = steps;
+        strcpy(c->header.model, model);
+        strcpy(c->path, path);
+        c->pending = 1;
+        pthread_cond_broadcast(&c->cond);
+        pthread_mutex_unlock(&c->lock);
+        return r;
+}
+
+/* Wait for the queued write (if any), and return its result (0 or -1). */
+int ckpt_wait(struct ckpt *c)
+{
+        int r;
+
+        pthread_mutex_lock(&c->lock);
+        while (c->pending)
+                pthread_cond_wait(&c->cond, &c->lock);
+        r = c->result;
+        pthread_mutex_unlock(&c->lock);
+        return r;
+}
+
+/* Finish the queued write (if any) and free everything. */
+void ckpt_destroy(struct ckpt *c)
+{
+        if (NULL == c)
+                return;
+        pthread_mutex_lock(&c->lock);
+        c->quit = 1;
+        pthread_cond_broadcast(&c->cond);
+        pthread_mutex_unlock(&c->lock);
+        pthread_join(c->thread, NULL);
+        pthread_cond_destroy(&c->cond);
+        pthread_mutex_destroy(&c->lock);
+        free(c->buf);
+        free(c);
+}
+
+int ckpt_read_header(const char *path, struct ckpt_header *h)
+{
+        FILE *fp = fopen(path, "rb");
+        int ok;
+
+        if (NULL == fp)
+                return -1;
+        ok = fread(h, sizeof(*h), 1, fp) == 1 &&
+             memcmp(h->magic, CKPT_MAGIC, sizeof(h->magic)) == 0;
+        fclose(fp);
+        if (!ok)
+                return -1;
+        h->model[CKPT_MODEL_LEN - 1] = '\0';
+        return 0;
+}
+
+/* Read the parameters of checkpoint 'path', which must have 'count' of them. */
+int ckpt_load(const char *path, float *params, long count)
+{
+        struct ckpt_header h;
+        FILE *fp = fopen(path, "rb");
+        int ok;
+
+        if (NULL == fp)
+                return -1;
+        ok = fread(&h, sizeof(h), 1, fp) == 1 &&
+             memcmp(h.magic, CKPT_MAGIC, sizeof(h.magic)) == 0 &&
+             h.count == count &&
+             fread(params, sizeof(float), count, fp) == (size_t) count;
+        fclose(fp);
+        return ok ? 0 : -1;
+}
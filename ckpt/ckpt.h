@@ -0,0 +1,37 @@
+/*
+ * ckpt.h
+ */
+
+#ifndef CKPT_H_
+#define CKPT_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CKPT_MAGIC      "DQNCKPT1"
+#define CKPT_MODEL_LEN  256
+
+/* file header, followed by 'count' floats of parameters */
+struct ckpt_header {
+        char magic[8];
+        long long count;                /* number of parameters */
+        long long steps;                /* training steps at the snapshot */
+        char model[CKPT_MODEL_LEN];     /* file with the network structure */
+};
+
+struct ckpt;
+
+extern struct ckpt *ckpt_create(long count);
+extern int   ckpt_save(struct ckpt *c, const float *params, long long steps,
+                       const char *path, const char *model);
+extern int   ckpt_wait(struct ckpt *c);
+extern void  ckpt_destroy(struct ckpt *c);
+extern int   ckpt_read_header(const char *path, struct ckpt_header *h);
+extern int   ckpt_load(const char *path, float *params, long count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CKPT_H_ */
@@ -0,0 +1,116 @@
+--------------------------------------------------------------------------------
+--
+-- "ckpt" module
+--
+-- This module exposes the asynchronous checkpoint writer (libckpt.so)
+-- through FFI. The structure of the network is saved once (torch.save),
+-- and every checkpoint after that is just a snapshot of its flat parameter
+-- tensor, written to disk by a background thread; see ckpt.c for details.
+--
+--------------------------------------------------------------------------------
+-- agent, 2026-10-18
+--------------------------------------------------------------------------------
+
+require 'torch'
+require 'paths'
+
+local ffi = require 'ffi'
+local metrics = require 'metrics/metrics'
+local ckpt = {}
+local lib = ffi.load(paths.cwd() .. '/ckpt/libckpt.so')
+local M_SAVE = metrics.histogram('checkpoint_save')
+
+-- Function prototype definition
+ffi.cdef [[
+    struct ckpt_header {
+        char magic[8];
+        long long count;
+        long long steps;
+        char model[256];
+    };
+
+    struct ckpt;
+    struct ckpt *ckpt_create(long count);
+    int   ckpt_save(struct ckpt *c, const float *params, long long steps,
+                    const char *path, const char *model);
+    int   ckpt_wait(struct ckpt *c);
+    void  ckpt_destroy(struct ckpt *c);
+    int   ckpt_read_header(const char *path, struct ckpt_header *h);
+    int   ckpt_load(const char *path, float *params, long count);
+]]
+
+local Writer = {}
+Writer.__index = Writer
+
+-- Create a checkpoint writer for 'network', whose flat parameter tensor
+-- (as returned by getParameters()) is 'w'. The structure of the network
+-- (with its current weights) is saved to 'model_path' right away, along
+-- with 'arguments' (e.g. the training options).
+function ckpt.writer(network, w, model_path, arguments)
+    torch.save(model_path, {model = network, arguments = arguments})
+
+    local c = lib.ckpt_create(w:nElement())
+    assert(c ~= nil, 'ckpt_create() failed')
+
+    local self = setmetatable({}, Writer)
+    self.c = ffi.gc(c, lib.ckpt_destroy)
+    self.w = w
+    self.model_path = model_path
+    if w:type() ~= 'torch.FloatTensor' or not w:isContiguous() then
+        -- e.g. CUDA parameters are staged through host memory
+        self.host = torch.FloatTensor(w:nElement())
+    end
+    return self
+end
+
+-- Snapshot the parameters and have them written to 'path' in the
+-- background. 'steps' is stored along with them.
+function Writer:save(path, steps)
+    local t = metrics.now()
+    local src = self.w
+    if self.host then src = self.host:copy(self.w) end
+    if lib.ckpt_save(self.c, torch.data(src), steps or 0, path,
+                     self.model_path) ~= 0 then
+        print('ckpt: failed to write the previous checkpoint')
+    end
+    metrics.record(M_SAVE, metrics.now() - t)
+end
+
+-- Wait for the last checkpoint to be written. Returns true on success.
+function Writer:wait()
+    return lib.ckpt_wait(self.c) == 0
+end
+
+-- Finish writing and release the writer.
+function Writer:close()
+    if not self.c then return end
+    local ok = self:wait()
+    lib.ckpt_destroy(ffi.gc(self.c, nil))
+    self.c = nil
+    return ok
+end
+
+-- Load checkpoint 'path'. Returns {model = network, steps = steps}, in
+-- the same form as the table saved by train-deepmind.lua before (so
+-- NeuralQLearner could load it).
+function ckpt.load(path)
+    local h = ffi.new('struct ckpt_header')
+    assert(lib.ckpt_read_header(path, h) == 0, 'not a checkpoint: ' .. path)
+
+    -- the model file is looked for next to the checkpoint as well
+    local model_path = ffi.string(h.model)
+    if not paths.filep(model_path) then
+        model_path = paths.concat(paths.dirname(path), paths.basename(model_path))
+    end
+    local model = torch.load(model_path).model
+
+    local w = model:getParameters()
+    local dst = w
+    if w:type() ~= 'torch.FloatTensor' then dst = torch.FloatTensor(w:nElement()) end
+    assert(lib.ckpt_load(path, torch.data(dst), dst:nElement()) == 0,
+           'checkpoint does not match ' .. model_path)
+    if dst ~= w then w:copy(dst) end
+    return {model = model, steps = tonumber(h.steps)}
+end
+
+return ckpt
@@ -0,0 +1,288 @@
+/*
+ *  dataset.c
+ *
+ *  DESCRIPTION:
+ *
+ *  Recorded transition datasets, for training the DQN offline (see
+ *  train-offline.lua), used by dataset/dataset.lua through Lua FFI.
+ *
+ *  A dataset file holds the transitions of one actor, in the order they
+ *  were played, in the format of the replay memory (TransitionTable): the
+ *  preprocessed 84x84 frame (as bytes), the action taken, the reward and
+ *  the terminal flag of every step; episodes follow each other, separated
+ *  by the terminal flags. Records have a fixed size (struct
+ *  dataset_header in dataset.h), so the file is compact (7064 bytes per
+ *  step) and record i is found by its offset.
+ *
+ *  Writers append to the file through a large stdio buffer. The number of
+ *  records is not stored but follows from the size of the file, so a file
+ *  left by a crashed writer is still valid: a partial last record is cut
+ *  off when the file is opened for writing again.
+ *
+ *  Readers map the whole file (mmap), so records are read in place
+ *  without copies or read() calls, and datasets larger than memory are
+ *  streamed by the page cache. The mapping is advised as sequential, and
+ *  the window ahead of the record being read is prefetched (WILLNEED) as
+ *  the reader advances, so that the consumer rarely waits for the disk.
+ *
+ *  PROCESS:
+ *
+ *  struct dataset_writer *dataset_writer_open(path, int frame_size, int n_actions);
+ *  int   dataset_write(w, const unsigned char *frame, int action, float reward,
+ *                      int terminal);
+ *  int   dataset_flush(w);
+ *  int   dataset_writer_close(w);
+ *
+ *  struct dataset *dataset_open(const char *path);
+ *  long  dataset_count(d);
+ *  int   dataset_frame_size(d);
+ *  int   dataset_n_actions(d);
+ *  const unsigned char *dataset_record(d, long i, int *action, float *reward,
+ *                                      int *terminal);
+ *  void  dataset_close(d);
+ *
+ *  GLOBALS: none
+ *
+ *  REFERENCE:
+ *
+ *  LIMITATIONS:
+ *
+ *  1. Rewards are stored in host byte order.
+ *  2. A file must not be written while it is mapped by a reader (the
+ *     reader only sees the records written before dataset_open()).
+ *
+ *  REVISION HISTORY:
+ *
+ *    Date             Description                                   Author
+ *    2026-10-18       initial coding                                agent
+ *
+ *  TARGET: Linux C
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "dataset.h"
+
+#define WRITE_BUF   (4 << 20)
+#define WINDOW      (16 << 20)  /* bytes prefetched ahead of the reader */
+
+struct dataset_writer {
+        FILE          *fp;
+        int            frame_size;
+        int            record_size;
+        unsigned char *record;
+};
+
+struct dataset {
+        unsigned char *base;
+        size_t         size;
+        long           count;
+        int            frame_size;
+        int            n_actions;
+        int            record_size;
+        size_t         ahead;   /* prefetched up to this offset */
+        long           page;
+};
+
+static int record_size_of(int frame_size)
+{
+        return ((frame_size + 2 + 3) & ~3) + (int) sizeof(float);
+}
+
+static int valid_header(const struct dataset_header *h)
+{
+        return memcmp(h->magic, DATASET_MAGIC, sizeof(h->magic)) == 0 &&
+               h->frame_size > 0 && h->n_actions > 0 && h->n_actions <= 255 &&
+               h->record_size == record_size_of(h->frame_size);
+}
+
+/*
+ * Writer API
+ */
+
+/* Open 'path' for appending records, creating it if needed; an existing
+ * file must have the same frame size and number of actions. */
+struct dataset_writer *dataset_writer_open(const char *path, int frame_size,
+                                           int n_actions)
+{
+        struct dataset_writer *w;
+        struct dataset_header h;
+        struct stat st;
+        off_t end;
+        int fd;
+
+        if (frame_size <= 0 || n_actions <= 0 || n_actions > 255)
+                return NULL;
+        if ((fd = open(path, O_RDWR | O_CREAT, 0644)) < 0)
+                return NULL;
+        if (fstat(fd, &st) < 0)
+                goto fail;
+        if (st.st_size < (off_t) sizeof(h)) {
+                /* new (or only partly created) file */
+                memset(&h, 0, sizeof(h));
+                memcpy(h.magic, DATASET_MAGIC, sizeof(h.magic));
+                h.frame_size = frame_size;
+                h.n_actions = n_actions;
+                h.record_size = record_size_of(frame_size);
+                if (ftruncate(fd, 0) < 0 ||
+                    pwrite(fd, &h, sizeof(h), 0) != (ssize_t) sizeof(h))
+                        goto fail;
+                end = sizeof(h);
+        } else {
+                if (pread(fd, &h, sizeof(h), 0) != (ssize_t) sizeof(h) ||
+                    !valid_header(&h) || h.frame_size != frame_size ||
+                    h.n_actions != n_actions)
+                        goto fail;
+                /* cut off a partial record (of a crashed writer) */
+                end = sizeof(h) + (st.st_size - sizeof(h)) / h.record_size * h.record_size;
+                if (end != st.st_size && ftruncate(fd, end) < 0)
+                        goto fail;
+        }
+        if (lseek(fd, end, SEEK_SET) != end)
+                goto fail;
+
+        w = calloc(1, sizeof(*w));
+        if (NULL == w)
+                goto fail;
+        w->frame_size = frame_size;
+        w->record_size = h.record_size;
+        w->record = calloc(1, h.record_size);
+        w->fp = fdopen(fd, "w");
+        if (NULL == w->record || NULL == w->fp) {
+                free(w->record);
+                free(w);
+                goto fail;
+        }
+        setvbuf(w->fp, NULL, _IOFBF, WRITE_BUF);
+        return w;
+fail:
+        close(fd);
+        return NULL;
+}
+
+/* Append 1 record; 'action' is 1-based. Returns 0, or -1 on error. */
+int dataset_write(struct dataset_writer *w, const unsigned char *frame,
+                  int action, float reward, int terminal)
+{
+        unsigned char *r = w->record;
+
+        if (action < 0 || action > 255)
+                return -1;
+        memcpy(r, frame, w->frame_size);
+        r[w->frame_size] = (unsigned char) action;
+        r[w->frame_size + 1] = terminal ? 1 : 0;
+        memcpy(r + w->record_size - sizeof(float), &reward, sizeof(float));
+        return fwrite(r, w->record_size, 1, w->fp) == 1 ? 0 : -1;
+}
+
+int dataset_flush(struct dataset_writer *w)
+{
+        return fflush(w->fp) == 0 ? 0 : -1;
+}
+
+int dataset_writer_close(struct dataset_writer *w)
+{
+        int r;
+
+        if (NULL == w)
+                return 0;
+        r = fclose(w->fp) == 0 ? 0 : -1;
+        free(w->record);
+        free(w);
+        return r;
+}
+
+/*
+ * Reader API
+ */
+struct dataset *dataset_open(const char *path)
+{
+        struct dataset *d;
+        struct dataset_header h;
+        struct stat st;
+        void *p;
+        int fd;
+
+        if ((fd = open(path, O_RDONLY)) < 0)
+                return NULL;
+        if (fstat(fd, &st) < 0 || st.st_size < (off_t) sizeof(h) ||
+            pread(fd, &h, sizeof(h), 0) != (ssize_t) sizeof(h) || !valid_header(&h)) {
+                close(fd);
+                return NULL;
+        }
+        p = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);      /* the mapping keeps the file */
+        if (MAP_FAILED == p)
+                return NULL;
+        d = calloc(1, sizeof(*d));
+        if (NULL == d) {
+                munmap(p, st.st_size);
+                return NULL;
+        }
+        d->base = p;
+        d->size = st.st_size;
+        d->frame_size = h.frame_size;
+        d->n_actions = h.n_actions;
+        d->record_size = h.record_size;
+        d->count = (st.st_size - sizeof(h)) / h.record_size;
+        d->page = sysconf(_SC_PAGESIZE);
+        madvise(d->base, d->size, MADV_SEQUENTIAL);
+        return d;
+}
+
+long dataset_count(const struct dataset *d)
+{
+        return d->count;
+}
+
+int dataset_frame_size(const struct dataset *d)
+{
+        return d->frame_size;
+}
+
+int dataset_n_actions(const struct dataset *d)
+{
+        return d->n_actions;
+}
+
+/*
+ * Return the frame of record 'i' (0-based; valid until dataset_close()),
+ * and its action, reward and terminal flag; NULL if 'i' is out of range.
+ */
+const unsigned char *dataset_record(struct dataset *d, long i, int *action,
+                                    float *reward, int *terminal)
+{
+        size_t off;
+        const unsigned char *r;
+
+        if (i < 0 || i >= d->count)
+                return NULL;
+        off = sizeof(struct dataset_header) + (size_t) i * d->record_size;
+        if (off + WINDOW / 2 > d->ahead && d->ahead < d->size) {
+                /* prefetch the next window */
+                size_t from = (off > d->ahead ? off : d->ahead) & ~(size_t) (d->page - 1);
+                size_t len = (from + WINDOW < d->size) ? WINDOW : d->size - from;
+
+                madvise(d->base + from, len, MADV_WILLNEED);
+                d->ahead = from + len;
+        }
+        r = d->base + off;
+        *action = r[d->frame_size];
+        *terminal = r[d->frame_size + 1];
+        memcpy(reward, r + d->record_size - sizeof(float), sizeof(float));
+        return r;
+}
+
+void dataset_close(struct dataset *d)
+{
+        if (NULL == d)
+                return;
+        munmap(d->base, d->size);
+        free(d);
+}
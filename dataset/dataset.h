@@ -0,0 +1,50 @@
+/*
+ * dataset.h
+ */
+
+#ifndef DATASET_H_
+#define DATASET_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DATASET_MAGIC   "DQNEPS01"
+
+/*
+ * A dataset file is this header, followed by records of 'record_size'
+ * bytes: the frame ('frame_size' bytes), the action (1 byte, 1-based),
+ * the terminal flag (1 byte), padding up to 4 bytes, and the reward (a
+ * float). The number of records follows from the size of the file.
+ */
+struct dataset_header {
+        char    magic[8];
+        int     frame_size;
+        int     n_actions;
+        int     record_size;
+        int     reserved[5];
+};
+
+struct dataset_writer;
+struct dataset;
+
+extern struct dataset_writer *dataset_writer_open(const char *path, int frame_size,
+                                                  int n_actions);
+extern int   dataset_write(struct dataset_writer *w, const unsigned char *frame,
+                           int action, float reward, int terminal);
+extern int   dataset_flush(struct dataset_writer *w);
+extern int   dataset_writer_close(struct dataset_writer *w);
+
+extern struct dataset *dataset_open(const char *path);
+extern long  dataset_count(const struct dataset *d);
+extern int   dataset_frame_size(const struct dataset *d);
+extern int   dataset_n_actions(const struct dataset *d);
+extern const unsigned char *dataset_record(struct dataset *d, long i, int *action,
+                                           float *reward, int *terminal);
+extern void  dataset_close(struct dataset *d);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DATASET_H_ */
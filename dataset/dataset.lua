@@ -0,0 +1,126 @@
+--------------------------------------------------------------------------------
+--
+-- "dataset" module
+--
+-- This module exposes the recorded transition datasets (libdataset.so)
+-- through FFI. A dataset file holds the steps played by one actor (frame,
+-- action, reward, terminal), in the format of the replay memory; it is
+-- written while training (train-deepmind.lua -record) and read back, by
+-- memory mapping, for offline training (train-offline.lua). See dataset.c
+-- for details.
+--
+-- Usage:
+--
+--   local dataset = require 'dataset/dataset'
+--   local w = dataset.writer('galaga_1.eps', 84 * 84, 6)
+--   w:add(frame, action, reward, terminal)   -- frame: ByteTensor(84 * 84)
+--   w:close()
+--
+--   local d = dataset.open('galaga_1.eps')
+--   local frame = torch.ByteTensor(d.frame_size)
+--   for i = 1, d.count do
+--       local action, reward, terminal = d:get(i, frame)
+--   end
+--   d:close()
+--
+--------------------------------------------------------------------------------
+-- agent, 2026-10-18
+--------------------------------------------------------------------------------
+
+require 'torch'
+
+local ffi = require 'ffi'
+local dataset = {}
+local lib = ffi.load(paths.cwd() .. '/dataset/libdataset.so')
+
+-- Function prototype definition
+ffi.cdef [[
+    struct dataset_writer;
+    struct dataset;
+    struct dataset_writer *dataset_writer_open(const char *path, int frame_size,
+                                               int n_actions);
+    int   dataset_write(struct dataset_writer *w, const unsigned char *frame,
+                        int action, float reward, int terminal);
+    int   dataset_flush(struct dataset_writer *w);
+    int   dataset_writer_close(struct dataset_writer *w);
+
+    struct dataset *dataset_open(const char *path);
+    long  dataset_count(const struct dataset *d);
+    int   dataset_frame_size(const struct dataset *d);
+    int   dataset_n_actions(const struct dataset *d);
+    const unsigned char *dataset_record(struct dataset *d, long i, int *action,
+                                        float *reward, int *terminal);
+    void  dataset_close(struct dataset *d);
+]]
+
+local Writer = {}
+Writer.__index = Writer
+
+-- Open 'path' for appending steps with frames of 'frame_size' bytes and
+-- 'n_actions' actions (an existing file must match them).
+function dataset.writer(path, frame_size, n_actions)
+    local w = lib.dataset_writer_open(path, frame_size, n_actions)
+    assert(w ~= nil, 'dataset: could not open ' .. path .. ' for writing')
+    local self = setmetatable({}, Writer)
+    self.w = ffi.gc(w, lib.dataset_writer_close)
+    self.path = path
+    self.frame_size = frame_size
+    return self
+end
+
+-- Append 1 step: 'frame' is a contiguous ByteTensor of frame_size bytes,
+-- 'action' is 1-based.
+function Writer:add(frame, action, reward, terminal)
+    assert(frame:type() == 'torch.ByteTensor' and frame:isContiguous() and
+           frame:nElement() == self.frame_size, 'dataset: bad frame')
+    assert(lib.dataset_write(self.w, torch.data(frame), action, reward,
+                             terminal and 1 or 0) == 0,
+           'dataset: write to ' .. self.path .. ' failed')
+end
+
+function Writer:flush()
+    return lib.dataset_flush(self.w) == 0
+end
+
+function Writer:close()
+    local ok = lib.dataset_writer_close(ffi.gc(self.w, nil)) == 0
+    self.w = nil
+    return ok
+end
+
+local Reader = {}
+Reader.__index = Reader
+
+-- Map dataset 'path' for reading. Returns nil if it is not a dataset.
+function dataset.open(path)
+    local d = lib.dataset_open(path)
+    if d == nil then return nil end
+    local self = setmetatable({}, Reader)
+    self.d = ffi.gc(d, lib.dataset_close)
+    self.path = path
+    self.count = tonumber(lib.dataset_count(d))
+    self.frame_size = lib.dataset_frame_size(d)
+    self.n_actions = lib.dataset_n_actions(d)
+    self.action = ffi.new('int[1]')
+    self.reward = ffi.new('float[1]')
+    self.terminal = ffi.new('int[1]')
+    return self
+end
+
+-- Copy the frame of step 'i' (1-based) into 'frame' (a contiguous
+-- ByteTensor of frame_size bytes), and return its action, reward and
+-- terminal flag.
+function Reader:get(i, frame)
+    local p = lib.dataset_record(self.d, i - 1, self.action, self.reward,
+                                 self.terminal)
+    assert(p ~= nil, 'dataset: step ' .. i .. ' out of range')
+    ffi.copy(torch.data(frame), p, self.frame_size)
+    return self.action[0], self.reward[0], self.terminal[0] ~= 0
+end
+
+function Reader:close()
+    lib.dataset_close(ffi.gc(self.d, nil))
+    self.d = nil
+end
+
+return dataset
@@ -0,0 +1,204 @@
+--------------------------------------------------------------------------------
+--
+-- ActorPool
+--
+-- Plays K games side by side with one NeuralQLearner agent. Each game
+-- environment (a module or object with the gameenv API) gets an "actor"
+-- of its own: a frame stack, the last state/action, and a lane of the
+-- agent's replay memory, so that the actors' episodes are never
+-- interleaved (the agent has to be created with 'actors' >= K).
+--
+-- Every step() advances all environments by 1 frame. The actors which
+-- have to decide on an action at this frame (every 'actrep' frames) are
+-- handled together: their current states are gathered into one
+-- (n, histLen, 84, 84) batch, evaluated by a single forward of the
+-- network (agent:act()), and the actions are scattered back to the
+-- environments. So the cost of a forward is shared by all environments
+-- instead of being paid by each of them.
+--
+-- Rewards of the repeated frames are summed up, and reported to the agent
+-- along with the next decision.
+--
+-- With 'testing_ep' set, the games are played for evaluation: actions are
+-- epsilon-greedy with that epsilon, and nothing is stored in the replay
+-- memory nor counted as agent steps (see eval-checkpoints.lua).
+--
+-- With 'learner' (a dqn.AsyncLearner), the time of the next decision is
+-- passed to learner:set_deadline() as soon as the current ones are made:
+-- the capture time of the frame due for it, from the environments which
+-- report capture times ('frame_time', see gameenv-threaded.lua and
+-- gameenv-native.lua), and the frame period (1/30 s, refined by the
+-- capture times). The deadline is cleared while a game restarts, as the
+-- learner could not hold up the actor then.
+--
+-- The decisions for the 1st environment are published as telemetry (see
+-- the "shmpub" module) while its frames are being published, i.e. when
+-- its display is on.
+--
+-- Usage:
+--
+--   local pool = dqn.ActorPool{agent = agent, envs = {env1, env2, ...},
+--                              actions = game_actions, actrep = 2,
+--                              learner = learner}
+--   while ... do
+--       local finished = pool:step()   -- games which have just ended
+--       ...
+--   end
+--
+--------------------------------------------------------------------------------
+-- agent, 2026-10-18
+--------------------------------------------------------------------------------
+
+require 'torch'
+
+local metrics = require 'metrics/metrics'
+local M_PERCEIVE = metrics.histogram('perceive')
+local trace = require 'trace/trace'
+local T_PERCEIVE = trace.name('perceive')
+local has_shmpub, shmpub = pcall(require, 'shmpub/shmpub')
+
+local ap = torch.class('dqn.ActorPool')
+
+
+function ap:__init(args)
+    self.agent   = args.agent
+    self.actions = args.actions
+    self.actrep  = args.actrep or 1
+    self.testing_ep = args.testing_ep  -- nil: training
+    self.learner = args.learner
+    self.frame_period = args.frame_period or 1/30  -- in seconds
+    assert(#args.envs <= self.agent.actors,
+           'the agent was created for fewer actors than environments')
+
+    self.decisions   = 0  -- number of actions chosen by the last step()
+    self.decide_time = 0  -- time spent choosing them, in seconds
+
+    self.actors = {}
+    for i, env in ipairs(args.envs) do
+        local a = self.agent:new_actor(i)
+        a.env = env
+        a.stats = torch.Tensor(#self.actions)  -- number of times each action is taken
+        self.actors[i] = a
+        self:new_game(a)
+    end
+end
+
+
+function ap:new_game(a)
+    a.games = (a.games or 0) + 1
+    a.env.new_game()
+    a.screen, a.reward, a.terminal = a.env.step(0)
+    a.frames = 0
+    a.stats:zero()
+    a.tic = torch.tic()
+end
+
+
+-- Advance every environment by 1 frame. Games which are over are restarted
+-- (before the frame), and returned as a list of
+-- {env, score, steps, time, stats}, where 'env' is the index of the
+-- environment, 'time' is the duration of the game in seconds and 'stats'
+-- counts the actions taken.
+function ap:step()
+    local agent, actors, actrep = self.agent, self.actors, self.actrep
+    local testing = self.testing_ep ~= nil
+    local finished = {}
+
+    for i, a in ipairs(actors) do
+        if a.terminal then
+            -- game is over; let the agent know about it
+            agent:observe(a, a.reward, a.screen, true, testing)
+            a.lastAction = 1
+            a.env.step(0)  -- release all buttons
+            finished[#finished + 1] = {
+                env = i, score = a.env.get_score(), steps = a.frames + 1,
+                time = torch.toc(a.tic), stats = a.stats:clone() }
+            if self.learner then self.learner:set_deadline(0) end
+            self:new_game(a)
+        end
+    end
+
+    -- choose actions for all actors due for a decision at once
+    local tic = torch.tic()
+    local t0 = trace.now()
+    local deciding, states = {}, {}
+    for _, a in ipairs(actors) do
+        if a.frames % actrep == 0 then
+            deciding[#deciding + 1] = a
+            states[#states + 1] = agent:observe(a, a.reward, a.screen, false, testing)
+            a.decided_reward = a.reward
+            a.reward = 0
+        end
+    end
+    if #deciding > 0 then
+        agent:act(deciding, states, self.testing_ep)
+    end
+    self.decisions = #deciding
+    self.decide_time = torch.toc(tic)
+    if #deciding > 0 then
+        metrics.record(M_PERCEIVE, self.decide_time)
+        trace.span(T_PERCEIVE, t0, nil, #deciding)  -- arg: batch size
+        if self.learner and not testing then
+            self.learner:set_deadline(self:next_deadline())
+        end
+    end
+
+    local a = actors[1]
+    if has_shmpub and a.frames % actrep == 0 and shmpub.is_open() then
+        shmpub.telemetry{step = agent.numSteps, game = a.games,
+                         score = a.env.get_score(), reward = a.decided_reward,
+                         action = a.lastAction, epsilon = agent.ep, q = a.lastQ}
+    end
+
+    for _, a in ipairs(actors) do
+        local screen, reward, terminal
+        if a.frames % actrep == 0 then
+            screen, reward, terminal = a.env.step(self.actions[a.lastAction])
+            a.stats[a.lastAction] = a.stats[a.lastAction] + 1
+        else
+            -- step() with no argument means take same action as previous
+            screen, reward, terminal = a.env.step()
+        end
+        a.screen, a.terminal = screen, terminal
+        a.reward = a.reward + reward
+        a.frames = a.frames + 1
+        self:track_period(a)
+    end
+
+    return finished
+end
+
+
+-- Refine the frame period by the capture times of consecutive frames
+-- (gaps of more than 2 periods, e.g. around a new game, are left out).
+function ap:track_period(a)
+    local t, prev = a.env.frame_time, a.frame_time
+    a.frame_time = t
+    if t and prev then
+        local d = t - prev
+        if d > 0 and d < 2 * self.frame_period then
+            self.frame_period = self.frame_period + (d - self.frame_period) / 16
+        end
+    end
+end
+
+
+-- The capture time of the next frame any actor has to decide on (0 if no
+-- environment reports capture times).
+function ap:next_deadline()
+    local deadline = math.huge
+    for _, a in ipairs(self.actors) do
+        if a.env.frame_time then
+            local n = self.actrep - a.frames % self.actrep
+            deadline = math.min(deadline,
+                                a.env.frame_time + n * self.frame_period)
+        end
+    end
+    return deadline < math.huge and deadline or 0
+end
+
+
+-- Number of environments in the pool.
+function ap:size()
+    return #self.actors
+end
@@ -0,0 +1,258 @@
+--------------------------------------------------------------------------------
+--
+-- AsyncLearner
+--
+-- Runs the Q-learning updates of a NeuralQLearner agent in a separate
+-- thread, so that the thread driving the game (the "actor", which calls
+-- agent:perceive()) no longer has to interleave training with gameplay.
+--
+-- The learner thread owns its own copy of the network, the target
+-- network and the RMSProp statistics. It samples from the actor's replay
+-- memory directly (the tensors are shared, not copied), and trains
+-- continuously, at most 'ratio' minibatch updates per agent step (0 means
+-- no limit) over the last 'window' steps. Every 'sync_freq' updates it
+-- publishes a snapshot of its weights; the actor picks up the latest
+-- snapshot when it calls sync(), and uses it for greedy action selection.
+--
+-- The updates are fitted in between the actor's decisions: the actor
+-- reports when it has to decide next by set_deadline() (dqn.ActorPool
+-- does), and the learner only starts an update which is predicted to end
+-- 'margin' seconds before that (see dqn.TrainScheduler).
+--
+-- The replay memory is protected by a mutex, which is held only while the
+-- actor adds a transition or the learner refills its sample buffer. The
+-- published weights are protected by another mutex.
+--
+-- Usage:
+--
+--   local learner = dqn.AsyncLearner{agent = agent, ratio = 0.25,
+--                                    sync_freq = 100, window = 1000,
+--                                    margin = 0.002}
+--   ... agent:perceive(...); learner:sync() ...
+--   learner:stop()
+--
+--------------------------------------------------------------------------------
+-- agent, 2026-10-18
+--------------------------------------------------------------------------------
+
+require 'torch'
+
+local threads = require 'threads'
+
+local al = torch.class('dqn.AsyncLearner')
+
+-- fields of the shared control tensor
+local STEPS, ENTRIES, INSERT, RMAX, STOP, UPDATES, VERSION = 1, 2, 3, 4, 5, 6, 7
+local DEADLINE, LATE = 8, 9
+
+
+function al:__init(args)
+    local agent = args.agent
+    self.agent     = agent
+    self.ratio     = args.ratio or 0
+    self.sync_freq = args.sync_freq or 100
+    self.window    = args.window or 1000
+    self.margin    = args.margin or 0.002
+    self.version   = 0
+
+    -- tensors and mutexes passed to the learner thread are shared with it
+    threads.Threads.serialization('threads.sharedserialize')
+
+    self.ctrl = torch.DoubleTensor(9):zero()
+    self.ctrl[RMAX] = agent.r_max
+    self.replay_mutex = threads.Mutex()
+    self.w_mutex = threads.Mutex()
+    self.pub_w = agent.w:clone()  -- the published weights
+
+    -- every transition added by the actor is published to the learner
+    local trans, ctrl, mutex = agent.transitions, self.ctrl, self.replay_mutex
+    local add = trans.add
+    trans.add = function (self, ...)
+        mutex:lock()
+        add(self, ...)
+        ctrl[ENTRIES] = self.numEntries
+        ctrl[INSERT] = self.insertIndex
+        mutex:unlock()
+    end
+
+    -- the target network is maintained by the learner
+    local target_q = agent.target_q
+    agent.target_q = nil
+    agent.target_network = nil
+    agent.target_w = nil
+
+    local cfg = {
+        minibatch_size = agent.minibatch_size, n_actions = agent.n_actions,
+        discount = agent.discount, rescale_r = agent.rescale_r,
+        clip_delta = agent.clip_delta, gpu = agent.gpu,
+        learn_start = agent.learn_start, wc = agent.wc, lr = agent.lr,
+        lr_start = agent.lr_start, lr_end = agent.lr_end,
+        lr_endt = agent.lr_endt, target_q = target_q, q_version = 0,
+    }
+    local tt = {
+        stateDim = trans.stateDim, numActions = trans.numActions,
+        histLen = trans.histLen, maxSize = trans.maxSize,
+        lanes = trans.lanes,
+        bufferSize = trans.bufferSize, nonTermProb = trans.nonTermProb,
+        gpu = agent.gpu, shared = trans:get_shared(),
+        arena = trans.arena_opts,
+    }
+    local network = agent.network:clone()
+    local pub_w, sync_freq = self.pub_w, self.sync_freq
+    local sched_args = {ratio = self.ratio, window = self.window,
+                        margin = self.margin, learn_start = agent.learn_start}
+    local replay_mutex_id, w_mutex_id = mutex:id(), self.w_mutex:id()
+    local tensor_type = torch.getdefaulttensortype()
+
+    self.thread = threads.Threads(1,
+        function ()
+            package.path = package.path .. ';./dqn-deepmind/?.lua'
+            require 'sys'
+            require 'initenv'
+            if cfg.gpu >= 0 then
+                require 'cutorch'
+                require 'cunn'
+                require 'cudnn'
+                cutorch.setDevice(cfg.gpu)
+            else
+                require 'nncpu/nncpu'
+            end
+            torch.setdefaulttensortype(tensor_type)
+        end)
+
+    self.thread:addjob(function ()
+        local replay_mutex = threads.Mutex(replay_mutex_id)
+        local w_mutex = threads.Mutex(w_mutex_id)
+        local metrics = require 'metrics/metrics'
+        local M_TRAIN_STEP = metrics.histogram('train_step')
+        require('trace/trace').thread_name('learner')
+
+        -- a NeuralQLearner with only the state qLearnMinibatch() needs
+        local l = torch.setmetatable(cfg, 'dqn.NeuralQLearner')
+        l.network = network
+        l.w, l.dw = network:getParameters()
+        l.dw:zero()
+        l.g  = l.dw:clone():zero()
+        l.g2 = l.dw:clone():zero()
+        if l.gpu >= 0 then
+            l.tmp = l.dw:clone():zero()
+        else
+            l.nncpu = require 'nncpu/nncpu'
+        end
+        local target_w
+        if l.target_q then
+            l.target_network = network:clone()
+            target_w = l.target_network:getParameters()
+        end
+        l.transitions = dqn.TransitionTable(tt)
+
+        -- the sample buffer is refilled with the replay memory locked,
+        -- after catching up with the actor's insertions
+        local fill_buffer = l.transitions.fill_buffer
+        l.transitions.fill_buffer = function (self)
+            replay_mutex:lock()
+            self.numEntries = ctrl[ENTRIES]
+            self.insertIndex = ctrl[INSERT]
+            fill_buffer(self)
+            replay_mutex:unlock()
+        end
+
+        local function publish()
+            w_mutex:lock()
+            pub_w:copy(l.w)
+            ctrl[VERSION] = ctrl[VERSION] + 1
+            w_mutex:unlock()
+        end
+
+        local sched = dqn.TrainScheduler(sched_args)
+        local updates, last_target = 0, l.learn_start
+        while ctrl[STOP] == 0 do
+            local steps = ctrl[STEPS]
+            local deadline = ctrl[DEADLINE]
+            local ok, wait = false, 0.001
+            if steps > l.learn_start and
+               ctrl[ENTRIES] >= math.max(tt.bufferSize, l.minibatch_size + 1) then
+                ok, wait = sched:ready(metrics.now(), steps, deadline)
+            end
+            if ok then
+                l.numSteps = steps
+                l.r_max = ctrl[RMAX]
+                l.transitions.numEntries = ctrl[ENTRIES]
+                local t = metrics.now()
+                l:qLearnMinibatch()
+                local t1 = metrics.now()
+                metrics.record(M_TRAIN_STEP, t1 - t)
+                sched:done(t, t1, deadline)
+                updates = updates + 1
+                ctrl[UPDATES] = updates
+                ctrl[LATE] = sched.late
+                if target_w and steps - last_target >= l.target_q then
+                    target_w:copy(l.w)
+                    last_target = steps
+                end
+                if updates % sync_freq == 0 then publish() end
+            else
+                sys.sleep(wait)
+            end
+        end
+        publish()
+    end)
+end
+
+
+-- Called by the actor after each agent:perceive(): reports the agent's
+-- progress to the learner, and loads the latest published weights (if
+-- any) into the agent's network. Returns true if new weights were loaded.
+function al:sync()
+    local agent, ctrl = self.agent, self.ctrl
+    ctrl[STEPS] = agent.numSteps
+    ctrl[RMAX] = agent.r_max
+    if ctrl[VERSION] == self.version then
+        return false
+    end
+
+    self.w_mutex:lock()
+    agent.w:copy(self.pub_w)
+    self.version = ctrl[VERSION]
+    self.w_mutex:unlock()
+    if agent.qnet then
+        agent.qnet:sync()
+        agent.qnet_stale = 0
+    end
+    agent:weights_changed()
+    return true
+end
+
+
+-- Called by the actor once it has decided: 'deadline' is when it has to
+-- decide next (metrics.now() clock), or 0 if unknown; no update is
+-- started which would still be running then.
+function al:set_deadline(deadline)
+    self.ctrl[DEADLINE] = deadline or 0
+end
+
+
+-- Total number of minibatch updates done by the learner so far.
+function al:updates()
+    return self.ctrl[UPDATES]
+end
+
+
+-- Number of minibatch updates which ended after the actor's deadline.
+function al:late()
+    return self.ctrl[LATE]
+end
+
+
+-- Stop the learner thread (after its current update), and load its final
+-- weights into the agent's network.
+function al:stop()
+    if not self.thread then return end
+    self.ctrl[STOP] = 1
+    self.thread:synchronize()
+    self.thread:terminate()
+    self.thread = nil
+    self:sync()
+    self.replay_mutex:free()
+    self.w_mutex:free()
+end
@@ -0,0 +1,66 @@
+--------------------------------------------------------------------------------
+--
+-- nn.ByteInput
+--
+-- The input layer of the Q-network: states are kept as gray levels
+-- (ByteTensor, 0-255) from the game environment through the frame stack
+-- and the replay memory to the minibatches, and only turned into floats
+-- here. It replaces the nn.Reshape at the front of the network: a batch
+-- of states (or a single one) is reshaped to (n, unpack(dims)), and
+-- scaled by 'scale' (1/255 for the [0, 1] input the network was trained
+-- with) into a tensor of the network's type.
+--
+-- On GPU, the states are copied to the device as bytes (a quarter of the
+-- floats), and converted there. On CPU, nncpu.convert() fuses this layer
+-- with the convolution after it ('fused'): the bytes are passed through,
+-- and the convolution converts them in its im2col, with the scale folded
+-- into its GEMM (see nncpu/conv.c); nncpu.qnet() folds the scale into
+-- the packed weights.
+--
+-- Float input (in gray levels as well) is accepted too, e.g. for the
+-- dummy forward of convnet.lua.
+--
+--------------------------------------------------------------------------------
+-- agent, 2026-10-18
+--------------------------------------------------------------------------------
+
+require 'nn'
+
+local bi, parent = torch.class('nn.ByteInput', 'nn.Module')
+
+
+function bi:__init(dims, scale)
+    parent.__init(self)
+    self.dims  = dims
+    self.scale = scale or 1/255
+    self.fused = false  -- set by nncpu.convert()
+    self.nelement = 1
+    for _, d in ipairs(dims) do self.nelement = self.nelement * d end
+    self.converted = self.output  -- of the network's type
+    self.gradInput = nil          -- the input is data
+end
+
+
+function bi:updateOutput(input)
+    local size = torch.LongStorage({input:nElement() / self.nelement,
+                                    unpack(self.dims)})
+    if self.fused and input:type() == 'torch.ByteTensor' then
+        self.output = input:contiguous():view(size)
+    else
+        self.output = self.converted:resize(size):copy(input):mul(self.scale)
+    end
+    return self.output
+end
+
+
+function bi:updateGradInput(input, gradOutput)
+    return nil
+end
+
+
+function bi:type(type, tensorCache)
+    self.output = self.converted
+    parent.type(self, type, tensorCache)
+    self.converted = self.output
+    return self
+end
@@ -0,0 +1,149 @@
+--------------------------------------------------------------------------------
+--
+-- FrameStack
+--
+-- A fixed-capacity circular stack of the most recent 'histLen' frames,
+-- used by TransitionTable to build the agent's current state for
+-- perceive(). It replaces the recent_s/recent_t tables, which cloned every
+-- frame and rebuilt the whole history stack (concatFrames) on each call.
+--
+-- All storage is allocated once. Each frame occupies 2 slots of a
+-- (2*histLen, stateDim) ByteTensor, at slot k and slot k+histLen, so the
+-- latest 'histLen' frames are always a contiguous window of the buffer,
+-- oldest first. A push() therefore writes only the new frame (plus its
+-- mirror copy), and get() returns a pre-built view of that window which
+-- could be fed to the network directly. Frames are kept in gray levels
+-- (0-255), as in the replay memory; the network scales them itself (see
+-- ByteInput.lua).
+--
+-- Episode boundaries are handled the same way as concatFrames() did: once
+-- a terminal frame has been pushed, all frames before the next one are
+-- zeroed out.
+--
+-- Only "linear" history with histSpacing 1 is supported.
+--
+-- A signature of every frame is also computed as it is pushed: the mean
+-- of every sigBlock x sigBlock block of pixels (12x12 means of 7x7 blocks
+-- for 84x84 frames), kept in the same double-slot layout, so signature()
+-- returns a fingerprint of the whole state as a view. The agent compares
+-- it against the last state evaluated, to skip the forward of the network
+-- on (nearly) identical states (see NeuralQLearner:greedy()). Frames
+-- which are not square, or not divisible in blocks, have no signature.
+--
+--------------------------------------------------------------------------------
+-- agent, 2026-10-18
+--------------------------------------------------------------------------------
+
+require 'torch'
+
+local fs = torch.class('dqn.FrameStack')
+
+
+function fs:__init(args)
+    self.histLen    = args.histLen
+    self.stateDim   = args.stateDim
+    self.zeroFrames = args.zeroFrames or 1
+    self.sigBlock   = args.sigBlock or 7
+
+    local histLen, stateDim = self.histLen, self.stateDim
+
+    self.buf   = torch.ByteTensor(2*histLen, stateDim):zero()
+    self.tmp   = torch.FloatTensor(stateDim)
+
+    -- pre-built views, so that push() and get() do not create new tensors
+    self.slots = {}
+    for i = 1, 2*histLen do
+        self.slots[i] = self.buf[i]
+    end
+    self.windows = {}
+    local size = torch.LongStorage({1, histLen, stateDim})
+    for p = 1, histLen do
+        self.windows[p] = torch.ByteTensor(self.buf:storage(),
+                                           p*stateDim + 1, size)
+    end
+
+    -- signatures, in gray levels (0-255)
+    local side, b = math.floor(math.sqrt(stateDim) + 0.5), self.sigBlock
+    if side * side == stateDim and side % b == 0 then
+        local g = side / b
+        self.sigDim = g * g
+        self.sigBuf = torch.FloatTensor(2*histLen, self.sigDim):zero()
+        self.sigSum = torch.FloatTensor(g, b, g, 1)
+        self.sigSlots, self.sigWindows = {}, {}
+        for i = 1, 2*histLen do
+            self.sigSlots[i] = self.sigBuf[i]:view(g, 1, g, 1)
+        end
+        for p = 1, histLen do
+            self.sigWindows[p] = torch.FloatTensor(self.sigBuf:storage(),
+                                                   p*self.sigDim + 1,
+                                                   torch.LongStorage({histLen*self.sigDim}))
+        end
+        self.sigScale = 1 / (b * b)
+    end
+
+    self:reset()
+end
+
+
+-- Forget all frames, as if a terminal frame had just been pushed.
+function fs:reset()
+    self.buf:zero()
+    if self.sigBuf then self.sigBuf:zero() end
+    self.pos = self.histLen
+    self.lastTerm = true
+end
+
+
+-- Push a new frame 's' (ByteTensor of stateDim elements in gray levels,
+-- or FloatTensor in [0,1), which is quantized the same way the replay
+-- memory used to). 'term' tells whether 's' is a terminal frame.
+function fs:push(s, term)
+    if self.lastTerm and self.zeroFrames ~= 0 then
+        -- frames from the previous episode are no longer visible
+        self.buf:zero()
+        if self.sigBuf then self.sigBuf:zero() end
+    end
+
+    local pos = self.pos % self.histLen + 1
+    local slot = self.slots[pos]
+    if s:type() == 'torch.ByteTensor' then
+        slot:copy(s)
+    else
+        slot:copy(self.tmp:copy(s):mul(255))
+    end
+    self.slots[pos + self.histLen]:copy(slot)
+
+    if self.sigBuf then
+        -- block sums, over columns then rows, scaled to mean gray levels
+        local g, b = self.sigSum:size(1), self.sigBlock
+        local sig = self.sigSlots[pos]
+        torch.sum(self.sigSum, self.tmp:copy(slot):view(g, b, g, b), 4)
+        torch.sum(sig, self.sigSum, 2)
+        sig:mul(self.sigScale)
+        self.sigSlots[pos + self.histLen]:copy(sig)
+    end
+
+    self.pos = pos
+    self.lastTerm = term and true or false
+end
+
+
+-- Return the current (1, histLen, stateDim) state. The returned tensor is
+-- a view into the stack and is only valid until the next push().
+function fs:get()
+    return self.windows[self.pos]
+end
+
+
+-- Return the signature of the current state (a FloatTensor of
+-- histLen * sigDim elements, valid until the next push()), or nil if the
+-- frames have no signature.
+function fs:signature()
+    return self.sigWindows and self.sigWindows[self.pos]
+end
+
+
+-- Return the latest frame as a ByteTensor (valid until the next push()).
+function fs:get_frame()
+    return self.slots[self.pos]
+end
@@ -10,6 +10,27 @@ end
 
 local nql = torch.class('dqn.NeuralQLearner')
 
+local metrics = require 'metrics/metrics'
+local M_PREPROCESS = metrics.histogram('preprocess')
+local M_PERCEIVE = metrics.histogram('perceive')
+local trace = require 'trace/trace'
+local T_PERCEIVE = trace.name('perceive')
+local T_QLEARN = trace.name('qLearnMinibatch')
+local M_MEMO_HIT = metrics.counter('greedy_memo_hit')
+local M_MEMO_MISS = metrics.counter('greedy_memo_miss')
+
+
+-- Networks saved before nn.ByteInput take [0, 1] floats through an
+-- nn.Reshape in front: swap it for an nn.ByteInput of the same shape, so
+-- that they take gray levels like the new ones.
+local function byte_input(net)
+    local m = net.modules and net.modules[1]
+    if m and torch.typename(m) == 'nn.Reshape' then
+        net.modules[1] = nn.ByteInput(m.size:totable(), 1/255)
+    end
+    return net
+end
+
 
 function nql:__init(args)
     self.state_dim  = args.state_dim -- State dimensionality.
@@ -35,8 +56,11 @@ function nql:__init(args)
 
     --- Q-learning parameters
     self.discount       = args.discount or 0.99 --Discount factor.
-    self.update_freq    = args.update_freq or 2
-    assert(self.update_freq > 1)
+    -- update_freq is no longer used: the updates are paced by the learner
+    -- thread (-train_ratio, see dqn.AsyncLearner)
+    if args.update_freq then
+        print('NeuralQLearner: update_freq is ignored, use -train_ratio instead')
+    end
     -- Number of points to replay per learning step.
     self.n_replay       = args.n_replay or 1
     -- Number of steps after which learning starts.
@@ -53,6 +77,21 @@ function nql:__init(args)
 
     self.gpu            = args.gpu
     self.cudnn          = args.cudnn
+    -- CPU inference engine for greedy() when not using GPU: 'fp32', 'fp16',
+    -- 'int8' (precision of the fully connected weights) or 'none'
+    self.cpu_infer      = args.cpu_infer or 'fp32'
+    -- refresh the inference engine's weights after this many updates
+    self.cpu_infer_sync = args.cpu_infer_sync or 1
+    -- train the convolution layers with nncpu's threaded kernels when not
+    -- using GPU (set to 0 to keep the default nn implementation)
+    self.cpu_train      = (args.cpu_train or 1) ~= 0
+    -- greedy() reuses the Q-values of an actor's previous state if the
+    -- weights have not changed since and the state is the same: 0 for
+    -- identical frames, or a tolerance (in gray levels) on the frame
+    -- signatures (block means, see dqn.FrameStack), which also reuses
+    -- them for small changes within a block; negative to always run the
+    -- network
+    self.memo_tol       = args.memo_tol or 0
 
     self.ncols          = args.ncols or 1  -- number of color channels in input
     self.input_dims     = args.input_dims or {self.hist_len*self.ncols, 84, 84}
@@ -61,6 +100,13 @@ function nql:__init(args)
     self.histSpacing    = args.histSpacing or 1
     self.nonTermProb    = args.nonTermProb or 1
     self.bufferSize     = args.bufferSize or 512
+    -- huge page arena for the replay memory: 'thp', 'hugetlb' or nil (the
+    -- heap), and whether to lock it in memory (see arena/arena.lua)
+    self.arena          = args.arena
+    self.arena_lock     = args.arena_lock
+    -- number of actors (environments) feeding the replay memory, each
+    -- gets a lane of its own (see dqn.ActorPool)
+    self.actors         = args.actors or 1
 
     self.transition_params = args.transition_params or {}
 
@@ -75,8 +121,15 @@ function nql:__init(args)
 
     local msg, err = pcall(require, self.network)
     if not msg then
-        -- try to load saved agent
-        local err_msg, exp = pcall(torch.load, self.network)
+        -- try to load saved agent (networks trained on CPU may contain
+        -- nn.CPUSpatialConvolution, which is defined by the nncpu module)
+        pcall(require, 'nncpu/nncpu')
+        local load = torch.load
+        if self.network:match('%.ckpt$') then
+            -- parameters saved by train-deepmind.lua (see ckpt/ckpt.lua)
+            load = require('ckpt/ckpt').load
+        end
+        local err_msg, exp = pcall(load, self.network)
         if not err_msg then
             error("Could not find network file ")
         end
@@ -90,6 +143,7 @@ function nql:__init(args)
         self.network = err
         self.network = self:network()
     end
+    byte_input(self.network)
 
     if self.gpu and self.gpu >= 0 then
         self.network:cuda()
@@ -101,6 +155,11 @@ function nql:__init(args)
         end
     else
         self.network:float()
+        self.nncpu = require 'nncpu/nncpu'
+        if self.cpu_train then
+            self.nncpu.convert(self.network, 'nncpu')
+            print('*** Using nncpu convolution ***')
+        end
     end
 
     -- Load preprocessing network.
@@ -124,19 +183,23 @@ function nql:__init(args)
     end
 
     -- Create transition table.
-    ---- assuming the transition table always gets floating point input
-    ---- (Foat or Cuda tensors) and always returns one of the two, as required
-    ---- internally it always uses ByteTensors for states, scaling and
-    ---- converting accordingly
+    ---- states are ByteTensors (gray levels) all the way, from the game
+    ---- environment to the minibatches, and only turned into floats by the
+    ---- nn.ByteInput layer of the network
     local transition_args = {
         stateDim = self.state_dim, numActions = self.n_actions,
         histLen = self.hist_len, gpu = self.gpu,
         maxSize = self.replay_memory, histType = self.histType,
         histSpacing = self.histSpacing, nonTermProb = self.nonTermProb,
-        bufferSize = self.bufferSize
+        bufferSize = self.bufferSize, lanes = self.actors,
+        arena = self.arena and {huge = self.arena,
+                                lock = (self.arena_lock or 0) ~= 0}
     }
 
     self.transitions = dqn.TransitionTable(transition_args)
+    -- perceive() acts as an actor of its own (see observe()), in lane 1
+    self.recent = self.transitions.recent
+    self.lane = 1
 
     self.numSteps = 0 -- Number of perceived states.
     self.lastState = nil
@@ -146,18 +209,28 @@ function nql:__init(args)
 
     self.q_max = 1
     self.r_max = 1
+    self.q_version = 0  -- bumped whenever greedy Q-values may change
 
     self.w, self.dw = self.network:getParameters()
     self.dw:zero()
 
-    self.deltas = self.dw:clone():fill(0)
-
-    self.tmp= self.dw:clone():fill(0)
     self.g  = self.dw:clone():fill(0)
     self.g2 = self.dw:clone():fill(0)
 
+    if self.gpu and self.gpu >= 0 then
+        self.tmp = self.dw:clone():fill(0)
+    else
+        -- RMSProp is done by a single fused pass over w/dw/g/g2 on CPU
+        if self.cpu_infer ~= 'none' then
+            self.qnet = self.nncpu.qnet(self.network, self.input_dims,
+                                        self.cpu_infer)
+            self.qnet_stale = 0  -- number of updates not yet in self.qnet
+        end
+    end
+
     if self.target_q then
         self.target_network = self.network:clone()
+        self.target_w = self.target_network:getParameters()
     end
 end
 
@@ -167,18 +240,37 @@ function nql:reset(state)
         return
     end
     self.best_network = state.best_network
-    self.network = state.model
+    self.network = byte_input(state.model)
+    if self.nncpu and self.cpu_train then
+        self.nncpu.convert(self.network, 'nncpu')
+    end
     self.w, self.dw = self.network:getParameters()
     self.dw:zero()
+    if self.qnet then
+        self.qnet = self.nncpu.qnet(self.network, self.input_dims,
+                                    self.cpu_infer)
+        self.qnet_stale = 0
+    end
+    if self.target_q then
+        self.target_network = self.network:clone()
+        self.target_w = self.target_network:getParameters()
+    end
     self.numSteps = 0
+    self:weights_changed()
     print("RESET STATE SUCCESFULLY")
 end
 
 
 function nql:preprocess(rawstate)
+    -- Note the returned tensor might be reused by the next preprocess() call
+    if rawstate:type() == 'torch.ByteTensor' and
+       rawstate:nElement() == self.state_dim then
+        -- an 84x84 screen in gray levels already, as the game
+        -- environments return them
+        return rawstate:view(self.state_dim)
+    end
     if self.preproc then
-        return self.preproc:forward(rawstate:float())
-                    :clone():reshape(self.state_dim)
+        return self.preproc:forward(rawstate:float()):view(self.state_dim)
     end
 
     return rawstate
@@ -249,6 +341,7 @@ function nql:qLearnMinibatch()
     -- Perform a minibatch Q-learning update:
     -- w += alpha * (r + gamma max Q(s2,a2) - Q(s,a)) * dQ(s,a)/dw
     assert(self.transitions:size() > self.minibatch_size)
+    local tic = trace.now()
 
     local s, a, r, s2, term = self.transitions:sample(self.minibatch_size)
 
@@ -261,15 +354,28 @@ function nql:qLearnMinibatch()
     -- get new gradient
     self.network:backward(s, targets)
 
-    -- add weight cost to gradient
-    self.dw:add(-self.wc, self.w)
-
     -- compute linearly annealed learning rate
     local t = math.max(0, self.numSteps - self.learn_start)
     self.lr = (self.lr_start - self.lr_end) * (self.lr_endt - t)/self.lr_endt +
                 self.lr_end
     self.lr = math.max(self.lr, self.lr_end)
 
+    if self.qnet then
+        self.qnet_stale = self.qnet_stale + 1
+    end
+    self:weights_changed()
+
+    if self.nncpu then
+        -- weight cost, RMSProp statistics and update in one pass
+        self.nncpu.rmsprop(self.w, self.dw, self.g, self.g2,
+                           self.lr, self.wc, 0.95, 0.01)
+        trace.span(T_QLEARN, tic, nil, self.minibatch_size)
+        return
+    end
+
+    -- add weight cost to gradient
+    self.dw:add(-self.wc, self.w)
+
     -- use gradients
     self.g:mul(0.95):add(0.05, self.dw)
     self.tmp:cmul(self.dw, self.dw)
@@ -281,8 +387,8 @@ function nql:qLearnMinibatch()
     self.tmp:sqrt()
 
     -- accumulate update
-    self.deltas:mul(0):addcdiv(self.lr, self.dw, self.tmp)
-    self.w:add(self.deltas)
+    self.w:addcdiv(self.lr, self.dw, self.tmp)
+    trace.span(T_QLEARN, tic, nil, self.minibatch_size)
 end
 
 --[[
@@ -306,9 +412,51 @@ end
 --]]
 
 function nql:perceive(reward, rawstate, terminal, testing, testing_ep)
+    local t = metrics.now()
+    local curState = self:observe(self, reward, rawstate, terminal, testing)
+
+    -- Select action
+    local actionIndex = 1
+    if not terminal then
+        actionIndex = self:eGreedy(curState, testing_ep, self)
+    end
+    self.lastAction = actionIndex
+    local t1 = metrics.now()
+    metrics.record(M_PERCEIVE, t1 - t)
+    trace.span(T_PERCEIVE, t, t1, actionIndex)
+
+    -- Q-Learning update code has been moved to dqn.AsyncLearner
+
+    if not terminal then
+        return actionIndex
+    else
+        return 0
+    end
+end
+
+
+function nql:new_actor(lane)
+    -- State of an actor which plays its own game with this agent, see
+    -- observe() and act().
+    return {recent = dqn.FrameStack{histLen = self.hist_len,
+                                    stateDim = self.state_dim},
+            lane = lane or 1}
+end
+
+
+function nql:observe(actor, reward, rawstate, terminal, testing)
+    -- Everything perceive() does except action selection, for 'actor' (as
+    -- created by new_actor()): pushes the new frame into the actor's
+    -- frame stack, and stores the actor's previous transition (s, a, r, s')
+    -- in its lane of the replay memory. The caller has to set
+    -- actor.lastAction. Returns the actor's current state, a
+    -- (1, input_dims) ByteTensor view which is valid until the actor's next
+    -- observe().
+
     -- Preprocess state (will be set to nil if terminal)
-    local state = self:preprocess(rawstate):float()
-    local curState
+    local t = metrics.now()
+    local state = self:preprocess(rawstate)
+    metrics.record(M_PREPROCESS, metrics.now() - t)
 
     if self.max_reward then
         reward = math.min(reward, self.max_reward)
@@ -320,62 +468,92 @@ function nql:perceive(reward, rawstate, terminal, testing, testing_ep)
         self.r_max = math.max(self.r_max, reward)
     end
 
-    self.transitions:add_recent_state(state, terminal)
-
-    local currentFullState = self.transitions:get_recent()
+    actor.recent:push(state, terminal)
 
     --Store transition s, a, r, s'
-    if self.lastState and not testing then
-        self.transitions:add(self.lastState, self.lastAction, reward,
-                             self.lastTerminal, priority)
+    if actor.lastState and not testing then
+        self.transitions:add(actor.lastState, actor.lastAction, reward,
+                             actor.lastTerminal, actor.lane)
+        if self.recorders then
+            -- the same transition, for offline training (dataset module)
+            self.recorders[actor.lane]:add(actor.lastState, actor.lastAction,
+                                           reward, actor.lastTerminal)
+        end
     end
 
-    -- valiation related code is removed
-    --if self.numSteps == self.learn_start+1 and not testing then
-    --    self:sample_validation_data()
-    --end
+    if not testing then
+        self.numSteps = self.numSteps + 1
+    end
 
-    curState= self.transitions:get_recent()
-    curState = curState:resize(1, unpack(self.input_dims))
+    -- keep the quantized (ByteTensor) copy of state, which is what
+    -- transitions:add() stores anyway
+    actor.lastState = actor.lastState or torch.ByteTensor(self.state_dim)
+    actor.lastState:copy(actor.recent:get_frame())
+    actor.lastTerminal = terminal
 
-    -- Select action
-    local actionIndex = 1
-    if not terminal then
-        actionIndex = self:eGreedy(curState, testing_ep)
+    if self.target_q and self.numSteps % self.target_q == 1 then
+        -- in place, so that no network is allocated
+        self.target_w:copy(self.w)
+        self:weights_changed()
     end
 
-    self.transitions:add_recent_action(actionIndex)
+    return actor.recent:get():view(1, unpack(self.input_dims))
+end
 
-    -- Q-Learning update code has been moved to train-deepmind.lua
-    --Do some Q-learning updates
-    --if self.numSteps > self.learn_start and not testing and
-    --    self.numSteps % self.update_freq == 0 then
-    --    for i = 1, self.n_replay do
-    --        self:qLearnMinibatch()
-    --    end
-    --end
 
-    if not testing then
-        self.numSteps = self.numSteps + 1
-    end
+function nql:act(actors, states, testing_ep)
+    -- Epsilon-greedy action selection for a batch of actors at once:
+    -- states[i] is the current state of actors[i] (as returned by
+    -- observe()), and the chosen action is stored in actors[i].lastAction
+    -- (and its Q-values in actors[i].lastQ, nil for a random action).
+    -- The greedy ones are evaluated by a single forward of the network.
+    self.ep = testing_ep or (self.ep_end +
+                math.max(0, (self.ep_start - self.ep_end) * (self.ep_endt -
+                math.max(0, self.numSteps - self.learn_start))/self.ep_endt))
 
-    self.lastState = state:clone()
-    self.lastAction = actionIndex
-    self.lastTerminal = terminal
+    local greedy = {}
+    for i = 1, #actors do
+        if torch.uniform() < self.ep then
+            actors[i].lastAction = torch.random(1, self.n_actions)
+            actors[i].lastQ = nil
+        else
+            local q = self:memo_lookup(actors[i])
+            if q then
+                actors[i].lastAction = self:best_action(q)
+                actors[i].lastQ = q
+            else
+                greedy[#greedy+1] = i
+            end
+        end
+    end
+    if #greedy == 0 then
+        return
+    elseif #greedy == 1 then
+        local i = greedy[1]
+        actors[i].lastAction = self:greedy(states[i], actors[i], true)
+        return
+    end
 
-    if self.target_q and self.numSteps % self.target_q == 1 then
-        self.target_network = self.network:clone()
+    self.batch_state = self.batch_state or torch.ByteTensor()
+    local batch = self.batch_state:resize(#greedy, unpack(self.input_dims))
+    for j, i in ipairs(greedy) do
+        batch[j]:copy(states[i])
+    end
+    if self.gpu >= 0 then
+        self.gpu_batch = self.gpu_batch or torch.CudaByteTensor()
+        batch = self.gpu_batch:resize(batch:size()):copy(batch)
     end
 
-    if not terminal then
-        return actionIndex
-    else
-        return 0
+    local q = self.network:forward(batch):float()
+    for j, i in ipairs(greedy) do
+        self:memo_store(actors[i], q[j])
+        actors[i].lastAction = self:best_action(q[j])
+        actors[i].lastQ = q[j]
     end
 end
 
 
-function nql:eGreedy(state, testing_ep)
+function nql:eGreedy(state, testing_ep, actor)
     self.ep = testing_ep or (self.ep_end +
                 math.max(0, (self.ep_start - self.ep_end) * (self.ep_endt -
                 math.max(0, self.numSteps - self.learn_start))/self.ep_endt))
@@ -383,12 +561,22 @@ function nql:eGreedy(state, testing_ep)
     if torch.uniform() < self.ep then
         return torch.random(1, self.n_actions)
     else
-        return self:greedy(state)
+        return self:greedy(state, actor)
     end
 end
 
 
-function nql:greedy(state)
+function nql:greedy(state, actor, looked_up)
+    -- If 'actor' is given, 'state' is its current state, and the Q-values
+    -- are memoized for it (see memo_lookup()) and kept in actor.lastQ.
+    if actor and not looked_up then
+        local q = self:memo_lookup(actor)
+        if q then
+            actor.lastQ = q
+            return self:best_action(q)
+        end
+    end
+
     -- Turn single state into minibatch.  Needed for convolutional nets.
     if state:dim() == 2 then
         assert(false, 'Input must be at least 3D')
@@ -396,10 +584,83 @@ function nql:greedy(state)
     end
 
     if self.gpu >= 0 then
-        state = state:cuda()
+        self.gpu_state = self.gpu_state or torch.CudaByteTensor()
+        state = self.gpu_state:resizeAs(state):copy(state)
+    end
+
+    local q
+    if self.qnet then
+        if self.qnet_stale > 0 and self.qnet_stale >= self.cpu_infer_sync then
+            self.qnet:sync()
+            self.qnet_stale = 0
+        end
+        q = self.qnet:forward(state)
+    else
+        q = self.network:forward(state):float():squeeze()
+    end
+    if actor then
+        self:memo_store(actor, q)
+        actor.lastQ = q
     end
 
-    local q = self.network:forward(state):float():squeeze()
+    return self:best_action(q)
+end
+
+
+function nql:weights_changed()
+    -- Invalidates the memoized Q-values of all actors; to be called
+    -- whenever the weights used by greedy() change.
+    self.q_version = self.q_version + 1
+end
+
+
+function nql:memo_lookup(actor)
+    -- Returns the memoized Q-values of 'actor' if its current state is
+    -- within memo_tol of the state they were computed for (by the frame
+    -- signatures of actor.recent, then by the frames themselves if
+    -- memo_tol is 0) and no weights have changed since, or nil (then
+    -- greedy() computes and stores them).
+    if self.memo_tol < 0 then return nil end
+    local sig = actor.recent:signature()
+    if not sig then return nil end
+
+    local memo = actor.memo
+    if not memo then
+        memo = {sig = sig:clone(), diff = sig:clone(), version = -1,
+                state = actor.recent:get():clone(),
+                q = torch.FloatTensor(self.n_actions)}
+        actor.memo = memo
+    end
+    if memo.version == self.q_version and
+       memo.diff:add(sig, -1, memo.sig):abs():max() <= self.memo_tol and
+       (self.memo_tol > 0 or memo.state:equal(actor.recent:get())) then
+        metrics.add(M_MEMO_HIT)
+        return memo.q
+    end
+    metrics.add(M_MEMO_MISS)
+    return nil
+end
+
+
+function nql:memo_store(actor, q)
+    local memo = actor.memo
+    if memo then
+        memo.sig:copy(actor.recent:signature())
+        memo.state:copy(actor.recent:get())
+        memo.q:copy(q)
+        memo.version = self.q_version
+    end
+end
+
+
+function nql:memo_hit_rate()
+    -- Fraction of greedy() evaluations served from the memo so far.
+    local hits, misses = metrics.count(M_MEMO_HIT), metrics.count(M_MEMO_MISS)
+    return (hits + misses > 0) and hits / (hits + misses) or 0
+end
+
+
+function nql:best_action(q)
     local maxq = q[1]
     local besta = {1}
 
@@ -416,8 +677,6 @@ function nql:greedy(state)
 
     local r = torch.random(1, #besta)
 
-    self.lastAction = besta[r]
-
     return besta[r]
 end
 
@@ -459,4 +718,13 @@ end
 function nql:report()
     print(get_weight_norms(self.network))
     print(get_grad_norms(self.network))
+    if self.transitions.arena then
+        local s = self.transitions.arena:stats()
+        print(string.format('replay arena: %d MB used, %d MB resident, %d MB ' ..
+                            'in huge pages%s, %slocked; page faults: %d minor, %d major',
+                            s.used / 2^20, s.resident / 2^20, s.huge / 2^20,
+                            s.hugetlb and ' (hugetlb)' or '',
+                            s.locked and '' or 'not ', s.minor_faults,
+                            s.major_faults))
+    end
 end
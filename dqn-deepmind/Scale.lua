@@ -24,8 +24,15 @@ function scale:forward(x)
     --end
 
     --x = image.rgb2y(x)
-    x = image.scale(x, self.width, self.height, 'bilinear')
-    return x
+    -- scale into a reused output buffer, instead of allocating a new one
+    self.output = self.output or x.new()
+    if x:dim() == 2 then
+        self.output:resize(self.height, self.width)
+    else
+        self.output:resize(x:size(1), self.height, self.width)
+    end
+    image.scale(self.output, x, 'bilinear')
+    return self.output
 end
 
 function scale:updateOutput(input)
@@ -0,0 +1,121 @@
+--------------------------------------------------------------------------------
+--
+-- TrainScheduler
+--
+-- Decides when the learner (dqn.AsyncLearner) runs its next minibatch
+-- update, so that it gets all the time the actor leaves over, without
+-- ever holding the actor up when a decision is due.
+--
+-- Deadline: the actor publishes the capture time of the next frame it
+-- has to decide on (see dqn.ActorPool). An update is only started if it
+-- is predicted to be done 'margin' seconds before that; otherwise the
+-- learner waits for the actor to decide, and to publish the deadline
+-- after that. Without a deadline (e.g. the simulated game, or while a
+-- game restarts), updates are not held back.
+--
+-- Latency model: the cost of an update is predicted from the ones
+-- before, as TCP predicts round-trip times: a moving average 'mean' and
+-- a moving mean deviation 'dev' (gains 1/8 and 1/4), and the prediction
+-- is mean + 4 * dev. So the first updates (which include the allocations)
+-- and occasional spikes make the learner careful for a while.
+--
+-- Ratio: at most 'ratio' updates per agent step (0 means no limit) over
+-- the last 'window' steps. Updates missed because of the deadlines (or a
+-- slow learner) could be made up for within the window, but older ones
+-- are forgotten, so the learner never bursts to catch up on a backlog.
+--
+-- Usage (in the learner thread):
+--
+--   local sched = dqn.TrainScheduler{ratio = 0.25, window = 1000,
+--                                    margin = 0.002, learn_start = 10000}
+--   local ok, wait = sched:ready(metrics.now(), steps, deadline)
+--   if ok then ... l:qLearnMinibatch(); sched:done(t0, metrics.now(), deadline)
+--   else sys.sleep(wait) end
+--
+--------------------------------------------------------------------------------
+-- agent, 2026-10-18
+--------------------------------------------------------------------------------
+
+require 'torch'
+
+local ts = torch.class('dqn.TrainScheduler')
+
+
+function ts:__init(args)
+    self.ratio       = args.ratio or 0
+    self.window      = math.max(args.window or 1000, 1)
+    self.margin      = args.margin or 0.002
+    self.learn_start = args.learn_start or 0
+
+    -- latency model (seconds), with an initial guess for the 1st update
+    self.mean = args.guess or 0.01
+    self.dev  = self.mean / 2
+
+    self.updates = 0    -- done so far
+    self.late    = 0    -- of them, done after their deadline
+    self.seen    = nil  -- latest agent step seen
+    -- updates done so far at each of the last 'window' steps (a ring)
+    self.at_step = {}
+end
+
+
+-- Predicted cost of the next update, in seconds.
+function ts:predict()
+    return self.mean + 4 * self.dev
+end
+
+
+-- Catch up with the agent steps done so far.
+function ts:advance(steps)
+    local n = self.window + 1
+    local first = math.max((self.seen or steps - 1) + 1, steps - self.window)
+    for s = first, steps do
+        self.at_step[s % n] = self.updates
+    end
+    self.seen = math.max(self.seen or steps, steps)
+end
+
+
+-- Whether 'ratio' allows another update at agent step 'steps'.
+function ts:below_ratio(steps)
+    if self.ratio <= 0 then return true end
+    local span = math.min(self.window, steps - self.learn_start)
+    if span <= 0 then return false end
+    local before = self.at_step[(steps - span) % (self.window + 1)] or 0
+    return self.updates - before < span * self.ratio
+end
+
+
+-- Called by the learner before each update: 'now' is the time, 'steps'
+-- the agent steps so far, and 'deadline' the actor's next decision
+-- (the same clock as 'now'; nil or 0 for none). Returns true if an update
+-- should be run now, or false and how long to wait (in seconds) before
+-- asking again.
+function ts:ready(now, steps, deadline)
+    self:advance(steps)
+    if not self:below_ratio(steps) then
+        return false, 0.001
+    end
+    if deadline and deadline > 0 then
+        local slack = deadline - self.margin - now
+        if slack < self:predict() then
+            -- the actor is about to decide (or deciding): poll finely, so
+            -- as not to miss much of the gap after its decision
+            return false, 0.0002
+        end
+    end
+    return true
+end
+
+
+-- Called by the learner after an update which started at 't0' and ended
+-- at 't1', against 'deadline' (as passed to ready()).
+function ts:done(t0, t1, deadline)
+    local err = (t1 - t0) - self.mean
+    self.mean = self.mean + err / 8
+    self.dev = self.dev + (math.abs(err) - self.dev) / 4
+    self.updates = self.updates + 1
+    if deadline and deadline > 0 and t1 > deadline then
+        self.late = self.late + 1
+    end
+end
@@ -23,6 +23,29 @@ function trans:__init(args)
     self.gpu = args.gpu
     self.numEntries = 0
     self.insertIndex = 0
+    -- The memory could be split into 'lanes' equal parts, each a circular
+    -- buffer of its own, so that several actors could add transitions
+    -- without interleaving their episodes (see dqn.ActorPool).
+    self.lanes = args.lanes or 1
+    self.laneSize = math.floor(self.maxSize / self.lanes)
+    self.laneInsert = {}
+    -- The replay memory (s) and the minibatch buffers (buf_s, buf_s2)
+    -- could be allocated in a huge page arena (see arena/arena.lua):
+    -- args.arena = {huge = 'thp'|'hugetlb'|'none', lock = true|false}.
+    self.arena_opts = args.arena
+
+    local s_size = self.stateDim*self.histLen
+    local alloc = function (...) return torch.ByteTensor(...) end
+    if self.arena_opts then
+        local bytes = 2*self.bufferSize*s_size + 3*64
+        if not args.shared then
+            bytes = bytes + self.maxSize*self.stateDim
+        end
+        self.arena = require('arena/arena').create(bytes, self.arena_opts)
+        alloc = function (...)
+            return self.arena:tensor('torch.ByteTensor', ...)
+        end
+    end
 
     self.histIndices = {}
     local histLen = self.histLen
@@ -51,28 +74,45 @@ function trans:__init(args)
         end
     end
 
-    self.s = torch.ByteTensor(self.maxSize, self.stateDim):fill(0)
-    self.a = torch.LongTensor(self.maxSize):fill(0)
-    self.r = torch.zeros(self.maxSize)
-    self.t = torch.ByteTensor(self.maxSize):fill(0)
+    if args.shared then
+        -- Use the replay memory of another table (e.g. the actor's one, as
+        -- seen from the learner thread).
+        self.s, self.a, self.r, self.t = args.shared.s, args.shared.a,
+                                         args.shared.r, args.shared.t
+        self.laneEntries = args.shared.laneEntries
+        assert(self.s:size(1) == self.maxSize and
+               self.s:size(2) == self.stateDim and
+               self.laneEntries:size(1) == self.lanes,
+               'shared memory size mismatch')
+    else
+        self.s = alloc(self.maxSize, self.stateDim):fill(0)
+        self.a = torch.LongTensor(self.maxSize):fill(0)
+        self.r = torch.zeros(self.maxSize)
+        self.t = torch.ByteTensor(self.maxSize):fill(0)
+        -- number of entries in each lane
+        self.laneEntries = torch.LongTensor(self.lanes):zero()
+    end
+    for l = 1, self.lanes do self.laneInsert[l] = 0 end
     self.action_encodings = torch.eye(self.numActions)
 
-    -- Tables for storing the last histLen states.  They are used for
-    -- constructing the most recent agent state more easily.
-    self.recent_s = {}
-    self.recent_a = {}
-    self.recent_t = {}
+    -- Circular stack of the last histLen states.  It is used for
+    -- constructing the most recent agent state without allocations.
+    assert(self.histType == "linear" and self.histSpacing == 1,
+           'only linear history with histSpacing=1 is supported')
+    self.recent = dqn.FrameStack{histLen = histLen, stateDim = self.stateDim,
+                                 zeroFrames = self.zeroFrames}
 
-    local s_size = self.stateDim*histLen
     self.buf_a      = torch.LongTensor(self.bufferSize):fill(0)
     self.buf_r      = torch.zeros(self.bufferSize)
     self.buf_term   = torch.ByteTensor(self.bufferSize):fill(0)
-    self.buf_s      = torch.ByteTensor(self.bufferSize, s_size):fill(0)
-    self.buf_s2     = torch.ByteTensor(self.bufferSize, s_size):fill(0)
+    self.buf_s      = alloc(self.bufferSize, s_size):fill(0)
+    self.buf_s2     = alloc(self.bufferSize, s_size):fill(0)
 
+    -- minibatches stay in gray levels (bytes) on their way to the network,
+    -- see ByteInput.lua
     if self.gpu and self.gpu >= 0 then
-        self.gpu_s  = self.buf_s:float():cuda()
-        self.gpu_s2 = self.buf_s2:float():cuda()
+        self.gpu_s  = torch.CudaByteTensor(self.buf_s:size()):zero()
+        self.gpu_s2 = torch.CudaByteTensor(self.buf_s2:size()):zero()
     end
 end
 
@@ -80,6 +120,8 @@ end
 function trans:reset()
     self.numEntries = 0
     self.insertIndex = 0
+    self.laneEntries:zero()
+    for l = 1, self.lanes do self.laneInsert[l] = 0 end
 end
 
 
@@ -106,8 +148,6 @@ function trans:fill_buffer()
         self.buf_s2[buf_ind]:copy(s2)
         self.buf_term[buf_ind] = term
     end
-    self.buf_s  = self.buf_s:float():div(255)
-    self.buf_s2 = self.buf_s2:float():div(255)
     if self.gpu and self.gpu >= 0 then
         self.gpu_s:copy(self.buf_s)
         self.gpu_s2:copy(self.buf_s2)
@@ -117,26 +157,44 @@ end
 
 function trans:sample_one()
     assert(self.numEntries > 1)
+    if self.lanes > 1 then
+        local n = self.laneEntries:max()
+        assert(n - self.recentMemSize >= 2, 'all lanes are too short to sample from')
+    end
     local index
     local valid = false
     while not valid do
-        -- start at 2 because of previous action
-        index = torch.random(2, self.numEntries-self.recentMemSize)
-        if self.t[index+self.recentMemSize-1] == 0 then
-            valid = true
-        end
-        if self.nonTermProb < 1 and self.t[index+self.recentMemSize] == 0 and
-            torch.uniform() > self.nonTermProb then
-            -- Discard non-terminal states with probability (1-nonTermProb).
-            -- Note that this is the terminal flag for s_{t+1}.
-            valid = false
+        -- pick a lane with probability proportional to its size
+        local base, n = 0, self.numEntries
+        if self.lanes > 1 then
+            local u = torch.random(1, self.numEntries)
+            local l = 1
+            while u > self.laneEntries[l] do
+                u = u - self.laneEntries[l]
+                l = l + 1
+            end
+            base, n = (l-1)*self.laneSize, self.laneEntries[l]
         end
-        if self.nonEventProb < 1 and self.t[index+self.recentMemSize] == 0 and
-            self.r[index+self.recentMemSize-1] == 0 and
-            torch.uniform() > self.nonTermProb then
-            -- Discard non-terminal or non-reward states with
-            -- probability (1-nonTermProb).
-            valid = false
+        -- (skip lanes too short for a full transition yet)
+        if n - self.recentMemSize >= 2 then
+            -- start at 2 because of previous action
+            index = base + torch.random(2, n-self.recentMemSize)
+            if self.t[index+self.recentMemSize-1] == 0 then
+                valid = true
+            end
+            if self.nonTermProb < 1 and self.t[index+self.recentMemSize] == 0 and
+                torch.uniform() > self.nonTermProb then
+                -- Discard non-terminal states with probability (1-nonTermProb).
+                -- Note that this is the terminal flag for s_{t+1}.
+                valid = false
+            end
+            if self.nonEventProb < 1 and self.t[index+self.recentMemSize] == 0 and
+                self.r[index+self.recentMemSize-1] == 0 and
+                torch.uniform() > self.nonTermProb then
+                -- Discard non-terminal or non-reward states with
+                -- probability (1-nonTermProb).
+                valid = false
+            end
         end
     end
 
@@ -168,12 +226,8 @@ function trans:sample(batch_size)
 end
 
 
-function trans:concatFrames(index, use_recent)
-    if use_recent then
-        s, t = self.recent_s, self.recent_t
-    else
-        s, t = self.s, self.t
-    end
+function trans:concatFrames(index)
+    local s, t = self.s, self.t
 
     local fullstate = s[1].new()
     fullstate:resize(self.histLen, unpack(s[1]:size():totable()))
@@ -212,13 +266,9 @@ function trans:concatFrames(index, use_recent)
 end
 
 
-function trans:concatActions(index, use_recent)
+function trans:concatActions(index)
     local act_hist = torch.FloatTensor(self.histLen, self.numActions)
-    if use_recent then
-        a, t = self.recent_a, self.recent_t
-    else
-        a, t = self.a, self.t
-    end
+    local a, t = self.a, self.t
 
     -- Zero out frames from all but the most recent episode.
     local zero_out = false
@@ -256,7 +306,23 @@ end
 
 function trans:get_recent()
     -- Assumes that the most recent state has been added, but the action has not
-    return self:concatFrames(1, true):float():div(255)
+    -- Note the returned tensor is only valid until the next add_recent_state()
+    return self.recent:get()
+end
+
+
+function trans:get_recent_frame()
+    -- The most recent state as a ByteTensor, in the format of self.s
+    return self.recent:get_frame()
+end
+
+
+function trans:get_shared()
+    -- The replay memory tensors, to be passed as args.shared of another
+    -- TransitionTable (numEntries/insertIndex have to be kept in sync by
+    -- the caller)
+    return {s = self.s, a = self.a, r = self.r, t = self.t,
+            laneEntries = self.laneEntries}
 end
 
 
@@ -269,25 +335,35 @@ function trans:get(index)
 end
 
 
-function trans:add(s, a, r, term)
+function trans:add(s, a, r, term, lane)
     assert(s, 'State cannot be nil')
     assert(a, 'Action cannot be nil')
     assert(r, 'Reward cannot be nil')
+    -- 'lane' is only needed when the table has more than 1 lane
+    lane = lane or 1
 
     -- Incremenet until at full capacity
-    if self.numEntries < self.maxSize then
+    local n = self.laneEntries[lane]
+    if n < self.laneSize then
+        self.laneEntries[lane] = n + 1
         self.numEntries = self.numEntries + 1
     end
 
     -- Always insert at next index, then wrap around
-    self.insertIndex = self.insertIndex + 1
+    local insert = self.laneInsert[lane] + 1
     -- Overwrite oldest experience once at capacity
-    if self.insertIndex > self.maxSize then
-        self.insertIndex = 1
+    if insert > self.laneSize then
+        insert = 1
     end
+    self.laneInsert[lane] = insert
+    self.insertIndex = (lane-1)*self.laneSize + insert
 
     -- Overwrite (s,a,r,t) at insertIndex
-    self.s[self.insertIndex] = s:clone():float():mul(255)
+    if s:type() == 'torch.ByteTensor' then
+        self.s[self.insertIndex]:copy(s)
+    else
+        self.s[self.insertIndex] = s:clone():float():mul(255)
+    end
     self.a[self.insertIndex] = a
     self.r[self.insertIndex] = r
     if term then
@@ -299,42 +375,7 @@ end
 
 
 function trans:add_recent_state(s, term)
-    local s = s:clone():float():mul(255):byte()
-    if #self.recent_s == 0 then
-        for i=1,self.recentMemSize do
-            table.insert(self.recent_s, s:clone():zero())
-            table.insert(self.recent_t, 1)
-        end
-    end
-
-    table.insert(self.recent_s, s)
-    if term then
-        table.insert(self.recent_t, 1)
-    else
-        table.insert(self.recent_t, 0)
-    end
-
-    -- Keep recentMemSize states.
-    if #self.recent_s > self.recentMemSize then
-        table.remove(self.recent_s, 1)
-        table.remove(self.recent_t, 1)
-    end
-end
-
-
-function trans:add_recent_action(a)
-    if #self.recent_a == 0 then
-        for i=1,self.recentMemSize do
-            table.insert(self.recent_a, 1)
-        end
-    end
-
-    table.insert(self.recent_a, a)
-
-    -- Keep recentMemSize steps.
-    if #self.recent_a > self.recentMemSize then
-        table.remove(self.recent_a, 1)
-    end
+    self.recent:push(s, term)
 end
 
 
@@ -354,7 +395,9 @@ function trans:write(file)
                       self.numEntries,
                       self.insertIndex,
                       self.recentMemSize,
-                      self.histIndices})
+                      self.histIndices,
+                      self.lanes,
+                      self.zeroFrames})
 end
 
 
@@ -365,7 +408,7 @@ Recreates an empty table.
 @param file (FILE object ) @see torch.DiskFile
 --]]
 function trans:read(file)
-    local stateDim, numActions, histLen, maxSize, bufferSize, numEntries, insertIndex, recentMemSize, histIndices = unpack(file:readObject())
+    local stateDim, numActions, histLen, maxSize, bufferSize, numEntries, insertIndex, recentMemSize, histIndices, lanes, zeroFrames = unpack(file:readObject())
     self.stateDim = stateDim
     self.numActions = numActions
     self.histLen = histLen
@@ -375,6 +418,12 @@ function trans:read(file)
     self.histIndices = histIndices
     self.numEntries = 0
     self.insertIndex = 0
+    self.lanes = lanes or 1
+    self.zeroFrames = zeroFrames or 1
+    self.laneSize = math.floor(self.maxSize / self.lanes)
+    self.laneEntries = torch.LongTensor(self.lanes):zero()
+    self.laneInsert = {}
+    for l = 1, self.lanes do self.laneInsert[l] = 0 end
 
     self.s = torch.ByteTensor(self.maxSize, self.stateDim):fill(0)
     self.a = torch.LongTensor(self.maxSize):fill(0)
@@ -382,11 +431,9 @@ function trans:read(file)
     self.t = torch.ByteTensor(self.maxSize):fill(0)
     self.action_encodings = torch.eye(self.numActions)
 
-    -- Tables for storing the last histLen states.  They are used for
-    -- constructing the most recent agent state more easily.
-    self.recent_s = {}
-    self.recent_a = {}
-    self.recent_t = {}
+    -- Circular stack of the last histLen states, as in __init().
+    self.recent = dqn.FrameStack{histLen = self.histLen, stateDim = self.stateDim,
+                                 zeroFrames = self.zeroFrames}
 
     self.buf_a      = torch.LongTensor(self.bufferSize):fill(0)
     self.buf_r      = torch.zeros(self.bufferSize)
@@ -395,7 +442,7 @@ function trans:read(file)
     self.buf_s2     = torch.ByteTensor(self.bufferSize, self.stateDim * self.histLen):fill(0)
 
     if self.gpu and self.gpu >= 0 then
-        self.gpu_s  = self.buf_s:float():cuda()
-        self.gpu_s2 = self.buf_s2:float():cuda()
+        self.gpu_s  = torch.CudaByteTensor(self.buf_s:size()):zero()
+        self.gpu_s2 = torch.CudaByteTensor(self.buf_s2:size()):zero()
     end
 end
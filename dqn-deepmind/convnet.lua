@@ -9,7 +9,8 @@ require "initenv"
 function create_network(args)
 
     local net = nn.Sequential()
-    net:add(nn.Reshape(unpack(args.input_dims)))
+    -- states come in as gray levels, see ByteInput.lua
+    net:add(nn.ByteInput(args.input_dims, 1/255))
 
     --- first convolutional layer
     local convLayer = nn.SpatialConvolution
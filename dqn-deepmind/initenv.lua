@@ -12,8 +12,13 @@ require 'nnutils'
 require 'image'
 require 'Scale'
 require 'NeuralQLearner'
+require 'FrameStack'
 require 'TransitionTable'
 require 'Rectifier'
+require 'ByteInput'
+require 'TrainScheduler'
+require 'AsyncLearner'
+require 'ActorPool'
 
 
 function torchSetup(_opt)
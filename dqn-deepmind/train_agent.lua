@@ -200,6 +200,9 @@ while step < opt.steps do
             agent.g, agent.g2, agent.delta, agent.delta2, agent.deltas, agent.tmp
         agent.w, agent.dw, agent.g, agent.g2, agent.delta, agent.delta2,
             agent.deltas, agent.tmp = nil, nil, nil, nil, nil, nil, nil, nil
+        -- the nncpu module and inference engine hold FFI handles
+        local nncpu, qnet = agent.nncpu, agent.qnet
+        agent.nncpu, agent.qnet = nil, nil
 
         local filename = opt.name
         if opt.save_versions > 0 then
@@ -225,6 +228,7 @@ while step < opt.steps do
             agent.valid_term = s, a, r, s2, term
         agent.w, agent.dw, agent.g, agent.g2, agent.delta, agent.delta2,
             agent.deltas, agent.tmp = w, dw, g, g2, delta, delta2, deltas, tmp
+        agent.nncpu, agent.qnet = nncpu, qnet
         print('Saved:', filename .. '.t7')
         io.flush()
         collectgarbage()
@@ -0,0 +1,685 @@
+/*
+ *  envpipe.c
+ *
+ *  DESCRIPTION:
+ *
+ *  Native pipelined game environment engine for the Nintendo Famicom Mini
+ *  (Galaga), used by gameenv/gameenv-native.lua through Lua FFI. Every
+ *  stage of turning HDMI video into DQN observations runs on its own
+ *  thread:
+ *
+ *    capture  - takes 1280x720 UYVY frames from the V4L2 device (keeping
+ *               1 of every 'frame_skip' frames)
+ *    convert  - converts them to 640x360 grayscale (same as vidcap)
+ *    parse    - reads score/lives/etc. off the frame (parse.c)
+ *    publish  - crops and scales the frame to the 84x84 observation
+ *
+ *  Stages are joined by lock-free single-producer/single-consumer rings
+ *  (spsc.h) which pass pointers to preallocated slots around: every kind
+ *  of slot cycles through a "work" ring and a "free" ring, so nothing is
+ *  allocated or copied between stages, and a stage which runs out of free
+ *  slots drops the frame instead of stalling the ones before it.
+ *
+ *  The publish stage hands observations to the consumer through a triple
+ *  buffer (3 observation slots, one of which is exchanged atomically), so
+ *  the consumer always gets the newest observation and a slow consumer
+ *  never holds up the pipeline. envpipe_latest() is thus only a couple of
+ *  atomic operations when an observation is ready.
+ *
+ *  When the device fails (or no frame has come for STALL seconds), the
+ *  capture thread reconnects it (device_reconnect()), after taking back
+ *  all raw slots, since the buffers they point to go away; the
+ *  reconnections and the time without frames are counted in the stats.
+ *
+ *  When envpipe_start() is called without a device name, no capture
+ *  thread is started and frames are fed by envpipe_feed() instead (for
+ *  testing without the capture hardware).
+ *
+ *  PROCESS:
+ *
+ *  struct envpipe *envpipe_create(int frame_skip);
+ *  int   envpipe_set_rect(e, int id, int h1, int h2, int w1, int w2);
+ *  int   envpipe_set_template(e, int id, const float *data);
+ *  int   envpipe_start(e, const char *devname);
+ *  int   envpipe_feed(e, const unsigned char *uyvy);
+ *  void  envpipe_set_action(e);
+ *  const struct envpipe_obs *envpipe_latest(e, unsigned long min_seq, int timeout);
+ *  void  envpipe_get_stats(e, struct envpipe_stats *s);
+ *  void  envpipe_stop(e);
+ *  void  envpipe_destroy(e);
+ *
+ *  GLOBALS: none
+ *
+ *  REFERENCE:
+ *
+ *  LIMITATIONS:
+ *
+ *  1. Only 1 engine could capture from a V4L2 device at a time (see
+ *     device.c).
+ *  2. envpipe_latest() and envpipe_feed() must each be called from a
+ *     single thread.
+ *  3. Idle stages poll their input ring with a short sleep (200 us).
+ *
+ *  Every stage records a trace event (trace.c) per frame, and every
+ *  action is followed as a flow (whose id is its action_seq) from
+ *  envpipe_set_action() to the conversion of the first frame captured
+ *  after it.
+ *
+ *  REVISION HISTORY:
+ *
+ *    Date             Description                                   Author
+ *    2026-10-18       initial coding                                agent
+ *    2026-10-18       trace events and action flows                 agent
+ *    2026-10-18       reconnects after device failures              agent
+ *    2026-10-18       84x84 screen in gray levels (bytes)           agent
+ *    2026-10-18       capture timestamps and the device's stride    agent
+ *    2026-10-18       scale the screen as image.scale() does        agent
+ *
+ *  TARGET: Linux C
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "envpipe.h"
+#include "parse.h"
+#include "spsc.h"
+#include "../vidcap/device.h"
+#include "../metrics/metrics.h"
+#include "../trace/trace.h"
+
+#define NRAW     2      /* V4L2 buffers in flight (device.c has 4) */
+#define NFRAMES  4      /* grayscale frame slots */
+#define FRESH    4      /* flag in 'mailbox', marking a new observation */
+#define IDLE_NS  200000
+#define STALL    0.5    /* seconds without frames to reconnect the device */
+#define RECONNECT_MS  2000
+
+struct raw_slot {
+        const unsigned char *data;
+        unsigned char       *copy;      /* fed frames are copied here */
+        int                  from_device;
+        int                  stride;    /* bytes per line of 'data' */
+        double               timestamp; /* when it was captured (or fed) */
+        unsigned long        action_seq;
+};
+
+struct frame_slot {
+        unsigned long       seq;
+        double              timestamp;
+        unsigned long       action_seq;
+        struct galaga_state state;
+        int                 offset;     /* horizontal shift found by the parser */
+        unsigned char       gray[ENVPIPE_FRAME_H * ENVPIPE_FRAME_W];
+};
+
+struct envpipe {
+        int                   frame_skip;
+        int                   running;
+        int                   has_capture;
+        int                   stride;   /* bytes per line of the device */
+        pthread_t             threads[4];
+        int                   nthreads;
+
+        struct raw_slot       raw[NRAW];
+        struct spsc           raw_free, raw_ready;          /* convert <-> capture */
+        struct raw_slot      *spare[NRAW];                  /* taken back by capture */
+        int                   nspare;
+        struct frame_slot    *frames;
+        struct spsc           frame_free;                   /* publish -> convert */
+        struct spsc           frame_parse;                  /* convert -> parse */
+        struct spsc           frame_publish;                /* parse -> publish */
+
+        struct envpipe_obs   *obs;      /* 3 slots, see envpipe_latest() */
+        int                   back;     /* slot being written by publish */
+        int                   front;    /* slot held by the consumer */
+        int                   mailbox;  /* the other slot, | FRESH if new */
+
+        unsigned long         action_seq;
+        unsigned long         seq;
+        unsigned long         captured, dropped, published;
+        unsigned long         reconnects;
+        double                outage;   /* seconds without frames (reconnected) */
+
+        struct galaga_parser  parser;
+
+        int                   m_capture_wait, m_convert, m_parse;  /* metrics */
+        int                   t_dequeue, t_convert, t_parse,       /* trace names */
+                              t_publish, t_action, t_reconnect;
+};
+
+static double now(void)
+{
+        struct timespec ts;
+
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void idle(void)
+{
+        struct timespec ts = { 0, IDLE_NS };
+
+        nanosleep(&ts, NULL);
+}
+
+static int is_running(struct envpipe *e)
+{
+        return __atomic_load_n(&e->running, __ATOMIC_ACQUIRE);
+}
+
+static void count(unsigned long *n)
+{
+        __atomic_add_fetch(n, 1, __ATOMIC_RELAXED);
+}
+
+/* pop from a ring, waiting while the engine is running */
+static void *wait_pop(struct envpipe *e, struct spsc *q)
+{
+        void *p;
+
+        while ((p = spsc_pop(q)) == NULL) {
+                if (!is_running(e))
+                        return NULL;
+                idle();
+        }
+        return p;
+}
+
+static void release_raw(struct envpipe *e, struct raw_slot *r)
+{
+        if (r->from_device)
+                device_free_frame((void *) r->data);
+        spsc_push(&e->raw_free, r);
+}
+
+/*
+ * capture stage
+ */
+
+/*
+ * Reconnect the device, which has missed frames since 'since'. Returns
+ * 0, or -1 if it could not be reconnected (or the engine is stopping).
+ */
+static int reconnect(struct envpipe *e, double since)
+{
+        struct raw_slot *r;
+        double t;
+        int ret;
+
+        /* the slots in flight hold buffers of the device: wait for them */
+        while (e->nspare < NRAW) {
+                if ((r = wait_pop(e, &e->raw_free)) == NULL)
+                        return -1;
+                e->spare[e->nspare++] = r;
+        }
+        t = now();
+        ret = device_reconnect(RECONNECT_MS);
+        trace_span(e->t_reconnect, t, now(), -1);
+        if (ret < 0)
+                return -1;
+        e->stride = device_get_bytesperline();
+        e->outage += now() - since;
+        __atomic_add_fetch(&e->reconnects, 1, __ATOMIC_RELEASE);
+        return 0;
+}
+
+static void *capture_thread(void *arg)
+{
+        struct envpipe *e = (struct envpipe *) arg;
+        unsigned long n = 0;
+        double down_since = 0;
+
+        trace_thread_name("envpipe capture");
+        while (is_running(e)) {
+                struct raw_slot *r;
+                double t = now(), t1;
+                void *p = device_get_next_frame(100000);  /* 0.1 second */
+
+                if (NULL == p) {
+                        if (0 == down_since)
+                                down_since = t;
+                        if ((device_get_error() || now() - down_since >= STALL) &&
+                            reconnect(e, down_since) == 0)
+                                down_since = 0;
+                        continue;
+                }
+                down_since = 0;
+                t1 = now();
+                metrics_record(e->m_capture_wait, t1 - t);
+                trace_span(e->t_dequeue, t, t1, n + 1);
+                if (++n % e->frame_skip != 0) {
+                        device_free_frame(p);
+                        continue;
+                }
+                count(&e->captured);
+                r = e->nspare > 0 ? e->spare[--e->nspare] : spsc_pop(&e->raw_free);
+                if (NULL == r) {
+                        device_free_frame(p);
+                        count(&e->dropped);
+                        continue;
+                }
+                r->data = (const unsigned char *) p;
+                r->from_device = 1;
+                r->stride = e->stride;
+                /* the capture clock, as vidcap's (CLOCK_MONOTONIC) */
+                r->timestamp = device_frame_timestamp(p);
+                if (r->timestamp < 0)
+                        r->timestamp = t1;
+                r->action_seq = __atomic_load_n(&e->action_seq, __ATOMIC_ACQUIRE);
+                spsc_push(&e->raw_ready, r);
+        }
+        return NULL;
+}
+
+/*
+ * convert stage
+ */
+static void uyvy_to_gray(const unsigned char *src, int stride,
+                         unsigned char *dst)
+{
+        int x, y;
+
+        src += 1;  /* the 1st Y value (the byte preceding it is a U) */
+        for (y = 0; y < ENVPIPE_FRAME_H; y++) {
+                const unsigned char *s0 = src + (long) y * 2 * stride;
+                const unsigned char *s1 = s0 + stride;
+
+                /* average of Y over 2x2 pixels */
+                for (x = 0; x < ENVPIPE_FRAME_W; x++)
+                        dst[x] = (s0[4 * x] + s0[4 * x + 2] +
+                                  s1[4 * x] + s1[4 * x + 2]) / 4;
+                dst += ENVPIPE_FRAME_W;
+        }
+}
+
+static void *convert_thread(void *arg)
+{
+        struct envpipe *e = (struct envpipe *) arg;
+        struct raw_slot *r;
+        unsigned long last_action = 0;
+
+        trace_thread_name("envpipe convert");
+        while ((r = wait_pop(e, &e->raw_ready)) != NULL) {
+                struct frame_slot *f = spsc_pop(&e->frame_free);
+                double t, t1;
+
+                if (NULL == f) {
+                        release_raw(e, r);
+                        count(&e->dropped);
+                        continue;
+                }
+                t = now();
+                if (r->action_seq != last_action) {
+                        /* the first frame captured after an action */
+                        trace_flow(e->t_action, TRACE_FLOW_STEP, r->action_seq);
+                        last_action = r->action_seq;
+                }
+                uyvy_to_gray(r->data, r->stride, f->gray);
+                t1 = now();
+                metrics_record(e->m_convert, t1 - t);
+                trace_span(e->t_convert, t, t1, e->seq + 1);
+                f->seq = ++e->seq;
+                f->timestamp = r->timestamp;
+                f->action_seq = r->action_seq;
+                release_raw(e, r);
+                spsc_push(&e->frame_parse, f);
+        }
+        return NULL;
+}
+
+/*
+ * parse stage
+ */
+static void *parse_thread(void *arg)
+{
+        struct envpipe *e = (struct envpipe *) arg;
+        struct frame_slot *f;
+
+        trace_thread_name("envpipe parse");
+        while ((f = wait_pop(e, &e->frame_parse)) != NULL) {
+                double t = now(), t1;
+
+                galaga_parse(&e->parser, f->gray, &f->state);
+                t1 = now();
+                metrics_record(e->m_parse, t1 - t);
+                trace_span(e->t_parse, t, t1, f->seq);
+                f->offset = e->parser.offset;
+                spsc_push(&e->frame_publish, f);
+        }
+        return NULL;
+}
+
+/*
+ * publish stage
+ */
+
+/* scale 'src_len' pixels (every 'src_step') to 'dst_len' pixels (every
+ * 'dst_step'), dst_len <= src_len: every pixel is the mean of the source
+ * pixels it covers (the ones on its edges weighted by how much of them
+ * it covers), rounded to a gray level. This is what image.scale() of
+ * torch/image does when shrinking in its 'bilinear' mode */
+static void scale_line(const unsigned char *src, int src_step, int src_len,
+                       unsigned char *dst, int dst_step, int dst_len)
+{
+        float scale = (float) src_len / dst_len;
+        float f0 = 0, f1, acc, n;
+        int i0 = 0, i1, d, i;
+
+        for (d = 0; d < dst_len; d++) {
+                f1 = (d + 1) * scale;
+                i1 = (int) f1;
+                f1 -= i1;
+                acc = (1 - f0) * src[i0 * src_step];
+                n = 1 - f0;
+                for (i = i0 + 1; i < i1; i++) {
+                        acc += src[i * src_step];
+                        n += 1;
+                }
+                if (i1 < src_len) {
+                        acc += f1 * src[i1 * src_step];
+                        n += f1;
+                }
+                acc = acc / n + 0.5f;
+                dst[d * dst_step] = (acc >= 255) ? 255 : (unsigned char) acc;
+                i0 = i1;
+                f0 = f1;
+        }
+}
+
+/* crop the RAW rectangle (336x336), blank its 5~6 leftmost/rightmost
+ * columns and scale it down to SCREEN x SCREEN, in gray levels: rows
+ * first, then columns, as image.scale(s, 84, 84) in gameenv-threaded.lua
+ * and gameenv-sim.lua, so that the screens are the same in every env */
+static void make_screen(const struct rect *raw, int offset,
+                        const unsigned char *gray, unsigned char *screen)
+{
+        unsigned char row[ENVPIPE_FRAME_W];
+        unsigned char tmp[ENVPIPE_FRAME_H * ENVPIPE_SCREEN];
+        int h = raw->h2 - raw->h1 + 1, w = raw->w2 - raw->w1 + 1;
+        int x, y;
+
+        for (y = 0; y < h; y++) {
+                memcpy(row, gray + (raw->h1 + y) * ENVPIPE_FRAME_W +
+                       raw->w1 + offset, w);
+                memset(row, 0, 5);
+                memset(row + w - 6, 0, 6);
+                scale_line(row, 1, w, tmp + y * ENVPIPE_SCREEN, 1,
+                           ENVPIPE_SCREEN);
+        }
+        for (x = 0; x < ENVPIPE_SCREEN; x++)
+                scale_line(tmp + x, ENVPIPE_SCREEN, h, screen + x,
+                           ENVPIPE_SCREEN, ENVPIPE_SCREEN);
+}
+
+static void *publish_thread(void *arg)
+{
+        struct envpipe *e = (struct envpipe *) arg;
+        struct frame_slot *f;
+
+        trace_thread_name("envpipe publish");
+        while ((f = wait_pop(e, &e->frame_publish)) != NULL) {
+                struct envpipe_obs *o = &e->obs[e->back];
+                double t = now();
+
+                o->seq = f->seq;
+                o->timestamp = f->timestamp;
+                o->action_seq = f->action_seq;
+                o->score = f->state.score;
+                o->lives = f->state.lives;
+                o->high = f->state.high;
+                o->flag = f->state.flag;
+                o->result = f->state.result;
+                make_screen(&e->parser.rects[ENVPIPE_RAW], f->offset, f->gray, o->screen);
+                memcpy(o->frame, f->gray, sizeof(o->frame));
+                spsc_push(&e->frame_free, f);
+
+                /* hand the slot over, and take the previous one back */
+                e->back = __atomic_exchange_n(&e->mailbox, e->back | FRESH,
+                                              __ATOMIC_ACQ_REL) & ~FRESH;
+                count(&e->published);
+                trace_span(e->t_publish, t, now(), f->seq);
+        }
+        return NULL;
+}
+
+/*
+ * API
+ */
+struct envpipe *envpipe_create(int frame_skip)
+{
+        struct envpipe *e = calloc(1, sizeof(*e));
+        int i;
+
+        if (NULL == e)
+                return NULL;
+        e->frames = calloc(NFRAMES, sizeof(struct frame_slot));
+        e->obs = calloc(3, sizeof(struct envpipe_obs));
+        if (NULL == e->frames || NULL == e->obs) {
+                envpipe_destroy(e);
+                return NULL;
+        }
+        e->frame_skip = (frame_skip > 0) ? frame_skip : 1;
+
+        spsc_init(&e->raw_free, NRAW);
+        spsc_init(&e->raw_ready, NRAW);
+        for (i = 0; i < NRAW; i++)
+                spsc_push(&e->raw_free, &e->raw[i]);
+        spsc_init(&e->frame_free, NFRAMES);
+        spsc_init(&e->frame_parse, NFRAMES);
+        spsc_init(&e->frame_publish, NFRAMES);
+        for (i = 0; i < NFRAMES; i++)
+                spsc_push(&e->frame_free, &e->frames[i]);
+        e->back = 0;
+        e->mailbox = 1;
+        e->front = 2;
+        e->m_capture_wait = metrics_histogram("capture_wait");
+        e->m_convert = metrics_histogram("convert");
+        e->m_parse = metrics_histogram("parse");
+        e->t_dequeue = trace_name("dequeue");
+        e->t_convert = trace_name("convert");
+        e->t_parse = trace_name("parse");
+        e->t_publish = trace_name("publish");
+        e->t_action = trace_name("action");
+        e->t_reconnect = trace_name("reconnect");
+        return e;
+}
+
+/* rectangles are given as in galaga_image.t7, i.e. 1-based and inclusive */
+int envpipe_set_rect(struct envpipe *e, int id, int h1, int h2, int w1, int w2)
+{
+        struct rect *r;
+
+        if (id < 0 || id >= ENVPIPE_DIGIT0 || e->running)
+                return -1;
+        /* 1 pixel of margin for the shift work-around in parse.c */
+        if (h1 < 1 || h2 < h1 || h2 > ENVPIPE_FRAME_H ||
+            w1 < 1 || w2 < w1 || w2 >= ENVPIPE_FRAME_W)
+                return -1;
+        /* the screen is scaled down from the RAW rectangle */
+        if (ENVPIPE_RAW == id &&
+            (h2 - h1 + 1 < ENVPIPE_SCREEN || w2 - w1 + 1 < ENVPIPE_SCREEN))
+                return -1;
+        r = &e->parser.rects[id];
+        r->h1 = h1 - 1;
+        r->h2 = h2 - 1;
+        r->w1 = w1 - 1;
+        r->w2 = w2 - 1;
+        return 0;
+}
+
+/* templates (HIGH, RESULT and DIGIT*) must be set after their rectangles */
+int envpipe_set_template(struct envpipe *e, int id, const float *data)
+{
+        int n;
+
+        if (id < 0 || id >= ENVPIPE_NUM_RECTS || e->running)
+                return -1;
+        if ((n = galaga_template_size(&e->parser, id)) <= 0)
+                return -1;
+        free(e->parser.templates[id]);
+        e->parser.templates[id] = malloc(n * sizeof(float));
+        if (NULL == e->parser.templates[id])
+                return -1;
+        memcpy(e->parser.templates[id], data, n * sizeof(float));
+        return 0;
+}
+
+int envpipe_start(struct envpipe *e, const char *devname)
+{
+        static void *(*const stages[])(void *) = {
+                convert_thread, parse_thread, publish_thread, capture_thread
+        };
+        int i, n = 3;
+
+        if (e->running)
+                return -1;
+        for (i = 0; i < ENVPIPE_NUM_RECTS; i++)
+                if (galaga_template_size(&e->parser, i) > 0 &&
+                    NULL == e->parser.templates[i])
+                        return -1;
+        if (e->parser.rects[ENVPIPE_RAW].h2 - e->parser.rects[ENVPIPE_RAW].h1 + 1 <
+            ENVPIPE_SCREEN)
+                return -1;
+
+        if (devname) {
+                if (device_initialize((char *) devname, ENVPIPE_RAW_W, ENVPIPE_RAW_H,
+                                      "UYVY") < 0)
+                        return -1;
+                /* rows could be padded by the driver */
+                e->stride = device_get_bytesperline();
+                if (e->stride < ENVPIPE_RAW_W * 2 ||
+                    device_start_capturing() < 0) {
+                        device_cleanup();
+                        return -1;
+                }
+                n = 4;
+        } else {
+                for (i = 0; i < NRAW; i++) {
+                        e->raw[i].copy = malloc(ENVPIPE_RAW_W * ENVPIPE_RAW_H * 2);
+                        if (NULL == e->raw[i].copy)
+                                return -1;
+                }
+        }
+
+        e->running = 1;
+        e->has_capture = (devname != NULL);
+        for (i = 0; i < n; i++) {
+                if (pthread_create(&e->threads[i], NULL, stages[i], e) != 0) {
+                        envpipe_stop(e);
+                        return -1;
+                }
+                e->nthreads++;
+        }
+        return 0;
+}
+
+/* feed 1 UYVY 1280x720 frame, when started without a device; returns -1
+ * if the frame is dropped */
+int envpipe_feed(struct envpipe *e, const unsigned char *uyvy)
+{
+        struct raw_slot *r;
+        double t = now();  /* a fed frame is "captured" when it is fed */
+
+        if (!e->running || e->has_capture)
+                return -1;
+        count(&e->captured);
+        if ((r = spsc_pop(&e->raw_free)) == NULL) {
+                count(&e->dropped);
+                return -1;
+        }
+        memcpy(r->copy, uyvy, ENVPIPE_RAW_W * ENVPIPE_RAW_H * 2);
+        r->data = r->copy;
+        r->from_device = 0;
+        r->stride = ENVPIPE_RAW_W * 2;
+        r->timestamp = t;
+        r->action_seq = __atomic_load_n(&e->action_seq, __ATOMIC_ACQUIRE);
+        spsc_push(&e->raw_ready, r);
+        return 0;
+}
+
+/* to be called right after a new action has been applied; frames
+ * captured from then on carry the new action_seq, which also starts a
+ * flow in the trace */
+void envpipe_set_action(struct envpipe *e)
+{
+        unsigned long seq = __atomic_add_fetch(&e->action_seq, 1, __ATOMIC_RELEASE);
+
+        trace_instant(e->t_action, seq);
+        trace_flow(e->t_action, TRACE_FLOW_START, seq);
+}
+
+/*
+ * Return the newest observation with seq >= min_seq, waiting up to
+ * 'timeout' microseconds for it (NULL on timeout). The returned slot is
+ * owned by the caller until the next call.
+ */
+const struct envpipe_obs *envpipe_latest(struct envpipe *e, unsigned long min_seq,
+                                         int timeout)
+{
+        double deadline = now() + timeout * 1e-6;
+
+        while (1) {
+                if (__atomic_load_n(&e->mailbox, __ATOMIC_ACQUIRE) & FRESH)
+                        e->front = __atomic_exchange_n(&e->mailbox, e->front,
+                                                       __ATOMIC_ACQ_REL) & ~FRESH;
+                if (e->obs[e->front].seq >= min_seq && e->obs[e->front].seq > 0)
+                        return &e->obs[e->front];
+                if (!e->running || now() > deadline)
+                        return NULL;
+                idle();
+        }
+}
+
+void envpipe_get_stats(struct envpipe *e, struct envpipe_stats *s)
+{
+        s->captured = __atomic_load_n(&e->captured, __ATOMIC_RELAXED);
+        s->dropped = __atomic_load_n(&e->dropped, __ATOMIC_RELAXED);
+        s->published = __atomic_load_n(&e->published, __ATOMIC_RELAXED);
+        s->reconnects = __atomic_load_n(&e->reconnects, __ATOMIC_ACQUIRE);
+        s->outage = e->outage;
+}
+
+void envpipe_stop(struct envpipe *e)
+{
+        struct raw_slot *r;
+        struct frame_slot *f;
+        int i;
+
+        if (!e->running)
+                return;
+        __atomic_store_n(&e->running, 0, __ATOMIC_RELEASE);
+        for (i = 0; i < e->nthreads; i++)
+                pthread_join(e->threads[i], NULL);
+        e->nthreads = 0;
+        /* give back the slots (and device buffers) still in the pipeline */
+        while ((r = spsc_pop(&e->raw_ready)) != NULL)
+                release_raw(e, r);
+        while (e->nspare > 0)
+                spsc_push(&e->raw_free, e->spare[--e->nspare]);
+        while ((f = spsc_pop(&e->frame_parse)) != NULL)
+                spsc_push(&e->frame_free, f);
+        while ((f = spsc_pop(&e->frame_publish)) != NULL)
+                spsc_push(&e->frame_free, f);
+        if (e->has_capture) {
+                device_stop_capturing();
+                device_cleanup();
+        }
+}
+
+void envpipe_destroy(struct envpipe *e)
+{
+        int i;
+
+        if (NULL == e)
+                return;
+        envpipe_stop(e);
+        for (i = 0; i < NRAW; i++)
+                free(e->raw[i].copy);
+        galaga_parser_cleanup(&e->parser);
+        free(e->frames);
+        free(e->obs);
+        free(e);
+}
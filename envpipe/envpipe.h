@@ -0,0 +1,69 @@
+/*
+ * envpipe.h
+ */
+
+#ifndef ENVPIPE_H_
+#define ENVPIPE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ENVPIPE_FRAME_W   640
+#define ENVPIPE_FRAME_H   360
+#define ENVPIPE_RAW_W     1280
+#define ENVPIPE_RAW_H     720
+#define ENVPIPE_SCREEN    84    /* observation is SCREEN x SCREEN */
+
+/* rectangles/templates of the galaga screen parser (see galaga_image.t7) */
+enum {
+        ENVPIPE_HIGH = 0,       /* "HIGH SCORE" */
+        ENVPIPE_RESULT,         /* "- RESULT -" */
+        ENVPIPE_FLAG,           /* stage flags, lower-right corner */
+        ENVPIPE_RAW,            /* the part of the screen fed to the DQN */
+        ENVPIPE_SCORE0,         /* score digits, ones first (6 of them) */
+        ENVPIPE_FIGHTER0 = ENVPIPE_SCORE0 + 6,  /* remaining fighters (3) */
+        ENVPIPE_DIGIT0 = ENVPIPE_FIGHTER0 + 3,  /* digit templates '0'..'9' */
+        ENVPIPE_NUM_RECTS = ENVPIPE_DIGIT0 + 10
+};
+
+struct envpipe_obs {
+        unsigned long seq;          /* frame number, starting from 1 */
+        double        timestamp;    /* capture time, CLOCK_MONOTONIC seconds */
+        unsigned long action_seq;   /* number of actions set before capture */
+        int           score;
+        int           lives;
+        int           high;
+        int           flag;
+        int           result;
+        unsigned char screen[ENVPIPE_SCREEN * ENVPIPE_SCREEN];  /* gray levels */
+        unsigned char frame[ENVPIPE_FRAME_H * ENVPIPE_FRAME_W]; /* grayscale */
+};
+
+struct envpipe_stats {
+        unsigned long captured;     /* frames taken from the device */
+        unsigned long dropped;      /* frames dropped for lack of free slots */
+        unsigned long published;    /* observations published */
+        unsigned long reconnects;   /* of the device, after it failed */
+        double        outage;       /* seconds without frames, reconnected */
+};
+
+struct envpipe;
+
+extern struct envpipe *envpipe_create(int frame_skip);
+extern int   envpipe_set_rect(struct envpipe *e, int id, int h1, int h2, int w1, int w2);
+extern int   envpipe_set_template(struct envpipe *e, int id, const float *data);
+extern int   envpipe_start(struct envpipe *e, const char *devname);
+extern int   envpipe_feed(struct envpipe *e, const unsigned char *uyvy);
+extern void  envpipe_set_action(struct envpipe *e);
+extern const struct envpipe_obs *envpipe_latest(struct envpipe *e, unsigned long min_seq,
+                                                int timeout);  /* microseconds */
+extern void  envpipe_get_stats(struct envpipe *e, struct envpipe_stats *s);
+extern void  envpipe_stop(struct envpipe *e);
+extern void  envpipe_destroy(struct envpipe *e);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ENVPIPE_H_ */
@@ -0,0 +1,137 @@
+--------------------------------------------------------------------------------
+--
+-- "envpipe" module
+--
+-- This module exposes the pipelined game environment engine (libenvpipe.so)
+-- through FFI. The engine captures, converts and parses Galaga game video
+-- on its own threads, and always has the newest 84x84 observation ready;
+-- see envpipe.c for details.
+--
+--------------------------------------------------------------------------------
+-- agent, 2026-10-18
+--------------------------------------------------------------------------------
+
+require 'torch'
+
+local ffi = require 'ffi'
+local envpipe = {}
+local lib = ffi.load(paths.cwd() .. '/envpipe/libenvpipe.so')
+
+-- Function prototype definition
+ffi.cdef [[
+    struct envpipe_obs {
+        unsigned long seq;
+        double        timestamp;
+        unsigned long action_seq;
+        int           score;
+        int           lives;
+        int           high;
+        int           flag;
+        int           result;
+        unsigned char screen[84 * 84];
+        unsigned char frame[360 * 640];
+    };
+
+    struct envpipe_stats {
+        unsigned long captured;
+        unsigned long dropped;
+        unsigned long published;
+        unsigned long reconnects;
+        double        outage;
+    };
+
+    struct envpipe;
+    struct envpipe *envpipe_create(int frame_skip);
+    int   envpipe_set_rect(struct envpipe *e, int id, int h1, int h2, int w1, int w2);
+    int   envpipe_set_template(struct envpipe *e, int id, const float *data);
+    int   envpipe_start(struct envpipe *e, const char *devname);
+    int   envpipe_feed(struct envpipe *e, const unsigned char *uyvy);
+    void  envpipe_set_action(struct envpipe *e);
+    const struct envpipe_obs *envpipe_latest(struct envpipe *e,
+                                             unsigned long min_seq, int timeout);
+    void  envpipe_get_stats(struct envpipe *e, struct envpipe_stats *s);
+    void  envpipe_stop(struct envpipe *e);
+    void  envpipe_destroy(struct envpipe *e);
+]]
+
+-- rectangle/template ids, as in envpipe.h
+local HIGH, RESULT, FLAG, RAW, SCORE0, FIGHTER0, DIGIT0 = 0, 1, 2, 3, 4, 10, 13
+
+local Engine = {}
+Engine.__index = Engine
+
+-- Create an engine which keeps 1 of every 'frame_skip' captured frames
+-- (2 for 30 fps out of the 60 fps HDMI video). 'galaga_image' is the
+-- table stored in galaga/galaga_image.t7.
+function envpipe.create(frame_skip, galaga_image)
+    local e = lib.envpipe_create(frame_skip or 2)
+    assert(e ~= nil, 'envpipe_create() failed')
+    e = ffi.gc(e, lib.envpipe_destroy)
+
+    local function set_rect(id, loc)
+        assert(lib.envpipe_set_rect(e, id, loc.h1, loc.h2, loc.w1, loc.w2) == 0,
+               'envpipe: bad rectangle ' .. id)
+    end
+    local function set_template(id, img)
+        local t = img:float():contiguous()
+        assert(lib.envpipe_set_template(e, id, torch.data(t)) == 0,
+               'envpipe: bad template ' .. id)
+    end
+    set_rect(HIGH, galaga_image.high_loc)
+    set_rect(RESULT, galaga_image.result_loc)
+    set_rect(FLAG, galaga_image.flag_loc)
+    set_rect(RAW, galaga_image.raw_loc)
+    for i = 1, 6 do set_rect(SCORE0 + i - 1, galaga_image.score_loc[i]) end
+    for i = 1, 3 do set_rect(FIGHTER0 + i - 1, galaga_image.fighter_loc[i]) end
+    set_template(HIGH, galaga_image.high)
+    set_template(RESULT, galaga_image.result)
+    -- galaga_image.digit[10] is the image of '0'
+    for i = 1, 10 do set_template(DIGIT0 + i % 10, galaga_image.digit[i]) end
+
+    local self = setmetatable({}, Engine)
+    self.e = e
+    self.stats_buf = ffi.new('struct envpipe_stats')
+    return self
+end
+
+-- Start the pipeline threads, capturing from 'devname' (e.g. '/dev/video0').
+-- Without 'devname', frames have to be fed by feed().
+function Engine:start(devname)
+    return lib.envpipe_start(self.e, devname)
+end
+
+-- Feed 1 UYVY 1280x720 frame (a ByteTensor of 1280*720*2 bytes).
+function Engine:feed(uyvy)
+    assert(uyvy:type() == 'torch.ByteTensor' and uyvy:isContiguous())
+    return lib.envpipe_feed(self.e, torch.data(uyvy))
+end
+
+-- Mark that a new action has just been applied.
+function Engine:set_action()
+    lib.envpipe_set_action(self.e)
+end
+
+-- Return the newest observation (struct envpipe_obs, valid until the next
+-- call) whose seq is at least 'min_seq', waiting up to 'timeout' seconds
+-- for it. Returns nil on timeout.
+function Engine:latest(min_seq, timeout)
+    local o = lib.envpipe_latest(self.e, min_seq or 0,
+                                 math.floor((timeout or 1) * 1000000))
+    if o == nil then return nil end
+    return o
+end
+
+function Engine:stats()
+    lib.envpipe_get_stats(self.e, self.stats_buf)
+    return { captured = tonumber(self.stats_buf.captured),
+             dropped = tonumber(self.stats_buf.dropped),
+             published = tonumber(self.stats_buf.published),
+             reconnects = tonumber(self.stats_buf.reconnects),
+             outage = self.stats_buf.outage }
+end
+
+function Engine:stop()
+    lib.envpipe_stop(self.e)
+end
+
+return envpipe
@@ -0,0 +1,170 @@
+/*
+ *  parse.c
+ *
+ *  DESCRIPTION:
+ *
+ *  Galaga game screen parser for the envpipe engine. This is a C port of
+ *  galaga/galaga.lua: it reads the score, the number of remaining
+ *  fighters and the "HIGH SCORE"/flag/"- RESULT -" indicators from a
+ *  640x360 grayscale frame, using the rectangles and templates of
+ *  galaga_image.t7 (which are handed over by gameenv-native.lua).
+ *
+ *  PROCESS:
+ *
+ *  int   galaga_template_size(const struct galaga_parser *p, int id);
+ *  void  galaga_parse(struct galaga_parser *p, const unsigned char *img,
+ *                     struct galaga_state *s);
+ *  void  galaga_parser_cleanup(struct galaga_parser *p);
+ *
+ *  GLOBALS: none
+ *
+ *  REFERENCE: galaga/galaga.lua
+ *
+ *  LIMITATIONS:
+ *
+ *  1. Like galaga.lua, the pixel shift work-around is decided once (the
+ *     first time "HIGH SCORE" is found) and never revisited.
+ *
+ *  REVISION HISTORY:
+ *
+ *    Date             Description                                   Author
+ *    2026-10-18       initial coding                                agent
+ *
+ *  TARGET: Linux C
+ *
+ */
+
+#include <stdlib.h>
+#include "parse.h"
+
+#define W  ENVPIPE_FRAME_W
+
+static struct rect shifted(const struct galaga_parser *p, int id, int offset)
+{
+        struct rect r = p->rects[id];
+
+        r.w1 += offset;
+        r.w2 += offset;
+        return r;
+}
+
+/* number of elements of a template (digit templates share the size of
+ * the score rectangles) */
+int galaga_template_size(const struct galaga_parser *p, int id)
+{
+        const struct rect *r;
+
+        if (id >= ENVPIPE_DIGIT0)
+                r = &p->rects[ENVPIPE_SCORE0];
+        else if (id == ENVPIPE_HIGH || id == ENVPIPE_RESULT)
+                r = &p->rects[id];
+        else
+                return -1;
+        return (r->h2 - r->h1 + 1) * (r->w2 - r->w1 + 1);
+}
+
+/* more than 'ratio' of the pixels in the rectangle are >= 16 */
+static int is_icon_present(const unsigned char *img, struct rect r, float ratio)
+{
+        int x, y, n = 0;
+
+        for (y = r.h1; y <= r.h2; y++)
+                for (x = r.w1; x <= r.w2; x++)
+                        n += (img[y * W + x] >= 16);
+        return n > ratio * (r.h2 - r.h1 + 1) * (r.w2 - r.w1 + 1);
+}
+
+/* less than 20% of the pixels differ from the template by 32 or more */
+static int matches(const unsigned char *img, struct rect r, const float *t)
+{
+        int x, y, n = 0;
+
+        for (y = r.h1; y <= r.h2; y++)
+                for (x = r.w1; x <= r.w2; x++) {
+                        float d = img[y * W + x] - *t++;
+                        n += (d >= 32.0f || d <= -32.0f);
+                }
+        return n < 0.2f * (r.h2 - r.h1 + 1) * (r.w2 - r.w1 + 1);
+}
+
+/* the digit template with the shortest 2-norm distance */
+static int rect_to_digit(const struct galaga_parser *p, const unsigned char *img,
+                         struct rect r)
+{
+        float best = 0.0f;
+        int i, x, y, digit = 0;
+
+        for (i = 0; i < 10; i++) {
+                const float *t = p->templates[ENVPIPE_DIGIT0 + i];
+                float dist = 0.0f;
+
+                for (y = r.h1; y <= r.h2; y++)
+                        for (x = r.w1; x <= r.w2; x++) {
+                                float d = img[y * W + x] - *t++;
+                                dist += d * d;
+                        }
+                if (i == 0 || dist < best) {
+                        best = dist;
+                        digit = i;
+                }
+        }
+        return digit;
+}
+
+static int has_high(struct galaga_parser *p, const unsigned char *img)
+{
+        const float *t = p->templates[ENVPIPE_HIGH];
+
+        if (matches(img, shifted(p, ENVPIPE_HIGH, p->offset), t)) {
+                p->confirmed = 1;
+                return 1;
+        }
+        if (p->confirmed)
+                return 0;
+        /* not confirmed yet, try the rectangle shifted 1 pixel right */
+        if (matches(img, shifted(p, ENVPIPE_HIGH, 1), t)) {
+                p->offset = 1;
+                p->confirmed = 1;
+                return 1;
+        }
+        return 0;
+}
+
+void galaga_parse(struct galaga_parser *p, const unsigned char *img,
+                  struct galaga_state *s)
+{
+        int i, scale = 1;
+
+        /* has_high() goes first since it might adjust p->offset */
+        s->high = has_high(p, img);
+        s->flag = is_icon_present(img, shifted(p, ENVPIPE_FLAG, p->offset), 0.5f);
+        s->result = matches(img, shifted(p, ENVPIPE_RESULT, p->offset),
+                            p->templates[ENVPIPE_RESULT]);
+
+        s->score = 0;
+        for (i = 0; i < 6; i++) {
+                struct rect r = shifted(p, ENVPIPE_SCORE0 + i, p->offset);
+
+                if (!is_icon_present(img, r, 0.2f))
+                        break;
+                s->score += rect_to_digit(p, img, r) * scale;
+                scale *= 10;
+        }
+
+        s->lives = 0;
+        for (i = 0; i < 3; i++) {
+                if (!is_icon_present(img, shifted(p, ENVPIPE_FIGHTER0 + i, p->offset), 0.5f))
+                        break;
+                s->lives++;
+        }
+}
+
+void galaga_parser_cleanup(struct galaga_parser *p)
+{
+        int i;
+
+        for (i = 0; i < ENVPIPE_NUM_RECTS; i++) {
+                free(p->templates[i]);
+                p->templates[i] = NULL;
+        }
+}
@@ -0,0 +1,30 @@
+/*
+ * parse.h
+ */
+
+#ifndef PARSE_H_
+#define PARSE_H_
+
+#include "envpipe.h"
+
+struct rect {
+        int h1, h2, w1, w2;     /* 0-based, inclusive */
+};
+
+struct galaga_parser {
+        struct rect  rects[ENVPIPE_NUM_RECTS];
+        float       *templates[ENVPIPE_NUM_RECTS];
+        int          confirmed;  /* location of "HIGH SCORE" confirmed */
+        int          offset;     /* horizontal pixel shift of all rects */
+};
+
+struct galaga_state {
+        int score, lives, high, flag, result;
+};
+
+extern int   galaga_template_size(const struct galaga_parser *p, int id);
+extern void  galaga_parse(struct galaga_parser *p, const unsigned char *img,
+                          struct galaga_state *s);
+extern void  galaga_parser_cleanup(struct galaga_parser *p);
+
+#endif /* PARSE_H_ */
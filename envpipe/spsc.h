@@ -0,0 +1,54 @@
+/*
+ * spsc.h
+ *
+ * Lock-free single-producer/single-consumer ring of pointers. The producer
+ * only writes 'tail' and the consumer only writes 'head', so a push or a
+ * pop is a couple of plain loads/stores plus one release store. The
+ * capacity must be a power of 2, no larger than SPSC_MAX.
+ */
+
+#ifndef SPSC_H_
+#define SPSC_H_
+
+#define SPSC_MAX  16
+
+struct spsc {
+        unsigned int size;
+        unsigned int head __attribute__((aligned(64)));  /* consumer */
+        unsigned int tail __attribute__((aligned(64)));  /* producer */
+        void        *items[SPSC_MAX] __attribute__((aligned(64)));
+};
+
+static inline void spsc_init(struct spsc *q, unsigned int size)
+{
+        q->size = size;
+        q->head = 0;
+        q->tail = 0;
+}
+
+/* returns -1 if the ring is full */
+static inline int spsc_push(struct spsc *q, void *item)
+{
+        unsigned int t = q->tail;
+
+        if (t - __atomic_load_n(&q->head, __ATOMIC_ACQUIRE) == q->size)
+                return -1;
+        q->items[t & (q->size - 1)] = item;
+        __atomic_store_n(&q->tail, t + 1, __ATOMIC_RELEASE);
+        return 0;
+}
+
+/* returns NULL if the ring is empty */
+static inline void *spsc_pop(struct spsc *q)
+{
+        unsigned int h = q->head;
+        void *item;
+
+        if (h == __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE))
+                return NULL;
+        item = q->items[h & (q->size - 1)];
+        __atomic_store_n(&q->head, h + 1, __ATOMIC_RELEASE);
+        return item;
+}
+
+#endif /* SPSC_H_ */
@@ -0,0 +1,232 @@
+--------------------------------------------------------------------------------
+--
+-- eval-checkpoints.lua
+--
+-- This program evaluates saved networks (.ckpt checkpoints written by
+-- train-deepmind.lua, or .t7 agent files) against the simulated Galaga
+-- (gameenv/gameenv-sim.lua), without the game console, and reports the
+-- distribution of their scores and the evaluation throughput.
+--
+--   $ th eval-checkpoints.lua -networks DQN_1.ckpt,DQN_2.ckpt [-episodes 30]
+--
+-- The games are played by -workers threads in parallel. A job is (a part
+-- of) the episodes of 1 checkpoint: the worker loads the network, and
+-- plays -envs games side by side (dqn.ActorPool), whose actions are
+-- chosen by 1 batched forward of the network. Actions are epsilon-greedy
+-- with -ep, and nothing is learnt. When there are fewer checkpoints than
+-- workers, the episodes of each are split into several jobs.
+--
+-- Each game of a job plays a fixed share of its episodes, so that short
+-- games do not make up more than their share of the results. The parts
+-- of all checkpoints are seeded alike (-seed), i.e. they start off with
+-- the same random numbers.
+--
+--------------------------------------------------------------------------------
+-- agent, 2026-10-18
+--------------------------------------------------------------------------------
+
+require 'torch'
+
+torch.setdefaulttensortype('torch.FloatTensor')
+
+cmd = torch.CmdLine()
+cmd:text()
+cmd:text('Evaluate saved networks against the simulated game:')
+cmd:text()
+cmd:text('Options:')
+cmd:option('-networks', '', 'comma-separated list of networks (.ckpt or .t7)')
+cmd:option('-episodes', 10, 'number of games played by each network')
+cmd:option('-workers', 2, 'number of worker threads')
+cmd:option('-envs', 4, 'number of games played side by side by a worker')
+cmd:option('-threads', 1, 'number of torch threads of each worker')
+cmd:option('-ep', 0.05, 'epsilon of the epsilon-greedy actions')
+cmd:option('-actrep', 2, 'how many steps to repeat an action (as in train-deepmind.lua)')
+cmd:option('-agent', 'NeuralQLearner', 'name of agent file to use')
+cmd:option('-agent_params', 'hist_len=4,preproc="net_downsample_2x_full_y",state_dim=7056,ncols=1,replay_memory=1000,bufferSize=8,minibatch_size=8', 'string of agent parameters')
+cmd:option('-seed', 1, 'seed for the Torch7 random number generator')
+cmd:option('-out', '', 'CSV file to write the score of every episode to')
+cmd:option('-gpu', -1, 'gpu flag (negative number means not using GPU)')
+cmd:text()
+
+local opt = cmd:parse(arg)
+assert(opt.networks ~= '', 'no networks given (-networks)')
+assert(opt.episodes > 0 and opt.workers > 0 and opt.envs > 0)
+
+local networks = {}
+for f in opt.networks:gmatch('[^,]+') do
+    assert(paths.filep(f), f .. ' not found')
+    networks[#networks + 1] = f
+end
+
+--
+-- Initialization
+--
+local threads = require 'threads'
+threads.Threads.serialization('threads.sharedserialize')
+
+local cfg = {
+    agent = opt.agent, agent_params = opt.agent_params, gpu = opt.gpu,
+    envs = opt.envs, ep = opt.ep, actrep = opt.actrep, threads = opt.threads,
+}
+local tensor_type = torch.getdefaulttensortype()
+
+local pool = threads.Threads(opt.workers,
+    function ()
+        package.path = package.path .. ';./dqn-deepmind/?.lua'
+        require 'initenv'
+        if cfg.gpu >= 0 then
+            require 'cutorch'
+            require 'cunn'
+            require 'cudnn'
+            cutorch.setDevice(cfg.gpu)
+        else
+            require 'nncpu/nncpu'
+        end
+        torch.setdefaulttensortype(tensor_type)
+        torch.setnumthreads(cfg.threads)
+    end)
+
+-- Play 'episodes' games with network 'path' (in a worker thread)
+local function evaluate(path, episodes, seed)
+    torch.manualSeed(seed)
+
+    local sim = require 'gameenv/gameenv-sim'
+    local n = math.min(cfg.envs, episodes)
+    local envs, quota = {}, {}
+    for k = 1, n do
+        envs[k] = k == 1 and sim or sim.new()
+        envs[k].init('galaga', 0)
+        -- episodes are dealt out to the games evenly
+        quota[k] = math.floor(episodes / n) + (k <= episodes % n and 1 or 0)
+    end
+    local actions = envs[1].get_actions()
+
+    local o = {
+        network = path, agent = cfg.agent, gpu = cfg.gpu, verbose = 0,
+        env = 'sim', agent_params = cfg.agent_params .. ',actors=' .. n,
+    }
+    local _, _, agent = setup(o, nil, actions)
+    local actor_pool = dqn.ActorPool{agent = agent, envs = envs,
+                                     actions = actions, actrep = cfg.actrep,
+                                     testing_ep = cfg.ep}
+
+    local r = {scores = {}, frames = {}, steps = 0, decisions = 0,
+               forwards = 0, decide_time = 0}
+    local left = episodes
+    local tic = torch.tic()
+    while left > 0 do
+        local finished = actor_pool:step()
+        r.steps = r.steps + actor_pool:size()
+        if actor_pool.decisions > 0 then
+            r.decisions = r.decisions + actor_pool.decisions
+            r.forwards = r.forwards + 1
+            r.decide_time = r.decide_time + actor_pool.decide_time
+        end
+        for _, f in ipairs(finished) do
+            if quota[f.env] > 0 then
+                quota[f.env] = quota[f.env] - 1
+                left = left - 1
+                r.scores[#r.scores + 1] = f.score
+                r.frames[#r.frames + 1] = f.steps
+            end
+        end
+    end
+    r.time = torch.toc(tic)
+
+    for _, env in ipairs(envs) do env.cleanup() end
+    collectgarbage()
+    return r
+end
+
+--
+-- Main program
+--
+local parts = math.min(math.max(1, math.floor(opt.workers / #networks)),
+                       opt.episodes)
+local results = {}
+for i = 1, #networks do
+    results[i] = {scores = {}, frames = {}, steps = 0, decisions = 0,
+                  forwards = 0, decide_time = 0, time = 0}
+end
+
+local tic = torch.tic()
+for p = 1, parts do
+    local episodes = math.floor(opt.episodes / parts) +
+                     (p <= opt.episodes % parts and 1 or 0)
+    for i, path in ipairs(networks) do
+        local seed = opt.seed + p - 1
+        pool:addjob(
+            function () return evaluate(path, episodes, seed) end,
+            function (r)
+                local t = results[i]
+                for j = 1, #r.scores do
+                    t.scores[#t.scores + 1] = r.scores[j]
+                    t.frames[#t.frames + 1] = r.frames[j]
+                end
+                for _, k in ipairs{'steps', 'decisions', 'forwards',
+                                   'decide_time', 'time'} do
+                    t[k] = t[k] + r[k]
+                end
+                if #t.scores == opt.episodes then
+                    print(string.format('%s: done in %.1f s', path, t.time))
+                end
+            end)
+    end
+end
+pool:synchronize()
+pool:terminate()
+local wall = torch.toc(tic)
+
+-- quantile 'q' of the sorted list 's' (nearest rank)
+local function quantile(s, q)
+    return s[math.max(1, math.ceil(q * #s))]
+end
+
+print(string.format('\n%-32s %6s %8s %8s %6s %6s %6s %6s %6s %8s',
+                    'network', 'games', 'mean', 'std', 'min', 'p25', 'median',
+                    'p75', 'max', 'frames/s'))
+local best
+for i, path in ipairs(networks) do
+    local t = results[i]
+    local s = torch.Tensor(t.scores)
+    local sorted = torch.totable(s:sort())
+    t.mean = s:mean()
+    local std = #t.scores > 1 and s:std() or 0
+    print(string.format('%-32s %6d %8.1f %8.1f %6d %6d %6d %6d %6d %8.0f',
+                        path, #t.scores, t.mean, std, sorted[1],
+                        quantile(sorted, 0.25), quantile(sorted, 0.5),
+                        quantile(sorted, 0.75), sorted[#sorted],
+                        t.steps / t.time))
+    if not best or t.mean > results[best].mean then best = i end
+end
+
+local games, steps, decisions, forwards, decide_time = 0, 0, 0, 0, 0
+for _, t in ipairs(results) do
+    games = games + #t.scores
+    steps = steps + t.steps
+    decisions = decisions + t.decisions
+    forwards = forwards + t.forwards
+    decide_time = decide_time + t.decide_time
+end
+print(string.format('\nbest: %s (mean score %.1f)', networks[best],
+                    results[best].mean))
+print(string.format('%d games in %.1f s with %d workers: %.2f games/s, ' ..
+                    '%.0f frames/s, %.0f decisions/s', games, wall,
+                    opt.workers, games / wall, steps / wall, decisions / wall))
+print(string.format('%.1f decisions per forward, %.2f ms per forward',
+                    decisions / math.max(forwards, 1),
+                    decide_time / math.max(forwards, 1) * 1000))
+
+if opt.out ~= '' then
+    local f = assert(io.open(opt.out, 'w'))
+    f:write('network,episode,score,frames\n')
+    for i, path in ipairs(networks) do
+        local t = results[i]
+        for j = 1, #t.scores do
+            f:write(string.format('%s,%d,%d,%d\n', path, j, t.scores[j],
+                                  t.frames[j]))
+        end
+    end
+    f:close()
+    print('Saved: ' .. opt.out)
+end
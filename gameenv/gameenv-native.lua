@@ -0,0 +1,239 @@
+--------------------------------------------------------------------------------
+--
+-- "gameenv-native" module
+--
+-- This module implements the Nintendo Famicom Mini "game environment" on
+-- top of the native "envpipe" engine, with the same API as
+-- gameenv-threaded.
+--
+-- Video capture, conversion, Galaga screen parsing and scaling run on
+-- dedicated native threads, so no Lua closures are serialized per step:
+-- step() applies the action and takes the newest observation the engine
+-- has published since the previous step.
+--
+--------------------------------------------------------------------------------
+-- agent, 2026-10-18
+--------------------------------------------------------------------------------
+
+require 'torch'
+
+local ffi = require 'ffi'
+local gpio = require 'gpio/gpio'
+local metrics = require 'metrics/metrics'
+local trace = require 'trace/trace'
+local envpipe = require 'envpipe/envpipe'
+
+local gameenv = {}
+gameenv.is_initialized = false
+gameenv.is_terminated = true
+gameenv.engine = nil
+
+local last_seq = 0      -- seq of the latest observation taken
+local screen            -- reused by every step()
+local shmpub, disp, frames = nil, 0, 0
+local M_GPIO_WRITE = metrics.histogram('gpio_write')
+local T_STEP = trace.name('step')
+local T_ACTION = trace.name('action')
+local last_action = 0   -- action_seq of the latest action seen in an observation
+
+-- Initialize the game environment.
+-- 'game' is the name of the game, default to 'galaga'.
+-- 'display_freq' is the frame interval for display, default to 1 frame.
+-- Note that display could be disabled by setting display_freq to 0
+function gameenv.init(game, display_freq)
+    disp = display_freq or 1
+
+    -- we only support Galaga for now
+    gameenv.game = game or 'galaga'
+    assert(gameenv.game == 'galaga', gameenv.game .. ' not supported!')
+
+    gameenv.engine = envpipe.create(2, torch.load('galaga/galaga_image.t7'))
+    assert(gameenv.engine:start('/dev/video0') == 0, 'envpipe start failed!')
+    screen = torch.ByteTensor(1, 84, 84)  -- gray levels
+    if disp ~= 0 then
+        -- frames are published for a viewer (shmpub/shmview)
+        local ok, m = pcall(require, 'shmpub/shmpub')
+        if ok and m.init('nintendo galaga') == 0 then
+            shmpub = m
+        else
+            print('gameenv-native: shmpub not available, display disabled')
+            disp = 0
+        end
+    end
+
+    -- init gpio pins
+    local pins = { 36, 37, 184, 219, 38, 63 }
+    for i = 1, #pins do gpio.export(pins[i]) end
+    os.execute('sleep 1')  -- sleep 1 sec to make sure udev rules take effect
+    for i = 1, #pins do gpio.set_output(pins[i]) end
+    for i = 1, #pins do gpio.set_low(pins[i]) end
+
+    gameenv.is_initialized = true
+end
+
+-- Clean up the game environment.
+function gameenv.cleanup()
+    -- reset all gpio pins to known state
+    local pins = { 36, 37, 184, 219, 38, 63 }
+    for i = 1, #pins do gpio.set_low(pins[i]) end
+
+    local s = gameenv.engine:stats()
+    print(string.format('envpipe: %d frames captured, %d dropped, %d published',
+                        s.captured, s.dropped, s.published))
+    if s.reconnects > 0 then
+        print(string.format('envpipe: device reconnected %d times, %.2f s without frames',
+                            s.reconnects, s.outage))
+    end
+    gameenv.engine:stop()
+    gameenv.engine = nil
+    if shmpub then shmpub.cleanup() end
+
+    gameenv.is_initialized = false
+end
+
+-- Get the list of available actions (hard-coded for Galaga, see
+-- gameenv-threaded.lua).
+function gameenv.get_actions()
+    assert(gameenv.is_initialized, 'get_action() called while gameenv is not initialized')
+    return { 1, 2, 3, 4, 5, 6 }
+end
+
+-- Take the newest observation which is at least 'n' frames newer than
+-- the previous one. gameenv.frame_time is set to its capture time
+-- (CLOCK_MONOTONIC seconds, as in gameenv-threaded.lua).
+local function next_obs(n)
+    local o = gameenv.engine:latest(last_seq + n, 2)
+    assert(o, 'envpipe: no video frame for 2 seconds')
+    last_seq = tonumber(o.seq)
+    gameenv.frame_time = tonumber(o.timestamp)
+    frames = frames + 1
+    if disp ~= 0 and frames % disp == 0 then
+        shmpub.display_raw(o.frame, 640, 360)
+    end
+    return o
+end
+
+-- Press or release 'Start' button of the Nintendo game console.
+local function start_button(press)
+    -- Start button is controlled by gpio63
+    if press then
+        gpio.set_high(63)
+    else
+        gpio.set_low(63)
+    end
+    gameenv.engine:set_action()
+end
+
+-- Take an action (see gameenv-threaded.lua for the button mapping).
+local action_pins = { 36, 37, 184, 219, 38, 63 }
+local action_masks = { [0] = 0, 1, 0, 2, 1 + 16, 16, 2 + 16 }
+
+local function take_action(a)
+    local t = metrics.now()
+    gpio.set_mask(action_pins, action_masks[a])
+    gameenv.engine:set_action()
+    metrics.record(M_GPIO_WRITE, metrics.now() - t)
+end
+
+-- Discard current game, and try to start a new game (the same sequence as
+-- in gameenv-threaded.lua).
+function gameenv.new_game()
+    local start_ok = false
+    local t
+    gameenv.last_score = 0
+
+    -- wait for the screen with 'HIGH SCORE' but no Flag
+    while true do
+        t = next_obs(10)
+        if t.high == 1 and t.flag == 0 and (t.lives == 1 or t.lives == 2) then
+            break
+        end
+    end
+
+    -- try pressing Start button up to 10 times
+    -- expect to see a game screen with 3 lives
+    for i = 1, 10 do
+        start_button(true)
+        t = next_obs(10)
+        start_button(false)
+        t = next_obs(10)
+        if t.high == 1 and t.lives == 3 then
+            start_ok = true
+            break
+        end
+    end
+    assert(start_ok)  -- if timeout then something is wrong
+
+    -- wait for Flag to appear, up to 10 seconds
+    start_ok = false
+    for i = 1, 30 do
+        if next_obs(10).flag == 1 then
+            start_ok = true
+            break
+        end
+    end
+    assert(start_ok)  -- if timeout then something is wrong
+
+    -- wait for lives to decrease from 3 to 2, up to 10 seconds
+    start_ok = false
+    for i = 1, 30 do
+        if next_obs(10).lives == 2 then
+            start_ok = true
+            break
+        end
+    end
+    assert(start_ok)  -- if timeout then something is wrong
+
+    -- a new game has really started
+    gameenv.is_terminated = false
+end
+
+-- Take one step for the game.
+-- 'a' is the action specified by caller. 'a' could be nil, which means
+-- no change from previous step.
+-- Returns 'screen', 'reward' and 'terminal'. Note 'screen' is reused by
+-- the next step() call. gameenv.frame_time is set to the capture time of
+-- 'screen'.
+function gameenv.step(a)
+    local reward = 0
+    local tic = trace.now()
+
+    if a then take_action(a) end
+
+    local t = next_obs(1)
+    ffi.copy(torch.data(screen), t.screen, 84 * 84)
+    if t.action_seq > last_action then
+        -- the first observation of the action (see envpipe_set_action())
+        last_action = tonumber(t.action_seq)
+        trace.flow(T_ACTION, 'end', last_action)
+    end
+
+    if gameenv.is_terminated then
+        trace.span(T_STEP, tic, nil, t.seq)
+        return screen, 0, true
+    end
+
+    -- work around galaga score misreadings around end of a game (see
+    -- gameenv-threaded.lua)
+    if t.score ~= 0 then
+        assert(t.score >= gameenv.last_score)
+        if t.score > gameenv.last_score then
+            reward = t.score - gameenv.last_score
+            gameenv.last_score = t.score
+        end
+    end
+
+    -- check whether the game has ended
+    if t.result == 1 or t.high == 0 then
+        gameenv.is_terminated = true
+    end
+    trace.span(T_STEP, tic, nil, t.seq)
+    return screen, reward, gameenv.is_terminated
+end
+
+-- Return current score of the game.
+function gameenv.get_score()
+    return gameenv.last_score
+end
+
+return gameenv
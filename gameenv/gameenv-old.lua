@@ -25,7 +25,9 @@ local gpio   = require 'gpio/gpio'
 -- 'game' is the name of the game, default to 'galaga'.
 -- 'display_freq' is the frame interval for display, default to 3 frames.
 -- Note that display could be disabled by setting display_freq to 0
-function gameenv.init(game, display_freq)
+-- 'pool' is how the 2 video frames per get are combined: 'drop' (the
+-- 1st one, default), 'max' or 'avg', see vidcap.set_pool()
+function gameenv.init(game, display_freq, pool)
     gameenv.game = game or 'galaga'
     gameenv.display_freq = display_freq or 3
     gameenv.cnt = 0  -- frame count
@@ -40,6 +42,7 @@ function gameenv.init(game, display_freq)
     gameenv.img:fill(0)
     local ret = vidcap.init()
     assert(ret == 0, 'vidcap.init() failed!')
+    vidcap.set_pool(pool)
 
     if gameenv.display_freq ~= 0 then
         -- create the display window (all 0's = black screen)
@@ -0,0 +1,377 @@
+--------------------------------------------------------------------------------
+--
+-- "gameenv-sim" module
+--
+-- A software stand-in for the Nintendo Famicom Mini "game environment",
+-- with the same API as gameenv-threaded, for testing and profiling the
+-- training code on a plain Linux box (no HDMI capture card, GPIO or game
+-- console needed).
+--
+-- It plays a much simplified Galaga: the fighter moves and fires
+-- according to the 6 actions, a formation of enemies sways at the top of
+-- the screen, some of them dive at the fighter and drop bullets. Each
+-- step renders a 640x360 grayscale frame in the same layout as the real
+-- game screen, with the HUD (HIGH SCORE, score digits, remaining
+-- fighters, stage flag and "- RESULT -") drawn from the templates in
+-- galaga/galaga_image.t7, so galaga.lua could parse it as usual. The
+-- 84x84 screen is then produced exactly as gameenv-threaded does.
+--
+-- The game is not paced at all: step() returns as soon as the next frame
+-- has been rendered. Any number of games could be played side by side:
+-- gameenv.new() returns another, independent environment with the same
+-- API.
+--
+--------------------------------------------------------------------------------
+-- agent, 2026-10-18
+--------------------------------------------------------------------------------
+
+require 'torch'
+require 'image'
+
+local galaga_image
+local sprites = {}
+
+-- playfield (raw_loc of galaga_image.t7) and sizes, in pixels
+local FX1, FX2, FY1, FY2               -- set by init()
+local SHIP, ENEMY = 12, 10
+local SHIP_Y                            -- top row of the fighter
+local SPEED, BULLET_SPEED, ENEMY_BULLET_SPEED, DIVE_SPEED = 4, 12, 8, 4
+local ROWS, COLS, SPACING = 4, 8, 28
+local P_DIVE, P_ENEMY_FIRE = 0.02, 0.05
+local RESPAWN = 30                      -- frames without fighter after a hit
+
+-- build a ByteTensor (1, H, W) sprite from rows of '#' and '.'
+local function bitmap(rows, value)
+    local t = torch.ByteTensor(1, #rows, #rows[1]):zero()
+    for y, row in ipairs(rows) do
+        for x = 1, #row do
+            if row:sub(x, x) == '#' then t[1][y][x] = value end
+        end
+    end
+    return t
+end
+
+local function make_sprites()
+    sprites.ship = bitmap({
+        '.....##.....',
+        '.....##.....',
+        '....####....',
+        '....####....',
+        '.#..####..#.',
+        '.#.######.#.',
+        '############',
+        '############',
+        '####.##.####',
+        '###..##..###',
+        '##...##...##',
+        '#....##....#' }, 220)
+    sprites.enemy = bitmap({
+        '##......##',
+        '.##....##.',
+        '..######..',
+        '.########.',
+        '###.##.###',
+        '##########',
+        '.########.',
+        '..#....#..',
+        '.#......#.',
+        '#........#' }, 160)
+    sprites.bullet = torch.ByteTensor(1, 6, 2):fill(255)
+    sprites.enemy_bullet = torch.ByteTensor(1, 4, 2):fill(200)
+    -- the stage flag is cut out of the saved RESULT screen
+    local loc = galaga_image.flag_loc
+    local full = torch.DoubleTensor(galaga_image.result:storage(), 1,
+                                    torch.LongStorage{1, 360, 640})
+    sprites.flag = full[{ {}, {loc.h1, loc.h2}, {loc.w1, loc.w2} }]:byte()
+    sprites.high = galaga_image.high:byte()
+    sprites.result = galaga_image.result:byte()
+    sprites.digit = {}
+    for i = 1, 10 do sprites.digit[i % 10] = galaga_image.digit[i]:byte() end
+end
+
+local function overlap(y1, x1, h1, w1, y2, x2, h2, w2)
+    return y1 < y2 + h2 and y2 < y1 + h1 and x1 < x2 + w2 and x2 < x1 + w1
+end
+
+-- Create a game environment. The module itself is one; more independent
+-- ones (e.g. for dqn.ActorPool) are created by gameenv.new(), and each has
+-- to be init()'ed separately.
+local function create()
+    local gameenv = {}
+    gameenv.is_initialized = false
+    gameenv.is_terminated = true
+
+    local frame, rawstate, screen          -- reused by every step()
+    local shmpub, disp, frames = nil, 0, 0
+    local g = {}                            -- game state
+
+    -- draw sprite 's' with its top-left corner at (y, x), clipped to the frame
+    local function draw(s, y, x)
+        local h, w = s:size(2), s:size(3)
+        local y1, x1 = math.max(y, 1), math.max(x, 1)
+        local y2, x2 = math.min(y + h - 1, 360), math.min(x + w - 1, 640)
+        if y1 > y2 or x1 > x2 then return end
+        frame[{ {}, {y1, y2}, {x1, x2} }]:copy(
+            s[{ {}, {y1 - y + 1, y2 - y + 1}, {x1 - x + 1, x2 - x + 1} }])
+    end
+
+    local function draw_at(s, loc)
+        draw(s, loc.h1, loc.w1)
+    end
+
+    -- Initialize the game environment.
+    -- 'game' is the name of the game, default to 'galaga'.
+    -- 'display_freq' is the frame interval for display (0 for none); frames
+    -- are published for a viewer (shmpub/shmview). Display is disabled if
+    -- the shmpub module is not available, or its shared memory could not
+    -- be created.
+    function gameenv.init(game, display_freq)
+        disp = display_freq or 0
+
+        gameenv.game = game or 'galaga'
+        assert(gameenv.game == 'galaga', gameenv.game .. ' not supported!')
+
+        if not galaga_image then  -- shared by all environments
+            galaga_image = torch.load('galaga/galaga_image.t7')
+            local loc = galaga_image.raw_loc
+            FX1, FX2, FY1, FY2 = loc.w1, loc.w2, loc.h1, loc.h2
+            SHIP_Y = FY2 - 24
+            make_sprites()
+        end
+
+        frame = torch.ByteTensor(1, 360, 640)
+        rawstate = torch.ByteTensor(1, FY2 - FY1 + 1, FX2 - FX1 + 1)
+        screen = torch.ByteTensor(1, 84, 84)
+
+        if disp ~= 0 then
+            local ok, m = pcall(require, 'shmpub/shmpub')
+            if ok and m.init('galaga (sim)') == 0 then
+                shmpub = m
+            else
+                print('gameenv-sim: shmpub not available, display disabled')
+                disp = 0
+            end
+        end
+        gameenv.is_initialized = true
+    end
+
+    -- Clean up the game environment.
+    function gameenv.cleanup()
+        if shmpub then shmpub.cleanup() end
+        gameenv.is_initialized = false
+    end
+
+    -- Get the list of available actions (the same as gameenv-threaded).
+    function gameenv.get_actions()
+        assert(gameenv.is_initialized, 'get_action() called while gameenv is not initialized')
+        return { 1, 2, 3, 4, 5, 6 }
+    end
+
+    local function new_stage()
+        g.stage = g.stage + 1
+        g.enemies = {}
+        for r = 1, ROWS do
+            for c = 1, COLS do
+                g.enemies[#g.enemies + 1] = {
+                    row = r, col = c, alive = true, diving = false,
+                    y = FY1 + 30 + (r - 1) * 20, x = 0 }
+            end
+        end
+    end
+
+    -- Discard current game and start a new one.
+    function gameenv.new_game()
+        g.score = 0
+        g.reserve = 2           -- fighters left besides the one in play
+        g.ship_x = math.floor((FX1 + FX2 - SHIP) / 2)
+        g.respawn = 0
+        g.cooldown = 0
+        g.bullets = {}
+        g.enemy_bullets = {}
+        g.t = 0
+        g.stage = 0
+        g.over = false
+        new_stage()
+        gameenv.last_score = 0
+        gameenv.is_terminated = false
+        gameenv.action = 2
+    end
+
+    -- the fighter is hit: take the next one, or end the game
+    local function lose_fighter()
+        g.bullets = {}
+        g.enemy_bullets = {}
+        if g.reserve == 0 then
+            g.over = true
+        else
+            g.reserve = g.reserve - 1
+            g.respawn = RESPAWN
+        end
+    end
+
+    local function update(a)
+        g.t = g.t + 1
+        g.cooldown = math.max(0, g.cooldown - 1)
+
+        -- fighter
+        if g.respawn > 0 then
+            g.respawn = g.respawn - 1
+        else
+            if a == 1 or a == 4 then g.ship_x = g.ship_x - SPEED end
+            if a == 3 or a == 6 then g.ship_x = g.ship_x + SPEED end
+            g.ship_x = math.max(FX1 + 6, math.min(FX2 - 6 - SHIP, g.ship_x))
+            if (a == 4 or a == 5 or a == 6) and g.cooldown == 0 and #g.bullets < 2 then
+                g.bullets[#g.bullets + 1] = { y = SHIP_Y - 6, x = g.ship_x + 5 }
+                g.cooldown = 6
+            end
+        end
+
+        -- enemies: the formation sways, divers home in on the fighter
+        local sway = math.floor(20 * math.sin(g.t / 30))
+        local left = FX1 + math.floor((FX2 - FX1 + 1 - COLS * SPACING) / 2)
+        local alive = {}
+        for _, e in ipairs(g.enemies) do
+            if e.alive then
+                alive[#alive + 1] = e
+                if e.diving then
+                    e.y = e.y + DIVE_SPEED
+                    if e.x < g.ship_x then e.x = e.x + 2 elseif e.x > g.ship_x then e.x = e.x - 2 end
+                    if torch.uniform() < P_ENEMY_FIRE then
+                        g.enemy_bullets[#g.enemy_bullets + 1] = { y = e.y + ENEMY, x = e.x + 4 }
+                    end
+                    if e.y > FY2 then  -- back to the formation
+                        e.diving = false
+                        e.y = FY1 + 30 + (e.row - 1) * 20
+                    end
+                else
+                    e.x = left + (e.col - 1) * SPACING + sway
+                end
+            end
+        end
+        if #alive == 0 then
+            new_stage()
+            return 0
+        end
+        if torch.uniform() < P_DIVE then
+            alive[torch.random(1, #alive)].diving = true
+        end
+
+        -- bullets
+        local reward = 0
+        local bullets = {}
+        for _, b in ipairs(g.bullets) do
+            b.y = b.y - BULLET_SPEED
+            local hit = false
+            for _, e in ipairs(alive) do
+                if e.alive and overlap(b.y, b.x, 6, 2, e.y, e.x, ENEMY, ENEMY) then
+                    e.alive = false
+                    hit = true
+                    reward = reward + (e.diving and 100 or 50)
+                    break
+                end
+            end
+            if not hit and b.y >= FY1 then bullets[#bullets + 1] = b end
+        end
+        g.bullets = bullets
+
+        if g.respawn == 0 then
+            local enemy_bullets = {}
+            for _, b in ipairs(g.enemy_bullets) do
+                b.y = b.y + ENEMY_BULLET_SPEED
+                if overlap(b.y, b.x, 4, 2, SHIP_Y, g.ship_x, SHIP, SHIP) then
+                    lose_fighter()
+                    return reward
+                end
+                if b.y <= FY2 then enemy_bullets[#enemy_bullets + 1] = b end
+            end
+            g.enemy_bullets = enemy_bullets
+            for _, e in ipairs(alive) do
+                if e.alive and e.diving and
+                   overlap(e.y, e.x, ENEMY, ENEMY, SHIP_Y, g.ship_x, SHIP, SHIP) then
+                    e.alive = false
+                    lose_fighter()
+                    return reward
+                end
+            end
+        end
+        return reward
+    end
+
+    local function render()
+        frame:zero()
+
+        -- HUD
+        draw_at(sprites.high, galaga_image.high_loc)
+        local s = g.score
+        for i = 1, 6 do
+            draw_at(sprites.digit[s % 10], galaga_image.score_loc[i])
+            s = math.floor(s / 10)
+            if s == 0 then break end
+        end
+        for i = 1, g.reserve do
+            draw_at(sprites.ship, galaga_image.fighter_loc[i])
+        end
+        if g.over then
+            draw_at(sprites.result, galaga_image.result_loc)
+            return
+        end
+        draw_at(sprites.flag, galaga_image.flag_loc)
+
+        -- playfield
+        for _, e in ipairs(g.enemies) do
+            if e.alive then draw(sprites.enemy, e.y, e.x) end
+        end
+        for _, b in ipairs(g.bullets) do draw(sprites.bullet, b.y, b.x) end
+        for _, b in ipairs(g.enemy_bullets) do draw(sprites.enemy_bullet, b.y, b.x) end
+        if g.respawn == 0 then draw(sprites.ship, SHIP_Y, g.ship_x) end
+    end
+
+    -- Take one step for the game.
+    -- 'a' is the action specified by caller (0 releases all buttons). 'a'
+    -- could be nil, which means no change from previous step.
+    -- Returns 'screen', 'reward' and 'terminal'. Note 'screen' is reused by
+    -- the next step() call.
+    function gameenv.step(a)
+        if a then gameenv.action = a end
+
+        local reward = 0
+        if not g.over then
+            reward = update(gameenv.action)
+            g.score = g.score + reward
+        end
+        render()
+
+        frames = frames + 1
+        if disp ~= 0 and frames % disp == 0 then shmpub.display(frame) end
+
+        -- same as gameenv-threaded: blank the leftmost and rightmost
+        -- columns and scale down to 84x84, in gray levels
+        rawstate:copy(frame[{ {}, {FY1, FY2}, {FX1, FX2} }])
+        rawstate[{ {}, {}, {1, 5} }]:fill(0)
+        rawstate[{ {}, {}, {331, 336} }]:fill(0)
+        image.scale(screen, rawstate, 'bilinear')
+
+        if gameenv.is_terminated then
+            return screen, 0, true
+        end
+        gameenv.last_score = g.score
+        gameenv.is_terminated = g.over
+        return screen, reward, gameenv.is_terminated
+    end
+
+    -- Return current score of the game.
+    function gameenv.get_score()
+        return gameenv.last_score
+    end
+
+    -- Return the last rendered 640x360 frame, a (1, 360, 640) ByteTensor (for
+    -- testing, e.g. parsing it with the galaga module).
+    function gameenv.get_frame()
+        return frame
+    end
+
+    gameenv.new = create
+    return gameenv
+end
+
+return create()
@@ -9,6 +9,17 @@
 -- thread, so as to offload main thread, which could spend more time handling
 -- neural network (perceive/train) tasks.
 --
+-- Only the parts of the frame which the "galaga" module reads (the
+-- playfield and the HUD rectangles) are captured, see vidcap.set_roi():
+-- they are converted at their places in the image, and the rest of it
+-- stays black (also in the frames displayed).
+--
+-- The supporting thread waits for the frames on an event loop (see
+-- term.evloop()): it is woken up as soon as the capture device is
+-- readable, takes the frames with vidcap.poll_rois(), and also wakes up
+-- every 0.1 second without frames, so that a stalled device is
+-- reconnected.
+--
 --------------------------------------------------------------------------------
 -- jkjung, 2017-03-10
 --------------------------------------------------------------------------------
@@ -17,6 +28,9 @@ require 'torch'
 
 local threads = require 'threads'
 local gpio = require 'gpio/gpio'
+local term = require 'term/term'
+local metrics = require 'metrics/metrics'
+local trace = require 'trace/trace'
 
 local gameenv = {}
 gameenv.is_initialized = false
@@ -24,13 +38,18 @@ gameenv.is_terminated= true
 gameenv.thread = nil
 
 local step_state
+local M_GPIO_WRITE = metrics.histogram('gpio_write')
+local T_STEP = trace.name('step')
 
 -- Initialize the game environment.
 -- 'game' is the name of the game, default to 'galaga'.
 -- 'display_freq' is the frame interval for display, default to 1 frame.
 -- Note that display could be disabled by setting display_freq to 0
-function gameenv.init(game, display_freq)
+-- 'pool' is how the 2 video frames per step are combined: 'drop' (the
+-- 1st one, default), 'max' or 'avg', see vidcap.set_pool()
+function gameenv.init(game, display_freq, pool)
     local display_freq = display_freq or 1
+    local pool = pool or 'drop'
     local tensor_type = torch.getdefaulttensortype()
 
     -- we only support Galaga for now, might expand the list of
@@ -44,8 +63,16 @@ function gameenv.init(game, display_freq)
         function ()
             require 'image'
             t_vidcap = require 'vidcap/vidcap'
+            t_term = require 'term/term'
             t_galaga = require 'galaga/galaga'
-            t_imshow = require 'imshow/imshow'
+            t_shmpub = require 'shmpub/shmpub'
+            t_metrics = require 'metrics/metrics'
+            t_M_PARSE = t_metrics.histogram('parse')
+            t_M_CAPTURE_WAIT = t_metrics.histogram('capture_wait')
+            t_trace = require 'trace/trace'
+            t_T_PARSE = t_trace.name('parse')
+            t_T_DEQUEUE = t_trace.name('dequeue')
+            t_trace.thread_name('gameenv worker')
             t_disp = display_freq
             t_frames = 0
             t_last_score = 0
@@ -55,16 +82,60 @@ function gameenv.init(game, display_freq)
             -- init the vidcap module
             t_img = t_vidcap.create_image()
             assert(t_vidcap.init() == 0, 'vidcap.init() failed!')
+            t_vidcap.set_pool(pool)
+            -- the regions read by t_galaga, 1 column wider for its
+            -- work-around of shifted pixels (see galaga.has_HIGH())
+            local gi = torch.load('galaga/galaga_image.t7')
+            local locs = { gi.raw_loc, gi.high_loc, gi.flag_loc, gi.result_loc }
+            for i = 1, 6 do locs[#locs + 1] = gi.score_loc[i] end
+            for i = 1, 3 do locs[#locs + 1] = gi.fighter_loc[i] end
+            t_img:zero()
+            for i, loc in ipairs(locs) do
+                local l = { h1 = loc.h1, h2 = loc.h2,
+                            w1 = loc.w1, w2 = math.min(loc.w2 + 1, 640) }
+                t_vidcap.set_roi(i, l, 1, t_img[{ {}, {l.h1, l.h2}, {l.w1, l.w2} }])
+            end
             if t_disp ~= 0 then
-                -- create the display window
-                t_imshow.init('nintendo galaga')
+                -- publish the frames for a viewer (shmpub/shmview)
+                if t_shmpub.init('nintendo galaga') ~= 0 then
+                    print('gameenv-threaded: shmpub not available, display disabled')
+                    t_disp = 0
+                end
+            end
+
+            -- the event loop: the device's fd (id 1), which is another
+            -- one after a reconnection (or none, if it failed)
+            t_loop = t_term.evloop()
+            t_watch_device = function ()
+                t_loop:remove(1)
+                local fd = t_vidcap.fd()
+                if fd >= 0 then t_loop:add_fd(fd, 1) end
+            end
+            t_watch_device()
+            -- wait for the next frame, and convert its regions
+            t_next_frame = function ()
+                local t = t_metrics.now()
+                while true do
+                    local got, reconnected = t_vidcap.poll_rois()
+                    if got then break end
+                    if reconnected then t_watch_device() end
+                    for _ in t_loop:wait(100) do end
+                end
+                local t1 = t_metrics.now()
+                t_metrics.record(t_M_CAPTURE_WAIT, t1 - t)
+                t_trace.span(t_T_DEQUEUE, t, t1, t_frames + 1)
             end
         end)
 
     -- init gpio pins
     local pins = { 36, 37, 184, 219, 38, 63 }
     for i = 1, #pins do gpio.export(pins[i]) end
-    os.execute('sleep 1')  -- sleep 1 sec to make sure udev rules take effect
+    -- wait 1 sec (on a timer) to make sure udev rules take effect
+    local loop = term.evloop()
+    loop:add_timer(1)
+    loop:set_timer(1, 1)
+    for _ in loop:wait(-1) do end
+    loop:destroy()
     for i = 1, #pins do gpio.set_output(pins[i]) end
     for i = 1, #pins do gpio.set_low(pins[i]) end
 
@@ -80,7 +151,13 @@ function gameenv.cleanup()
     -- terminate the supporting thread
     gameenv.thread:addjob(
         function ()
-            t_imshow.cleanup()
+            local n, seconds = t_vidcap.outages()
+            if n > 0 then
+                print(string.format('vidcap: device reconnected %d times, %.2f s without frames',
+                                    n, seconds))
+            end
+            t_loop:destroy()
+            t_shmpub.cleanup()
             t_vidcap.cleanup()
         end)
     gameenv.thread:terminate()
@@ -124,10 +201,10 @@ local function preview_frames(n)
         function ()
             if n > 1 then t_vidcap.flush() end
             for i = 1, n do
-                t_vidcap.get(t_img)
+                t_next_frame()
                 t_frames = t_frames + 1
                 if t_disp ~= 0 and t_frames % t_disp == 0 then
-                    t_imshow.display(t_img)
+                    t_shmpub.display(t_img)
                 end
             end
             return { high = t_galaga.has_HIGH(t_img),
@@ -148,20 +225,26 @@ local function step_1_frame()
     -- queue a new job to the supporting thread
     gameenv.thread:addjob(
         function ()
-            t_vidcap.get(t_img)
+            t_next_frame()
             t_frames = t_frames + 1
             if t_disp ~= 0 and t_frames % t_disp == 0 then
-                t_imshow.display(t_img)
+                t_shmpub.display(t_img)
             end
-            local s = t_galaga.crop_rawstate(t_img):type(torch.getdefaulttensortype()):div(256)  -- normalize pixel values to [0, 1)
+            local t = t_metrics.now()
+            local s = t_galaga.crop_rawstate(t_img):clone()  -- in gray levels, see dqn-deepmind/ByteInput.lua
             assert(s:size(2) == 336 and s:size(3) == 336)
             s[{ {}, {}, {1, 5} }]:fill(0)
             s[{ {}, {}, {331, 336} }]:fill(0)
             local screen = image.scale(s, 84, 84)
-            return { screen = screen,
-                     score = t_galaga.get_score(t_img),
-                     high = t_galaga.has_HIGH(t_img),
-                     result = t_galaga.has_RESULT(t_img) }
+            local ret = { screen = screen,
+                          time = t_vidcap.timestamp(),
+                          score = t_galaga.get_score(t_img),
+                          high = t_galaga.has_HIGH(t_img),
+                          result = t_galaga.has_RESULT(t_img) }
+            local t1 = t_metrics.now()
+            t_metrics.record(t_M_PARSE, t1 - t)
+            t_trace.span(t_T_PARSE, t, t1, t_frames)
+            return ret
         end,
         function (t)
             step_state = t
@@ -174,29 +257,40 @@ end
 -- while 0 is a special case used to indicate no-op (release all buttons).
 -- take_actions() is now hard-coded for Galaga...
 -- 1~6
-local function take_action(a)
-    -- set all gpio pins to low (release all buttons)
-    local pins = { 36, 37, 184, 219, 38, 63 }
-    for i = 1, #pins do gpio.set_low(pins[i]) end
+--
+--   GPIO pin #    Nintendo button
+--      36             Left
+--      37             Right
+--      38             A (Fire)
+--
+-- All the pins are written in one gpio.set_mask() call: a pin is set high
+-- (button pressed) if its bit is set in the mask of the action, and low
+-- (released) otherwise.
+local action_pins = { 36, 37, 184, 219, 38, 63 }
+local action_masks = {
+    [0] = 0,    -- release all buttons
+    1,          -- Left
+    0,          -- Stay
+    2,          -- Right
+    1 + 16,     -- L + F
+    16,         -- Fire
+    2 + 16,     -- R + F
+}
 
-    --   GPIO pin #    Nintendo button
-    --      36             Left
-    --      37             Right
-    --      38             A (Fire)
-
-    -- set corresponding gpio pin(s) to high (press certain buttons)
-    if a == 1 then gpio.set_high(36) end                    -- Left
-    if a == 3 then gpio.set_high(37) end                    -- Right
-    if a == 5 then gpio.set_high(38) end                    -- Fire
-    if a == 4 then gpio.set_high(36) gpio.set_high(38) end  -- L + F
-    if a == 6 then gpio.set_high(37) gpio.set_high(38) end  -- R + F
+local function take_action(a)
+    local t = metrics.now()
+    gpio.set_mask(action_pins, action_masks[a])
+    metrics.record(M_GPIO_WRITE, metrics.now() - t)
 end
 
 -- Discard current game, and try to start a new game.
 -- new_game() is hard-coded for Galaga...
 -- Note the program could busy-wait for a long time, or even forever (if
 -- the Nintendo game console is not under Galaga game...)
-function gameenv.new_game()
+-- If 'manual', the Start button is left to a human player (the pins are
+-- monitored as inputs, see record-demo.lua), and the program waits for
+-- the new game as long as it takes.
+function gameenv.new_game(manual)
     local start_ok = false
     local t
     gameenv.last_score = 0
@@ -210,9 +304,16 @@ function gameenv.new_game()
         end
     end
 
+    if manual then
+        -- wait for the player to press Start
+        repeat t = preview_frames(10) until t.high and t.lives == 3
+        start_ok = true
+    end
+
     -- try pressing Start button up to 10 times
     -- expect to see a game screen with 3 lives
     for i = 1, 10 do
+        if start_ok then break end
         start_button(true)
         t = preview_frames(10)
         start_button(false)
@@ -257,19 +358,24 @@ end
 -- Take one step for the game.
 -- 'a' is the action specified by caller. 'a' could be nil, which means
 -- no change from previous step.
--- Returns 'screen', 'reward' and 'terminal'.
+-- Returns 'screen', 'reward' and 'terminal'. gameenv.frame_time is set
+-- to the capture time of 'screen' (CLOCK_MONOTONIC seconds, see
+-- vidcap.timestamp()).
 function gameenv.step(a)
     -- assign a small negative reward as default, to discourage the behavior:
     -- (1) dodging at the corner without trying to take out any enemies,
     -- (2) intentionally colliding with enemies to get some score.
     -- local reward = -0.01
     local reward = 0
+    local tic = trace.now()
 
     if a then take_action(a) end
 
     local t = step_1_frame()
+    gameenv.frame_time = t.time
 
     if gameenv.is_terminated then
+        trace.span(T_STEP, tic)
         return t.screen, 0, true
     end
 
@@ -288,6 +394,7 @@ function gameenv.step(a)
     if t.result == true or t.high == false then
         gameenv.is_terminated = true
     end
+    trace.span(T_STEP, tic)
     return t.screen, reward, gameenv.is_terminated
 end
 
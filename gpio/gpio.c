@@ -6,6 +6,10 @@
  *  This code implements TX1 GPIO API for Lua by FFI. It uses jetsonGPIO
  *  code from JetsonHacks.com.
  *
+ *  gpio_set_mask() sets a group of pins (e.g. all the buttons of the
+ *  game controller) in one call, and records it as a trace event
+ *  (../trace).
+ *
  *  PROCESS:
  *
  *  GLOBALS:
@@ -18,6 +22,8 @@
  *
  *    Date             Description                             Author
  *    2017-02-16       initial coding                          jkjung
+ *    2026-10-18       gpio_set_mask()                         agent
+ *    2026-10-18       trace name registered lazily            agent
  *
  *  TARGET: Linux C
  *
@@ -26,6 +32,9 @@
 #include <unistd.h>
 #include <stdlib.h>
 #include "jetsonGPIO.h"
+#include "../trace/trace.h"
+
+static int t_set_mask = -1;
 
 #if 0
 void gpio_export(int pin);
@@ -33,6 +42,7 @@ void gpio_unexport(int pin);
 void gpio_set_output(int pin);
 void gpio_set_high(int pin);
 void gpio_set_low(int pin);
+void gpio_set_mask(const int *pins, int n, unsigned int mask);
 #endif /* 0 */ 
 
 void gpio_export(int pin)
@@ -59,3 +69,18 @@ void gpio_set_low(int pin)
 {
         gpioSetValue(pin, low);
 }
+
+/* set pins[i] high if bit i of 'mask' is set, otherwise low */
+void gpio_set_mask(const int *pins, int n, unsigned int mask)
+{
+        double t = trace_now();
+        int i;
+
+        /* registered on the 1st call (trace_name() returns the same id
+         * to every caller) */
+        if (t_set_mask < 0)
+                t_set_mask = trace_name("gpio_set_mask");
+        for (i = 0; i < n; i++)
+                gpioSetValue(pins[i], (mask >> i) & 1 ? high : low);
+        trace_span(t_set_mask, t, trace_now(), mask);
+}
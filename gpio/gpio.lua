@@ -5,6 +5,11 @@
 -- This module implements GPIO output functions through FFI. The underlying
 -- C code uses /sys/class/gpio interface to access GPIO.
 --
+-- monitor_start() turns pins into inputs watched by a thread of the C
+-- library (edge interrupts, see monitor.c), e.g. to record the buttons a
+-- human presses on the game controller. Button masks have bit i-1 set for
+-- pins[i]; times are CLOCK_MONOTONIC seconds, as vidcap.timestamp().
+--
 -- Note the following gpio pins are available on J21 of Jetson TX1:
 -- 36, 37, 38, 63, 184, 186, 187, 219
 --
@@ -23,6 +28,13 @@ ffi.cdef [[
     void gpio_set_output(int pin);
     void gpio_set_high(int pin);
     void gpio_set_low(int pin);
+    void gpio_set_mask(const int *pins, int n, unsigned int mask);
+
+    int      gpio_monitor_start(const int *pins, int n, int active_low);
+    unsigned gpio_monitor_mask(void);
+    unsigned gpio_monitor_held(double t0, double t1);
+    int      gpio_monitor_events(double *t, unsigned *mask, int max);
+    void     gpio_monitor_stop(void);
 ]]
 
 function gpio.export(p)     lib.gpio_export(p)     end
@@ -31,4 +43,46 @@ function gpio.set_output(p) lib.gpio_set_output(p) end
 function gpio.set_high(p)   lib.gpio_set_high(p)   end
 function gpio.set_low(p)    lib.gpio_set_low(p)    end
 
+-- Set pins[i] (a table of pin numbers) high if bit i-1 of 'mask' is set,
+-- otherwise low, in one call.
+local pin_arrays = setmetatable({}, { __mode = 'k' })
+function gpio.set_mask(pins, mask)
+    local a = pin_arrays[pins]
+    if not a then
+        a = ffi.new('int[?]', #pins, pins)
+        pin_arrays[pins] = a
+    end
+    lib.gpio_set_mask(a, #pins, mask)
+end
+
+-- Start watching pins[i] (a table of pin numbers, made inputs). A button
+-- is pressed when its pin is high, or low if 'active_low'.
+function gpio.monitor_start(pins, active_low)
+    local a = ffi.new('int[?]', #pins, pins)
+    assert(lib.gpio_monitor_start(a, #pins, active_low and 1 or 0) == 0,
+           'gpio: could not monitor the pins')
+end
+
+-- the mask of the buttons pressed now
+function gpio.monitor_mask() return lib.gpio_monitor_mask() end
+
+-- the mask of the buttons pressed at any time between 't0' and 't1'
+function gpio.monitor_held(t0, t1) return lib.gpio_monitor_held(t0, t1) end
+
+-- the button changes since the last call, as a table of {t, mask}
+local ev_t = ffi.new('double[256]')
+local ev_mask = ffi.new('unsigned[256]')
+function gpio.monitor_events()
+    local events = {}
+    repeat
+        local n = lib.gpio_monitor_events(ev_t, ev_mask, 256)
+        for i = 0, n - 1 do
+            events[#events + 1] = { t = ev_t[i], mask = ev_mask[i] }
+        end
+    until n < 256
+    return events
+end
+
+function gpio.monitor_stop() lib.gpio_monitor_stop() end
+
 return gpio
@@ -68,6 +68,19 @@
                 return -1;  \
         } while (0)
 
+/*
+ * gpioSysfsDir
+ * The sysfs GPIO directory: SYSFS_GPIO_DIR, unless overridden by the
+ * GPIO_SYSFS_DIR environment variable (e.g. a mock directory for testing
+ * and benchmarks without the GPIO hardware)
+ */
+const char *gpioSysfsDir(void)
+{
+        const char *dir = getenv("GPIO_SYSFS_DIR");
+
+        return (dir && *dir) ? dir : SYSFS_GPIO_DIR;
+}
+
 /*
  * gpioExport
  * Export the given gpio to userspace;
@@ -78,7 +91,7 @@ int gpioExport(jetsonGPIO gpio)
         int fileDescriptor, length;
         char commandBuffer[MAX_BUF];
 
-        snprintf(commandBuffer, sizeof(commandBuffer), SYSFS_GPIO_DIR  "/gpio%d/direction", gpio);
+        snprintf(commandBuffer, sizeof(commandBuffer), "%s/gpio%d/direction", gpioSysfsDir(), gpio);
         fileDescriptor = open(commandBuffer, O_WRONLY);
         if (fileDescriptor >= 0) {
                 /* the "direction" file for this gpio already exists, so don't need to do export again */
@@ -86,7 +99,8 @@ int gpioExport(jetsonGPIO gpio)
                 return 0;
         }
 
-        fileDescriptor = open(SYSFS_GPIO_DIR "/export", O_WRONLY);
+        snprintf(commandBuffer, sizeof(commandBuffer), "%s/export", gpioSysfsDir());
+        fileDescriptor = open(commandBuffer, O_WRONLY);
         if (fileDescriptor < 0)
                 error_open("gpioExport unable to open gpio%d");
 
@@ -108,7 +122,8 @@ int gpioUnexport(jetsonGPIO gpio)
         int fileDescriptor, length;
         char commandBuffer[MAX_BUF];
 
-        fileDescriptor = open(SYSFS_GPIO_DIR "/unexport", O_WRONLY);
+        snprintf(commandBuffer, sizeof(commandBuffer), "%s/unexport", gpioSysfsDir());
+        fileDescriptor = open(commandBuffer, O_WRONLY);
         if (fileDescriptor < 0)
                 error_open("gpioUnexport unable to open gpio%d");
 
@@ -130,7 +145,7 @@ int gpioSetDirection(jetsonGPIO gpio, unsigned int out_flag)
         int fileDescriptor;
         char commandBuffer[MAX_BUF];
 
-        snprintf(commandBuffer, sizeof(commandBuffer), SYSFS_GPIO_DIR  "/gpio%d/direction", gpio);
+        snprintf(commandBuffer, sizeof(commandBuffer), "%s/gpio%d/direction", gpioSysfsDir(), gpio);
         fileDescriptor = open(commandBuffer, O_WRONLY);
         if (fileDescriptor < 0)
                 error_open("gpioSetDirection unable to open gpio%d");
@@ -158,7 +173,7 @@ int gpioSetValue(jetsonGPIO gpio, unsigned int value)
         int fileDescriptor;
         char commandBuffer[MAX_BUF];
 
-        snprintf(commandBuffer, sizeof(commandBuffer), SYSFS_GPIO_DIR "/gpio%d/value", gpio);
+        snprintf(commandBuffer, sizeof(commandBuffer), "%s/gpio%d/value", gpioSysfsDir(), gpio);
         fileDescriptor = open(commandBuffer, O_WRONLY);
         if (fileDescriptor < 0)
                 error_open("gpioSetValue unable to open gpio%d");
@@ -187,7 +202,7 @@ int gpioGetValue(jetsonGPIO gpio, unsigned int *value)
         char commandBuffer[MAX_BUF];
         char ch;
 
-        snprintf(commandBuffer, sizeof(commandBuffer), SYSFS_GPIO_DIR "/gpio%d/value", gpio);
+        snprintf(commandBuffer, sizeof(commandBuffer), "%s/gpio%d/value", gpioSysfsDir(), gpio);
         fileDescriptor = open(commandBuffer, O_RDONLY);
         if (fileDescriptor < 0)
                 error_open("gpioGetValue unable to open gpio%d");
@@ -212,7 +227,7 @@ int gpioSetEdge(jetsonGPIO gpio, char *edge)
         int fileDescriptor;
         char commandBuffer[MAX_BUF];
 
-        snprintf(commandBuffer, sizeof(commandBuffer), SYSFS_GPIO_DIR "/gpio%d/edge", gpio);
+        snprintf(commandBuffer, sizeof(commandBuffer), "%s/gpio%d/edge", gpioSysfsDir(), gpio);
         fileDescriptor = open(commandBuffer, O_WRONLY);
         if (fileDescriptor < 0)
                 error_open("gpioSetEdge unable to open gpio%d");
@@ -234,7 +249,7 @@ int gpioActiveLow(jetsonGPIO gpio, unsigned int value)
         int fileDescriptor;
         char commandBuffer[MAX_BUF];
 
-        snprintf(commandBuffer, sizeof(commandBuffer), SYSFS_GPIO_DIR "/gpio%d/active_low", gpio);
+        snprintf(commandBuffer, sizeof(commandBuffer), "%s/gpio%d/active_low", gpioSysfsDir(), gpio);
         fileDescriptor = open(commandBuffer, O_WRONLY);
         if (fileDescriptor < 0)
                 error_open("gpioActiveLow unable to open gpio%d");
@@ -49,7 +49,7 @@
 #define JETSONGPIO_H_
 
 #define SYSFS_GPIO_DIR "/sys/class/gpio"
-#define MAX_BUF        64
+#define MAX_BUF        256  /* room for an overridden sysfs directory */
 
 typedef unsigned int jetsonGPIO;
 typedef unsigned int pinDirection;
@@ -78,6 +78,7 @@ enum jetsonTX1GPIONumber {
         gpio219 = 219,  /* J21 - Pin 29 - Output - GPIO19_AUD_RST     */
 };
 
+const char *gpioSysfsDir(void);
 int gpioExport(jetsonGPIO gpio);
 int gpioUnexport(jetsonGPIO gpio);
 int gpioSetDirection(jetsonGPIO, pinDirection out_flag);
@@ -0,0 +1,268 @@
+/*
+ *  monitor.c
+ *
+ *  DESCRIPTION:
+ *
+ *  GPIO input monitor, for recording the buttons a human presses on the
+ *  game controller (see record-demo.lua). The controller lines which are
+ *  otherwise driven by gpio_set_mask() are made inputs with edge
+ *  interrupts on both edges (gpioSetEdge), and a dedicated thread waits
+ *  for edges with poll() on their sysfs value files. Every change of the
+ *  buttons is kept, as the mask of pressed buttons (bit i for pins[i])
+ *  and a CLOCK_MONOTONIC timestamp, in a ring of the latest MON_RING
+ *  changes; V4L2 frame timestamps are on the same clock, so the buttons
+ *  held between 2 frames could be looked up (gpio_monitor_held).
+ *
+ *  The values are also read every MON_POLL_MS, in case an edge is missed
+ *  (or the lines have no interrupts, e.g. a mock sysfs directory).
+ *
+ *  PROCESS:
+ *
+ *  int      gpio_monitor_start(const int *pins, int n, int active_low);
+ *  unsigned gpio_monitor_mask(void);
+ *  unsigned gpio_monitor_held(double t0, double t1);
+ *  int      gpio_monitor_events(double *t, unsigned *mask, int max);
+ *  void     gpio_monitor_stop(void);
+ *
+ *  GLOBALS:
+ *
+ *  The monitor (only 1 could run at a time).
+ *
+ *  REFERENCE:
+ *
+ *  1. Documentation/gpio/sysfs.txt ("value" ... poll(2) ... POLLPRI)
+ *
+ *  LIMITATIONS:
+ *
+ *  1. gpio_monitor_held() only knows the latest MON_RING changes.
+ *  2. gpio_monitor_events() must be called from 1 thread.
+ *
+ *  REVISION HISTORY:
+ *
+ *    Date             Description                                   Author
+ *    2026-10-18       initial coding                                agent
+ *
+ *  TARGET: Linux C
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <pthread.h>
+#include "jetsonGPIO.h"
+#include "../trace/trace.h"
+
+#if 0
+int      gpio_monitor_start(const int *pins, int n, int active_low);
+unsigned gpio_monitor_mask(void);
+unsigned gpio_monitor_held(double t0, double t1);
+int      gpio_monitor_events(double *t, unsigned *mask, int max);
+void     gpio_monitor_stop(void);
+#endif /* 0 */
+
+#define MON_PINS     16
+#define MON_RING     1024       /* power of 2 */
+#define MON_POLL_MS  100
+
+struct mon_event {
+        double   t;
+        unsigned mask;
+};
+
+static struct {
+        int              running;
+        pthread_t        thread;
+        int              n;
+        int              active_low;
+        int              fds[MON_PINS];
+        int              stop_pipe[2];
+        unsigned         mask;          /* current */
+        struct mon_event ring[MON_RING];
+        unsigned long    head;          /* number of changes so far */
+        unsigned long    tail;          /* of gpio_monitor_events() */
+        int              t_edge;
+} mon = { .stop_pipe = { -1, -1 } };
+
+static double now(void)
+{
+        struct timespec ts;
+
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* the mask of pressed buttons, from the value files */
+static unsigned read_mask(void)
+{
+        unsigned mask = 0;
+        char ch;
+        int i;
+
+        for (i = 0; i < mon.n; i++) {
+                if (pread(mon.fds[i], &ch, 1, 0) == 1 &&
+                    ((ch != '0') ^ (mon.active_low != 0)))
+                        mask |= 1U << i;
+        }
+        return mask;
+}
+
+static void record(double t, unsigned mask)
+{
+        unsigned long h = mon.head;
+
+        mon.ring[h % MON_RING].t = t;
+        mon.ring[h % MON_RING].mask = mask;
+        __atomic_store_n(&mon.mask, mask, __ATOMIC_RELEASE);
+        __atomic_store_n(&mon.head, h + 1, __ATOMIC_RELEASE);
+        trace_instant(mon.t_edge, mask);
+}
+
+static void *monitor_thread(void *arg)
+{
+        struct pollfd pfd[MON_PINS + 1];
+        int i, r;
+
+        trace_thread_name("gpio monitor");
+        for (i = 0; i < mon.n; i++) {
+                pfd[i].fd = mon.fds[i];
+                pfd[i].events = POLLPRI | POLLERR;
+        }
+        pfd[mon.n].fd = mon.stop_pipe[0];
+        pfd[mon.n].events = POLLIN;
+
+        while (1) {
+                unsigned mask;
+
+                r = poll(pfd, mon.n + 1, MON_POLL_MS);
+                if (r < 0)
+                        continue;  /* EINTR */
+                if (pfd[mon.n].revents)
+                        break;
+                /* timestamp first: the edge happened before the read */
+                {
+                        double t = now();
+
+                        mask = read_mask();
+                        if (mask != mon.mask)
+                                record(t, mask);
+                }
+        }
+        return NULL;
+}
+
+/*
+ * Start monitoring pins[0..n-1] (which are made inputs); bit i of the
+ * masks is set when pins[i] is high (low if 'active_low'). Returns 0, or
+ * -1 on error.
+ */
+int gpio_monitor_start(const int *pins, int n, int active_low)
+{
+        char path[MAX_BUF];
+        int i;
+
+        if (mon.running || n <= 0 || n > MON_PINS)
+                return -1;
+        mon.n = 0;
+        mon.active_low = active_low;
+        mon.t_edge = trace_name("gpio_edge");
+        for (i = 0; i < n; i++) {
+                gpioExport(pins[i]);
+                gpioSetDirection(pins[i], inputPin);
+                gpioSetEdge(pins[i], "both");
+                snprintf(path, sizeof(path), "%s/gpio%d/value", gpioSysfsDir(), pins[i]);
+                if ((mon.fds[i] = open(path, O_RDONLY | O_NONBLOCK)) < 0) {
+                        perror(path);
+                        goto fail;
+                }
+                mon.n = i + 1;
+        }
+        if (pipe(mon.stop_pipe) < 0)
+                goto fail;
+        mon.head = mon.tail = 0;
+        mon.mask = ~0U;  /* so that the initial state is recorded */
+        record(now(), read_mask());
+        if (pthread_create(&mon.thread, NULL, monitor_thread, NULL) != 0)
+                goto fail;
+        mon.running = 1;
+        return 0;
+fail:
+        for (i = 0; i < mon.n; i++)
+                close(mon.fds[i]);
+        mon.n = 0;
+        if (mon.stop_pipe[0] >= 0) {
+                close(mon.stop_pipe[0]);
+                close(mon.stop_pipe[1]);
+                mon.stop_pipe[0] = mon.stop_pipe[1] = -1;
+        }
+        return -1;
+}
+
+/* the buttons pressed now */
+unsigned gpio_monitor_mask(void)
+{
+        return __atomic_load_n(&mon.mask, __ATOMIC_ACQUIRE);
+}
+
+/*
+ * The buttons pressed at any time between t0 and t1 (CLOCK_MONOTONIC
+ * seconds), i.e. including those pressed and released in between.
+ */
+unsigned gpio_monitor_held(double t0, double t1)
+{
+        unsigned long head = __atomic_load_n(&mon.head, __ATOMIC_ACQUIRE), i;
+        unsigned long oldest = (head > MON_RING) ? head - MON_RING : 0;
+        unsigned mask = 0;
+
+        /* from the latest change back to the 1st one at or before t0 */
+        for (i = head; i > oldest; i--) {
+                const struct mon_event *e = &mon.ring[(i - 1) % MON_RING];
+
+                if (e->t <= t1)
+                        mask |= e->mask;
+                if (e->t <= t0)
+                        break;
+        }
+        return mask;
+}
+
+/*
+ * Copy up to 'max' changes since the last call (timestamps and masks).
+ * Returns how many were copied; changes overwritten in the ring are lost.
+ */
+int gpio_monitor_events(double *t, unsigned *mask, int max)
+{
+        unsigned long head = __atomic_load_n(&mon.head, __ATOMIC_ACQUIRE);
+        int n = 0;
+
+        if (head - mon.tail > MON_RING)
+                mon.tail = head - MON_RING;
+        while (mon.tail < head && n < max) {
+                t[n] = mon.ring[mon.tail % MON_RING].t;
+                mask[n] = mon.ring[mon.tail % MON_RING].mask;
+                mon.tail++;
+                n++;
+        }
+        return n;
+}
+
+void gpio_monitor_stop(void)
+{
+        int i;
+
+        if (!mon.running)
+                return;
+        if (write(mon.stop_pipe[1], "x", 1) != 1)
+                perror("gpio_monitor_stop");
+        pthread_join(mon.thread, NULL);
+        for (i = 0; i < mon.n; i++)
+                close(mon.fds[i]);
+        close(mon.stop_pipe[0]);
+        close(mon.stop_pipe[1]);
+        mon.stop_pipe[0] = mon.stop_pipe[1] = -1;
+        mon.n = 0;
+        mon.running = 0;
+}
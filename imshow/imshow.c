@@ -6,6 +6,12 @@
  *  This code encapsulates OpenCV's (2.4.x) cvShowImage with Lua FFI,
  *  so that Torch7 code could call this modele to display images/video.
  *
+ *  In headless mode (the IMSHOW_HEADLESS environment variable is set, or
+ *  there is no X display) no window is created, and imshow_display()
+ *  only keeps a copy of the latest image. So training could run with
+ *  display enabled on a machine without a screen, and the cost of the
+ *  display path could be benchmarked without a window system.
+ *
  *  PROCESS:
  *
  *  GLOBALS:
@@ -22,6 +28,7 @@
  *
  *    Date             Description                                   Author
  *    2017-03-11       initial coding                                jkjung
+ *    2026-10-18       headless mode                                 agent
  *
  *  TARGET: Linux C
  *
@@ -32,6 +39,9 @@
 #include "opencv/highgui.h"
 
 static char imshow_name[128];
+static int  headless;
+static unsigned char *last;     /* latest image, in headless mode */
+static int  last_size;
 
 #if 0
 int  imshow_init(const char *name, int len);
@@ -41,7 +51,13 @@ void imshow_cleanup();
 
 static void bye(void)
 {
-        cvDestroyAllWindows();
+        if (headless) {
+                free(last);
+                last = NULL;
+                last_size = 0;
+        } else {
+                cvDestroyAllWindows();
+        }
 }
 
 int imshow_init(const char *name, int len)
@@ -49,14 +65,29 @@ int imshow_init(const char *name, int len)
         atexit(bye);
         if (len > 127)  len = 127;
         strncpy(imshow_name, name, len);
-        cvNamedWindow(imshow_name, CV_WINDOW_AUTOSIZE);
+        headless = getenv("IMSHOW_HEADLESS") != NULL || getenv("DISPLAY") == NULL;
+        if (!headless)
+                cvNamedWindow(imshow_name, CV_WINDOW_AUTOSIZE);
         return 0;
 }
 
 /* Display 1 image frame (grayscale) */
 void imshow_display(unsigned char *buf, int w, int h)
 {
-        CvMat mat = cvMat(h, w, CV_8UC1, buf);
+        CvMat mat;
+
+        if (headless) {
+                if (w * h > last_size) {
+                        free(last);
+                        last_size = 0;
+                        if ((last = malloc(w * h)) == NULL)
+                                return;
+                        last_size = w * h;
+                }
+                memcpy(last, buf, w * h);
+                return;
+        }
+        mat = cvMat(h, w, CV_8UC1, buf);
         cvShowImage(imshow_name, &mat);
         cvWaitKey(1);
 }
@@ -0,0 +1,403 @@
+/*
+ *  metrics.c
+ *
+ *  DESCRIPTION:
+ *
+ *  Low-overhead latency histograms and counters for the hot paths of the
+ *  training loop (video capture, conversion, Galaga parsing, preprocess,
+ *  perceive, training steps, GPIO writes, checkpoints, ...), used by the
+ *  other native libraries directly and by Lua code through FFI
+ *  (metrics/metrics.lua).
+ *
+ *  Metrics live in one process-wide registry, looked up by name, so every
+ *  thread (and every Lua state, e.g. the learner thread's) records into
+ *  the same ones. Registration takes a lock; recording is lock-free: a
+ *  few relaxed atomic additions (and a compare-and-swap for the maximum).
+ *
+ *  Histograms are HDR style (log-linear): values in nanoseconds below 16
+ *  get a bucket each, and every power of 2 above that is split into 16
+ *  buckets, so any value is known within 1/16 (~6%) over the whole
+ *  range, with a fixed array of counts and no allocation.
+ *
+ *  metrics_dump() writes all metrics to a file, either in the Prometheus
+ *  text format (the file is replaced atomically, for a local scraper) or
+ *  as CSV rows appended to the file (for trends across long runs). A
+ *  background thread could do that periodically (metrics_start_dumper()).
+ *
+ *  PROCESS:
+ *
+ *  int    metrics_histogram(const char *name);
+ *  int    metrics_counter(const char *name);
+ *  double metrics_now(void);
+ *  void   metrics_record(int id, double seconds);
+ *  void   metrics_record_ns(int id, unsigned long long ns);
+ *  void   metrics_add(int id, unsigned long long n);
+ *  unsigned long long metrics_count(int id);
+ *  double metrics_quantile(int id, double q);
+ *  int    metrics_dump(const char *path, int format);
+ *  int    metrics_start_dumper(const char *path, int format, double interval);
+ *  void   metrics_stop_dumper(void);
+ *
+ *  GLOBALS:
+ *
+ *  The registry of metrics, and the state of the dumper thread.
+ *
+ *  REFERENCE:
+ *
+ *  1. HdrHistogram, http://hdrhistogram.org/
+ *  2. Prometheus text exposition format,
+ *     https://prometheus.io/docs/instrumenting/exposition_formats/
+ *
+ *  LIMITATIONS:
+ *
+ *  1. At most METRICS_MAX metrics, which are never freed.
+ *  2. A dump is not an atomic snapshot of all metrics: recording goes on
+ *     while it is taken.
+ *
+ *  REVISION HISTORY:
+ *
+ *    Date             Description                                   Author
+ *    2026-10-18       initial coding                                agent
+ *
+ *  TARGET: Linux C
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "metrics.h"
+
+#define PATH_LEN 1024
+
+struct metric {
+        char                name[METRICS_NAME_LEN];
+        unsigned long long  count;
+        unsigned long long  sum;        /* ns for histograms */
+        unsigned long long  max;
+        unsigned long long *buckets;    /* NULL for counters */
+};
+
+static struct metric   metrics[METRICS_MAX];
+static int             nmetrics;        /* published with release semantics */
+static pthread_mutex_t reg_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static struct {
+        pthread_t       thread;
+        pthread_mutex_t lock;
+        pthread_cond_t  cond;
+        int             running;
+        char            path[PATH_LEN];
+        int             format;
+        double          interval;
+} dumper = { .lock = PTHREAD_MUTEX_INITIALIZER, .cond = PTHREAD_COND_INITIALIZER };
+
+static int bucket_of(unsigned long long v)
+{
+        int e;
+
+        if (v < METRICS_SUB)
+                return (int) v;
+        e = 63 - __builtin_clzll(v) - METRICS_SUB_BITS;
+        return METRICS_SUB + e * METRICS_SUB + (int) ((v >> e) & (METRICS_SUB - 1));
+}
+
+/* the middle of bucket 'i', in ns */
+static double bucket_value(int i)
+{
+        int e, m;
+
+        if (i < METRICS_SUB)
+                return i;
+        e = (i - METRICS_SUB) / METRICS_SUB;
+        m = (i - METRICS_SUB) % METRICS_SUB;
+        return (double) ((unsigned long long) (METRICS_SUB + m) << e) +
+               ((1ULL << e) - 1) / 2.0;
+}
+
+static struct metric *get(int id)
+{
+        if (id < 0 || id >= __atomic_load_n(&nmetrics, __ATOMIC_ACQUIRE))
+                return NULL;
+        return &metrics[id];
+}
+
+static int lookup(const char *name, int histogram)
+{
+        int i, n;
+
+        if (strlen(name) >= METRICS_NAME_LEN)
+                return -1;
+        pthread_mutex_lock(&reg_lock);
+        n = nmetrics;
+        for (i = 0; i < n; i++) {
+                if (strcmp(metrics[i].name, name) == 0) {
+                        pthread_mutex_unlock(&reg_lock);
+                        /* the same name can not be of both kinds */
+                        return ((metrics[i].buckets != NULL) == histogram) ? i : -1;
+                }
+        }
+        if (n == METRICS_MAX) {
+                pthread_mutex_unlock(&reg_lock);
+                return -1;
+        }
+        if (histogram) {
+                metrics[n].buckets = calloc(METRICS_BUCKETS, sizeof(unsigned long long));
+                if (NULL == metrics[n].buckets) {
+                        pthread_mutex_unlock(&reg_lock);
+                        return -1;
+                }
+        }
+        strcpy(metrics[n].name, name);
+        __atomic_store_n(&nmetrics, n + 1, __ATOMIC_RELEASE);
+        pthread_mutex_unlock(&reg_lock);
+        return n;
+}
+
+/* quantiles 'qs' (n of them) of the histogram of 'm', in ns */
+static void quantiles(struct metric *m, const double *qs, double *out, int n)
+{
+        unsigned long long counts[METRICS_BUCKETS], total = 0, acc;
+        int i, j;
+
+        for (i = 0; i < METRICS_BUCKETS; i++) {
+                counts[i] = __atomic_load_n(&m->buckets[i], __ATOMIC_RELAXED);
+                total += counts[i];
+        }
+        for (j = 0; j < n; j++) {
+                unsigned long long target = (unsigned long long) (qs[j] * total + 0.5);
+
+                out[j] = 0.0;
+                if (total == 0)
+                        continue;
+                if (target < 1)
+                        target = 1;
+                for (i = 0, acc = 0; i < METRICS_BUCKETS; i++) {
+                        acc += counts[i];
+                        if (acc >= target) {
+                                out[j] = bucket_value(i);
+                                break;
+                        }
+                }
+        }
+}
+
+static void write_prometheus(FILE *fp, struct metric *m)
+{
+        static const double qs[4] = { 0.5, 0.9, 0.99, 0.999 };
+        double v[4];
+        int i;
+
+        if (NULL == m->buckets) {
+                fprintf(fp, "# TYPE dqn_%s_total counter\n", m->name);
+                fprintf(fp, "dqn_%s_total %llu\n", m->name,
+                        __atomic_load_n(&m->count, __ATOMIC_RELAXED));
+                return;
+        }
+        quantiles(m, qs, v, 4);
+        fprintf(fp, "# TYPE dqn_%s_seconds summary\n", m->name);
+        for (i = 0; i < 4; i++)
+                fprintf(fp, "dqn_%s_seconds{quantile=\"%g\"} %.9f\n",
+                        m->name, qs[i], v[i] * 1e-9);
+        fprintf(fp, "dqn_%s_seconds_sum %.9f\n", m->name,
+                __atomic_load_n(&m->sum, __ATOMIC_RELAXED) * 1e-9);
+        fprintf(fp, "dqn_%s_seconds_count %llu\n", m->name,
+                __atomic_load_n(&m->count, __ATOMIC_RELAXED));
+        fprintf(fp, "# TYPE dqn_%s_seconds_max gauge\n", m->name);
+        fprintf(fp, "dqn_%s_seconds_max %.9f\n", m->name,
+                __atomic_load_n(&m->max, __ATOMIC_RELAXED) * 1e-9);
+}
+
+static void write_csv(FILE *fp, struct metric *m, double t)
+{
+        static const double qs[4] = { 0.5, 0.9, 0.99, 0.999 };
+        unsigned long long count = __atomic_load_n(&m->count, __ATOMIC_RELAXED);
+        double v[4], sum;
+
+        if (NULL == m->buckets) {
+                fprintf(fp, "%.3f,%s,%llu,,,,,,,\n", t, m->name, count);
+                return;
+        }
+        quantiles(m, qs, v, 4);
+        sum = __atomic_load_n(&m->sum, __ATOMIC_RELAXED) * 1e-9;
+        fprintf(fp, "%.3f,%s,%llu,%.9f,%.9f,%.9f,%.9f,%.9f,%.9f,%.9f\n",
+                t, m->name, count, sum, count ? sum / count : 0.0,
+                v[0] * 1e-9, v[1] * 1e-9, v[2] * 1e-9, v[3] * 1e-9,
+                __atomic_load_n(&m->max, __ATOMIC_RELAXED) * 1e-9);
+}
+
+static void *dumper_thread(void *arg)
+{
+        struct timespec ts;
+        double t;
+
+        pthread_mutex_lock(&dumper.lock);
+        while (dumper.running) {
+                clock_gettime(CLOCK_REALTIME, &ts);
+                t = ts.tv_sec + ts.tv_nsec * 1e-9 + dumper.interval;
+                ts.tv_sec = (time_t) t;
+                ts.tv_nsec = (long) ((t - ts.tv_sec) * 1e9);
+                while (dumper.running &&
+                       pthread_cond_timedwait(&dumper.cond, &dumper.lock, &ts) == 0)
+                        ;
+                metrics_dump(dumper.path, dumper.format);
+        }
+        pthread_mutex_unlock(&dumper.lock);
+        return NULL;
+}
+
+/*
+ * API
+ */
+
+/* Get (or create) the histogram 'name'. Returns its id, or -1. */
+int metrics_histogram(const char *name)
+{
+        return lookup(name, 1);
+}
+
+/* Get (or create) the counter 'name'. Returns its id, or -1. */
+int metrics_counter(const char *name)
+{
+        return lookup(name, 0);
+}
+
+/* CLOCK_MONOTONIC time in seconds, for timing what is to be recorded */
+double metrics_now(void)
+{
+        struct timespec ts;
+
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+void metrics_record(int id, double seconds)
+{
+        metrics_record_ns(id, seconds > 0 ? (unsigned long long) (seconds * 1e9) : 0);
+}
+
+void metrics_record_ns(int id, unsigned long long ns)
+{
+        struct metric *m = get(id);
+        unsigned long long max;
+
+        if (NULL == m || NULL == m->buckets)
+                return;
+        __atomic_add_fetch(&m->buckets[bucket_of(ns)], 1, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&m->count, 1, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&m->sum, ns, __ATOMIC_RELAXED);
+        max = __atomic_load_n(&m->max, __ATOMIC_RELAXED);
+        while (ns > max &&
+               !__atomic_compare_exchange_n(&m->max, &max, ns, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                ;
+}
+
+void metrics_add(int id, unsigned long long n)
+{
+        struct metric *m = get(id);
+
+        if (NULL == m || NULL != m->buckets)
+                return;
+        __atomic_add_fetch(&m->count, n, __ATOMIC_RELAXED);
+}
+
+/* number of values recorded (histograms) or the value (counters) */
+unsigned long long metrics_count(int id)
+{
+        struct metric *m = get(id);
+
+        return m ? __atomic_load_n(&m->count, __ATOMIC_RELAXED) : 0;
+}
+
+/* the 'q' quantile (0 ~ 1) of a histogram, in seconds */
+double metrics_quantile(int id, double q)
+{
+        struct metric *m = get(id);
+        double v;
+
+        if (NULL == m || NULL == m->buckets)
+                return 0.0;
+        quantiles(m, &q, &v, 1);
+        return v * 1e-9;
+}
+
+/* Write all metrics to 'path' in 'format' (METRICS_PROMETHEUS or
+ * METRICS_CSV). Returns 0, or -1 on error. */
+int metrics_dump(const char *path, int format)
+{
+        char tmp[PATH_LEN + 8];
+        struct timespec ts;
+        FILE *fp;
+        int i, n = __atomic_load_n(&nmetrics, __ATOMIC_ACQUIRE), ok;
+
+        if (strlen(path) >= PATH_LEN)
+                return -1;
+        if (METRICS_CSV == format) {
+                fp = fopen(path, "a");
+                if (NULL == fp)
+                        return -1;
+                clock_gettime(CLOCK_REALTIME, &ts);
+                fseek(fp, 0, SEEK_END);
+                if (ftell(fp) == 0)
+                        fprintf(fp, "time,name,count,sum,mean,p50,p90,p99,p999,max\n");
+                for (i = 0; i < n; i++)
+                        write_csv(fp, &metrics[i], ts.tv_sec + ts.tv_nsec * 1e-9);
+                return fclose(fp) == 0 ? 0 : -1;
+        }
+
+        /* replaced atomically, so a scraper never sees a partial file */
+        snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+        fp = fopen(tmp, "w");
+        if (NULL == fp)
+                return -1;
+        for (i = 0; i < n; i++)
+                write_prometheus(fp, &metrics[i]);
+        ok = !ferror(fp);
+        if (fclose(fp) != 0 || !ok || rename(tmp, path) != 0) {
+                remove(tmp);
+                return -1;
+        }
+        return 0;
+}
+
+/* Dump all metrics to 'path' every 'interval' seconds (and once more when
+ * stopped) on a background thread. Returns 0, or -1 on error. */
+int metrics_start_dumper(const char *path, int format, double interval)
+{
+        int ret = 0;
+
+        if (strlen(path) >= PATH_LEN || interval <= 0)
+                return -1;
+        /* the dumper thread reads all of these under the lock */
+        pthread_mutex_lock(&dumper.lock);
+        if (dumper.running) {
+                pthread_mutex_unlock(&dumper.lock);
+                return -1;
+        }
+        strcpy(dumper.path, path);
+        dumper.format = format;
+        dumper.interval = interval;
+        dumper.running = 1;
+        if (pthread_create(&dumper.thread, NULL, dumper_thread, NULL) != 0) {
+                dumper.running = 0;
+                ret = -1;
+        }
+        pthread_mutex_unlock(&dumper.lock);
+        return ret;
+}
+
+void metrics_stop_dumper(void)
+{
+        pthread_mutex_lock(&dumper.lock);
+        if (!dumper.running) {
+                pthread_mutex_unlock(&dumper.lock);
+                return;
+        }
+        dumper.running = 0;
+        pthread_cond_signal(&dumper.cond);
+        pthread_mutex_unlock(&dumper.lock);
+        pthread_join(dumper.thread, NULL);
+}
@@ -0,0 +1,42 @@
+/*
+ * metrics.h
+ */
+
+#ifndef METRICS_H_
+#define METRICS_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define METRICS_MAX         64      /* histograms and counters, in total */
+#define METRICS_NAME_LEN    48
+
+/* histogram buckets: values (in ns) below 2^SUB_BITS have a bucket each,
+ * every power of 2 above that is split into 2^SUB_BITS buckets */
+#define METRICS_SUB_BITS    4
+#define METRICS_SUB         (1 << METRICS_SUB_BITS)
+#define METRICS_BUCKETS     (METRICS_SUB + (64 - METRICS_SUB_BITS) * METRICS_SUB)
+
+enum {
+        METRICS_PROMETHEUS = 0,     /* text exposition format, overwritten */
+        METRICS_CSV = 1             /* 1 row per metric per dump, appended */
+};
+
+extern int    metrics_histogram(const char *name);
+extern int    metrics_counter(const char *name);
+extern double metrics_now(void);
+extern void   metrics_record(int id, double seconds);
+extern void   metrics_record_ns(int id, unsigned long long ns);
+extern void   metrics_add(int id, unsigned long long n);
+extern unsigned long long metrics_count(int id);
+extern double metrics_quantile(int id, double q);
+extern int    metrics_dump(const char *path, int format);
+extern int    metrics_start_dumper(const char *path, int format, double interval);
+extern void   metrics_stop_dumper(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* METRICS_H_ */
@@ -0,0 +1,81 @@
+--------------------------------------------------------------------------------
+--
+-- "metrics" module
+--
+-- This module exposes the latency histograms and counters (libmetrics.so)
+-- through FFI. The registry is shared by the whole process: the native
+-- libraries (vidcap, envpipe, ckpt) and every Lua state (e.g. the learner
+-- thread's) record into the same metrics; see metrics.c for details.
+--
+-- Usage:
+--
+--   local metrics = require 'metrics/metrics'
+--   local M_PERCEIVE = metrics.histogram('perceive')
+--   local t = metrics.now()
+--   ...
+--   metrics.record(M_PERCEIVE, metrics.now() - t)
+--
+--------------------------------------------------------------------------------
+-- agent, 2026-10-18
+--------------------------------------------------------------------------------
+
+require 'torch'
+
+local ffi = require 'ffi'
+local metrics = {}
+local lib = ffi.load(paths.cwd() .. '/metrics/libmetrics.so')
+
+-- Function prototype definition
+ffi.cdef [[
+    int    metrics_histogram(const char *name);
+    int    metrics_counter(const char *name);
+    double metrics_now(void);
+    void   metrics_record(int id, double seconds);
+    void   metrics_add(int id, unsigned long long n);
+    unsigned long long metrics_count(int id);
+    double metrics_quantile(int id, double q);
+    int    metrics_dump(const char *path, int format);
+    int    metrics_start_dumper(const char *path, int format, double interval);
+    void   metrics_stop_dumper(void);
+]]
+
+local formats = { prometheus = 0, csv = 1 }
+
+-- Get (or create) a histogram/counter by name. Returns its id (-1 if it
+-- could not be created, which makes record()/add() do nothing).
+function metrics.histogram(name) return lib.metrics_histogram(name) end
+function metrics.counter(name)   return lib.metrics_counter(name)   end
+
+-- Monotonic time in seconds.
+function metrics.now() return lib.metrics_now() end
+
+-- Record a latency (in seconds) into histogram 'id'.
+function metrics.record(id, seconds) lib.metrics_record(id, seconds) end
+
+-- Add 'n' (default 1) to counter 'id'.
+function metrics.add(id, n) lib.metrics_add(id, n or 1) end
+
+-- Number of values recorded into histogram 'id', or the value of counter
+-- 'id'.
+function metrics.count(id) return tonumber(lib.metrics_count(id)) end
+
+-- The 'q' quantile (e.g. 0.99) of histogram 'id', in seconds.
+function metrics.quantile(id, q) return lib.metrics_quantile(id, q) end
+
+-- Write all metrics to 'path' now. 'format' is 'prometheus' (default) or
+-- 'csv'. Returns true on success.
+function metrics.dump(path, format)
+    return lib.metrics_dump(path, formats[format or 'prometheus']) == 0
+end
+
+-- Dump all metrics to 'path' every 'interval' seconds on a background
+-- thread, until stop_dumper().
+function metrics.start_dumper(path, format, interval)
+    local f = formats[format or 'prometheus']
+    assert(f, 'unknown metrics format: ' .. tostring(format))
+    return lib.metrics_start_dumper(path, f, interval or 10) == 0
+end
+
+function metrics.stop_dumper() lib.metrics_stop_dumper() end
+
+return metrics
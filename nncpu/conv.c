@@ -0,0 +1,451 @@
+/*
+ *  conv.c
+ *
+ *  DESCRIPTION:
+ *
+ *  Spatial convolution layer (forward, grad-input and grad-weight) for
+ *  training on CPU, with the same NCHW tensor layout and weight layout
+ *  (out_c x in_c x kh x kw) as Torch's nn.SpatialConvolution. It is used
+ *  through nn.CPUSpatialConvolution in nncpu.lua.
+ *
+ *  Each sample is lowered to a matrix by im2col and multiplied by the
+ *  weights with nncpu_sgemm():
+ *
+ *    forward:      out[n]  = W * col(in[n]) + b
+ *    grad-input:   gin[n]  = col2im(W^T * gout[n])
+ *    grad-weight:  gW     += scale * sum_n gout[n] * col(in[n])^T
+ *
+ *  The input of the first layer of a network could also be given as
+ *  bytes (gray levels, the frames as they are kept in the replay memory)
+ *  with a scale, e.g. 1/255: the _u8 functions convert them to float in
+ *  im2col, and the scale is folded into the alpha of the GEMM, so the
+ *  minibatch is never converted to float as a whole.
+ *
+ *  The samples of a minibatch are split over the nncpu thread pool. Each
+ *  task has its own slice of the workspace (im2col buffer, GEMM packing
+ *  buffers and grad-weight/grad-bias partial sums), which is kept in the
+ *  nncpu_conv object and reused by subsequent calls; it only grows when a
+ *  larger input is seen.
+ *
+ *  PROCESS:
+ *
+ *  struct nncpu_conv *nncpu_conv_create(int in_c, int out_c, int kh, int kw,
+ *                                       int stride, int pad);
+ *  int   nncpu_conv_forward(c, int batch, int in_h, int in_w, const float *input,
+ *                           const float *weight, const float *bias, float *output);
+ *  int   nncpu_conv_backward_input(c, int batch, int in_h, int in_w,
+ *                                  const float *grad_output, const float *weight,
+ *                                  float *grad_input);
+ *  int   nncpu_conv_backward_weight(c, int batch, int in_h, int in_w,
+ *                                   const float *input, const float *grad_output,
+ *                                   float scale, float *grad_weight, float *grad_bias);
+ *  int   nncpu_conv_forward_u8(c, int batch, int in_h, int in_w,
+ *                              const unsigned char *input, float in_scale,
+ *                              const float *weight, const float *bias, float *output);
+ *  int   nncpu_conv_backward_weight_u8(c, int batch, int in_h, int in_w,
+ *                                      const unsigned char *input, float in_scale,
+ *                                      const float *grad_output, float scale,
+ *                                      float *grad_weight, float *grad_bias);
+ *  void  nncpu_conv_destroy(c);
+ *
+ *  GLOBALS: none
+ *
+ *  REFERENCE:
+ *
+ *  LIMITATIONS:
+ *
+ *  1. Stride and padding are the same in both directions.
+ *  2. bias and grad_bias may be NULL (layer without bias).
+ *  3. A nncpu_conv object should not be used by 2 threads at the same time.
+ *
+ *  REVISION HISTORY:
+ *
+ *    Date             Description                                   Author
+ *    2026-10-18       initial coding                                agent
+ *    2026-10-18       byte input with the scale folded into the GEMM  agent
+ *
+ *  TARGET: Linux C
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "nncpu.h"
+
+struct nncpu_conv {
+        int     in_c, out_c, kh, kw, stride, pad;
+        int     n_slices;       /* number of per-task workspace slices */
+        long    slice_floats;   /* size of 1 slice */
+        float  *work;
+};
+
+/* layout of a workspace slice */
+struct slice {
+        float *col;     /* K x P */
+        float *gemm;    /* NNCPU_GEMM_WORKSPACE */
+        float *gw;      /* out_c x K */
+        float *gb;      /* out_c */
+};
+
+struct conv_job {
+        struct nncpu_conv *c;
+        int          batch, in_h, in_w, out_h, out_w, ntasks;
+        const float *input, *weight, *bias, *grad_output;
+        float       *output, *grad_input;
+        const unsigned char *input_u8;  /* instead of 'input' if not NULL */
+        float        in_scale;          /* of input_u8 */
+};
+
+struct nncpu_conv *nncpu_conv_create(int in_c, int out_c, int kh, int kw,
+                                     int stride, int pad)
+{
+        struct nncpu_conv *c;
+
+        if (in_c <= 0 || out_c <= 0 || kh <= 0 || kw <= 0 || stride <= 0 || pad < 0)
+                return NULL;
+        c = (struct nncpu_conv *) calloc(1, sizeof(*c));
+        if (!c)
+                return NULL;
+        c->in_c   = in_c;
+        c->out_c  = out_c;
+        c->kh     = kh;
+        c->kw     = kw;
+        c->stride = stride;
+        c->pad    = pad;
+        return c;
+}
+
+void nncpu_conv_destroy(struct nncpu_conv *c)
+{
+        if (!c)
+                return;
+        free(c->work);
+        free(c);
+}
+
+static long round_up(long n)
+{
+        return (n + 15) & ~15L;  /* keep every buffer 64-byte aligned */
+}
+
+/* make sure there are 'ntasks' workspace slices with 'kp' floats of im2col
+ * buffer each */
+static int get_slices(struct nncpu_conv *c, int ntasks, long kp)
+{
+        long k = (long) c->in_c * c->kh * c->kw;
+        long need = round_up(kp) + round_up(NNCPU_GEMM_WORKSPACE) +
+                    round_up(c->out_c * k) + round_up(c->out_c);
+
+        if (ntasks > c->n_slices || need > c->slice_floats) {
+                void *p;
+                int n = (ntasks > c->n_slices) ? ntasks : c->n_slices;
+                long f = (need > c->slice_floats) ? need : c->slice_floats;
+
+                if (posix_memalign(&p, 64, sizeof(float) * f * n) != 0)
+                        return -1;
+                free(c->work);
+                c->work = (float *) p;
+                c->n_slices = n;
+                c->slice_floats = f;
+        }
+        return 0;
+}
+
+/* the im2col buffer is first, and gets whatever is not used by the rest */
+static void get_slice(const struct nncpu_conv *c, int idx, struct slice *s)
+{
+        long k = (long) c->in_c * c->kh * c->kw;
+        long rest = round_up(NNCPU_GEMM_WORKSPACE) + round_up(c->out_c * k) +
+                    round_up(c->out_c);
+
+        s->col  = c->work + c->slice_floats * idx;
+        s->gemm = s->col + (c->slice_floats - rest);
+        s->gw   = s->gemm + round_up(NNCPU_GEMM_WORKSPACE);
+        s->gb   = s->gw + round_up(c->out_c * k);
+}
+
+static void im2col(const struct nncpu_conv *c, const float *in, int in_h, int in_w,
+                   int out_h, int out_w, float *col)
+{
+        int ic, ky, kx, oy, ox;
+
+        for (ic = 0; ic < c->in_c; ic++) {
+                const float *plane = in + (long) ic * in_h * in_w;
+                for (ky = 0; ky < c->kh; ky++) {
+                        for (kx = 0; kx < c->kw; kx++) {
+                                for (oy = 0; oy < out_h; oy++) {
+                                        int iy = oy * c->stride + ky - c->pad;
+                                        if (iy < 0 || iy >= in_h) {
+                                                memset(col, 0, out_w * sizeof(float));
+                                                col += out_w;
+                                                continue;
+                                        }
+                                        for (ox = 0; ox < out_w; ox++) {
+                                                int ix = ox * c->stride + kx - c->pad;
+                                                *col++ = (ix >= 0 && ix < in_w) ?
+                                                         plane[iy * in_w + ix] : 0.0f;
+                                        }
+                                }
+                        }
+                }
+        }
+}
+
+/* the same as im2col(), from bytes (not scaled, see in_scale) */
+static void im2col_u8(const struct nncpu_conv *c, const unsigned char *in,
+                      int in_h, int in_w, int out_h, int out_w, float *col)
+{
+        int ic, ky, kx, oy, ox;
+
+        for (ic = 0; ic < c->in_c; ic++) {
+                const unsigned char *plane = in + (long) ic * in_h * in_w;
+                for (ky = 0; ky < c->kh; ky++) {
+                        for (kx = 0; kx < c->kw; kx++) {
+                                for (oy = 0; oy < out_h; oy++) {
+                                        int iy = oy * c->stride + ky - c->pad;
+                                        if (iy < 0 || iy >= in_h) {
+                                                memset(col, 0, out_w * sizeof(float));
+                                                col += out_w;
+                                                continue;
+                                        }
+                                        for (ox = 0; ox < out_w; ox++) {
+                                                int ix = ox * c->stride + kx - c->pad;
+                                                *col++ = (ix >= 0 && ix < in_w) ?
+                                                         (float) plane[iy * in_w + ix] : 0.0f;
+                                        }
+                                }
+                        }
+                }
+        }
+}
+
+/* lower sample 'n' of the job's input into 'col'; returns the scale of it */
+static float lower(const struct conv_job *job, int n, float *col)
+{
+        const struct nncpu_conv *c = job->c;
+        long size = (long) c->in_c * job->in_h * job->in_w;
+
+        if (job->input_u8) {
+                im2col_u8(c, job->input_u8 + n * size, job->in_h, job->in_w,
+                          job->out_h, job->out_w, col);
+                return job->in_scale;
+        }
+        im2col(c, job->input + n * size, job->in_h, job->in_w,
+               job->out_h, job->out_w, col);
+        return 1.0f;
+}
+
+static void col2im(const struct nncpu_conv *c, const float *col, int in_h, int in_w,
+                   int out_h, int out_w, float *in)
+{
+        int ic, ky, kx, oy, ox;
+
+        memset(in, 0, sizeof(float) * c->in_c * in_h * in_w);
+        for (ic = 0; ic < c->in_c; ic++) {
+                float *plane = in + (long) ic * in_h * in_w;
+                for (ky = 0; ky < c->kh; ky++) {
+                        for (kx = 0; kx < c->kw; kx++) {
+                                for (oy = 0; oy < out_h; oy++) {
+                                        int iy = oy * c->stride + ky - c->pad;
+                                        if (iy < 0 || iy >= in_h) {
+                                                col += out_w;
+                                                continue;
+                                        }
+                                        for (ox = 0; ox < out_w; ox++, col++) {
+                                                int ix = ox * c->stride + kx - c->pad;
+                                                if (ix >= 0 && ix < in_w)
+                                                        plane[iy * in_w + ix] += *col;
+                                        }
+                                }
+                        }
+                }
+        }
+}
+
+static int prepare(struct nncpu_conv *c, struct conv_job *job, int batch,
+                   int in_h, int in_w)
+{
+        int nt;
+
+        if (!c || batch <= 0 || in_h + 2 * c->pad < c->kh || in_w + 2 * c->pad < c->kw)
+                return -1;
+        job->c      = c;
+        job->batch  = batch;
+        job->in_h   = in_h;
+        job->in_w   = in_w;
+        job->out_h  = (in_h + 2 * c->pad - c->kh) / c->stride + 1;
+        job->out_w  = (in_w + 2 * c->pad - c->kw) / c->stride + 1;
+        job->input_u8 = NULL;
+        nt = nncpu_get_num_threads();
+        job->ntasks = (batch < nt) ? batch : nt;
+        return get_slices(c, job->ntasks,
+                          (long) c->in_c * c->kh * c->kw * job->out_h * job->out_w);
+}
+
+static void forward_task(void *arg, int idx, int ntasks)
+{
+        const struct conv_job *job = (const struct conv_job *) arg;
+        const struct nncpu_conv *c = job->c;
+        int k = c->in_c * c->kh * c->kw;
+        int p = job->out_h * job->out_w;
+        struct slice s;
+        int n, oc, i;
+
+        get_slice(c, idx, &s);
+        for (n = idx; n < job->batch; n += ntasks) {
+                float *out = job->output + (long) n * c->out_c * p;
+                float alpha = lower(job, n, s.col);
+
+                for (oc = 0; oc < c->out_c; oc++)
+                        for (i = 0; i < p; i++)
+                                out[oc * p + i] = job->bias ? job->bias[oc] : 0.0f;
+                nncpu_sgemm(0, 0, c->out_c, p, k, alpha, job->weight, k,
+                            s.col, p, 1.0f, out, p, s.gemm);
+        }
+}
+
+static void backward_input_task(void *arg, int idx, int ntasks)
+{
+        const struct conv_job *job = (const struct conv_job *) arg;
+        const struct nncpu_conv *c = job->c;
+        int k = c->in_c * c->kh * c->kw;
+        int p = job->out_h * job->out_w;
+        struct slice s;
+        int n;
+
+        get_slice(c, idx, &s);
+        for (n = idx; n < job->batch; n += ntasks) {
+                nncpu_sgemm(1, 0, k, p, c->out_c, 1.0f, job->weight, k,
+                            job->grad_output + (long) n * c->out_c * p, p,
+                            0.0f, s.col, p, s.gemm);
+                col2im(c, s.col, job->in_h, job->in_w, job->out_h, job->out_w,
+                       job->grad_input + (long) n * c->in_c * job->in_h * job->in_w);
+        }
+}
+
+static void backward_weight_task(void *arg, int idx, int ntasks)
+{
+        const struct conv_job *job = (const struct conv_job *) arg;
+        const struct nncpu_conv *c = job->c;
+        int k = c->in_c * c->kh * c->kw;
+        int p = job->out_h * job->out_w;
+        struct slice s;
+        int n, oc, i;
+
+        get_slice(c, idx, &s);
+        memset(s.gw, 0, sizeof(float) * c->out_c * k);
+        memset(s.gb, 0, sizeof(float) * c->out_c);
+        for (n = idx; n < job->batch; n += ntasks) {
+                const float *gout = job->grad_output + (long) n * c->out_c * p;
+                float alpha = lower(job, n, s.col);
+
+                nncpu_sgemm(0, 1, c->out_c, k, p, alpha, gout, p,
+                            s.col, p, 1.0f, s.gw, k, s.gemm);
+                for (oc = 0; oc < c->out_c; oc++) {
+                        float sum = 0.0f;
+                        for (i = 0; i < p; i++)
+                                sum += gout[oc * p + i];
+                        s.gb[oc] += sum;
+                }
+        }
+}
+
+int nncpu_conv_forward(struct nncpu_conv *c, int batch, int in_h, int in_w,
+                       const float *input, const float *weight, const float *bias,
+                       float *output)
+{
+        struct conv_job job;
+
+        if (prepare(c, &job, batch, in_h, in_w) < 0)
+                return -1;
+        job.input  = input;
+        job.weight = weight;
+        job.bias   = bias;
+        job.output = output;
+        nncpu_parallel_for(job.ntasks, forward_task, &job);
+        return 0;
+}
+
+/* forward of byte 'input', as if it were float input * in_scale */
+int nncpu_conv_forward_u8(struct nncpu_conv *c, int batch, int in_h, int in_w,
+                          const unsigned char *input, float in_scale,
+                          const float *weight, const float *bias, float *output)
+{
+        struct conv_job job;
+
+        if (prepare(c, &job, batch, in_h, in_w) < 0)
+                return -1;
+        job.input_u8 = input;
+        job.in_scale = in_scale;
+        job.weight   = weight;
+        job.bias     = bias;
+        job.output   = output;
+        nncpu_parallel_for(job.ntasks, forward_task, &job);
+        return 0;
+}
+
+int nncpu_conv_backward_input(struct nncpu_conv *c, int batch, int in_h, int in_w,
+                              const float *grad_output, const float *weight,
+                              float *grad_input)
+{
+        struct conv_job job;
+
+        if (prepare(c, &job, batch, in_h, in_w) < 0)
+                return -1;
+        job.grad_output = grad_output;
+        job.weight      = weight;
+        job.grad_input  = grad_input;
+        nncpu_parallel_for(job.ntasks, backward_input_task, &job);
+        return 0;
+}
+
+/* reduce the per-task partial sums of backward_weight_task() */
+static void reduce_weight(struct nncpu_conv *c, const struct conv_job *job,
+                          float scale, float *grad_weight, float *grad_bias)
+{
+        struct slice s;
+        long k, i;
+        int t, oc;
+
+        k = (long) c->in_c * c->kh * c->kw;
+        for (t = 0; t < job->ntasks; t++) {
+                get_slice(c, t, &s);
+                for (i = 0; i < c->out_c * k; i++)
+                        grad_weight[i] += scale * s.gw[i];
+                for (oc = 0; grad_bias && oc < c->out_c; oc++)
+                        grad_bias[oc] += scale * s.gb[oc];
+        }
+}
+
+int nncpu_conv_backward_weight(struct nncpu_conv *c, int batch, int in_h, int in_w,
+                               const float *input, const float *grad_output,
+                               float scale, float *grad_weight, float *grad_bias)
+{
+        struct conv_job job;
+
+        if (prepare(c, &job, batch, in_h, in_w) < 0)
+                return -1;
+        job.input       = input;
+        job.grad_output = grad_output;
+        nncpu_parallel_for(job.ntasks, backward_weight_task, &job);
+        reduce_weight(c, &job, scale, grad_weight, grad_bias);
+        return 0;
+}
+
+/* grad-weight for byte 'input', as if it were float input * in_scale */
+int nncpu_conv_backward_weight_u8(struct nncpu_conv *c, int batch, int in_h, int in_w,
+                                  const unsigned char *input, float in_scale,
+                                  const float *grad_output, float scale,
+                                  float *grad_weight, float *grad_bias)
+{
+        struct conv_job job;
+
+        if (prepare(c, &job, batch, in_h, in_w) < 0)
+                return -1;
+        job.input_u8    = input;
+        job.in_scale    = in_scale;
+        job.grad_output = grad_output;
+        nncpu_parallel_for(job.ntasks, backward_weight_task, &job);
+        reduce_weight(c, &job, scale, grad_weight, grad_bias);
+        return 0;
+}
@@ -0,0 +1,187 @@
+/*
+ *  gemm.c
+ *
+ *  DESCRIPTION:
+ *
+ *  Single precision matrix multiply for the nncpu convolution kernels:
+ *
+ *    C = alpha * op(A) * op(B) + beta * C
+ *
+ *  with row-major matrices, op(X) = X or X^T, op(A) M x K, op(B) K x N and
+ *  C M x N. It is cache blocked in the usual way: a KC x NC panel of op(B)
+ *  and an MC x KC block of op(A) are packed into contiguous buffers (so the
+ *  transposes cost nothing extra), and a MR x NR register-blocked micro
+ *  kernel walks over the packed data.
+ *
+ *  The function itself is single-threaded; callers parallelize over
+ *  independent GEMMs (e.g. samples of a minibatch). The packing buffers are
+ *  supplied by the caller (see NNCPU_GEMM_WORKSPACE), so nothing is
+ *  allocated here.
+ *
+ *  PROCESS:
+ *
+ *  void nncpu_sgemm(int trans_a, int trans_b, int m, int n, int k,
+ *                   float alpha, const float *a, int lda,
+ *                   const float *b, int ldb,
+ *                   float beta, float *c, int ldc, float *work);
+ *
+ *  GLOBALS: none
+ *
+ *  REFERENCE:
+ *
+ *    K. Goto and R. van de Geijn, "Anatomy of High-Performance Matrix
+ *    Multiplication", ACM TOMS 34(3), 2008.
+ *
+ *  LIMITATIONS:
+ *
+ *  REVISION HISTORY:
+ *
+ *    Date             Description                                   Author
+ *    2026-10-18       initial coding                                agent
+ *
+ *  TARGET: Linux C
+ *
+ */
+
+#include <string.h>
+#include "nncpu.h"
+#include "simd.h"
+
+#define MR  4
+#define NR  (2 * VLEN)
+
+#if NNCPU_GEMM_NC % (2 * 8) != 0
+#error "NNCPU_GEMM_NC must be a multiple of NR"
+#endif
+
+#define A_AT(i, j)  (trans_a ? a[(long) (j) * lda + (i)] : a[(long) (i) * lda + (j)])
+#define B_AT(i, j)  (trans_b ? b[(long) (j) * ldb + (i)] : b[(long) (i) * ldb + (j)])
+
+/* pack op(A)[i0:i0+mc, k0:k0+kc] into MR-row strips, k-major within a strip */
+static void pack_a(int trans_a, const float *a, int lda, int i0, int mc,
+                   int k0, int kc, float *pa)
+{
+        int i, p, r;
+
+        for (i = 0; i < mc; i += MR) {
+                for (p = 0; p < kc; p++) {
+                        for (r = 0; r < MR; r++)
+                                *pa++ = (i + r < mc) ? A_AT(i0 + i + r, k0 + p) : 0.0f;
+                }
+        }
+}
+
+/* pack op(B)[k0:k0+kc, j0:j0+nc] into NR-column strips, k-major */
+static void pack_b(int trans_b, const float *b, int ldb, int k0, int kc,
+                   int j0, int nc, float *pb)
+{
+        int j, p, r;
+
+        for (j = 0; j < nc; j += NR) {
+                if (!trans_b && j + NR <= nc) {
+                        for (p = 0; p < kc; p++) {
+                                memcpy(pb, b + (long) (k0 + p) * ldb + j0 + j, NR * sizeof(float));
+                                pb += NR;
+                        }
+                        continue;
+                }
+                for (p = 0; p < kc; p++) {
+                        for (r = 0; r < NR; r++)
+                                *pb++ = (j + r < nc) ? B_AT(k0 + p, j0 + j + r) : 0.0f;
+                }
+        }
+}
+
+/* c[MR x NR] += alpha * pa[MR x kc] * pb[kc x NR], for the valid mr x nr part */
+static void micro_kernel(int kc, float alpha, const float *pa, const float *pb,
+                         float *c, int ldc, int mr, int nr)
+{
+        vf c00 = vf_zero(), c01 = vf_zero();
+        vf c10 = vf_zero(), c11 = vf_zero();
+        vf c20 = vf_zero(), c21 = vf_zero();
+        vf c30 = vf_zero(), c31 = vf_zero();
+        vf va = vf_set1(alpha);
+        int p, i, j;
+
+        for (p = 0; p < kc; p++) {
+                vf b0 = vf_load(pb);
+                vf b1 = vf_load(pb + VLEN);
+                vf a0 = vf_set1(pa[0]);
+                vf a1 = vf_set1(pa[1]);
+                vf a2 = vf_set1(pa[2]);
+                vf a3 = vf_set1(pa[3]);
+
+                c00 = vf_madd(c00, a0, b0);  c01 = vf_madd(c01, a0, b1);
+                c10 = vf_madd(c10, a1, b0);  c11 = vf_madd(c11, a1, b1);
+                c20 = vf_madd(c20, a2, b0);  c21 = vf_madd(c21, a2, b1);
+                c30 = vf_madd(c30, a3, b0);  c31 = vf_madd(c31, a3, b1);
+                pa += MR;
+                pb += NR;
+        }
+
+        if (mr == MR && nr == NR) {
+                vf_store(c,                   vf_madd(vf_load(c),                   va, c00));
+                vf_store(c + VLEN,            vf_madd(vf_load(c + VLEN),            va, c01));
+                vf_store(c + ldc,             vf_madd(vf_load(c + ldc),             va, c10));
+                vf_store(c + ldc + VLEN,      vf_madd(vf_load(c + ldc + VLEN),      va, c11));
+                vf_store(c + 2 * ldc,         vf_madd(vf_load(c + 2 * ldc),         va, c20));
+                vf_store(c + 2 * ldc + VLEN,  vf_madd(vf_load(c + 2 * ldc + VLEN),  va, c21));
+                vf_store(c + 3 * ldc,         vf_madd(vf_load(c + 3 * ldc),         va, c30));
+                vf_store(c + 3 * ldc + VLEN,  vf_madd(vf_load(c + 3 * ldc + VLEN),  va, c31));
+        } else {
+                float t[MR * NR];
+
+                vf_store(t,                   c00);  vf_store(t + VLEN,          c01);
+                vf_store(t + NR,              c10);  vf_store(t + NR + VLEN,     c11);
+                vf_store(t + 2 * NR,          c20);  vf_store(t + 2 * NR + VLEN, c21);
+                vf_store(t + 3 * NR,          c30);  vf_store(t + 3 * NR + VLEN, c31);
+                for (i = 0; i < mr; i++)
+                        for (j = 0; j < nr; j++)
+                                c[i * ldc + j] += alpha * t[i * NR + j];
+        }
+}
+
+void nncpu_sgemm(int trans_a, int trans_b, int m, int n, int k,
+                 float alpha, const float *a, int lda,
+                 const float *b, int ldb,
+                 float beta, float *c, int ldc, float *work)
+{
+        float *pa = work;
+        float *pb = work + NNCPU_GEMM_MC * NNCPU_GEMM_KC;
+        int i, j, ii, jj, p;
+
+        if (beta == 0.0f) {
+                for (i = 0; i < m; i++)
+                        memset(c + (long) i * ldc, 0, n * sizeof(float));
+        } else if (beta != 1.0f) {
+                for (i = 0; i < m; i++)
+                        for (j = 0; j < n; j++)
+                                c[(long) i * ldc + j] *= beta;
+        }
+        if (alpha == 0.0f || k == 0)
+                return;
+
+        for (j = 0; j < n; j += NNCPU_GEMM_NC) {
+                int nc = (n - j < NNCPU_GEMM_NC) ? n - j : NNCPU_GEMM_NC;
+
+                for (p = 0; p < k; p += NNCPU_GEMM_KC) {
+                        int kc = (k - p < NNCPU_GEMM_KC) ? k - p : NNCPU_GEMM_KC;
+
+                        pack_b(trans_b, b, ldb, p, kc, j, nc, pb);
+                        for (i = 0; i < m; i += NNCPU_GEMM_MC) {
+                                int mc = (m - i < NNCPU_GEMM_MC) ? m - i : NNCPU_GEMM_MC;
+
+                                pack_a(trans_a, a, lda, i, mc, p, kc, pa);
+                                for (jj = 0; jj < nc; jj += NR) {
+                                        int nr = (nc - jj < NR) ? nc - jj : NR;
+                                        for (ii = 0; ii < mc; ii += MR) {
+                                                int mr = (mc - ii < MR) ? mc - ii : MR;
+                                                micro_kernel(kc, alpha, pa + ii * kc, pb + jj * kc,
+                                                             c + (long) (i + ii) * ldc + j + jj, ldc,
+                                                             mr, nr);
+                                        }
+                                }
+                        }
+                }
+        }
+}
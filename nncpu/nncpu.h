@@ -0,0 +1,82 @@
+/*
+ * nncpu.h
+ */
+
+#ifndef NNCPU_H_
+#define NNCPU_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* threadpool.c */
+typedef void (*nncpu_task_fn)(void *arg, int idx, int ntasks);
+
+extern void  nncpu_set_num_threads(int n);
+extern int   nncpu_get_num_threads();
+extern void  nncpu_parallel_for(int ntasks, nncpu_task_fn fn, void *arg);
+
+/* rmsprop.c */
+extern void  nncpu_rmsprop(float *w, float *dw, float *g, float *g2, long n,
+                           float lr, float wc, float decay, float eps);
+
+/* qnet.c */
+enum { NNCPU_FP32 = 0, NNCPU_FP16 = 1, NNCPU_INT8 = 2 };
+
+struct nncpu_qnet;
+
+extern struct nncpu_qnet *nncpu_qnet_create(int in_c, int in_h, int in_w);
+extern int   nncpu_qnet_add_conv(struct nncpu_qnet *q, int out_c, int kh, int kw,
+                                 int stride, int pad);
+extern int   nncpu_qnet_add_linear(struct nncpu_qnet *q, int n_out);
+extern int   nncpu_qnet_add_relu(struct nncpu_qnet *q);
+extern int   nncpu_qnet_set_precision(struct nncpu_qnet *q, int precision);
+extern int   nncpu_qnet_set_input_scale(struct nncpu_qnet *q, float scale);
+extern int   nncpu_qnet_set_weights(struct nncpu_qnet *q, int layer,
+                                    const float *weight, const float *bias);
+extern int   nncpu_qnet_num_outputs(struct nncpu_qnet *q);
+extern int   nncpu_qnet_forward(struct nncpu_qnet *q, const float *input, float *output);
+extern int   nncpu_qnet_forward_u8(struct nncpu_qnet *q, const unsigned char *input,
+                                   float *output);
+extern void  nncpu_qnet_destroy(struct nncpu_qnet *q);
+
+/* gemm.c */
+#define NNCPU_GEMM_MC  64
+#define NNCPU_GEMM_KC  256
+#define NNCPU_GEMM_NC  256
+#define NNCPU_GEMM_WORKSPACE  (NNCPU_GEMM_MC * NNCPU_GEMM_KC + NNCPU_GEMM_KC * NNCPU_GEMM_NC)
+
+extern void  nncpu_sgemm(int trans_a, int trans_b, int m, int n, int k,
+                         float alpha, const float *a, int lda,
+                         const float *b, int ldb,
+                         float beta, float *c, int ldc, float *work);
+
+/* conv.c */
+struct nncpu_conv;
+
+extern struct nncpu_conv *nncpu_conv_create(int in_c, int out_c, int kh, int kw,
+                                            int stride, int pad);
+extern int   nncpu_conv_forward(struct nncpu_conv *c, int batch, int in_h, int in_w,
+                                const float *input, const float *weight,
+                                const float *bias, float *output);
+extern int   nncpu_conv_backward_input(struct nncpu_conv *c, int batch, int in_h, int in_w,
+                                       const float *grad_output, const float *weight,
+                                       float *grad_input);
+extern int   nncpu_conv_backward_weight(struct nncpu_conv *c, int batch, int in_h, int in_w,
+                                        const float *input, const float *grad_output,
+                                        float scale, float *grad_weight, float *grad_bias);
+extern int   nncpu_conv_forward_u8(struct nncpu_conv *c, int batch, int in_h, int in_w,
+                                   const unsigned char *input, float in_scale,
+                                   const float *weight, const float *bias, float *output);
+extern int   nncpu_conv_backward_weight_u8(struct nncpu_conv *c, int batch, int in_h,
+                                           int in_w, const unsigned char *input,
+                                           float in_scale, const float *grad_output,
+                                           float scale, float *grad_weight,
+                                           float *grad_bias);
+extern void  nncpu_conv_destroy(struct nncpu_conv *c);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NNCPU_H_ */
@@ -0,0 +1,341 @@
+--------------------------------------------------------------------------------
+--
+-- "nncpu" module
+--
+-- This module exposes the CPU neural network kernels of libnncpu.so
+-- through FFI: a fused RMSProp update, a Q-network inference engine and
+-- a multithreaded convolution layer for training (nn.CPUSpatialConvolution).
+-- These kernels are used by the DQN agent when it runs without a GPU.
+--
+--------------------------------------------------------------------------------
+-- agent, 2026-10-18
+--------------------------------------------------------------------------------
+
+require 'torch'
+require 'nn'
+
+local ffi = require 'ffi'
+local nncpu = {}
+local lib = ffi.load(paths.cwd() .. '/nncpu/libnncpu.so')
+
+-- Function prototype definition
+ffi.cdef [[
+    void nncpu_set_num_threads(int n);
+    int  nncpu_get_num_threads();
+    void nncpu_rmsprop(float *w, float *dw, float *g, float *g2, long n,
+                       float lr, float wc, float decay, float eps);
+
+    struct nncpu_qnet;
+    struct nncpu_qnet *nncpu_qnet_create(int in_c, int in_h, int in_w);
+    int   nncpu_qnet_add_conv(struct nncpu_qnet *q, int out_c, int kh, int kw,
+                              int stride, int pad);
+    int   nncpu_qnet_add_linear(struct nncpu_qnet *q, int n_out);
+    int   nncpu_qnet_add_relu(struct nncpu_qnet *q);
+    int   nncpu_qnet_set_precision(struct nncpu_qnet *q, int precision);
+    int   nncpu_qnet_set_input_scale(struct nncpu_qnet *q, float scale);
+    int   nncpu_qnet_set_weights(struct nncpu_qnet *q, int layer,
+                                 const float *weight, const float *bias);
+    int   nncpu_qnet_num_outputs(struct nncpu_qnet *q);
+    int   nncpu_qnet_forward(struct nncpu_qnet *q, const float *input, float *output);
+    int   nncpu_qnet_forward_u8(struct nncpu_qnet *q, const unsigned char *input,
+                                float *output);
+    void  nncpu_qnet_destroy(struct nncpu_qnet *q);
+
+    struct nncpu_conv;
+    struct nncpu_conv *nncpu_conv_create(int in_c, int out_c, int kh, int kw,
+                                         int stride, int pad);
+    int   nncpu_conv_forward(struct nncpu_conv *c, int batch, int in_h, int in_w,
+                             const float *input, const float *weight,
+                             const float *bias, float *output);
+    int   nncpu_conv_backward_input(struct nncpu_conv *c, int batch, int in_h,
+                                    int in_w, const float *grad_output,
+                                    const float *weight, float *grad_input);
+    int   nncpu_conv_backward_weight(struct nncpu_conv *c, int batch, int in_h,
+                                     int in_w, const float *input,
+                                     const float *grad_output, float scale,
+                                     float *grad_weight, float *grad_bias);
+    int   nncpu_conv_forward_u8(struct nncpu_conv *c, int batch, int in_h, int in_w,
+                                const unsigned char *input, float in_scale,
+                                const float *weight, const float *bias, float *output);
+    int   nncpu_conv_backward_weight_u8(struct nncpu_conv *c, int batch, int in_h,
+                                        int in_w, const unsigned char *input,
+                                        float in_scale, const float *grad_output,
+                                        float scale, float *grad_weight,
+                                        float *grad_bias);
+    void  nncpu_conv_destroy(struct nncpu_conv *c);
+]]
+
+local precisions = { fp32 = 0, fp16 = 1, int8 = 2 }
+
+local function check_float(t, name)
+    assert(t:type() == 'torch.FloatTensor', name .. ' must be a FloatTensor')
+    assert(t:isContiguous(), name .. ' must be contiguous')
+end
+
+local function is_byte(t)
+    return t:type() == 'torch.ByteTensor'
+end
+
+function nncpu.set_num_threads(n) lib.nncpu_set_num_threads(n)         end
+function nncpu.get_num_threads()  return lib.nncpu_get_num_threads()   end
+
+-- Fused centered RMSProp step (see rmsprop.c), updating w, g and g2 (and
+-- dw when wc ~= 0) in place. All tensors must be contiguous FloatTensors
+-- of the same number of elements.
+function nncpu.rmsprop(w, dw, g, g2, lr, wc, decay, eps)
+    check_float(w, 'w')
+    check_float(dw, 'dw')
+    check_float(g, 'g')
+    check_float(g2, 'g2')
+    local n = w:nElement()
+    assert(dw:nElement() == n and g:nElement() == n and g2:nElement() == n)
+    lib.nncpu_rmsprop(torch.data(w), torch.data(dw), torch.data(g),
+                      torch.data(g2), n, lr, wc or 0, decay or 0.95,
+                      eps or 0.01)
+end
+
+--------------------------------------------------------------------------------
+-- QNet: CPU inference engine for a conv + linear Q-network (see qnet.c)
+--------------------------------------------------------------------------------
+
+local QNet = {}
+QNet.__index = QNet
+
+-- Build an inference engine mirroring 'network' (an nn.Sequential as built
+-- by dqn-deepmind/convnet.lua, on CPU), for a single input of 'input_dims'
+-- ({C, H, W}). 'precision' ('fp32', 'fp16' or 'int8') selects how the
+-- fully connected weights are kept. The scale of an nn.ByteInput layer is
+-- folded into the weights of the first layer. The current weights of
+-- 'network' are loaded; call sync() again after the network has been
+-- trained.
+function nncpu.qnet(network, input_dims, precision)
+    precision = precision or 'fp32'
+    assert(precisions[precision], 'unknown precision: ' .. tostring(precision))
+    assert(#input_dims == 3, 'input_dims must be {C, H, W}')
+
+    local q = lib.nncpu_qnet_create(input_dims[1], input_dims[2], input_dims[3])
+    assert(q ~= nil, 'nncpu_qnet_create() failed')
+    q = ffi.gc(q, lib.nncpu_qnet_destroy)
+
+    local layers = {}
+    for _, m in ipairs(network.modules) do
+        local name = torch.typename(m)
+        if name == 'nn.Reshape' or name == 'nn.View' then
+            -- nothing to do, the engine always flattens before linear layers
+        elseif name == 'nn.ByteInput' then
+            assert(#layers == 0, 'nncpu.qnet: nn.ByteInput must come first')
+            assert(lib.nncpu_qnet_set_input_scale(q, m.scale) == 0)
+        elseif name == 'nn.SpatialConvolution' or
+               name == 'nn.SpatialConvolutionMM' or
+               name == 'nn.CPUSpatialConvolution' then
+            assert(m.dW == m.dH and (m.padW or 0) == (m.padH or 0),
+                   'nncpu.qnet: only square stride/padding is supported')
+            assert(lib.nncpu_qnet_add_conv(q, m.nOutputPlane, m.kH, m.kW,
+                                           m.dW, m.padW or 0) >= 0,
+                   'nncpu.qnet: bad convolution layer')
+            layers[#layers + 1] = m
+        elseif name == 'nn.Linear' then
+            assert(lib.nncpu_qnet_add_linear(q, m.weight:size(1)) >= 0,
+                   'nncpu.qnet: bad linear layer')
+            layers[#layers + 1] = m
+        elseif name == 'nn.Rectifier' or name == 'nn.ReLU' then
+            assert(lib.nncpu_qnet_add_relu(q) == 0)
+        else
+            error('nncpu.qnet: unsupported module ' .. name)
+        end
+    end
+    assert(lib.nncpu_qnet_set_precision(q, precisions[precision]) == 0)
+
+    local self = setmetatable({}, QNet)
+    self.q = q
+    self.layers = layers
+    self.input_size = input_dims[1] * input_dims[2] * input_dims[3]
+    self.output = torch.FloatTensor(lib.nncpu_qnet_num_outputs(q))
+    self:sync()
+    return self
+end
+
+-- Reload (re-pack) weights from the torch modules.
+function QNet:sync()
+    for i, m in ipairs(self.layers) do
+        local w = m.weight:contiguous()
+        local b = m.bias:contiguous()
+        check_float(w, 'weight')
+        assert(lib.nncpu_qnet_set_weights(self.q, i - 1, torch.data(w),
+                                          torch.data(b)) == 0)
+    end
+end
+
+-- Forward one input (contiguous FloatTensor or ByteTensor with C*H*W
+-- elements). The returned 1-D tensor of Q-values is reused by the next
+-- forward() call.
+function QNet:forward(input)
+    assert(input:nElement() == self.input_size, 'wrong input size')
+    if is_byte(input) then
+        assert(input:isContiguous(), 'input must be contiguous')
+        lib.nncpu_qnet_forward_u8(self.q, torch.data(input), torch.data(self.output))
+    else
+        check_float(input, 'input')
+        lib.nncpu_qnet_forward(self.q, torch.data(input), torch.data(self.output))
+    end
+    return self.output
+end
+
+--------------------------------------------------------------------------------
+-- nn.CPUSpatialConvolution: drop-in nn.SpatialConvolution for training on
+-- CPU with the threaded GEMM kernels of conv.c
+--------------------------------------------------------------------------------
+
+local CPUConv, parent = torch.class('nn.CPUSpatialConvolution',
+                                    'nn.SpatialConvolution')
+
+-- The native object (and its workspace) is kept out of the module itself
+-- so that networks can still be cloned and torch.save()'d.
+local workspaces = setmetatable({}, {__mode = 'k'})
+
+local function conv_object(m)
+    local c = workspaces[m]
+    if not c then
+        assert(m.dW == m.dH and (m.padW or 0) == (m.padH or 0),
+               'nn.CPUSpatialConvolution: only square stride/padding is supported')
+        c = lib.nncpu_conv_create(m.nInputPlane, m.nOutputPlane, m.kH, m.kW,
+                                  m.dW, m.padW or 0)
+        assert(c ~= nil, 'nncpu_conv_create() failed')
+        c = ffi.gc(c, lib.nncpu_conv_destroy)
+        workspaces[m] = c
+    end
+    return c
+end
+
+-- returns the input as a contiguous 4-D tensor, plus batch size and H/W
+local function batch_view(m, input)
+    assert(input:type() == 'torch.FloatTensor' or
+           (is_byte(input) and m.input_scale),
+           'nn.CPUSpatialConvolution: only FloatTensor is supported')
+    input = input:contiguous()
+    if input:dim() == 3 then
+        input = input:view(1, input:size(1), input:size(2), input:size(3))
+    end
+    assert(input:dim() == 4 and input:size(2) == m.nInputPlane,
+           'nn.CPUSpatialConvolution: bad input size')
+    return input, input:size(1), input:size(3), input:size(4)
+end
+
+local function out_size(m, h, w)
+    local pad = m.padW or 0
+    return math.floor((h + 2 * pad - m.kH) / m.dH) + 1,
+           math.floor((w + 2 * pad - m.kW) / m.dW) + 1
+end
+
+local function bias_data(t)
+    return t and torch.data(t) or nil
+end
+
+function CPUConv:updateOutput(input)
+    local x, n, h, w = batch_view(self, input)
+    local oh, ow = out_size(self, h, w)
+    assert(self.weight:isContiguous(), 'weight must be contiguous')
+    self.output:resize(n, self.nOutputPlane, oh, ow)
+    if is_byte(x) then
+        assert(lib.nncpu_conv_forward_u8(conv_object(self), n, h, w, torch.data(x),
+                                         self.input_scale, torch.data(self.weight),
+                                         bias_data(self.bias),
+                                         torch.data(self.output)) == 0)
+    else
+        assert(lib.nncpu_conv_forward(conv_object(self), n, h, w, torch.data(x),
+                                      torch.data(self.weight), bias_data(self.bias),
+                                      torch.data(self.output)) == 0)
+    end
+    if input:dim() == 3 then
+        self.output = self.output:view(self.nOutputPlane, oh, ow)
+    end
+    return self.output
+end
+
+function CPUConv:updateGradInput(input, gradOutput)
+    if not self.gradInput then return end
+    if is_byte(input) then
+        -- the input is data (see nn.ByteInput), there is no gradient to it
+        self.gradInput:resize(input:size())
+        return self.gradInput
+    end
+    local x, n, h, w = batch_view(self, input)
+    local gout = gradOutput:contiguous()
+    self.gradInput:resizeAs(input)
+    assert(lib.nncpu_conv_backward_input(conv_object(self), n, h, w,
+                                         torch.data(gout), torch.data(self.weight),
+                                         torch.data(self.gradInput)) == 0)
+    return self.gradInput
+end
+
+function CPUConv:accGradParameters(input, gradOutput, scale)
+    local x, n, h, w = batch_view(self, input)
+    local gout = gradOutput:contiguous()
+    assert(self.gradWeight:isContiguous(), 'gradWeight must be contiguous')
+    if is_byte(x) then
+        assert(lib.nncpu_conv_backward_weight_u8(conv_object(self), n, h, w,
+                                                 torch.data(x), self.input_scale,
+                                                 torch.data(gout), scale or 1,
+                                                 torch.data(self.gradWeight),
+                                                 bias_data(self.gradBias)) == 0)
+        return
+    end
+    assert(lib.nncpu_conv_backward_weight(conv_object(self), n, h, w,
+                                          torch.data(x), torch.data(gout),
+                                          scale or 1,
+                                          torch.data(self.gradWeight),
+                                          bias_data(self.gradBias)) == 0)
+end
+
+function CPUConv:type(type, tensorCache)
+    assert(type == nil or type == 'torch.FloatTensor',
+           'nn.CPUSpatialConvolution: only FloatTensor is supported')
+    return parent.type(self, type, tensorCache)
+end
+
+-- Swap the convolution layers of 'net' in place, in the same way as
+-- cudnn.convert(): dst = 'nncpu' turns nn.SpatialConvolution(MM) into
+-- nn.CPUSpatialConvolution, dst = 'nn' turns them back (e.g. before the
+-- network is loaded somewhere nncpu is not available). The parameters
+-- are shared, so this can be done before or after getParameters().
+-- An nn.ByteInput right before the first convolution is fused with it:
+-- byte input is passed through, and converted (and scaled) by the
+-- convolution's im2col instead.
+function nncpu.convert(net, dst)
+    dst = dst or 'nncpu'
+    assert(dst == 'nncpu' or dst == 'nn', 'unknown conversion: ' .. dst)
+    local function convert(m)
+        local name = torch.typename(m)
+        if dst == 'nncpu' and (name == 'nn.SpatialConvolution' or
+                               name == 'nn.SpatialConvolutionMM') then
+            assert(m.weight:type() == 'torch.FloatTensor',
+                   'nncpu.convert: network must be float')
+            if name == 'nn.SpatialConvolutionMM' then
+                -- MM keeps 2-D weights, nn.SpatialConvolution 4-D ones
+                m.weight = m.weight:view(m.nOutputPlane, m.nInputPlane,
+                                         m.kH, m.kW)
+                m.gradWeight = m.gradWeight:view(m.weight:size())
+                m.finput, m.fgradInput = nil, nil
+            end
+            torch.setmetatable(m, 'nn.CPUSpatialConvolution')
+        elseif dst == 'nn' and name == 'nn.CPUSpatialConvolution' then
+            workspaces[m] = nil
+            torch.setmetatable(m, 'nn.SpatialConvolution')
+        end
+        if m.modules then
+            for i, sub in ipairs(m.modules) do
+                convert(sub)
+                local prev = m.modules[i - 1]
+                if prev and torch.typename(prev) == 'nn.ByteInput' then
+                    local fuse = torch.typename(sub) == 'nn.CPUSpatialConvolution'
+                    prev.fused = fuse
+                    sub.input_scale = fuse and prev.scale or nil
+                end
+            end
+        end
+    end
+    convert(net)
+    return net
+end
+
+return nncpu
@@ -0,0 +1,572 @@
+/*
+ *  qnet.c
+ *
+ *  DESCRIPTION:
+ *
+ *  A CPU inference engine for the (fixed topology) DQN Q-network, i.e.
+ *  a few convolution layers followed by a few fully connected layers, all
+ *  with optional ReLU, as built by dqn-deepmind/convnet.lua. It is used
+ *  by NeuralQLearner:greedy() when the agent runs without a GPU.
+ *
+ *  All activation buffers are allocated when the network is described, so
+ *  a forward pass does no memory allocation. Convolutions are computed
+ *  directly (no im2col) on channels-last (HWC) activations, with weights
+ *  packed as [ky][kx][in_c][out_c], so the inner loop is a vector
+ *  multiply-add across output channels. Fully connected layers are row
+ *  dot products; their weights could optionally be kept in fp16 or int8
+ *  (with a per-row scale), which halves/quarters the memory traffic of the
+ *  big 3136x512 layer. Convolution weights are small and always stay fp32.
+ *
+ *  The input could be scaled on its way in (nncpu_qnet_set_input_scale(),
+ *  e.g. 1/255 for gray levels): the scale is folded into the weights of
+ *  the first layer when they are packed, so it costs nothing per forward.
+ *  nncpu_qnet_forward_u8() takes the input as bytes, which are converted
+ *  while they are transposed to HWC anyway.
+ *
+ *  Weights are given in Torch layout (nn.SpatialConvolution: out_c x in_c
+ *  x kh x kw, nn.Linear: n_out x n_in, Torch's CHW flattening order) and
+ *  re-packed by nncpu_qnet_set_weights(). The caller is expected to call
+ *  it again whenever the network is updated.
+ *
+ *  PROCESS:
+ *
+ *  struct nncpu_qnet *nncpu_qnet_create(int in_c, int in_h, int in_w);
+ *  int   nncpu_qnet_add_conv(q, int out_c, int kh, int kw, int stride, int pad);
+ *  int   nncpu_qnet_add_linear(q, int n_out);
+ *  int   nncpu_qnet_add_relu(q);
+ *  int   nncpu_qnet_set_precision(q, int precision);
+ *  int   nncpu_qnet_set_input_scale(q, float scale);
+ *  int   nncpu_qnet_set_weights(q, int layer, const float *weight, const float *bias);
+ *  int   nncpu_qnet_num_outputs(q);
+ *  int   nncpu_qnet_forward(q, const float *input, float *output);
+ *  int   nncpu_qnet_forward_u8(q, const unsigned char *input, float *output);
+ *  void  nncpu_qnet_destroy(q);
+ *
+ *  Input of forward() is a single CHW float (or byte) image (batch size 1).
+ *
+ *  GLOBALS: none
+ *
+ *  REFERENCE:
+ *
+ *  LIMITATIONS:
+ *
+ *  1. Linear layers could only be followed by linear layers.
+ *  2. A qnet object should not be used by 2 threads at the same time.
+ *
+ *  REVISION HISTORY:
+ *
+ *    Date             Description                                   Author
+ *    2026-10-18       initial coding                                agent
+ *    2026-10-18       input scale folded into the 1st layer, byte input agent
+ *
+ *  TARGET: Linux C
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "nncpu.h"
+#include "simd.h"
+
+#define QNET_MAX_LAYERS  16
+#define ROWS_PER_TASK    32     /* linear layer rows per parallel task */
+#define MIN_PARALLEL_MAC (256 * 1024)
+
+enum { LAYER_CONV, LAYER_LINEAR };
+
+struct qnet_layer {
+        int          type;
+        int          relu;
+        int          in_c, in_h, in_w;
+        int          out_c, out_h, out_w;
+        int          kh, kw, stride, pad;
+        long         n_weights;
+        float       *w;         /* packed fp32 weights */
+        nncpu_half  *wh;        /* fp16 copy (linear layers only) */
+        int8_t      *wq;        /* int8 copy (linear layers only) */
+        float       *wscale;    /* per-row scale of wq */
+        float       *b;
+        float       *out;       /* activations, HWC for conv layers */
+};
+
+struct nncpu_qnet {
+        int                in_c, in_h, in_w;
+        int                precision;
+        float              in_scale;    /* folded into layer 0 */
+        int                n_layers;
+        struct qnet_layer  layers[QNET_MAX_LAYERS];
+        float             *in_hwc;
+};
+
+static void *alloc_aligned(size_t n)
+{
+        void *p;
+
+        if (n == 0)  n = 1;
+        if (posix_memalign(&p, 64, n) != 0)
+                return NULL;
+        memset(p, 0, n);
+        return p;
+}
+
+struct nncpu_qnet *nncpu_qnet_create(int in_c, int in_h, int in_w)
+{
+        struct nncpu_qnet *q;
+
+        if (in_c <= 0 || in_h <= 0 || in_w <= 0)
+                return NULL;
+        q = (struct nncpu_qnet *) calloc(1, sizeof(*q));
+        if (!q)
+                return NULL;
+        q->in_c = in_c;
+        q->in_h = in_h;
+        q->in_w = in_w;
+        q->in_scale = 1.0f;
+        q->in_hwc = (float *) alloc_aligned(sizeof(float) * in_c * in_h * in_w);
+        if (!q->in_hwc) {
+                free(q);
+                return NULL;
+        }
+        return q;
+}
+
+void nncpu_qnet_destroy(struct nncpu_qnet *q)
+{
+        int i;
+
+        if (!q)
+                return;
+        for (i = 0; i < q->n_layers; i++) {
+                struct qnet_layer *L = &q->layers[i];
+                free(L->w);
+                free(L->wh);
+                free(L->wq);
+                free(L->wscale);
+                free(L->b);
+                free(L->out);
+        }
+        free(q->in_hwc);
+        free(q);
+}
+
+/* shape of the output of the last layer (or the input) */
+static void last_shape(const struct nncpu_qnet *q, int *c, int *h, int *w)
+{
+        if (q->n_layers == 0) {
+                *c = q->in_c;  *h = q->in_h;  *w = q->in_w;
+        } else {
+                const struct qnet_layer *L = &q->layers[q->n_layers - 1];
+                *c = L->out_c;  *h = L->out_h;  *w = L->out_w;
+        }
+}
+
+static int alloc_layer(struct qnet_layer *L)
+{
+        L->w   = (float *) alloc_aligned(sizeof(float) * L->n_weights);
+        L->b   = (float *) alloc_aligned(sizeof(float) * L->out_c);
+        L->out = (float *) alloc_aligned(sizeof(float) * L->out_c * L->out_h * L->out_w);
+        if (!L->w || !L->b || !L->out) {
+                free(L->w);
+                free(L->b);
+                free(L->out);
+                return -1;
+        }
+        return 0;
+}
+
+int nncpu_qnet_add_conv(struct nncpu_qnet *q, int out_c, int kh, int kw,
+                        int stride, int pad)
+{
+        struct qnet_layer *L;
+        int c, h, w;
+
+        if (!q || q->n_layers >= QNET_MAX_LAYERS)
+                return -1;
+        if (q->n_layers > 0 && q->layers[q->n_layers - 1].type != LAYER_CONV)
+                return -1;
+        last_shape(q, &c, &h, &w);
+        if (out_c <= 0 || kh <= 0 || kw <= 0 || stride <= 0 || pad < 0 ||
+            h + 2 * pad < kh || w + 2 * pad < kw)
+                return -1;
+
+        L = &q->layers[q->n_layers];
+        memset(L, 0, sizeof(*L));
+        L->type   = LAYER_CONV;
+        L->in_c   = c;
+        L->in_h   = h;
+        L->in_w   = w;
+        L->out_c  = out_c;
+        L->out_h  = (h + 2 * pad - kh) / stride + 1;
+        L->out_w  = (w + 2 * pad - kw) / stride + 1;
+        L->kh     = kh;
+        L->kw     = kw;
+        L->stride = stride;
+        L->pad    = pad;
+        L->n_weights = (long) out_c * c * kh * kw;
+        if (alloc_layer(L) < 0)
+                return -1;
+        return q->n_layers++;
+}
+
+int nncpu_qnet_add_linear(struct nncpu_qnet *q, int n_out)
+{
+        struct qnet_layer *L;
+        int c, h, w;
+
+        if (!q || q->n_layers >= QNET_MAX_LAYERS || n_out <= 0)
+                return -1;
+        last_shape(q, &c, &h, &w);
+
+        L = &q->layers[q->n_layers];
+        memset(L, 0, sizeof(*L));
+        L->type   = LAYER_LINEAR;
+        L->in_c   = c;
+        L->in_h   = h;
+        L->in_w   = w;
+        L->out_c  = n_out;
+        L->out_h  = 1;
+        L->out_w  = 1;
+        L->n_weights = (long) n_out * c * h * w;
+        if (alloc_layer(L) < 0)
+                return -1;
+        L->wh     = (nncpu_half *) alloc_aligned(sizeof(nncpu_half) * L->n_weights);
+        L->wq     = (int8_t *) alloc_aligned(L->n_weights);
+        L->wscale = (float *) alloc_aligned(sizeof(float) * n_out);
+        if (!L->wh || !L->wq || !L->wscale) {
+                free(L->w);  free(L->b);  free(L->out);
+                free(L->wh);  free(L->wq);  free(L->wscale);
+                return -1;
+        }
+        return q->n_layers++;
+}
+
+int nncpu_qnet_add_relu(struct nncpu_qnet *q)
+{
+        if (!q || q->n_layers == 0)
+                return -1;
+        q->layers[q->n_layers - 1].relu = 1;
+        return 0;
+}
+
+int nncpu_qnet_num_outputs(struct nncpu_qnet *q)
+{
+        int c, h, w;
+
+        if (!q || q->n_layers == 0)
+                return -1;
+        last_shape(q, &c, &h, &w);
+        return c * h * w;
+}
+
+/* 0: fp32, 1: fp16, 2: int8 (for linear layers); takes effect on the
+ * next nncpu_qnet_set_weights() of each layer */
+int nncpu_qnet_set_precision(struct nncpu_qnet *q, int precision)
+{
+        if (!q || precision < NNCPU_FP32 || precision > NNCPU_INT8)
+                return -1;
+        q->precision = precision;
+        return 0;
+}
+
+/* scale of the input (e.g. 1/255 for gray levels); takes effect on the
+ * next nncpu_qnet_set_weights() of layer 0 */
+int nncpu_qnet_set_input_scale(struct nncpu_qnet *q, float scale)
+{
+        if (!q || scale <= 0.0f)
+                return -1;
+        q->in_scale = scale;
+        return 0;
+}
+
+static void quantize_linear(struct qnet_layer *L, int precision)
+{
+        long n_in = L->n_weights / L->out_c;
+        long i;
+        int j;
+
+        if (precision == NNCPU_FP16) {
+                for (i = 0; i < L->n_weights; i++)
+                        L->wh[i] = float_to_half(L->w[i]);
+        } else if (precision == NNCPU_INT8) {
+                for (j = 0; j < L->out_c; j++) {
+                        const float *row = L->w + j * n_in;
+                        int8_t *qrow = L->wq + j * n_in;
+                        float m = 0.0f, s;
+
+                        for (i = 0; i < n_in; i++)
+                                if (fabsf(row[i]) > m)  m = fabsf(row[i]);
+                        s = (m > 0.0f) ? m / 127.0f : 1.0f;
+                        L->wscale[j] = s;
+                        for (i = 0; i < n_in; i++)
+                                qrow[i] = (int8_t) lrintf(row[i] / s);
+                }
+        }
+}
+
+int nncpu_qnet_set_weights(struct nncpu_qnet *q, int layer,
+                           const float *weight, const float *bias)
+{
+        struct qnet_layer *L;
+        int oc, ic, ky, kx;
+
+        if (!q || layer < 0 || layer >= q->n_layers || !weight || !bias)
+                return -1;
+        L = &q->layers[layer];
+
+        if (L->type == LAYER_CONV) {
+                /* [oc][ic][ky][kx] -> [ky][kx][ic][oc] */
+                for (oc = 0; oc < L->out_c; oc++)
+                        for (ic = 0; ic < L->in_c; ic++)
+                                for (ky = 0; ky < L->kh; ky++)
+                                        for (kx = 0; kx < L->kw; kx++)
+                                                L->w[((ky * L->kw + kx) * L->in_c + ic) * L->out_c + oc] =
+                                                        *weight++;
+        } else if (L->in_h * L->in_w == 1) {
+                memcpy(L->w, weight, sizeof(float) * L->n_weights);
+        } else {
+                /* columns in Torch's CHW order -> our HWC order */
+                int hw = L->in_h * L->in_w;
+                long n_in = (long) L->in_c * hw;
+                int j, p;
+
+                for (j = 0; j < L->out_c; j++) {
+                        const float *src = weight + j * n_in;
+                        float *dst = L->w + j * n_in;
+                        for (ic = 0; ic < L->in_c; ic++)
+                                for (p = 0; p < hw; p++)
+                                        dst[p * L->in_c + ic] = src[ic * hw + p];
+                }
+        }
+        memcpy(L->b, bias, sizeof(float) * L->out_c);
+        if (0 == layer && q->in_scale != 1.0f) {
+                long i;
+                for (i = 0; i < L->n_weights; i++)
+                        L->w[i] *= q->in_scale;
+        }
+
+        if (L->type == LAYER_LINEAR)
+                quantize_linear(L, q->precision);
+        return 0;
+}
+
+/*
+ * Convolution of 1 output row, HWC in and out.
+ */
+static void conv_row(const struct qnet_layer *L, const float *in, int oy)
+{
+        const int IC = L->in_c, OC = L->out_c;
+        const vf zero = vf_zero();
+        int ox, oc, ky, kx, ic;
+
+        for (ox = 0; ox < L->out_w; ox++) {
+                float *o = L->out + (oy * L->out_w + ox) * OC;
+                int y0 = oy * L->stride - L->pad;
+                int x0 = ox * L->stride - L->pad;
+
+                for (oc = 0; oc + 4 * VLEN <= OC; oc += 4 * VLEN) {
+                        vf a0 = vf_load(L->b + oc);
+                        vf a1 = vf_load(L->b + oc + VLEN);
+                        vf a2 = vf_load(L->b + oc + 2 * VLEN);
+                        vf a3 = vf_load(L->b + oc + 3 * VLEN);
+
+                        for (ky = 0; ky < L->kh; ky++) {
+                                int iy = y0 + ky;
+                                if (iy < 0 || iy >= L->in_h)  continue;
+                                for (kx = 0; kx < L->kw; kx++) {
+                                        int ix = x0 + kx;
+                                        const float *ip, *wp;
+                                        if (ix < 0 || ix >= L->in_w)  continue;
+                                        ip = in + (iy * L->in_w + ix) * IC;
+                                        wp = L->w + (ky * L->kw + kx) * IC * OC + oc;
+                                        for (ic = 0; ic < IC; ic++, wp += OC) {
+                                                vf v = vf_set1(ip[ic]);
+                                                a0 = vf_madd(a0, v, vf_load(wp));
+                                                a1 = vf_madd(a1, v, vf_load(wp + VLEN));
+                                                a2 = vf_madd(a2, v, vf_load(wp + 2 * VLEN));
+                                                a3 = vf_madd(a3, v, vf_load(wp + 3 * VLEN));
+                                        }
+                                }
+                        }
+                        if (L->relu) {
+                                a0 = vf_max(a0, zero);  a1 = vf_max(a1, zero);
+                                a2 = vf_max(a2, zero);  a3 = vf_max(a3, zero);
+                        }
+                        vf_store(o + oc, a0);
+                        vf_store(o + oc + VLEN, a1);
+                        vf_store(o + oc + 2 * VLEN, a2);
+                        vf_store(o + oc + 3 * VLEN, a3);
+                }
+                for (; oc < OC; oc++) {
+                        float a = L->b[oc];
+
+                        for (ky = 0; ky < L->kh; ky++) {
+                                int iy = y0 + ky;
+                                if (iy < 0 || iy >= L->in_h)  continue;
+                                for (kx = 0; kx < L->kw; kx++) {
+                                        int ix = x0 + kx;
+                                        const float *ip, *wp;
+                                        if (ix < 0 || ix >= L->in_w)  continue;
+                                        ip = in + (iy * L->in_w + ix) * IC;
+                                        wp = L->w + (ky * L->kw + kx) * IC * OC + oc;
+                                        for (ic = 0; ic < IC; ic++, wp += OC)
+                                                a += ip[ic] * *wp;
+                                }
+                        }
+                        o[oc] = (L->relu && a < 0.0f) ? 0.0f : a;
+                }
+        }
+}
+
+static float dot_fp32(const float *w, const float *x, long n)
+{
+        vf a0 = vf_zero(), a1 = vf_zero(), a2 = vf_zero(), a3 = vf_zero();
+        float s;
+        long i = 0;
+
+        for (; i + 4 * VLEN <= n; i += 4 * VLEN) {
+                a0 = vf_madd(a0, vf_load(w + i), vf_load(x + i));
+                a1 = vf_madd(a1, vf_load(w + i + VLEN), vf_load(x + i + VLEN));
+                a2 = vf_madd(a2, vf_load(w + i + 2 * VLEN), vf_load(x + i + 2 * VLEN));
+                a3 = vf_madd(a3, vf_load(w + i + 3 * VLEN), vf_load(x + i + 3 * VLEN));
+        }
+        s = vf_hsum(vf_add(vf_add(a0, a1), vf_add(a2, a3)));
+        for (; i < n; i++)
+                s += w[i] * x[i];
+        return s;
+}
+
+static float dot_fp16(const nncpu_half *w, const float *x, long n)
+{
+        vf a0 = vf_zero(), a1 = vf_zero();
+        float s;
+        long i = 0;
+
+        for (; i + 2 * VLEN <= n; i += 2 * VLEN) {
+                a0 = vf_madd(a0, vf_load_half(w + i), vf_load(x + i));
+                a1 = vf_madd(a1, vf_load_half(w + i + VLEN), vf_load(x + i + VLEN));
+        }
+        s = vf_hsum(vf_add(a0, a1));
+        for (; i < n; i++)
+                s += half_to_float(w[i]) * x[i];
+        return s;
+}
+
+static float dot_int8(const int8_t *w, const float *x, long n)
+{
+        vf a0 = vf_zero(), a1 = vf_zero();
+        float s;
+        long i = 0;
+
+        for (; i + 2 * VLEN <= n; i += 2 * VLEN) {
+                a0 = vf_madd(a0, vf_load_i8(w + i), vf_load(x + i));
+                a1 = vf_madd(a1, vf_load_i8(w + i + VLEN), vf_load(x + i + VLEN));
+        }
+        s = vf_hsum(vf_add(a0, a1));
+        for (; i < n; i++)
+                s += (float) w[i] * x[i];
+        return s;
+}
+
+static void linear_rows(const struct qnet_layer *L, const float *in,
+                        int precision, int from, int to)
+{
+        long n_in = L->n_weights / L->out_c;
+        int j;
+
+        for (j = from; j < to; j++) {
+                float a;
+
+                if (precision == NNCPU_FP16)
+                        a = dot_fp16(L->wh + j * n_in, in, n_in);
+                else if (precision == NNCPU_INT8)
+                        a = dot_int8(L->wq + j * n_in, in, n_in) * L->wscale[j];
+                else
+                        a = dot_fp32(L->w + j * n_in, in, n_in);
+                a += L->b[j];
+                L->out[j] = (L->relu && a < 0.0f) ? 0.0f : a;
+        }
+}
+
+struct layer_job {
+        const struct qnet_layer *L;
+        const float *in;
+        int precision;
+};
+
+static void conv_task(void *arg, int idx, int ntasks)
+{
+        const struct layer_job *job = (const struct layer_job *) arg;
+
+        conv_row(job->L, job->in, idx);
+}
+
+static void linear_task(void *arg, int idx, int ntasks)
+{
+        const struct layer_job *job = (const struct layer_job *) arg;
+        int from = idx * ROWS_PER_TASK;
+        int to = from + ROWS_PER_TASK;
+
+        if (to > job->L->out_c)  to = job->L->out_c;
+        linear_rows(job->L, job->in, job->precision, from, to);
+}
+
+static int run(struct nncpu_qnet *q, float *output)
+{
+        const float *in = q->in_hwc;
+        int i, p;
+
+        for (i = 0; i < q->n_layers; i++) {
+                const struct qnet_layer *L = &q->layers[i];
+                struct layer_job job = { L, in, q->precision };
+                long macs = L->n_weights * L->out_h * L->out_w;
+
+                if (L->type == LAYER_CONV) {
+                        if (macs >= MIN_PARALLEL_MAC)
+                                nncpu_parallel_for(L->out_h, conv_task, &job);
+                        else
+                                for (p = 0; p < L->out_h; p++)
+                                        conv_row(L, in, p);
+                } else {
+                        if (macs >= MIN_PARALLEL_MAC)
+                                nncpu_parallel_for((L->out_c + ROWS_PER_TASK - 1) / ROWS_PER_TASK,
+                                                   linear_task, &job);
+                        else
+                                linear_rows(L, in, q->precision, 0, L->out_c);
+                }
+                in = L->out;
+        }
+        memcpy(output, in, sizeof(float) * nncpu_qnet_num_outputs(q));
+        return 0;
+}
+
+int nncpu_qnet_forward(struct nncpu_qnet *q, const float *input, float *output)
+{
+        int c, p, hw;
+
+        if (!q || q->n_layers == 0 || !input || !output)
+                return -1;
+
+        /* CHW -> HWC */
+        hw = q->in_h * q->in_w;
+        for (c = 0; c < q->in_c; c++)
+                for (p = 0; p < hw; p++)
+                        q->in_hwc[p * q->in_c + c] = input[c * hw + p];
+        return run(q, output);
+}
+
+int nncpu_qnet_forward_u8(struct nncpu_qnet *q, const unsigned char *input,
+                          float *output)
+{
+        int c, p, hw;
+
+        if (!q || q->n_layers == 0 || !input || !output)
+                return -1;
+
+        /* CHW -> HWC, to float */
+        hw = q->in_h * q->in_w;
+        for (c = 0; c < q->in_c; c++)
+                for (p = 0; p < hw; p++)
+                        q->in_hwc[p * q->in_c + c] = input[c * hw + p];
+        return run(q, output);
+}
@@ -0,0 +1,221 @@
+/*
+ * simd.h
+ *
+ * A thin float vector abstraction for the nncpu kernels, so that the
+ * kernels themselves are written once for NEON, AVX, SSE2 and plain C.
+ *
+ *   vf        vector of VLEN floats
+ *   vf_*()    load/store/arithmetic on vf
+ *
+ * Low precision weight formats (see qnet.c) are stored as nncpu_half
+ * (IEEE fp16 bits) or int8_t, and expanded to vf by vf_load_half() and
+ * vf_load_i8().
+ */
+
+#ifndef NNCPU_SIMD_H_
+#define NNCPU_SIMD_H_
+
+#include <stdint.h>
+#include <string.h>
+
+typedef uint16_t nncpu_half;
+
+static inline float half_to_float(nncpu_half h)
+{
+        uint32_t sign = (uint32_t) (h & 0x8000) << 16;
+        uint32_t exp  = (h >> 10) & 0x1f;
+        uint32_t man  = h & 0x3ff;
+        uint32_t bits;
+        float f;
+
+        if (exp == 0) {
+                if (man == 0) {
+                        bits = sign;
+                } else {        /* subnormal */
+                        exp = 127 - 15 + 1;
+                        while (!(man & 0x400)) {
+                                man <<= 1;
+                                exp--;
+                        }
+                        bits = sign | (exp << 23) | ((man & 0x3ff) << 13);
+                }
+        } else if (exp == 0x1f) {
+                bits = sign | 0x7f800000 | (man << 13);
+        } else {
+                bits = sign | ((exp + 127 - 15) << 23) | (man << 13);
+        }
+        memcpy(&f, &bits, sizeof(f));
+        return f;
+}
+
+static inline nncpu_half float_to_half(float f)
+{
+        uint32_t bits, sign, man;
+        int exp;
+
+        memcpy(&bits, &f, sizeof(bits));
+        sign = (bits >> 16) & 0x8000;
+        exp  = (int) ((bits >> 23) & 0xff) - 127 + 15;
+        man  = bits & 0x7fffff;
+
+        if (exp <= 0) {                 /* underflow to (sub)normal */
+                if (exp < -10)
+                        return (nncpu_half) sign;
+                man |= 0x800000;
+                man = (man + (1u << (13 - exp))) >> (14 - exp);
+                return (nncpu_half) (sign | man);
+        }
+        if (exp >= 0x1f)                /* overflow (weights never get here) */
+                return (nncpu_half) (sign | 0x7c00);
+        man += 0x1000;                  /* round to nearest */
+        if (man & 0x800000) {
+                man = 0;
+                if (++exp >= 0x1f)
+                        return (nncpu_half) (sign | 0x7c00);
+        }
+        return (nncpu_half) (sign | (exp << 10) | (man >> 13));
+}
+
+#if defined(__AVX__)
+
+#include <immintrin.h>
+#define VLEN 8
+typedef __m256 vf;
+
+static inline vf   vf_load(const float *p)        { return _mm256_loadu_ps(p); }
+static inline void vf_store(float *p, vf a)       { _mm256_storeu_ps(p, a); }
+static inline vf   vf_set1(float a)               { return _mm256_set1_ps(a); }
+static inline vf   vf_zero(void)                  { return _mm256_setzero_ps(); }
+static inline vf   vf_add(vf a, vf b)             { return _mm256_add_ps(a, b); }
+static inline vf   vf_mul(vf a, vf b)             { return _mm256_mul_ps(a, b); }
+static inline vf   vf_max(vf a, vf b)             { return _mm256_max_ps(a, b); }
+#if defined(__FMA__)
+static inline vf   vf_madd(vf c, vf a, vf b)      { return _mm256_fmadd_ps(a, b, c); }
+#else
+static inline vf   vf_madd(vf c, vf a, vf b)      { return _mm256_add_ps(c, _mm256_mul_ps(a, b)); }
+#endif
+static inline float vf_hsum(vf a)
+{
+        __m128 s = _mm_add_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1));
+        s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+        s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+        return _mm_cvtss_f32(s);
+}
+#if defined(__F16C__)
+static inline vf   vf_load_half(const nncpu_half *p)
+{
+        return _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *) p));
+}
+#define HAVE_VF_LOAD_HALF 1
+#endif
+#if defined(__AVX2__)
+static inline vf   vf_load_i8(const int8_t *p)
+{
+        return _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i *) p)));
+}
+#define HAVE_VF_LOAD_I8 1
+#endif
+
+#elif defined(__ARM_NEON)
+
+#include <arm_neon.h>
+#define VLEN 4
+typedef float32x4_t vf;
+
+static inline vf   vf_load(const float *p)        { return vld1q_f32(p); }
+static inline void vf_store(float *p, vf a)       { vst1q_f32(p, a); }
+static inline vf   vf_set1(float a)               { return vdupq_n_f32(a); }
+static inline vf   vf_zero(void)                  { return vdupq_n_f32(0.0f); }
+static inline vf   vf_add(vf a, vf b)             { return vaddq_f32(a, b); }
+static inline vf   vf_mul(vf a, vf b)             { return vmulq_f32(a, b); }
+static inline vf   vf_max(vf a, vf b)             { return vmaxq_f32(a, b); }
+#if defined(__aarch64__)
+static inline vf   vf_madd(vf c, vf a, vf b)      { return vfmaq_f32(c, a, b); }
+static inline float vf_hsum(vf a)                 { return vaddvq_f32(a); }
+static inline vf   vf_load_half(const nncpu_half *p)
+{
+        return vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(p)));
+}
+#define HAVE_VF_LOAD_HALF 1
+#else
+static inline vf   vf_madd(vf c, vf a, vf b)      { return vmlaq_f32(c, a, b); }
+static inline float vf_hsum(vf a)
+{
+        float32x2_t s = vadd_f32(vget_low_f32(a), vget_high_f32(a));
+        return vget_lane_f32(vpadd_f32(s, s), 0);
+}
+#endif
+static inline vf   vf_load_i8(const int8_t *p)
+{
+        int32_t t;
+        int16x8_t h;
+
+        memcpy(&t, p, 4);
+        h = vmovl_s8(vreinterpret_s8_s32(vdup_n_s32(t)));
+        return vcvtq_f32_s32(vmovl_s16(vget_low_s16(h)));
+}
+#define HAVE_VF_LOAD_I8 1
+
+#elif defined(__SSE2__)
+
+#include <emmintrin.h>
+#define VLEN 4
+typedef __m128 vf;
+
+static inline vf   vf_load(const float *p)        { return _mm_loadu_ps(p); }
+static inline void vf_store(float *p, vf a)       { _mm_storeu_ps(p, a); }
+static inline vf   vf_set1(float a)               { return _mm_set1_ps(a); }
+static inline vf   vf_zero(void)                  { return _mm_setzero_ps(); }
+static inline vf   vf_add(vf a, vf b)             { return _mm_add_ps(a, b); }
+static inline vf   vf_mul(vf a, vf b)             { return _mm_mul_ps(a, b); }
+static inline vf   vf_max(vf a, vf b)             { return _mm_max_ps(a, b); }
+static inline vf   vf_madd(vf c, vf a, vf b)      { return _mm_add_ps(c, _mm_mul_ps(a, b)); }
+static inline float vf_hsum(vf a)
+{
+        __m128 s = _mm_add_ps(a, _mm_movehl_ps(a, a));
+        s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+        return _mm_cvtss_f32(s);
+}
+
+#else
+
+#define VLEN 1
+typedef float vf;
+
+static inline vf   vf_load(const float *p)        { return *p; }
+static inline void vf_store(float *p, vf a)       { *p = a; }
+static inline vf   vf_set1(float a)               { return a; }
+static inline vf   vf_zero(void)                  { return 0.0f; }
+static inline vf   vf_add(vf a, vf b)             { return a + b; }
+static inline vf   vf_mul(vf a, vf b)             { return a * b; }
+static inline vf   vf_max(vf a, vf b)             { return a > b ? a : b; }
+static inline vf   vf_madd(vf c, vf a, vf b)      { return c + a * b; }
+static inline float vf_hsum(vf a)                 { return a; }
+
+#endif
+
+#ifndef HAVE_VF_LOAD_HALF
+static inline vf vf_load_half(const nncpu_half *p)
+{
+        float t[VLEN];
+        int i;
+
+        for (i = 0; i < VLEN; i++)
+                t[i] = half_to_float(p[i]);
+        return vf_load(t);
+}
+#endif
+
+#ifndef HAVE_VF_LOAD_I8
+static inline vf vf_load_i8(const int8_t *p)
+{
+        float t[VLEN];
+        int i;
+
+        for (i = 0; i < VLEN; i++)
+                t[i] = (float) p[i];
+        return vf_load(t);
+}
+#endif
+
+#endif /* NNCPU_SIMD_H_ */
@@ -0,0 +1,265 @@
+/*
+ *  test_input_u8.c
+ *
+ *  DESCRIPTION:
+ *
+ *  Test of the byte input path of nncpu: the 1st layer fed with gray
+ *  levels (unsigned char) and the 1/255 scale folded in, against a plain
+ *  float reference fed with the same frames divided by 255, as
+ *  nn.ByteInput replaces x:float():div(255) in front of the network.
+ *
+ *  1. nncpu_conv_forward_u8() and nncpu_conv_backward_weight_u8() for
+ *     the 1st convolution of convnet_atari3, against a direct
+ *     (loop-by-loop) convolution of the float frames; and the gradients
+ *     accumulated by a 2nd backward_weight call.
+ *  2. nncpu_qnet_forward_u8() with nncpu_qnet_set_input_scale(1/255),
+ *     for the whole convnet_atari3 network in fp32, fp16 and int8,
+ *     against a direct float forward of the network.
+ *
+ *  Errors are relative to the largest magnitude of the reference. It is
+ *  built and run by 'make test'.
+ *
+ *    $ ./test_input_u8 [threads]
+ *
+ *  REVISION HISTORY:
+ *
+ *    Date             Description                                   Author
+ *    2026-10-18       initial coding                                agent
+ *
+ *  TARGET: Linux C
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "nncpu.h"
+
+#define BATCH      8
+#define N_ACTIONS  6
+
+/* a layer of convnet_atari3: a convolution, or a linear layer (k == 0) */
+struct layer {
+        int     in_c, out_c, k, stride, pad, in_hw, out_hw;
+        float  *w, *b;
+};
+
+static struct layer net[] = {
+        { 4,  32, 8, 4, 1, 84, 20 },
+        { 32, 64, 4, 2, 0, 20, 9 },
+        { 64, 64, 3, 1, 0, 9,  7 },
+        { 64 * 7 * 7, 512, 0 },
+        { 512, N_ACTIONS, 0 },
+};
+#define N_LAYERS  ((int) (sizeof(net) / sizeof(net[0])))
+
+static unsigned int seed = 1;
+
+/* uniform in [-r, r) */
+static float uniform(float r)
+{
+        seed = seed * 1103515245u + 12345u;
+        return r * ((float) (seed >> 8) / (float) (1 << 24) * 2.0f - 1.0f);
+}
+
+/* as nn's default initialization: uniform in +-1/sqrt(fan_in) */
+static void init_layer(struct layer *L)
+{
+        long n_in = L->k ? (long) L->in_c * L->k * L->k : L->in_c;
+        long i;
+
+        L->w = malloc(sizeof(float) * n_in * L->out_c);
+        L->b = malloc(sizeof(float) * L->out_c);
+        for (i = 0; i < n_in * L->out_c; i++)
+                L->w[i] = uniform(1.0f / sqrtf((float) n_in));
+        for (i = 0; i < L->out_c; i++)
+                L->b[i] = uniform(1.0f / sqrtf((float) n_in));
+}
+
+/* direct convolution (CHW) of 1 sample, optionally with ReLU */
+static void ref_conv(const struct layer *L, const float *in, float *out,
+                     int relu)
+{
+        int oc, ic, oy, ox, ky, kx, iy, ix;
+
+        for (oc = 0; oc < L->out_c; oc++)
+                for (oy = 0; oy < L->out_hw; oy++)
+                        for (ox = 0; ox < L->out_hw; ox++) {
+                                double s = L->b[oc];
+                                for (ic = 0; ic < L->in_c; ic++)
+                                        for (ky = 0; ky < L->k; ky++)
+                                                for (kx = 0; kx < L->k; kx++) {
+                                                        iy = oy * L->stride - L->pad + ky;
+                                                        ix = ox * L->stride - L->pad + kx;
+                                                        if (iy < 0 || iy >= L->in_hw ||
+                                                            ix < 0 || ix >= L->in_hw)
+                                                                continue;
+                                                        s += L->w[((oc * L->in_c + ic) * L->k + ky) * L->k + kx] *
+                                                             in[(ic * L->in_hw + iy) * L->in_hw + ix];
+                                                }
+                                if (relu && s < 0)
+                                        s = 0;
+                                out[(oc * L->out_hw + oy) * L->out_hw + ox] = (float) s;
+                        }
+}
+
+static void ref_linear(const struct layer *L, const float *in, float *out,
+                       int relu)
+{
+        int j, i;
+
+        for (j = 0; j < L->out_c; j++) {
+                double s = L->b[j];
+                for (i = 0; i < L->in_c; i++)
+                        s += L->w[(long) j * L->in_c + i] * in[i];
+                out[j] = (float) ((relu && s < 0) ? 0 : s);
+        }
+}
+
+/* direct float forward of the whole network for 1 sample */
+static void ref_forward(const float *in, float *q)
+{
+        static float a[32 * 20 * 20], b[64 * 9 * 9], c[64 * 7 * 7], d[512];
+
+        ref_conv(&net[0], in, a, 1);
+        ref_conv(&net[1], a, b, 1);
+        ref_conv(&net[2], b, c, 1);
+        ref_linear(&net[3], c, d, 1);
+        ref_linear(&net[4], d, q, 0);
+}
+
+/* max |x - y| / max |y| */
+static double rel_error(const float *x, const float *y, long n)
+{
+        double e = 0, m = 1e-12;
+        long i;
+
+        for (i = 0; i < n; i++) {
+                if (fabs(x[i] - y[i]) > e)  e = fabs(x[i] - y[i]);
+                if (fabs(y[i]) > m)         m = fabs(y[i]);
+        }
+        return e / m;
+}
+
+static int check(const char *what, double err, double tolerance)
+{
+        printf("%-36s relative error = %.3g\n", what, err);
+        if (err > tolerance || err != err) {
+                printf("FAILED: %s (tolerance %g)\n", what, tolerance);
+                return 1;
+        }
+        return 0;
+}
+
+int main(int argc, char **argv)
+{
+        const long frame = 4 * 84 * 84;
+        const struct layer *L0 = &net[0];
+        const long out0 = (long) L0->out_c * L0->out_hw * L0->out_hw;
+        const long n_w0 = (long) L0->out_c * L0->in_c * L0->k * L0->k;
+        unsigned char *x8 = malloc(BATCH * frame);
+        float *x = malloc(sizeof(float) * BATCH * frame);
+        float *y = malloc(sizeof(float) * BATCH * out0);
+        float *ref = malloc(sizeof(float) * BATCH * out0);
+        float *gy = malloc(sizeof(float) * BATCH * out0);
+        float *gw = calloc(n_w0, sizeof(float)), *gw_ref = calloc(n_w0, sizeof(float));
+        float gb[32] = { 0 }, gb_ref[32] = { 0 };
+        float q[N_ACTIONS], q_ref[BATCH][N_ACTIONS];
+        struct nncpu_conv *conv;
+        int failed = 0, i, n, p, oc, ic, oy, ox, ky, kx, iy, ix;
+        const char *names[] = { "fp32", "fp16", "int8" };
+        const double tolerance[] = { 1e-4, 1e-2, 1e-2 };
+
+        nncpu_set_num_threads(argc > 1 ? atoi(argv[1]) : 4);
+        for (i = 0; i < N_LAYERS; i++)
+                init_layer(&net[i]);
+        for (i = 0; i < BATCH * frame; i++) {
+                seed = seed * 1103515245u + 12345u;
+                x8[i] = (unsigned char) (seed >> 16);
+                x[i] = x8[i] / 255.0f;  /* as x:float():div(255) */
+        }
+
+        /* 1. the 1st convolution, forward and grad-weight */
+        conv = nncpu_conv_create(L0->in_c, L0->out_c, L0->k, L0->k,
+                                 L0->stride, L0->pad);
+        nncpu_conv_forward_u8(conv, BATCH, 84, 84, x8, 1.0f / 255, L0->w, L0->b, y);
+        for (n = 0; n < BATCH; n++)
+                ref_conv(L0, x + n * frame, ref + n * out0, 0);
+        failed += check("conv forward, bytes vs floats/255",
+                        rel_error(y, ref, BATCH * out0), 1e-5);
+
+        for (i = 0; i < BATCH * out0; i++)
+                gy[i] = uniform(1.0f);
+        nncpu_conv_backward_weight_u8(conv, BATCH, 84, 84, x8, 1.0f / 255, gy,
+                                      0.5f, gw, gb);
+        for (n = 0; n < BATCH; n++)
+                for (oc = 0; oc < L0->out_c; oc++)
+                        for (oy = 0; oy < L0->out_hw; oy++)
+                                for (ox = 0; ox < L0->out_hw; ox++) {
+                                        float g = 0.5f * gy[n * out0 + (oc * L0->out_hw + oy) * L0->out_hw + ox];
+                                        gb_ref[oc] += g;
+                                        for (ic = 0; ic < L0->in_c; ic++)
+                                                for (ky = 0; ky < L0->k; ky++)
+                                                        for (kx = 0; kx < L0->k; kx++) {
+                                                                iy = oy * L0->stride - L0->pad + ky;
+                                                                ix = ox * L0->stride - L0->pad + kx;
+                                                                if (iy < 0 || iy >= 84 || ix < 0 || ix >= 84)
+                                                                        continue;
+                                                                gw_ref[((oc * L0->in_c + ic) * L0->k + ky) * L0->k + kx] +=
+                                                                        g * x[n * frame + (ic * 84 + iy) * 84 + ix];
+                                                        }
+                                }
+        failed += check("conv grad-weight, bytes vs floats/255",
+                        rel_error(gw, gw_ref, n_w0), 1e-4);
+        failed += check("conv grad-bias, bytes vs floats/255",
+                        rel_error(gb, gb_ref, L0->out_c), 1e-4);
+        /* gradients are accumulated: a 2nd call gives twice the reference */
+        nncpu_conv_backward_weight_u8(conv, BATCH, 84, 84, x8, 1.0f / 255, gy,
+                                      0.5f, gw, gb);
+        for (i = 0; i < n_w0; i++)
+                gw_ref[i] *= 2;
+        for (i = 0; i < L0->out_c; i++)
+                gb_ref[i] *= 2;
+        failed += check("conv grad-weight, accumulated",
+                        rel_error(gw, gw_ref, n_w0), 1e-4);
+        failed += check("conv grad-bias, accumulated",
+                        rel_error(gb, gb_ref, L0->out_c), 1e-4);
+        nncpu_conv_destroy(conv);
+
+        /* 2. the whole network, as the actor evaluates it */
+        for (n = 0; n < BATCH; n++)
+                ref_forward(x + n * frame, q_ref[n]);
+        for (p = 0; p < 3; p++) {
+                struct nncpu_qnet *qn = nncpu_qnet_create(4, 84, 84);
+                double err = 0;
+                char what[64];
+
+                for (i = 0; i < N_LAYERS; i++) {
+                        if (net[i].k)
+                                nncpu_qnet_add_conv(qn, net[i].out_c, net[i].k, net[i].k,
+                                                    net[i].stride, net[i].pad);
+                        else
+                                nncpu_qnet_add_linear(qn, net[i].out_c);
+                        if (i < N_LAYERS - 1)
+                                nncpu_qnet_add_relu(qn);
+                }
+                nncpu_qnet_set_precision(qn, p);
+                nncpu_qnet_set_input_scale(qn, 1.0f / 255);
+                for (i = 0; i < N_LAYERS; i++)
+                        nncpu_qnet_set_weights(qn, i, net[i].w, net[i].b);
+                for (n = 0; n < BATCH; n++) {
+                        double e;
+                        nncpu_qnet_forward_u8(qn, x8 + n * frame, q);
+                        e = rel_error(q, q_ref[n], N_ACTIONS);
+                        if (e > err)  err = e;
+                }
+                snprintf(what, sizeof(what), "qnet %s, bytes vs floats/255",
+                         names[p]);
+                failed += check(what, err, tolerance[p]);
+                nncpu_qnet_destroy(qn);
+        }
+
+        printf(failed ? "FAILED\n" : "OK\n");
+        return failed ? 1 : 0;
+}
@@ -0,0 +1,165 @@
+/*
+ *  test_threadpool.c
+ *
+ *  DESCRIPTION:
+ *
+ *  Stress test of the nncpu worker pool (threadpool.c): runs many
+ *  nncpu_parallel_for() calls back to back, each with its own arguments
+ *  on the stack of a short-lived frame (at a different depth from the
+ *  previous call's, so a stale 'arg' is told from the current one), and
+ *  checks that every task of every call is run exactly once, with that
+ *  call's arguments. A call which does not return (e.g. a worker missed
+ *  its job) is reported by a watchdog. It is built and run by
+ *  'make test'.
+ *
+ *  The pool is linked with pthread_mutex_unlock() and pthread_cond_wait()
+ *  wrapped (ld --wrap): the CPU is yielded after some unlocks, and some
+ *  wakeups are made late (the lock is released again for a moment, as
+ *  if it were contended). This widens the windows where races between
+ *  the caller and the workers show up, even on 1 CPU.
+ *
+ *    $ ./test_threadpool [calls] [threads]
+ *
+ *  REVISION HISTORY:
+ *
+ *    Date             Description                                   Author
+ *    2026-10-18       initial coding                                agent
+ *
+ *  TARGET: Linux C
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <alloca.h>
+#include <sched.h>
+#include <unistd.h>
+#include <signal.h>
+#include <pthread.h>
+#include "nncpu.h"
+
+#define MAX_TASKS  64
+
+struct call {
+        unsigned long   id;             /* the call these tasks belong to */
+        int             runs[MAX_TASKS];
+};
+
+static unsigned long    current;        /* id of the call in progress */
+static unsigned long    stale;          /* tasks run with another call's arg */
+static volatile long    done_calls, checked_calls;
+
+int __real_pthread_mutex_unlock(pthread_mutex_t *m);
+int __real_pthread_cond_wait(pthread_cond_t *c, pthread_mutex_t *m);
+
+/* a per-thread xorshift, for the random delays */
+static unsigned int chance(void)
+{
+        static __thread unsigned int x;
+
+        if (0 == x)
+                x = (unsigned int) (unsigned long) &x | 1;
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        return x;
+}
+
+int __wrap_pthread_mutex_unlock(pthread_mutex_t *m)
+{
+        int r = __real_pthread_mutex_unlock(m);
+
+        if (chance() % 4 == 0)
+                sched_yield();
+        return r;
+}
+
+int __wrap_pthread_cond_wait(pthread_cond_t *c, pthread_mutex_t *m)
+{
+        int r = __real_pthread_cond_wait(c, m);
+
+        if (chance() % 8 == 0) {
+                __real_pthread_mutex_unlock(m);
+                usleep(20);
+                pthread_mutex_lock(m);
+        }
+        return r;
+}
+
+static void task(void *arg, int i, int n)
+{
+        struct call *c = (struct call *) arg;
+
+        if (c->id != __atomic_load_n(&current, __ATOMIC_ACQUIRE))
+                __atomic_add_fetch(&stale, 1, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&c->runs[i], 1, __ATOMIC_RELAXED);
+}
+
+/* 1 call, with its arguments in this frame; returns the number of errors */
+static __attribute__((noinline)) int one_call(unsigned long id, int ntasks)
+{
+        struct call c;
+        int i, errors = 0;
+
+        memset(&c, 0, sizeof(c));
+        c.id = id;
+        __atomic_store_n(&current, id, __ATOMIC_RELEASE);
+        nncpu_parallel_for(ntasks, task, &c);
+        for (i = 0; i < ntasks; i++)
+                if (c.runs[i] != 1)
+                        errors++;
+        /* scribble over the frame, as the caller's next frame would */
+        memset(&c, 0xa5, sizeof(c));
+        return errors;
+}
+
+/* one_call() with its frame 'id' % 4 * 256 bytes deeper */
+static int call_at_depth(unsigned long id, int ntasks)
+{
+        volatile char *pad = alloca(64 + id % 4 * 256);
+
+        pad[0] = 0;
+        return one_call(id, ntasks);
+}
+
+/* fail if no call has returned for 10 seconds */
+static void watchdog(int sig)
+{
+        static const char msg[] = "a call did not return\nFAILED\n";
+
+        if (done_calls == checked_calls) {
+                if (write(1, msg, sizeof(msg) - 1) < 0)
+                        _exit(2);
+                _exit(1);
+        }
+        checked_calls = done_calls;
+        alarm(10);
+}
+
+int main(int argc, char **argv)
+{
+        long calls = argc > 1 ? atol(argv[1]) : 200000;
+        int threads = argc > 2 ? atoi(argv[2]) : 4;
+        long k, errors = 0;
+
+        signal(SIGALRM, watchdog);
+        alarm(10);
+        nncpu_set_num_threads(threads);
+        printf("%ld calls with %d threads\n", calls, nncpu_get_num_threads());
+        fflush(stdout);
+        for (k = 0; k < calls; k++) {
+                errors += call_at_depth(k + 1, 2 + (int) (k % (MAX_TASKS - 1)));
+                done_calls = k + 1;
+        }
+        alarm(0);
+
+        printf("tasks not run exactly once: %ld, run with a stale arg: %lu\n",
+               errors, stale);
+        if (errors || stale) {
+                printf("FAILED\n");
+                return 1;
+        }
+        printf("OK\n");
+        return 0;
+}
@@ -0,0 +1,229 @@
+/*
+ *  threadpool.c
+ *
+ *  DESCRIPTION:
+ *
+ *  A minimal pthread worker pool used by the nncpu kernels. The only
+ *  operation is a blocking parallel-for: nncpu_parallel_for() splits a
+ *  job into 'ntasks' independent tasks, which are picked up (in any
+ *  order) by the worker threads and the calling thread itself. It
+ *  returns when all tasks are done.
+ *
+ *  PROCESS:
+ *
+ *  void nncpu_set_num_threads(int n);
+ *  int  nncpu_get_num_threads();
+ *  void nncpu_parallel_for(int ntasks, nncpu_task_fn fn, void *arg);
+ *
+ *  Worker threads are created lazily on the first parallel_for() call.
+ *  The default number of threads is the number of online CPUs.
+ *
+ *  GLOBALS: none
+ *
+ *  REFERENCE:
+ *
+ *  LIMITATIONS:
+ *
+ *  Only one parallel_for() job runs at a time. If another thread calls
+ *  parallel_for() while the pool is busy, that job simply runs serially
+ *  in the calling thread (it is never blocked by the other job).
+ *
+ *  parallel_for() returns only after every worker has joined its job
+ *  (even if there was no task left for it), so that no worker could pick
+ *  up the next job's tasks with this job's 'fn' and 'arg'.
+ *
+ *  REVISION HISTORY:
+ *
+ *    Date             Description                                   Author
+ *    2026-10-18       initial coding                                agent
+ *    2026-10-18       wait for all workers to join each job         agent
+ *    2026-10-18       start the workers after set_num_threads(n)    agent
+ *
+ *  TARGET: Linux C
+ *
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "nncpu.h"
+
+static pthread_mutex_t  call_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t  lock      = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t   work_cv   = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t   done_cv   = PTHREAD_COND_INITIALIZER;
+
+static pthread_t       *workers;
+static int              n_workers;
+static int              n_threads;      /* 0: not decided yet */
+static int              started;        /* workers started for n_threads */
+static unsigned long    start_generation; /* job_generation at their start */
+static int              shutting_down;
+
+/* the current job, protected by 'lock' */
+static nncpu_task_fn    job_fn;
+static void            *job_arg;
+static int              job_ntasks;
+static unsigned long    job_generation;
+static int              job_joined;     /* workers which took the job */
+static int              job_active;     /* workers still inside the job */
+static int              next_task;      /* atomic */
+static int              tasks_done;     /* atomic */
+
+static void run_tasks(nncpu_task_fn fn, void *arg, int ntasks)
+{
+        int i;
+
+        while ((i = __atomic_fetch_add(&next_task, 1, __ATOMIC_RELAXED)) < ntasks) {
+                fn(arg, i, ntasks);
+                if (__atomic_add_fetch(&tasks_done, 1, __ATOMIC_ACQ_REL) == ntasks) {
+                        pthread_mutex_lock(&lock);
+                        pthread_cond_signal(&done_cv);
+                        pthread_mutex_unlock(&lock);
+                }
+        }
+}
+
+static void *worker_main(void *unused)
+{
+        unsigned long seen = start_generation;
+
+        pthread_mutex_lock(&lock);
+        while (1) {
+                nncpu_task_fn fn;
+                void *arg;
+                int ntasks;
+
+                while (job_generation == seen && !shutting_down)
+                        pthread_cond_wait(&work_cv, &lock);
+                if (shutting_down)
+                        break;
+                seen   = job_generation;
+                fn     = job_fn;
+                arg    = job_arg;
+                ntasks = job_ntasks;
+                job_joined++;
+                job_active++;
+                pthread_mutex_unlock(&lock);
+
+                run_tasks(fn, arg, ntasks);
+
+                pthread_mutex_lock(&lock);
+                if (--job_active == 0)
+                        pthread_cond_signal(&done_cv);
+        }
+        pthread_mutex_unlock(&lock);
+        return NULL;
+}
+
+static void stop_workers(void)
+{
+        int i;
+
+        pthread_mutex_lock(&lock);
+        shutting_down = 1;
+        pthread_cond_broadcast(&work_cv);
+        pthread_mutex_unlock(&lock);
+        for (i = 0; i < n_workers; i++)
+                pthread_join(workers[i], NULL);
+        free(workers);
+        workers = NULL;
+        n_workers = 0;
+        shutting_down = 0;
+        started = 0;
+}
+
+static void start_workers(void)
+{
+        int i;
+
+        started = 1;
+        start_generation = job_generation;  /* no job is in progress */
+        if (n_threads <= 0) {
+                n_threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+                if (n_threads <= 0)  n_threads = 1;
+        }
+        if (n_threads == 1)
+                return;
+        workers = (pthread_t *) calloc(n_threads - 1, sizeof(pthread_t));
+        if (!workers) {
+                n_threads = 1;
+                return;
+        }
+        for (i = 0; i < n_threads - 1; i++) {
+                if (pthread_create(&workers[i], NULL, worker_main, NULL) != 0)
+                        break;
+        }
+        n_workers = i;
+        n_threads = n_workers + 1;
+}
+
+void nncpu_set_num_threads(int n)
+{
+        pthread_mutex_lock(&call_lock);
+        if (n_workers > 0)
+                stop_workers();
+        started = 0;
+        n_threads = (n > 0) ? n : 0;
+        pthread_mutex_unlock(&call_lock);
+}
+
+int nncpu_get_num_threads()
+{
+        int n;
+
+        pthread_mutex_lock(&call_lock);
+        if (!started)
+                start_workers();
+        n = n_threads;
+        pthread_mutex_unlock(&call_lock);
+        return n;
+}
+
+void nncpu_parallel_for(int ntasks, nncpu_task_fn fn, void *arg)
+{
+        int i;
+
+        if (ntasks <= 0)
+                return;
+        if (ntasks == 1 || pthread_mutex_trylock(&call_lock) != 0) {
+                /* trivial job, or the pool is busy with someone else's */
+                for (i = 0; i < ntasks; i++)
+                        fn(arg, i, ntasks);
+                return;
+        }
+        if (!started)
+                start_workers();
+        if (n_workers == 0) {
+                pthread_mutex_unlock(&call_lock);
+                for (i = 0; i < ntasks; i++)
+                        fn(arg, i, ntasks);
+                return;
+        }
+
+        pthread_mutex_lock(&lock);
+        job_fn     = fn;
+        job_arg    = arg;
+        job_ntasks = ntasks;
+        next_task  = 0;
+        tasks_done = 0;
+        job_joined = 0;
+        job_generation++;
+        pthread_cond_broadcast(&work_cv);
+        pthread_mutex_unlock(&lock);
+
+        run_tasks(fn, arg, ntasks);
+
+        /*
+         * wait for all tasks, and for all workers to join and leave this
+         * job: a worker which has not joined yet would otherwise take the
+         * next job's 'next_task' with this 'fn' and 'arg'
+         */
+        pthread_mutex_lock(&lock);
+        while (__atomic_load_n(&tasks_done, __ATOMIC_ACQUIRE) < ntasks ||
+               job_joined < n_workers || job_active > 0)
+                pthread_cond_wait(&done_cv, &lock);
+        pthread_mutex_unlock(&lock);
+
+        pthread_mutex_unlock(&call_lock);
+}
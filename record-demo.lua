@@ -0,0 +1,126 @@
+--------------------------------------------------------------------------------
+--
+-- record-demo.lua
+--
+-- This program records a human playing Galaga into a transition dataset
+-- (dataset module), which train-deepmind.lua -demo preloads into the
+-- replay memory, so that training starts from the human's play instead
+-- of learn_start steps of random actions.
+--
+--   $ th record-demo.lua -out demo_1.eps [-games 5]
+--
+-- The GPIO pins which otherwise press the buttons (see gameenv-threaded)
+-- are monitored as inputs instead (gpio.monitor_start()), so the buttons
+-- must be wired to them; the human presses Start and plays on the
+-- controller. The button changes are timestamped by the monitor thread
+-- and matched against the capture times of the frames: the action of a
+-- step is what was held between its frame and the next decision's, as
+-- one of the 6 actions of the agent (Left and Right together are Stay).
+--
+-- The steps are recorded as train-deepmind.lua -record does: 1 every
+-- -actrep frames, with the preprocessed (84x84) frame, the rewards of
+-- the frames in between summed up and clipped to [-1, 1].
+--
+--------------------------------------------------------------------------------
+-- agent, 2026-10-18
+--------------------------------------------------------------------------------
+
+require 'torch'
+
+torch.setdefaulttensortype('torch.FloatTensor')
+
+cmd = torch.CmdLine()
+cmd:text()
+cmd:text('Record a human playing into a dataset:')
+cmd:text()
+cmd:text('Options:')
+cmd:option('-out', 'demo.eps', 'dataset file to append the steps to')
+cmd:option('-games', 1, 'number of games to record')
+cmd:option('-actrep', 2, 'how many steps to repeat an action (as in train-deepmind.lua)')
+cmd:option('-active_low', false, 'buttons pull the pins low when pressed')
+cmd:option('-display_freq', 2, 'frequency of game image display')
+cmd:text()
+
+local opt = cmd:parse(arg)
+
+--
+-- Initialization
+--
+package.path = package.path .. ';./dqn-deepmind/?.lua'
+require 'nn'
+gpio = require 'gpio/gpio'
+dataset = require 'dataset/dataset'
+game_env = require 'gameenv/gameenv-threaded'
+game_env.init('galaga', opt.display_freq)
+game_actions = game_env.get_actions()
+
+-- the pins of gameenv-threaded: Left, Right, -, -, A (Fire), Start
+local pins = { 36, 37, 184, 219, 38, 63 }
+local LEFT, RIGHT, FIRE = 1, 2, 16
+gpio.monitor_start(pins, opt.active_low)
+
+local state_dim = 84 * 84
+local frame = torch.ByteTensor(state_dim)
+
+local writer = dataset.writer(opt.out, state_dim, #game_actions)
+
+-- the action (1~6, see gameenv.get_actions()) for a mask of buttons
+local function action_of(mask)
+    local left = bit.band(mask, LEFT) ~= 0
+    local right = bit.band(mask, RIGHT) ~= 0
+    local a = 2  -- Stay
+    if left and not right then a = 1 end
+    if right and not left then a = 3 end
+    if bit.band(mask, FIRE) ~= 0 then a = a + 3 end
+    return a
+end
+
+-- the screen (84x84 gray levels) as a frame of the replay memory
+local function quantize(screen)
+    return frame:copy(screen:view(state_dim))
+end
+
+--
+-- Main program
+--
+local total = 0
+local stats = torch.Tensor(#game_actions)
+for g = 1, opt.games do
+    print('Press Start for game ' .. g .. ' of ' .. opt.games)
+    game_env.new_game(true)
+    stats:zero()
+
+    local screen, reward, terminal = game_env.step()
+    local t_prev, r_sum, frames, steps = game_env.frame_time, 0, 0, 0
+    local s_prev = quantize(screen):clone()
+    while not terminal do
+        screen, reward, terminal = game_env.step()
+        frames = frames + 1
+        r_sum = r_sum + reward
+        if terminal or frames % opt.actrep == 0 then
+            local t = game_env.frame_time
+            local a = action_of(gpio.monitor_held(t_prev, t))
+            writer:add(s_prev, a, math.max(-1, math.min(1, r_sum)), false)
+            stats[a] = stats[a] + 1
+            s_prev:copy(quantize(screen))
+            t_prev, r_sum, steps = t, 0, steps + 1
+        end
+    end
+    -- the terminal state (its action and reward are not learned from)
+    writer:add(s_prev, 2, 0, true)
+    writer:flush()
+    total = total + steps + 1
+
+    stats:div(math.max(stats:sum(), 1))
+    io.write(string.format('Game %d: score %d, %d steps; actions: ', g,
+                           game_env.get_score(), steps))
+    for i = 1, stats:size(1) do io.write(string.format('%.2f, ', stats[i])) end
+    print('')
+end
+
+writer:close()
+gpio.monitor_stop()
+-- give the pins back to gameenv as outputs before its cleanup
+for i = 1, #pins do gpio.set_output(pins[i]) end
+game_env.cleanup()
+print(string.format('\n%d steps recorded into %s', total, opt.out))
@@ -0,0 +1,325 @@
+/*
+ *  shmpub.c
+ *
+ *  DESCRIPTION:
+ *
+ *  Publisher of the game frames and the agent's telemetry (score, reward,
+ *  action, Q-values) into POSIX shared memory, replacing the in-process
+ *  OpenCV window of imshow for watching a training run: a viewer is a
+ *  separate process (shmview.c, or anything which maps the layout of
+ *  shmpub.h), so the training process links no GUI library, and a slow
+ *  or stuck viewer could never stall it.
+ *
+ *  The shared memory object (SHMPUB_NAME by default) is the header,
+ *  which holds the latest telemetry, followed by a ring of SHMPUB_SLOTS
+ *  frame slots. There is 1 writer per record (the thread displaying
+ *  frames, and the one publishing telemetry), and it never waits: every
+ *  record is guarded by a sequence counter (seqlock), which is odd while
+ *  the record is being written. Readers copy a record and retry if the
+ *  counter was odd or changed meanwhile; the ring lets them copy the
+ *  latest frame while the next one is being written. Publishing a frame
+ *  costs a memcpy into the shared memory and 3 stores.
+ *
+ *  PROCESS:
+ *
+ *  writer:
+ *
+ *  int  shmpub_open(const char *name, const char *title, int frame_max);
+ *  int  shmpub_is_open(void);
+ *  void shmpub_frame(const unsigned char *buf, int w, int h);
+ *  void shmpub_telemetry(const struct shmpub_telemetry *t);
+ *  void shmpub_close(void);
+ *
+ *  readers:
+ *
+ *  struct shmpub_reader *shmpub_attach(const char *name);
+ *  const struct shmpub_header *shmpub_header(r);
+ *  int  shmpub_read_frame(r, unsigned char *buf, int size, int *w, int *h,
+ *                         uint64_t *frame_no);
+ *  int  shmpub_read_telemetry(r, struct shmpub_telemetry *t);
+ *  int  shmpub_stale(r);
+ *  void shmpub_detach(r);
+ *
+ *  GLOBALS:
+ *
+ *  The mapping of the writer (1 publisher per process).
+ *
+ *  REFERENCE:
+ *
+ *  1. shm_overview(7)
+ *  2. "Seqlocks", Documentation/locking/seqlock.rst of the Linux kernel
+ *
+ *  LIMITATIONS:
+ *
+ *  1. Frames are 8-bit gray, of up to 'frame_max' bytes.
+ *  2. A reader which is preempted for longer than SHMPUB_SLOTS - 1 frames
+ *     while copying one retries with the latest frame.
+ *  3. Of 2 training processes with the same shared memory name, viewers
+ *     attaching later see the one which started last.
+ *
+ *  REVISION HISTORY:
+ *
+ *    Date             Description                                   Author
+ *    2026-10-18       initial coding                                agent
+ *
+ *  TARGET: Linux C
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "shmpub.h"
+
+#define HEADER_SIZE  ((sizeof(struct shmpub_header) + 63) & ~(size_t) 63)
+#define RETRIES      100
+
+struct shmpub_reader {
+        struct shmpub_header *h;
+        size_t                size;
+        char                  name[64];
+        ino_t                 ino;
+};
+
+static struct shmpub_header *pub;
+static size_t pub_size;
+static char   pub_name[64];
+
+static size_t slot_size(int frame_max)
+{
+        return (sizeof(struct shmpub_slot) + frame_max + 63) & ~(size_t) 63;
+}
+
+static struct shmpub_slot *slot(struct shmpub_header *h, uint64_t i)
+{
+        return (struct shmpub_slot *) ((unsigned char *) h + HEADER_SIZE +
+                                       (i % h->slots) * slot_size(h->frame_max));
+}
+
+static double now(void)
+{
+        struct timespec ts;
+
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*
+ * Create (or replace) shared memory object 'name' (NULL for
+ * SHMPUB_NAME), for frames of up to 'frame_max' bytes. Returns 0, or -1
+ * on error.
+ */
+int shmpub_open(const char *name, const char *title, int frame_max)
+{
+        size_t size;
+        int fd;
+
+        if (pub || frame_max <= 0)
+                return -1;
+        if (NULL == name)
+                name = SHMPUB_NAME;
+        size = HEADER_SIZE + SHMPUB_SLOTS * slot_size(frame_max);
+        /* a new object: viewers of a previous run keep their (old) mapping */
+        shm_unlink(name);
+        fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+        if (fd < 0) {
+                perror(name);
+                return -1;
+        }
+        if (ftruncate(fd, size) < 0) {
+                perror(name);
+                close(fd);
+                return -1;
+        }
+        pub = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (MAP_FAILED == pub) {
+                perror(name);
+                pub = NULL;
+                return -1;
+        }
+        pub_size = size;
+        snprintf(pub_name, sizeof(pub_name), "%s", name);
+
+        pub->version = SHMPUB_VERSION;
+        pub->slots = SHMPUB_SLOTS;
+        pub->frame_max = frame_max;
+        pub->writer_pid = getpid();
+        snprintf(pub->title, sizeof(pub->title), "%s", title ? title : "");
+        /* readers check the magic last */
+        __atomic_store_n(&pub->magic, SHMPUB_MAGIC, __ATOMIC_RELEASE);
+        return 0;
+}
+
+/* 1 if a publisher is open in this process (of any thread), otherwise 0 */
+int shmpub_is_open(void)
+{
+        return pub != NULL;
+}
+
+/* Publish 1 gray frame of w x h bytes (dropped if larger than frame_max) */
+void shmpub_frame(const unsigned char *buf, int w, int h)
+{
+        struct shmpub_slot *s;
+        uint64_t n, seq;
+
+        if (NULL == pub || w * h > pub->frame_max)
+                return;
+        n = pub->frames;
+        s = slot(pub, n);
+        seq = s->seq;
+        __atomic_store_n(&s->seq, seq + 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        s->time = now();
+        s->w = w;
+        s->h = h;
+        s->frame_no = n + 1;
+        memcpy(s + 1, buf, w * h);
+        __atomic_store_n(&s->seq, seq + 2, __ATOMIC_RELEASE);
+        __atomic_store_n(&pub->frames, n + 1, __ATOMIC_RELEASE);
+}
+
+/* Publish the telemetry of the agent */
+void shmpub_telemetry(const struct shmpub_telemetry *t)
+{
+        uint64_t seq;
+
+        if (NULL == pub)
+                return;
+        seq = pub->telemetry_seq;
+        __atomic_store_n(&pub->telemetry_seq, seq + 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        memcpy(&pub->telemetry, t, sizeof(*t));
+        pub->telemetry.time = now();
+        __atomic_store_n(&pub->telemetry_seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+/* Unmap and remove the shared memory object (viewers keep their mapping) */
+void shmpub_close(void)
+{
+        if (NULL == pub)
+                return;
+        munmap(pub, pub_size);
+        shm_unlink(pub_name);
+        pub = NULL;
+}
+
+/* Map shared memory object 'name' (NULL for SHMPUB_NAME) read-only */
+struct shmpub_reader *shmpub_attach(const char *name)
+{
+        struct shmpub_reader *r;
+        struct stat st;
+        int fd;
+
+        if (NULL == name)
+                name = SHMPUB_NAME;
+        fd = shm_open(name, O_RDONLY, 0);
+        if (fd < 0)
+                return NULL;
+        if (fstat(fd, &st) < 0 || (size_t) st.st_size < HEADER_SIZE ||
+            (r = calloc(1, sizeof(*r))) == NULL) {
+                close(fd);
+                return NULL;
+        }
+        r->size = st.st_size;
+        r->ino = st.st_ino;
+        snprintf(r->name, sizeof(r->name), "%s", name);
+        r->h = mmap(NULL, r->size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (MAP_FAILED == r->h ||
+            __atomic_load_n(&r->h->magic, __ATOMIC_ACQUIRE) != SHMPUB_MAGIC ||
+            r->h->version != SHMPUB_VERSION ||
+            HEADER_SIZE + r->h->slots * slot_size(r->h->frame_max) > r->size) {
+                if (MAP_FAILED != r->h)
+                        munmap(r->h, r->size);
+                free(r);
+                return NULL;
+        }
+        return r;
+}
+
+const struct shmpub_header *shmpub_header(struct shmpub_reader *r)
+{
+        return r->h;
+}
+
+/*
+ * Copy the latest frame into 'buf' (of 'size' bytes). Returns 1 if a
+ * frame was copied, 0 if none has been published yet, or -1 on error
+ * (the buffer is too small, or the writer is too fast to be read).
+ */
+int shmpub_read_frame(struct shmpub_reader *r, unsigned char *buf, int size,
+                      int *w, int *h, uint64_t *frame_no)
+{
+        const struct shmpub_slot *s;
+        uint64_t n, seq;
+        int i;
+
+        for (i = 0; i < RETRIES; i++) {
+                n = __atomic_load_n(&r->h->frames, __ATOMIC_ACQUIRE);
+                if (0 == n)
+                        return 0;
+                s = slot(r->h, n - 1);
+                seq = __atomic_load_n(&s->seq, __ATOMIC_ACQUIRE);
+                if (seq & 1)
+                        continue;
+                *w = s->w;
+                *h = s->h;
+                *frame_no = s->frame_no;
+                if (*w * *h > size || *w * *h > r->h->frame_max)
+                        return -1;
+                memcpy(buf, s + 1, *w * *h);
+                __atomic_thread_fence(__ATOMIC_ACQUIRE);
+                if (__atomic_load_n(&s->seq, __ATOMIC_RELAXED) == seq)
+                        return 1;
+        }
+        return -1;
+}
+
+/* Copy the latest telemetry. Returns 0, or -1 if it could not be read */
+int shmpub_read_telemetry(struct shmpub_reader *r, struct shmpub_telemetry *t)
+{
+        uint64_t seq;
+        int i;
+
+        for (i = 0; i < RETRIES; i++) {
+                seq = __atomic_load_n(&r->h->telemetry_seq, __ATOMIC_ACQUIRE);
+                if (seq & 1)
+                        continue;
+                memcpy(t, &r->h->telemetry, sizeof(*t));
+                __atomic_thread_fence(__ATOMIC_ACQUIRE);
+                if (__atomic_load_n(&r->h->telemetry_seq, __ATOMIC_RELAXED) == seq)
+                        return 0;
+        }
+        return -1;
+}
+
+/*
+ * Returns 1 if the shared memory object has been removed or replaced
+ * (the writer has exited or restarted) since 'r' attached, otherwise 0.
+ */
+int shmpub_stale(struct shmpub_reader *r)
+{
+        struct stat st;
+        int fd, stale;
+
+        fd = shm_open(r->name, O_RDONLY, 0);
+        if (fd < 0)
+                return 1;
+        stale = fstat(fd, &st) < 0 || st.st_ino != r->ino;
+        close(fd);
+        return stale;
+}
+
+void shmpub_detach(struct shmpub_reader *r)
+{
+        if (NULL == r)
+                return;
+        munmap(r->h, r->size);
+        free(r);
+}
@@ -0,0 +1,81 @@
+/*
+ * shmpub.h
+ *
+ * Layout of the shared memory of the frame/telemetry publisher, see
+ * shmpub.c.
+ */
+
+#ifndef SHMPUB_H_
+#define SHMPUB_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SHMPUB_MAGIC      0x42555053u   /* "SPUB" */
+#define SHMPUB_VERSION    1
+#define SHMPUB_NAME       "/dqn_display"
+#define SHMPUB_SLOTS      4             /* frames in the ring */
+#define SHMPUB_MAX_Q      18            /* Q-values in the telemetry */
+
+/* telemetry of the agent (of the 1st game), published per decision */
+struct shmpub_telemetry {
+        double  time;                   /* CLOCK_MONOTONIC seconds */
+        int64_t step;                   /* agent steps */
+        int32_t game;                   /* games played so far */
+        int32_t score;                  /* parsed from the screen */
+        float   reward;                 /* of the last decision */
+        int32_t terminal;
+        int32_t action;                 /* 1-based, 0 for none */
+        float   epsilon;
+        int32_t n_q;                    /* 0 if the action was random */
+        float   q[SHMPUB_MAX_Q];
+};
+
+/* a frame slot; the frame (w * h bytes, gray) follows the header */
+struct shmpub_slot {
+        uint64_t seq;                   /* seqlock: odd while written */
+        double   time;
+        int32_t  w, h;
+        uint64_t frame_no;              /* 1, 2, ... */
+        uint8_t  pad[32];               /* frame at a 64-byte offset */
+};
+
+struct shmpub_header {
+        uint32_t magic;
+        uint32_t version;
+        int32_t  slots;
+        int32_t  frame_max;             /* bytes of a frame slot */
+        int32_t  writer_pid;
+        char     title[60];
+        uint64_t frames;                /* frames published so far */
+        uint64_t telemetry_seq;         /* seqlock of 'telemetry' */
+        struct shmpub_telemetry telemetry;
+        uint8_t  pad[64];
+};
+
+/* writer (the training process) */
+extern int  shmpub_open(const char *name, const char *title, int frame_max);
+extern int  shmpub_is_open(void);
+extern void shmpub_frame(const unsigned char *buf, int w, int h);
+extern void shmpub_telemetry(const struct shmpub_telemetry *t);
+extern void shmpub_close(void);
+
+/* readers (viewers, any number of them) */
+struct shmpub_reader;
+extern struct shmpub_reader *shmpub_attach(const char *name);
+extern const struct shmpub_header *shmpub_header(struct shmpub_reader *r);
+extern int  shmpub_read_frame(struct shmpub_reader *r, unsigned char *buf,
+                              int size, int *w, int *h, uint64_t *frame_no);
+extern int  shmpub_read_telemetry(struct shmpub_reader *r,
+                                  struct shmpub_telemetry *t);
+extern int  shmpub_stale(struct shmpub_reader *r);
+extern void shmpub_detach(struct shmpub_reader *r);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SHMPUB_H_ */
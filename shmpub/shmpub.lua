@@ -0,0 +1,106 @@
+--------------------------------------------------------------------------------
+--
+-- "shmpub" module
+--
+-- This module publishes the game frames and the agent's telemetry into
+-- POSIX shared memory (libshmpub.so) through FFI, for a viewer in another
+-- process (shmpub/shmview) to render or encode. It has the interface of
+-- the "imshow" module (init/display/cleanup), without its OpenCV window in
+-- the training process: publishing a frame is a memcpy, and never waits
+-- for a viewer. See shmpub.c for details.
+--
+-- Usage:
+--
+--   local shmpub = require 'shmpub/shmpub'
+--   shmpub.init('nintendo galaga')
+--   shmpub.display(img)   -- (1, H, W) ByteTensor
+--   shmpub.telemetry{step = 1000, game = 3, score = 1200, reward = 1,
+--                    action = 5, epsilon = 0.1, q = q}
+--   shmpub.cleanup()
+--
+-- The module could be used from any thread of the process (e.g. frames
+-- from the gameenv worker, telemetry from the actor); there is 1
+-- publisher per process, which is opened by init().
+--
+--------------------------------------------------------------------------------
+-- agent, 2026-10-18
+--------------------------------------------------------------------------------
+
+require 'torch'
+
+local ffi = require 'ffi'
+local shmpub = {}
+local lib = ffi.load(paths.cwd() .. '/shmpub/libshmpub.so')
+
+-- Function prototype definition
+ffi.cdef [[
+    struct shmpub_telemetry {
+        double  time;
+        int64_t step;
+        int32_t game;
+        int32_t score;
+        float   reward;
+        int32_t terminal;
+        int32_t action;
+        float   epsilon;
+        int32_t n_q;
+        float   q[18];
+    };
+    int  shmpub_open(const char *name, const char *title, int frame_max);
+    int  shmpub_is_open(void);
+    void shmpub_frame(const unsigned char *buf, int w, int h);
+    void shmpub_telemetry(const struct shmpub_telemetry *t);
+    void shmpub_close(void);
+]]
+
+local MAX_Q = 18
+
+-- Open the publisher. 'title' names the run for viewers; the shared
+-- memory object is 'name' (default '/dqn_display'), for frames of up to
+-- 'frame_max' bytes (default 640x360).
+function shmpub.init(title, name, frame_max)
+    return lib.shmpub_open(name, title or 'shmpub', frame_max or 640 * 360)
+end
+
+-- true if the publisher is open (by any thread)
+function shmpub.is_open()
+    return lib.shmpub_is_open() ~= 0
+end
+
+function shmpub.display(img)
+    -- expect 'img' to be a (1, H, W) ByteTensor, as imshow.display()
+    assert(img:type() == 'torch.ByteTensor')
+    assert(img:dim() == 3 and img:isContiguous())
+    lib.shmpub_frame(img:data(), img:size(3), img:size(2))
+end
+
+-- publish a gray frame of w x h bytes at pointer 'p' (no tensor needed)
+function shmpub.display_raw(p, w, h)
+    lib.shmpub_frame(p, w, h)
+end
+
+-- Publish the telemetry of the agent: a table of step, game, score,
+-- reward, terminal, action and epsilon, and the Q-values q (a
+-- FloatTensor) if the action was greedy.
+local t = ffi.new('struct shmpub_telemetry')
+function shmpub.telemetry(s)
+    t.step = s.step or 0
+    t.game = s.game or 0
+    t.score = s.score or 0
+    t.reward = s.reward or 0
+    t.terminal = s.terminal and 1 or 0
+    t.action = s.action or 0
+    t.epsilon = s.epsilon or 0
+    t.n_q = 0
+    if s.q then
+        t.n_q = math.min(s.q:nElement(), MAX_Q)
+        for i = 1, t.n_q do t.q[i - 1] = s.q[i] end
+    end
+    lib.shmpub_telemetry(t)
+end
+
+function shmpub.cleanup()
+    lib.shmpub_close()
+end
+
+return shmpub
@@ -0,0 +1,177 @@
+/*
+ *  shmview.c
+ *
+ *  DESCRIPTION:
+ *
+ *  Viewer of the frames and telemetry published by a training process
+ *  (shmpub.c), without any GUI library: it attaches to the shared memory
+ *  and
+ *
+ *    - prints the telemetry (score, reward, action, Q-values) and the
+ *      frame rate on stderr every second (unless -q),
+ *
+ *  and, every interval (-i, 100 ms by default), if there is a new frame
+ *
+ *    - with -o, writes the latest frame to a PGM file (replaced
+ *      atomically, so an image viewer could reload it),
+ *    - with -r, writes every new frame raw to stdout, to be rendered or
+ *      encoded, e.g.
+ *
+ *        $ shmpub/shmview -r | ffplay -f rawvideo -pixel_format gray \
+ *                                     -video_size 640x360 -
+ *
+ *  It re-attaches when the training process is restarted.
+ *
+ *  PROCESS:
+ *
+ *  $ shmview [-n name] [-i interval_ms] [-o frame.pgm] [-r] [-q]
+ *
+ *  GLOBALS: none
+ *
+ *  REFERENCE:
+ *
+ *  LIMITATIONS:
+ *
+ *  1. With -r, frames published faster than the interval are skipped,
+ *     and the frame size must not change.
+ *
+ *  REVISION HISTORY:
+ *
+ *    Date             Description                                   Author
+ *    2026-10-18       initial coding                                agent
+ *
+ *  TARGET: Linux C
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+#include "shmpub.h"
+
+static const char *action_names[] = {
+        "-", "Left", "Stay", "Right", "Left+Fire", "Fire", "Right+Fire"
+};
+
+static double now(void)
+{
+        struct timespec ts;
+
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int write_pgm(const char *path, const unsigned char *buf, int w, int h)
+{
+        char tmp[512];
+        FILE *fp;
+        int ok;
+
+        snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+        if ((fp = fopen(tmp, "wb")) == NULL)
+                return -1;
+        fprintf(fp, "P5\n%d %d\n255\n", w, h);
+        ok = fwrite(buf, 1, w * h, fp) == (size_t) (w * h);
+        if (fclose(fp) != 0 || !ok)
+                return -1;
+        return rename(tmp, path);
+}
+
+static void print_telemetry(const struct shmpub_telemetry *t, double fps)
+{
+        int i;
+
+        fprintf(stderr, "game %d step %lld: score %d, reward %.2f%s, %s "
+                "(epsilon %.3f), %.1f fps", t->game, (long long) t->step,
+                t->score, t->reward, t->terminal ? " (end)" : "",
+                (t->action >= 0 && t->action <= 6) ? action_names[t->action] : "?",
+                t->epsilon, fps);
+        if (t->n_q > 0) {
+                fprintf(stderr, ", Q:");
+                for (i = 0; i < t->n_q && i < SHMPUB_MAX_Q; i++)
+                        fprintf(stderr, " %.3f", t->q[i]);
+        }
+        fprintf(stderr, "\n");
+}
+
+static void usage(const char *prog)
+{
+        fprintf(stderr, "usage: %s [-n name] [-i interval_ms] [-o frame.pgm] "
+                "[-r] [-q]\n", prog);
+        exit(2);
+}
+
+int main(int argc, char *argv[])
+{
+        const char *name = NULL, *pgm = NULL;
+        int interval = 100, raw = 0, quiet = 0;
+        struct shmpub_reader *r = NULL;
+        struct shmpub_telemetry t;
+        unsigned char *buf = NULL;
+        uint64_t frame_no, last_no = 0, tic_no = 0;
+        double tic = now(), last_new = now(), fps = 0;
+        int c, w, h, size = 0;
+
+        while ((c = getopt(argc, argv, "n:i:o:rq")) != -1) {
+                switch (c) {
+                case 'n': name = optarg; break;
+                case 'i': interval = atoi(optarg); break;
+                case 'o': pgm = optarg; break;
+                case 'r': raw = 1; break;
+                case 'q': quiet = 1; break;
+                default:  usage(argv[0]);
+                }
+        }
+        if (interval <= 0)
+                usage(argv[0]);
+        signal(SIGPIPE, SIG_DFL);
+
+        while (1) {
+                usleep(interval * 1000);
+                if (NULL == r) {
+                        if ((r = shmpub_attach(name)) == NULL)
+                                continue;
+                        size = shmpub_header(r)->frame_max;
+                        free(buf);
+                        if ((buf = malloc(size)) == NULL)
+                                return 1;
+                        fprintf(stderr, "attached to '%s' (pid %d)\n",
+                                shmpub_header(r)->title,
+                                shmpub_header(r)->writer_pid);
+                        last_no = tic_no = 0;
+                        tic = last_new = now();
+                }
+
+                if (shmpub_read_frame(r, buf, size, &w, &h, &frame_no) == 1 &&
+                    frame_no != last_no) {
+                        last_no = frame_no;
+                        last_new = now();
+                        if (pgm && write_pgm(pgm, buf, w, h) != 0)
+                                perror(pgm);
+                        if (raw && fwrite(buf, 1, w * h, stdout) != (size_t) (w * h))
+                                return 0;  /* the consumer is gone */
+                        if (raw)
+                                fflush(stdout);
+                }
+                if (now() - tic >= 1.0) {
+                        fps = (last_no - tic_no) / (now() - tic);
+                        tic = now();
+                        tic_no = last_no;
+                        if (!quiet && shmpub_read_telemetry(r, &t) == 0 && t.time > 0)
+                                print_telemetry(&t, fps);
+                }
+
+                /* nothing new for a while: the writer might have restarted */
+                if (now() - last_new > 2.0) {
+                        last_new = now();
+                        if (shmpub_stale(r)) {
+                                shmpub_detach(r);
+                                r = NULL;
+                        }
+                }
+        }
+        return 0;
+}
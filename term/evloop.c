@@ -0,0 +1,272 @@
+/*
+ *  evloop.c
+ *
+ *  DESCRIPTION:
+ *
+ *  Event loop for Lua by FFI: file descriptors (stdin, the V4L2 device,
+ *  see vidcap_fd()), timers (timerfd, e.g. for button pulses and frame
+ *  deadlines) and wakeups from other threads (eventfd) are registered
+ *  with an id of the caller's choice, and waited for together by 1
+ *  epoll_wait(). So a tool reacts to whichever comes first within
+ *  microseconds, instead of polling each of them in slices.
+ *
+ *  evloop_wait() returns the ids of the ready sources, and does not call
+ *  back into Lua: the caller dispatches them. Expirations of timers and
+ *  counts of wakeups are consumed by evloop_wait() (and returned); for
+ *  plain file descriptors, the caller reads them (e.g. term_waitkey(0),
+ *  vidcap_poll()), otherwise they are reported ready again.
+ *
+ *  PROCESS:
+ *
+ *  struct evloop *evloop_create(void);
+ *  int  evloop_add_fd(l, int fd, int id);
+ *  int  evloop_add_timer(l, int id);
+ *  int  evloop_set_timer(l, int id, double first, double interval);
+ *  int  evloop_add_wakeup(l, int id);
+ *  int  evloop_wakeup(int fd);
+ *  int  evloop_remove(l, int id);
+ *  int  evloop_wait(l, int *ids, unsigned long long *counts, int max,
+ *                   int timeout);
+ *  void evloop_destroy(l);
+ *
+ *  GLOBALS: none
+ *
+ *  REFERENCE:
+ *
+ *  1. epoll(7), timerfd_create(2), eventfd(2)
+ *
+ *  LIMITATIONS:
+ *
+ *  1. A loop is waited for by 1 thread; only evloop_wakeup() could be
+ *     called from others.
+ *  2. Up to EVLOOP_MAX sources per loop.
+ *
+ *  REVISION HISTORY:
+ *
+ *    Date             Description                             Author
+ *    2026-10-18       initial coding                          agent
+ *
+ *  TARGET: Linux C
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
+
+#define EVLOOP_MAX  64
+
+#define SRC_FD      1           /* the caller's fd, left to the caller */
+#define SRC_TIMER   2           /* a timerfd owned by the loop */
+#define SRC_WAKEUP  3           /* an eventfd owned by the loop */
+
+struct evloop {
+        int     epfd;
+        struct {
+                int type;       /* 0 if free */
+                int fd;
+                int id;
+        } src[EVLOOP_MAX];
+};
+
+#if 0
+struct evloop *evloop_create(void);
+int  evloop_add_fd(struct evloop *l, int fd, int id);
+int  evloop_add_timer(struct evloop *l, int id);
+int  evloop_set_timer(struct evloop *l, int id, double first, double interval);
+int  evloop_add_wakeup(struct evloop *l, int id);
+int  evloop_wakeup(int fd);
+int  evloop_remove(struct evloop *l, int id);
+int  evloop_wait(struct evloop *l, int *ids, unsigned long long *counts,
+                 int max, int timeout);
+void evloop_destroy(struct evloop *l);
+#endif  /* 0 */
+
+struct evloop *evloop_create(void)
+{
+        struct evloop *l = calloc(1, sizeof(*l));
+
+        if (NULL == l)
+                return NULL;
+        l->epfd = epoll_create1(EPOLL_CLOEXEC);
+        if (l->epfd < 0) {
+                free(l);
+                return NULL;
+        }
+        return l;
+}
+
+static int find(struct evloop *l, int id)
+{
+        int i;
+
+        for (i = 0; i < EVLOOP_MAX; i++)
+                if (l->src[i].type && l->src[i].id == id)
+                        return i;
+        return -1;
+}
+
+/* register 'fd' of 'type' as 'id'; returns 'fd', or -1 on error */
+static int add(struct evloop *l, int type, int fd, int id)
+{
+        struct epoll_event ev;
+        int i;
+
+        if (fd < 0 || find(l, id) >= 0)
+                return -1;
+        for (i = 0; i < EVLOOP_MAX; i++)
+                if (!l->src[i].type)
+                        break;
+        if (EVLOOP_MAX == i)
+                return -1;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.u32 = i;
+        if (epoll_ctl(l->epfd, EPOLL_CTL_ADD, fd, &ev) < 0)
+                return -1;
+        l->src[i].type = type;
+        l->src[i].fd = fd;
+        l->src[i].id = id;
+        return fd;
+}
+
+/* Wait for 'fd' (e.g. 0 for stdin) to be readable, as 'id' */
+int evloop_add_fd(struct evloop *l, int fd, int id)
+{
+        return add(l, SRC_FD, fd, id) < 0 ? -1 : 0;
+}
+
+/* Add a (disarmed) timer as 'id', see evloop_set_timer(). Returns 0 or -1 */
+int evloop_add_timer(struct evloop *l, int id)
+{
+        int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+
+        if (add(l, SRC_TIMER, fd, id) < 0) {
+                if (fd >= 0)
+                        close(fd);
+                return -1;
+        }
+        return 0;
+}
+
+static void to_timespec(double s, struct timespec *ts)
+{
+        ts->tv_sec = (time_t) s;
+        ts->tv_nsec = (long) ((s - ts->tv_sec) * 1e9);
+}
+
+/*
+ * Arm timer 'id' to expire 'first' seconds from now, then every
+ * 'interval' seconds (0 for once); 'first' <= 0 disarms it. Returns 0,
+ * or -1 on error.
+ */
+int evloop_set_timer(struct evloop *l, int id, double first, double interval)
+{
+        struct itimerspec its;
+        int i = find(l, id);
+
+        if (i < 0 || l->src[i].type != SRC_TIMER)
+                return -1;
+        memset(&its, 0, sizeof(its));
+        if (first > 0) {
+                to_timespec(first, &its.it_value);
+                if (0 == its.it_value.tv_sec && 0 == its.it_value.tv_nsec)
+                        its.it_value.tv_nsec = 1;  /* 0 would disarm */
+                if (interval > 0)
+                        to_timespec(interval, &its.it_interval);
+        }
+        return timerfd_settime(l->src[i].fd, 0, &its, NULL);
+}
+
+/*
+ * Add a wakeup as 'id': returns its fd, for evloop_wakeup() from any
+ * thread, or -1 on error.
+ */
+int evloop_add_wakeup(struct evloop *l, int id)
+{
+        int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+        if (add(l, SRC_WAKEUP, fd, id) < 0) {
+                if (fd >= 0)
+                        close(fd);
+                return -1;
+        }
+        return fd;
+}
+
+/* Wake up the loop of wakeup 'fd' (from any thread). Returns 0 or -1 */
+int evloop_wakeup(int fd)
+{
+        uint64_t one = 1;
+
+        return write(fd, &one, sizeof(one)) == sizeof(one) ? 0 : -1;
+}
+
+/* Unregister 'id' (and close its timer or wakeup). Returns 0 or -1 */
+int evloop_remove(struct evloop *l, int id)
+{
+        int i = find(l, id);
+
+        if (i < 0)
+                return -1;
+        epoll_ctl(l->epfd, EPOLL_CTL_DEL, l->src[i].fd, NULL);
+        if (l->src[i].type != SRC_FD)
+                close(l->src[i].fd);
+        l->src[i].type = 0;
+        return 0;
+}
+
+/*
+ * Wait up to 'timeout' msecs (-1: forever, 0: don't wait) for any of the
+ * sources. The ids of up to 'max' ready ones are stored in 'ids', with
+ * 'counts' (if not NULL): the number of expirations of a timer, the
+ * number of wakeups, or 1 for a readable fd. Returns how many are ready
+ * (0 on timeout), or -1 on error.
+ */
+int evloop_wait(struct evloop *l, int *ids, unsigned long long *counts,
+                int max, int timeout)
+{
+        struct epoll_event ev[EVLOOP_MAX];
+        uint64_t n;
+        int r, i, k, out = 0;
+
+        if (max > EVLOOP_MAX)
+                max = EVLOOP_MAX;
+        do {
+                r = epoll_wait(l->epfd, ev, max, timeout);
+        } while (r < 0 && EINTR == errno);
+        if (r < 0)
+                return -1;
+
+        for (i = 0; i < r; i++) {
+                k = ev[i].data.u32;
+                n = 1;
+                if (l->src[k].type != SRC_FD &&
+                    read(l->src[k].fd, &n, sizeof(n)) != sizeof(n))
+                        continue;  /* e.g. a timer re-armed meanwhile */
+                ids[out] = l->src[k].id;
+                if (counts)
+                        counts[out] = n;
+                out++;
+        }
+        return out;
+}
+
+void evloop_destroy(struct evloop *l)
+{
+        int i;
+
+        if (NULL == l)
+                return;
+        for (i = 0; i < EVLOOP_MAX; i++)
+                if (l->src[i].type)
+                        evloop_remove(l, l->src[i].id);
+        close(l->epfd);
+        free(l);
+}
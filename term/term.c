@@ -6,6 +6,10 @@
  *  This code implements a wait_key() method for Lua by FFI. It uses terminal
  *  I/O calls which should work on all Linux platforms.
  *
+ *  To wait for keys along with other events (video frames, timers), add
+ *  stdin to an event loop (evloop.c) and call term_waitkey(0) when it is
+ *  ready.
+ *
  *  PROCESS:
  *
  *  GLOBALS:
@@ -18,6 +22,7 @@
  *
  *    Date             Description                             Author
  *    2017-02-17       initial coding                          jkjung
+ *    2026-10-18       term_msleep(), timeouts over 1 second   agent
  *
  *  TARGET: Linux C
  *
@@ -27,6 +32,8 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <termios.h>
+#include <time.h>
+#include <errno.h>
 #include <sys/select.h>
 
 #if 0
@@ -76,14 +83,19 @@ void term_cleanup()
 
 void term_msleep(int msec)
 {
+        struct timespec t = { .tv_sec = msec / 1000,
+                              .tv_nsec = (msec % 1000) * 1000000L };
 
+        while (nanosleep(&t, &t) < 0 && EINTR == errno)
+                ;
 }
 
 int term_waitkey(int timeout)  /* timeout in msecs */
 {
         int c;
         fd_set fds;
-        struct timeval t = { .tv_sec = 0, .tv_usec = timeout * 1000 };
+        struct timeval t = { .tv_sec = timeout / 1000,
+                             .tv_usec = (timeout % 1000) * 1000 };
 
         FD_ZERO(&fds);
         FD_SET(STDIN_FILENO, &fds);
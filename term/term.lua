@@ -6,6 +6,17 @@
 -- code uses terminal I/O calls to alter the behavior of terminal, and would
 -- restore it before exiting
 --
+-- evloop() creates an event loop (evloop.c), which waits for stdin, other
+-- fds (e.g. vidcap.fd()), timers and wakeups from other threads at once:
+--
+--   local loop = term.evloop()
+--   loop:add_stdin(1)
+--   loop:add_timer(2)
+--   loop:set_timer(2, 0.03)           -- once, in 30 ms
+--   for id, count in loop:wait(-1) do
+--       if id == 1 then local c = term.waitkey(0) ... end
+--   end
+--
 --------------------------------------------------------------------------------
 -- jkjung, 2017-02-17
 --------------------------------------------------------------------------------
@@ -20,6 +31,18 @@ ffi.cdef [[
     void term_cleanup();
     void term_msleep(int msec);
     int  term_waitkey(int timeout);
+
+    struct evloop;
+    struct evloop *evloop_create(void);
+    int  evloop_add_fd(struct evloop *l, int fd, int id);
+    int  evloop_add_timer(struct evloop *l, int id);
+    int  evloop_set_timer(struct evloop *l, int id, double first, double interval);
+    int  evloop_add_wakeup(struct evloop *l, int id);
+    int  evloop_wakeup(int fd);
+    int  evloop_remove(struct evloop *l, int id);
+    int  evloop_wait(struct evloop *l, int *ids, unsigned long long *counts,
+                     int max, int timeout);
+    void evloop_destroy(struct evloop *l);
 ]]
 
 function term.init()    lib.term_init()    end
@@ -33,4 +56,66 @@ function term.waitkey(t)  -- t is timeout in msec
     return c
 end
 
+local EVLOOP_MAX = 64
+local Loop = {}
+Loop.__index = Loop
+
+function term.evloop()
+    local l = lib.evloop_create()
+    assert(l ~= nil, 'term: could not create an event loop')
+    local self = setmetatable({}, Loop)
+    self.l = ffi.gc(l, lib.evloop_destroy)
+    self.ids = ffi.new('int[?]', EVLOOP_MAX)
+    self.counts = ffi.new('unsigned long long[?]', EVLOOP_MAX)
+    return self
+end
+
+-- Sources are registered with an 'id' (a number) of the caller's choice,
+-- which wait() returns when they are ready.
+function Loop:add_fd(fd, id)
+    assert(lib.evloop_add_fd(self.l, fd, id) == 0, 'term: could not add fd ' .. fd)
+end
+
+function Loop:add_stdin(id) self:add_fd(0, id) end
+
+-- a timer, disarmed until set_timer()
+function Loop:add_timer(id)
+    assert(lib.evloop_add_timer(self.l, id) == 0, 'term: could not add a timer')
+end
+
+-- expire in 'first' seconds, then every 'interval' seconds (nil or 0 for
+-- once); 'first' = 0 disarms the timer
+function Loop:set_timer(id, first, interval)
+    assert(lib.evloop_set_timer(self.l, id, first, interval or 0) == 0,
+           'term: could not set timer ' .. id)
+end
+
+-- a wakeup: returns the fd to pass to term.wakeup() (from any thread)
+function Loop:add_wakeup(id)
+    local fd = lib.evloop_add_wakeup(self.l, id)
+    assert(fd >= 0, 'term: could not add a wakeup')
+    return fd
+end
+
+function term.wakeup(fd) return lib.evloop_wakeup(fd) == 0 end
+
+function Loop:remove(id) return lib.evloop_remove(self.l, id) == 0 end
+
+-- Wait up to 'timeout' msecs (-1 for ever) and iterate over the ready
+-- sources: id and count (timer expirations, wakeups, or 1 for an fd).
+function Loop:wait(timeout)
+    local n = lib.evloop_wait(self.l, self.ids, self.counts, EVLOOP_MAX, timeout or -1)
+    local i = 0
+    return function ()
+        if i >= n then return nil end
+        i = i + 1
+        return self.ids[i - 1], tonumber(self.counts[i - 1])
+    end
+end
+
+function Loop:destroy()
+    lib.evloop_destroy(ffi.gc(self.l, nil))
+    self.l = nil
+end
+
 return term
@@ -0,0 +1,71 @@
+--------------------------------------------------------------------------------
+--
+-- Test code of "arena" module
+--
+-- This allocates a replay-memory-sized ByteTensor in a huge page arena and
+-- on the heap, checks the arena tensors, and times random gathers of
+-- frames (as TransitionTable:sample() does) from both. It should be run
+-- from the top directory:
+--
+--   $ th test/test_arena.lua [options]
+--
+--------------------------------------------------------------------------------
+-- agent, 2026-10-18
+--------------------------------------------------------------------------------
+
+require 'torch'
+
+cmd = torch.CmdLine()
+cmd:text()
+cmd:text('options:')
+cmd:option('-entries', 50000, 'number of 84x84 frames in the replay memory')
+cmd:option('-huge', 'thp', 'huge pages: thp, hugetlb or none')
+cmd:option('-lock', false, 'lock the arena in memory')
+cmd:option('-gathers', 200000, 'number of frames gathered at random')
+cmd:text()
+opt = cmd:parse(arg or {})
+
+local arena = require 'arena/arena'
+local ffi = require 'ffi'
+
+local dim = 84 * 84
+local a = arena.create(opt.entries * dim + 2^20, {huge = opt.huge, lock = opt.lock})
+
+-- tensors are aligned, and do not overlap
+local t1 = a:tensor('torch.FloatTensor', 3)
+local t2 = a:tensor('torch.ByteTensor', opt.entries, dim)
+assert(tonumber(ffi.cast('intptr_t', torch.data(t1))) % 64 == 0, 't1 not aligned')
+assert(tonumber(ffi.cast('intptr_t', torch.data(t2))) % 64 == 0, 't2 not aligned')
+t1:fill(1.5)
+t2:fill(7)
+assert(t1:sum() == 4.5 and t2[opt.entries][dim] == 7, 'arena tensors overlap')
+print('arena tensors OK')
+
+local heap = torch.ByteTensor(opt.entries, dim):fill(7)
+
+local function gather(s)
+    local buf = torch.ByteTensor(32, 4 * dim)
+    local idx = torch.LongTensor(opt.gathers):random(1, opt.entries - 4)
+    local tic = torch.tic()
+    for i = 1, opt.gathers do
+        local j = idx[i]
+        buf[(i - 1) % 32 + 1]:copy(s:narrow(1, j, 4))
+    end
+    return torch.toc(tic)
+end
+
+local t_heap, t_arena = gather(heap), gather(t2)
+print(string.format('random gathers of 4 frames: heap %.2f us, arena %.2f us',
+                    t_heap / opt.gathers * 1e6, t_arena / opt.gathers * 1e6))
+
+local s = a:stats()
+print(string.format('arena: %d MB mapped, %d MB used, %d MB resident, ' ..
+                    '%d MB in huge pages%s, %slocked',
+                    s.size / 2^20, s.used / 2^20, s.resident / 2^20,
+                    s.huge / 2^20, s.hugetlb and ' (hugetlb)' or '',
+                    s.locked and '' or 'not '))
+print(string.format('page faults: %d minor, %d major', s.minor_faults,
+                    s.major_faults))
+
+t1, t2 = nil, nil
+a:destroy()
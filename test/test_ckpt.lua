@@ -0,0 +1,69 @@
+--------------------------------------------------------------------------------
+--
+-- Test code of "ckpt" module
+--
+-- This saves checkpoints of the DQN network, loads them back and compares
+-- the parameters, and prints how long save() holds up the caller compared
+-- to torch.save(). It should be run from the top directory:
+--
+--   $ th test/test_ckpt.lua [options]
+--
+--------------------------------------------------------------------------------
+-- agent, 2026-10-18
+--------------------------------------------------------------------------------
+
+require 'torch'
+require 'nn'
+
+torch.setdefaulttensortype('torch.FloatTensor')
+
+cmd = torch.CmdLine()
+cmd:text()
+cmd:text('options:')
+cmd:option('-dir', '/tmp', 'directory for the checkpoint files')
+cmd:text()
+opt = cmd:parse(arg or {})
+
+package.path = package.path .. ';./dqn-deepmind/?.lua'
+require 'initenv'
+local ckpt = require 'ckpt/ckpt'
+
+local net = require('convnet_atari3')({n_actions = 6, verbose = 0,
+                                       hist_len = 4, ncols = 1,
+                                       input_dims = {4, 84, 84},
+                                       gpu = -1}):float()
+local w = net:getParameters()
+w:uniform(-1, 1)
+
+local model_path = paths.concat(opt.dir, 'test_ckpt.model.t7')
+local path = paths.concat(opt.dir, 'test_ckpt.ckpt')
+
+local tic = torch.tic()
+local writer = ckpt.writer(net, w, model_path)
+print(string.format('model saved in %.1f ms (%d parameters)',
+                    torch.toc(tic) * 1000, w:nElement()))
+
+local expected = w:clone()
+tic = torch.tic()
+writer:save(path, 1234)
+print(string.format('save() returned in %.1f ms', torch.toc(tic) * 1000))
+w:add(1)  -- must not affect the snapshot being written
+tic = torch.tic()
+assert(writer:wait())
+print(string.format('written in %.1f ms more', torch.toc(tic) * 1000))
+
+tic = torch.tic()
+torch.save(paths.concat(opt.dir, 'test_ckpt.t7'), {model = net})
+print(string.format('torch.save() took %.1f ms', torch.toc(tic) * 1000))
+
+local exp = ckpt.load(path)
+assert(exp.steps == 1234)
+local w2 = exp.model:getParameters()
+assert(w2:nElement() == expected:nElement() and w2:equal(expected))
+assert(not paths.filep(path .. '.tmp'))
+writer:close()
+
+os.remove(model_path)
+os.remove(path)
+os.remove(paths.concat(opt.dir, 'test_ckpt.t7'))
+print('OK')
@@ -0,0 +1,84 @@
+--------------------------------------------------------------------------------
+--
+-- Test code of "dataset" module
+--
+-- This writes a dataset of random steps, reads it back and compares every
+-- step, checks that a partial record (of a crashed writer) is cut off when
+-- the file is opened again, and prints the read throughput. It should be
+-- run from the top directory:
+--
+--   $ th test/test_dataset.lua [options]
+--
+--------------------------------------------------------------------------------
+-- agent, 2026-10-18
+--------------------------------------------------------------------------------
+
+require 'torch'
+
+cmd = torch.CmdLine()
+cmd:text()
+cmd:text('options:')
+cmd:option('-dir', '/tmp', 'directory for the dataset file')
+cmd:option('-steps', 20000, 'number of steps to write')
+cmd:text()
+opt = cmd:parse(arg or {})
+
+local dataset = require 'dataset/dataset'
+
+local path = paths.concat(opt.dir, 'test_dataset.eps')
+local frame_size, n_actions = 84 * 84, 6
+os.remove(path)
+
+-- write random steps, remembering what was written
+torch.manualSeed(1)
+local frames = torch.ByteTensor(16, frame_size):random(0, 255)
+local actions, rewards, terms = {}, {}, {}
+local w = dataset.writer(path, frame_size, n_actions)
+local tic = torch.tic()
+for i = 1, opt.steps do
+    actions[i] = torch.random(1, n_actions)
+    rewards[i] = torch.uniform(-1, 1)
+    terms[i] = torch.uniform() < 0.01
+    w:add(frames[(i - 1) % 16 + 1], actions[i], rewards[i], terms[i])
+end
+assert(w:close())
+print(string.format('wrote %d steps in %.3f s', opt.steps, torch.toc(tic)))
+
+-- read them back
+local d = assert(dataset.open(path))
+assert(d.count == opt.steps and d.frame_size == frame_size and
+       d.n_actions == n_actions, 'bad dataset header/size')
+local frame = torch.ByteTensor(frame_size)
+for i = 1, d.count do
+    local a, r, t = d:get(i, frame)
+    assert(a == actions[i] and t == terms[i] and
+           math.abs(r - rewards[i]) < 1e-6, 'step ' .. i .. ' differs')
+    assert(frame:equal(frames[(i - 1) % 16 + 1]), 'frame ' .. i .. ' differs')
+end
+d:close()
+print('read back OK')
+
+-- a partial record is cut off when appending again
+local f = assert(io.open(path, 'ab'))
+f:write(string.rep('x', 1000))
+f:close()
+w = dataset.writer(path, frame_size, n_actions)
+w:add(frames[1], 1, 0, true)
+w:close()
+d = assert(dataset.open(path))
+assert(d.count == opt.steps + 1, 'partial record not cut off')
+local a, r, t = d:get(d.count, frame)
+assert(a == 1 and r == 0 and t and frame:equal(frames[1]))
+d:close()
+print('partial record cut off OK')
+
+-- read throughput
+d = assert(dataset.open(path))
+tic = torch.tic()
+for i = 1, d.count do d:get(i, frame) end
+local secs = torch.toc(tic)
+print(string.format('read %d steps in %.3f s: %.0f steps/s, %.1f MB/s',
+                    d.count, secs, d.count / secs,
+                    d.count * frame_size / secs / 2^20))
+d:close()
+os.remove(path)
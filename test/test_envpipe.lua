@@ -0,0 +1,72 @@
+--------------------------------------------------------------------------------
+--
+-- Test code of "envpipe" module
+--
+-- This feeds the engine with the Galaga screens saved in galaga_image.t7
+-- (so no capture hardware is needed), checks the parsed game state and
+-- measures the throughput of the pipeline. It should be run from the top
+-- directory:
+--
+--   $ th test/test_envpipe.lua [options]
+--
+--------------------------------------------------------------------------------
+-- agent, 2026-10-18
+--------------------------------------------------------------------------------
+
+require 'torch'
+require 'image'
+
+cmd = torch.CmdLine()
+cmd:text()
+cmd:text('options:')
+cmd:option('-frames', 1000, 'number of frames to feed for timing')
+cmd:text()
+opt = cmd:parse(arg or {})
+
+local envpipe = require 'envpipe/envpipe'
+local galaga_image = torch.load('galaga/galaga_image.t7')
+
+-- turn a saved 640x360 grayscale screen into a 1280x720 UYVY frame
+local function to_uyvy(t)
+    local gray = torch.DoubleTensor(t:storage(), 1, torch.LongStorage{360, 640})
+    local y = image.scale(gray:byte(), 1280, 720, 'simple')
+    local uyvy = torch.ByteTensor(720, 1280, 2):fill(128)
+    uyvy:select(3, 2):copy(y)
+    return uyvy
+end
+
+local result_screen = to_uyvy(galaga_image.result)  -- game over screen
+local high_screen = to_uyvy(galaga_image.high)      -- "HIGH" only
+
+local engine = envpipe.create(1, galaga_image)
+assert(engine:start() == 0)
+
+engine:feed(result_screen)
+local o = engine:latest(1, 1)
+print(string.format('result screen: score = %d, lives = %d, high = %d, ' ..
+                    'flag = %d, result = %d', o.score, o.lives, o.high,
+                    o.flag, o.result))
+assert(o.score == 20480 and o.result == 1 and o.flag == 1)
+
+engine:set_action()
+engine:feed(high_screen)
+o = engine:latest(2, 1)
+assert(o.seq == 2 and o.action_seq == 1 and o.result == 0 and o.score == 0)
+
+local tic = torch.tic()
+local fed = 0
+while fed < opt.frames do
+    if engine:feed(fed % 2 == 0 and high_screen or result_screen) == 0 then
+        fed = fed + 1
+    end
+end
+-- frames might be dropped inside the pipeline, so just wait for the last one
+while engine:stats().published < engine:stats().captured -
+                                  engine:stats().dropped do end
+local t = torch.toc(tic)
+local s = engine:stats()
+print(string.format('%d frames in %.3f s (%.1f fps), %d dropped',
+                    opt.frames, t, opt.frames / t, s.dropped))
+engine:stop()
+
+print('OK')
@@ -0,0 +1,88 @@
+--------------------------------------------------------------------------------
+--
+-- Test code of the event loop of "term" module
+--
+-- This should be run from the top directory:
+--
+--   $ th test/test_evloop.lua
+--
+-- It measures how late a periodic timer and a one-shot timer (re-armed
+-- at every expiration) are handled, and the latency of wakeups from
+-- another thread, without any hardware.
+--
+--------------------------------------------------------------------------------
+-- agent, 2026-10-18
+--------------------------------------------------------------------------------
+
+require 'torch'
+require 'sys'
+
+term = require 'term/term'
+threads = require 'threads'
+
+PERIODIC, ONESHOT, WAKEUP = 1, 2, 3
+local N = 200
+
+loop = term.evloop()
+loop:add_timer(PERIODIC)
+loop:add_timer(ONESHOT)
+local fd = loop:add_wakeup(WAKEUP)
+
+-- periodic timer at 200 Hz, one-shot timer every 3 ms
+local late = { [PERIODIC] = torch.Tensor(N):zero(), [ONESHOT] = torch.Tensor(N):zero() }
+local n = { [PERIODIC] = 0, [ONESHOT] = 0 }
+local t0 = sys.clock()
+local due = { [PERIODIC] = t0 + 0.005, [ONESHOT] = t0 + 0.003 }
+loop:set_timer(PERIODIC, 0.005, 0.005)
+loop:set_timer(ONESHOT, 0.003)
+while n[PERIODIC] < N or n[ONESHOT] < N do
+    for id, count in loop:wait(1000) do
+        local t = sys.clock()
+        if n[id] < N then
+            n[id] = n[id] + 1
+            late[id][n[id]] = (t - due[id]) * 1e6
+        end
+        if id == PERIODIC then
+            due[id] = due[id] + 0.005 * count
+        else
+            due[id] = t + 0.003
+            loop:set_timer(ONESHOT, 0.003)
+        end
+    end
+end
+loop:set_timer(PERIODIC, 0)
+loop:set_timer(ONESHOT, 0)
+for id, name in pairs({ [PERIODIC] = 'periodic', [ONESHOT] = 'one-shot' }) do
+    local s = late[id]:sort()
+    print(string.format('%-9s timer: %d expirations, late by p50 = %.0f us, p99 = %.0f us',
+                        name, N, s[N / 2], s[math.ceil(N * 0.99)]))
+end
+
+-- wakeups from another thread, which sends the time it woke the loop at
+threads.Threads.serialization('threads.sharedserialize')
+local pool = threads.Threads(1)
+local sent = torch.DoubleTensor(N)
+pool:addjob(function ()
+    require 'sys'
+    local term = require 'term/term'
+    for i = 1, N do
+        sys.sleep(0.002)
+        sent[i] = sys.clock()
+        term.wakeup(fd)
+    end
+end)
+local lat, got = torch.Tensor(N), 0
+while got < N do
+    for id, count in loop:wait(1000) do
+        assert(id == WAKEUP)
+        local t = sys.clock()
+        for i = got + 1, got + count do lat[i] = (t - sent[i]) * 1e6 end
+        got = got + count
+    end
+end
+pool:synchronize()
+pool:terminate()
+lat = lat:sort()
+print(string.format('wakeups: %d, latency p50 = %.0f us, p99 = %.0f us',
+                    N, lat[N / 2], lat[math.ceil(N * 0.99)]))
+loop:destroy()
@@ -20,12 +20,17 @@ cmd:text('options:')
 cmd:option('-games', 100, 'play this many games and calculate average score')
 cmd:option('-actrep', 2, 'how many steps to repeat an action')
 cmd:option('-plot', false, 'plot histogram at the end')
+cmd:option('-gameenv', 'threaded', 'game environment implementation: threaded, native or sim')
 cmd:text()
 opt = cmd:parse(arg or {})
 
-gameenv = require 'gameenv/gameenv-threaded'
+gameenv = require('gameenv/gameenv-' .. opt.gameenv)
 
 gameenv.init('galaga')
+if opt.gameenv == 'sim' then
+    -- the simulated screens should parse just like the real ones
+    galaga = require 'galaga/galaga'
+end
 actions = gameenv.get_actions()
 history = {}
 
@@ -45,6 +50,11 @@ for i = 1, opt.games do
         end
         assert(screen:dim() == 3)
         assert(screen:size(1) == 1 and screen:size(2) == 84 and screen:size(3) == 84)
+        if galaga then
+            local img = gameenv.get_frame()
+            assert(galaga.get_score(img) == gameenv.get_score())
+            assert(galaga.has_HIGH(img) and galaga.has_RESULT(img) == terminal)
+        end
         if reward > 0 then total_reward = total_reward + reward end
         cnt = cnt + 1
     end
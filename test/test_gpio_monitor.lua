@@ -0,0 +1,29 @@
+--------------------------------------------------------------------------------
+--
+-- Test code of the input monitor of "gpio" module
+--
+-- This should be run from the top directory, pressing buttons on the
+-- controller (wired to the pins of gameenv-threaded) for 10 seconds:
+--
+--   $ th test/test_gpio_monitor.lua
+--
+--------------------------------------------------------------------------------
+-- agent, 2026-10-18
+--------------------------------------------------------------------------------
+
+require 'torch'
+
+gpio = require 'gpio/gpio'
+pins = { 36, 37, 184, 219, 38, 63 }  -- Left, Right, -, -, A (Fire), Start
+
+gpio.monitor_start(pins)
+local t0
+for i = 1, 20 do
+    os.execute('sleep 0.5')
+    for _, e in ipairs(gpio.monitor_events()) do
+        t0 = t0 or e.t
+        print(string.format('%8.3f s: buttons 0x%02x', e.t - t0, e.mask))
+    end
+end
+print(string.format('pressed now: 0x%02x', gpio.monitor_mask()))
+gpio.monitor_stop()
@@ -19,7 +19,11 @@
 --      38             A (Fire)        SPACE
 --      63             Start           ENTER
 --      
--- The test script quits when the user hits ESC key.
+-- The test script quits when the user hits '.' key.
+--
+-- A key press raises its pin, and (re)arms a 30 ms timer of the pin which
+-- lowers it, so a held key (auto-repeat) holds the button. Keys and timers
+-- are waited for by 1 event loop (term.evloop()).
 --
 --------------------------------------------------------------------------------
 -- jkjung, 2017-02-16
@@ -45,25 +49,35 @@ key_to_gpio = {
 }
 
 for i = 1, #pins do gpio.export(pins[i]) end
-os.execute('sleep 1')  -- sleep 1 sec to make sure udev rules take effect
+term.msleep(1000)  -- sleep 1 sec to make sure udev rules take effect
 for i = 1, #pins do gpio.set_output(pins[i]) end
 for i = 1, #pins do gpio.set_low(pins[i]) end
 
-while true do
-    local c = term.waitkey(30)
-    if c then
-        if c == string.byte('.') then break end
-        local p = key_to_gpio[c]
-        if p then
-            gpio.set_high(p)
-            term.msleep(30)
-            print('key ' .. c .. ' ->', 'gpio'..p)
+-- the event ids: KEY for stdin, and the pin number for the timer of a pin
+KEY = 1
+loop = term.evloop()
+loop:add_stdin(KEY)
+for i = 1, #pins do loop:add_timer(pins[i]) end
+
+local done = false
+while not done do
+    for id in loop:wait(-1) do
+        if id == KEY then
+            local c = term.waitkey(0)
+            if c == string.byte('.') then done = true end
+            local p = c and key_to_gpio[c]
+            if p then
+                gpio.set_high(p)
+                loop:set_timer(p, 0.03)  -- release in 30 ms
+                print('key ' .. c .. ' ->', 'gpio'..p)
+            end
+        else
+            gpio.set_low(id)  -- pulse of pin 'id' is over
         end
-    else
-        for i = 1, #pins do gpio.set_low(pins[i]) end
     end
 end
 
+loop:destroy()
 term.cleanup()
 
 for i = 1, #pins do gpio.set_low(pins[i]) end
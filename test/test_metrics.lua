@@ -0,0 +1,64 @@
+--------------------------------------------------------------------------------
+--
+-- Test code of "metrics" module
+--
+-- This records known latencies, checks the quantiles and the dumped files,
+-- and measures the cost of recording. It should be run from the top
+-- directory:
+--
+--   $ th test/test_metrics.lua [options]
+--
+--------------------------------------------------------------------------------
+-- agent, 2026-10-18
+--------------------------------------------------------------------------------
+
+require 'torch'
+
+cmd = torch.CmdLine()
+cmd:text()
+cmd:text('options:')
+cmd:option('-iters', 1000000, 'number of values to record for timing')
+cmd:option('-dir', '/tmp', 'directory for the dumped files')
+cmd:text()
+opt = cmd:parse(arg or {})
+
+local metrics = require 'metrics/metrics'
+
+local h = metrics.histogram('test_latency')
+local c = metrics.counter('test_events')
+assert(h >= 0 and c >= 0)
+assert(metrics.histogram('test_latency') == h)  -- looked up by name
+assert(metrics.counter('test_latency') == -1)    -- not a counter
+
+-- 1 ~ 1000 us, uniformly
+for i = 1, 1000 do metrics.record(h, i * 1e-6) end
+metrics.add(c, 3)
+assert(metrics.count(h) == 1000 and metrics.count(c) == 3)
+local p50, p99 = metrics.quantile(h, 0.5), metrics.quantile(h, 0.99)
+print(string.format('p50 = %.1f us, p99 = %.1f us', p50 * 1e6, p99 * 1e6))
+-- histogram buckets are within 1/16
+assert(math.abs(p50 - 500e-6) < 500e-6 / 16)
+assert(math.abs(p99 - 990e-6) < 990e-6 / 16)
+
+local prom = paths.concat(opt.dir, 'test_metrics.prom')
+local csv = paths.concat(opt.dir, 'test_metrics.csv')
+os.remove(csv)
+assert(metrics.dump(prom) and metrics.dump(csv, 'csv'))
+local text = io.open(prom):read('*a')
+assert(text:find('dqn_test_latency_seconds_count 1000', 1, true))
+assert(text:find('dqn_test_events_total 3', 1, true))
+local lines = 0
+for _ in io.lines(csv) do lines = lines + 1 end
+assert(lines >= 3)  -- header, and a row per metric
+os.remove(prom)
+os.remove(csv)
+
+local tic = torch.tic()
+for i = 1, opt.iters do
+    local t = metrics.now()
+    metrics.record(h, metrics.now() - t)
+end
+print(string.format('now() + record(): %.1f ns per value',
+                    torch.toc(tic) / opt.iters * 1e9))
+
+print('OK')
@@ -0,0 +1,185 @@
+--------------------------------------------------------------------------------
+--
+-- Test code of "nncpu" module
+--
+-- This checks the nncpu kernels against the equivalent Torch code, and
+-- prints how long each of them takes. It should be run from the top
+-- directory:
+--
+--   $ th test/test_nncpu.lua [options]
+--
+--------------------------------------------------------------------------------
+-- agent, 2026-10-18
+--------------------------------------------------------------------------------
+
+require 'torch'
+require 'nn'
+
+torch.setdefaulttensortype('torch.FloatTensor')
+
+cmd = torch.CmdLine()
+cmd:text()
+cmd:text('options:')
+cmd:option('-threads', 0, 'number of nncpu threads (0 means number of CPUs)')
+cmd:option('-iters', 100, 'number of iterations for timing')
+cmd:text()
+opt = cmd:parse(arg or {})
+
+package.path = package.path .. ';./dqn-deepmind/?.lua'
+require 'initenv'
+local nncpu = require 'nncpu/nncpu'
+nncpu.set_num_threads(opt.threads)
+print('nncpu threads: ' .. nncpu.get_num_threads())
+
+torch.manualSeed(1)
+
+local function timeit(f)
+    local tic = torch.tic()
+    for i = 1, opt.iters do f() end
+    return torch.toc(tic) / opt.iters * 1000
+end
+
+-- rmsprop: compare with the Torch code from NeuralQLearner
+do
+    local n = 1700000
+    local w, dw = torch.randn(n), torch.randn(n):mul(0.01)
+    local g, g2 = torch.randn(n):mul(0.01), torch.rand(n):mul(0.01)
+    local lr, wc = 0.00025, 0.001
+
+    local w1, dw1, g1, g21 = w:clone(), dw:clone(), g:clone(), g2:clone()
+    local tmp = torch.Tensor(n)
+    dw1:add(-wc, w1)
+    g1:mul(0.95):add(0.05, dw1)
+    tmp:cmul(dw1, dw1)
+    g21:mul(0.95):add(0.05, tmp)
+    tmp:cmul(g1, g1):mul(-1):add(g21):add(0.01):sqrt()
+    w1:addcdiv(lr, dw1, tmp)
+
+    nncpu.rmsprop(w, dw, g, g2, lr, wc, 0.95, 0.01)
+    local err = math.max((w - w1):abs():max(), (g - g1):abs():max(),
+                         (g2 - g21):abs():max(), (dw - dw1):abs():max())
+    print(string.format('rmsprop: max abs error = %g', err))
+    assert(err < 1e-5)
+    print(string.format('rmsprop: %.3f ms', timeit(function ()
+        nncpu.rmsprop(w, dw, g, g2, lr, 0, 0.95, 0.01) end)))
+end
+
+-- qnet: compare with nn forward of the convnet_atari3 network, for a
+-- state in gray levels (as bytes, and as floats), and with the float
+-- reference: the same network with the nn.Reshape it had in front before
+-- nn.ByteInput, fed with x:float():div(255)
+do
+    local input_dims = {4, 84, 84}
+    local net = require('convnet_atari3')({input_dims = input_dims,
+        hist_len = 4, ncols = 1, n_actions = 6, gpu = -1, verbose = 0})
+    net:float()
+    local x8 = torch.ByteTensor(1, 4, 84, 84):random(0, 255)
+    local x = x8:float()
+    local ref = net:forward(x):clone():squeeze()
+    local err = (net:forward(x8):squeeze() - ref):abs():max()
+    print(string.format('nn forward of bytes: max abs error = %g', err))
+    assert(err < 1e-5)
+    local fnet = net:clone()
+    fnet.modules[1] = nn.Reshape(unpack(input_dims)):float()
+    local fref = fnet:forward(x8:float():div(255)):clone():squeeze()
+    err = (ref - fref):abs():max()
+    print(string.format('nn forward of bytes vs floats/255: max abs error = %g', err))
+    assert(err < 1e-5)
+
+    for _, p in ipairs({'fp32', 'fp16', 'int8'}) do
+        local qnet = nncpu.qnet(net, input_dims, p)
+        local q = qnet:forward(x)
+        local err = math.max((q - ref):abs():max(),
+                             (qnet:forward(x8) - ref):abs():max(),
+                             (qnet:forward(x8) - fref):abs():max())
+        print(string.format('qnet %s: max abs error = %g, %.3f ms (bytes %.3f ms)',
+                            p, err, timeit(function () qnet:forward(x) end),
+                            timeit(function () qnet:forward(x8) end)))
+        assert(err < (p == 'fp32' and 1e-4 or 1e-2))
+    end
+    print(string.format('nn forward: %.3f ms',
+                        timeit(function () net:forward(x) end)))
+end
+
+-- nn.CPUSpatialConvolution: compare forward/backward with nn, for the
+-- convolution layers of convnet_atari3 on a minibatch of 32
+do
+    local n = 32
+    for _, l in ipairs({{4, 32, 8, 4, 1, 84}, {32, 64, 4, 2, 0, 20},
+                        {64, 64, 3, 1, 0, 9}}) do
+        local ref = nn.SpatialConvolution(l[1], l[2], l[3], l[3], l[4], l[4],
+                                          l[5], l[5]):float()
+        local conv = ref:clone()
+        nncpu.convert(conv, 'nncpu')
+        local x = torch.randn(n, l[1], l[6], l[6])
+        local y = ref:forward(x)
+        local gy = torch.randn(y:size())
+        local gx = ref:backward(x, gy)
+        ref:zeroGradParameters()
+        conv:zeroGradParameters()
+        ref:backward(x, gy, 0.5)
+        conv:forward(x)
+        conv:backward(x, gy, 0.5)
+        local err = math.max((conv.output - y):abs():max(),
+                             (conv.gradInput - gx):abs():max(),
+                             (conv.gradWeight - ref.gradWeight):abs():max(),
+                             (conv.gradBias - ref.gradBias):abs():max())
+        -- gradients are accumulated, as the RMSProp update expects: a 2nd
+        -- backward without zeroing gives twice the reference
+        conv:forward(x)
+        conv:backward(x, gy, 0.5)
+        local acc = math.max((conv.gradWeight - ref.gradWeight * 2):abs():max(),
+                             (conv.gradBias - ref.gradBias * 2):abs():max())
+        print(string.format('conv %dx%d %d->%d: max abs error = %g ' ..
+                            '(accumulated %g), %.3f ms (nn %.3f ms)',
+                            l[3], l[3], l[1], l[2], err, acc,
+                            timeit(function () conv:forward(x)
+                                               conv:backward(x, gy) end),
+                            timeit(function () ref:forward(x)
+                                               ref:backward(x, gy) end)))
+        assert(err < 1e-3 and acc < 2e-3)
+    end
+end
+
+-- nn.ByteInput fused with the 1st convolution: byte input converted in
+-- im2col, with the 1/255 scale folded into the GEMM; compared with nn
+-- (unfused), and with a plain convolution of x:float():div(255)
+do
+    local n = 32
+    local ref = nn.Sequential()
+    ref:add(nn.ByteInput({4, 84, 84}, 1/255))
+    ref:add(nn.SpatialConvolution(4, 32, 8, 8, 4, 4, 1, 1))
+    ref:float()
+    local conv = ref:clone()
+    nncpu.convert(conv, 'nncpu')
+    assert(conv.modules[1].fused and conv.modules[2].input_scale == 1/255)
+    local x8 = torch.ByteTensor(n, 4 * 84 * 84):random(0, 255)
+    local y = ref:forward(x8)
+    local gy = torch.randn(y:size())
+    ref:zeroGradParameters()
+    conv:zeroGradParameters()
+    ref:backward(x8, gy, 0.5)
+    conv:forward(x8)
+    conv:backward(x8, gy, 0.5)
+    local c, r = conv.modules[2], ref.modules[2]
+    local fconv = r:clone()
+    fconv:zeroGradParameters()
+    local x = x8:float():div(255):view(n, 4, 84, 84)
+    local fy = fconv:forward(x)
+    fconv:backward(x, gy, 0.5)
+    local err = math.max((conv.output - y):abs():max(),
+                         (c.gradWeight - r.gradWeight):abs():max(),
+                         (c.gradBias - r.gradBias):abs():max(),
+                         (conv.output - fy):abs():max(),
+                         (c.gradWeight - fconv.gradWeight):abs():max(),
+                         (c.gradBias - fconv.gradBias):abs():max())
+    print(string.format('conv of bytes: max abs error = %g, %.3f ms ' ..
+                        '(floats %.3f ms)', err,
+                        timeit(function () conv:forward(x8)
+                                           conv:backward(x8, gy) end),
+                        timeit(function () ref:forward(x8)
+                                           ref:backward(x8, gy) end)))
+    assert(err < 1e-3)
+end
+
+print('OK')
@@ -0,0 +1,39 @@
+--------------------------------------------------------------------------------
+--
+-- Test code of "shmpub" module
+--
+-- This should be run from the top directory, with a viewer attached from
+-- another terminal: (hit Ctrl-C to end it)
+--
+--   $ th test/test_shmpub.lua
+--   $ shmpub/shmview -o /tmp/frame.pgm
+--
+-- It publishes a moving bar at 30 fps, and fake telemetry.
+--
+--------------------------------------------------------------------------------
+-- agent, 2026-10-18
+--------------------------------------------------------------------------------
+
+require 'torch'
+require 'sys'
+
+shmpub = require 'shmpub/shmpub'
+
+img = torch.ByteTensor(1, 360, 640)
+q = torch.FloatTensor(6)
+assert(shmpub.init('test_shmpub') == 0, 'shmpub.init() failed!')
+
+local n = 0
+while true do
+    n = n + 1
+    local x = n % 640 + 1
+    img:fill(32)
+    img[{ {}, {}, {x, math.min(x + 15, 640)} }]:fill(255)
+    shmpub.display(img)
+    if n % 2 == 0 then
+        q:uniform()
+        shmpub.telemetry{step = n / 2, game = 1, score = 10 * n,
+                         reward = 0, action = n % 6 + 1, epsilon = 0.1, q = q}
+    end
+    sys.sleep(1 / 30)
+end
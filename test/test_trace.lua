@@ -0,0 +1,76 @@
+--------------------------------------------------------------------------------
+--
+-- Test code of "trace" module
+--
+-- This records spans, instants and a flow from the main thread and a
+-- worker thread, exports them and checks the Chrome trace_event JSON. It
+-- should be run from the top directory:
+--
+--   $ th test/test_trace.lua [options]
+--
+-- The exported file could then be opened in chrome://tracing.
+--
+--------------------------------------------------------------------------------
+-- agent, 2026-10-18
+--------------------------------------------------------------------------------
+
+require 'torch'
+
+cmd = torch.CmdLine()
+cmd:text()
+cmd:text('options:')
+cmd:option('-out', '/tmp/test_trace.json', 'file to export the trace to')
+cmd:option('-iters', 1000000, 'number of spans to record for timing')
+cmd:text()
+opt = cmd:parse(arg or {})
+
+local threads = require 'threads'
+local trace = require 'trace/trace'
+
+local T_STEP, T_ACTION = trace.name('step'), trace.name('action')
+assert(not pcall(trace.name, 'bad "name"'))
+
+-- nothing is recorded until tracing is enabled
+trace.span(T_STEP, trace.now())
+trace.enable(true)
+assert(trace.enabled())
+trace.thread_name('test main')
+
+-- flow 1 starts in a 'step' span of this thread, and ends in a span of
+-- the worker thread
+local t = trace.now()
+trace.instant(T_ACTION, 1)
+trace.flow(T_ACTION, 'start', 1)
+trace.span(T_STEP, t, nil, 1)
+
+local worker = threads.Threads(1)
+worker:addjob(function ()
+    local trace = require 'trace/trace'
+    trace.thread_name('test worker')
+    local id = trace.name('parse')
+    local t = trace.now()
+    trace.flow(trace.name('action'), 'end', 1)
+    trace.span(id, t, nil, 42)
+end)
+worker:synchronize()
+worker:terminate()
+
+assert(trace.export(opt.out))
+local json = io.open(opt.out):read('*a')
+assert(json:find('"name":"test main"', 1, true))
+assert(json:find('"name":"test worker"', 1, true))
+assert(json:find('"name":"parse","cat":"dqn","ph":"X"', 1, true))
+assert(json:find('"ph":"s"', 1, true) and json:find('"ph":"f"', 1, true))
+local _, spans = json:gsub('"ph":"X"', '')
+assert(spans == 2, 'expected 2 spans, got ' .. spans)
+print('exported to ' .. opt.out)
+
+local tic = torch.tic()
+for i = 1, opt.iters do
+    trace.span(T_STEP, trace.now(), nil, i)
+end
+print(string.format('now() + span(): %.1f ns per event',
+                    torch.toc(tic) / opt.iters * 1e9))
+trace.enable(false)
+
+print('OK')
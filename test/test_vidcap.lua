@@ -19,6 +19,8 @@ cmd:text('options:')
 cmd:option('-save', false, 'whether to save images in the image folder')
 cmd:option('-index', 0, 'starting index for the 1st saved image')
 cmd:option('-interval', 5, 'frame count between saved images')
+cmd:option('-pool', 'drop', 'pooling of frame pairs: drop, max or avg')
+cmd:option('-roi', false, 'capture only the playfield (and show it at 1/4 too)')
 cmd:text()
 opt = cmd:parse(arg or {})
 
@@ -30,12 +32,25 @@ idx = opt.index              -- saved image index
 
 ret = vidcap.init()
 assert(ret == 0, 'vidcap.init() failed!')
+vidcap.set_pool(opt.pool)
+if opt.roi then
+    -- raw_loc of galaga_image.t7, at its place and scaled down to 84x84
+    local loc = { h1 = 13, h2 = 348, w1 = 110, w2 = 445 }
+    img:zero()
+    vidcap.set_roi(1, loc, 1, img[{ {}, {loc.h1, loc.h2}, {loc.w1, loc.w2} }])
+    small = vidcap.set_roi(2, loc, 4)
+end
 
 os.execute('mkdir -p image')
 vidcap.flush()
 while true do
     --vidcap.vidcap_get(torch.data(img))
-    vidcap.get(img)
+    if opt.roi then
+        vidcap.get_rois()
+        win2 = image.display({image = small, win = win2, zoom = 2})
+    else
+        vidcap.get(img)
+    end
     win = image.display({image = img, win = win})
     if (opt.save) then
         cnt = cnt + 1
@@ -0,0 +1,368 @@
+/*
+ *  trace.c
+ *
+ *  DESCRIPTION:
+ *
+ *  Event tracer for following single steps of the training loop across
+ *  threads: from take_action() setting the GPIO pins, to the first frame
+ *  captured after that, to the step() which hands the resulting
+ *  observation to perceive(). It is used by the other native libraries
+ *  (vidcap, envpipe, gpio) directly and by Lua code through FFI
+ *  (trace/trace.lua), and exports Chrome trace_event JSON, which could be
+ *  opened in chrome://tracing or https://ui.perfetto.dev.
+ *
+ *  Every thread records its events into a ring buffer of its own (the
+ *  latest TRACE_RING events are kept), so recording takes no lock and
+ *  threads never contend: a timestamp and a few relaxed atomic stores.
+ *  Tracing is off until trace_enable(1), and then costs ~50 ns per event.
+ *
+ *  Events are spans (a name, a start and an end time), instants, and
+ *  flows, which link the spans of one step on different threads (a flow
+ *  is identified by a number, e.g. envpipe's action_seq, and binds to the
+ *  span enclosing it). Spans and instants carry 1 integer argument
+ *  ("arg" in the trace; -1 for none).
+ *
+ *  trace_export() could be called at any time, from any thread: it copies
+ *  every ring (dropping the events overwritten while copying) and writes
+ *  them out, while recording goes on.
+ *
+ *  PROCESS:
+ *
+ *  int    trace_name(const char *name);
+ *  void   trace_enable(int on);
+ *  int    trace_enabled(void);
+ *  double trace_now(void);
+ *  void   trace_thread_name(const char *name);
+ *  void   trace_span(int name, double t0, double t1, long long arg);
+ *  void   trace_instant(int name, long long arg);
+ *  void   trace_flow(int name, int phase, unsigned long long id);
+ *  int    trace_export(const char *path);
+ *
+ *  GLOBALS:
+ *
+ *  The registry of event names, and the ring buffers of all threads.
+ *
+ *  REFERENCE:
+ *
+ *  1. Trace Event Format, https://docs.google.com/document/d/
+ *     1CvAClvFfyA5R-PhYUmn5OOQtYMH4h6I0nSsKchNAySU
+ *
+ *  LIMITATIONS:
+ *
+ *  1. At most TRACE_THREADS threads record events over the life of the
+ *     process; the ring of a thread is not freed when it exits, and
+ *     threads beyond the limit record nothing.
+ *  2. Names may only contain letters, digits and "_ .:-" (they are not
+ *     escaped in the JSON output).
+ *  3. Times are CLOCK_MONOTONIC, the same clock as metrics_now().
+ *
+ *  REVISION HISTORY:
+ *
+ *    Date             Description                                   Author
+ *    2026-10-18       initial coding                                agent
+ *
+ *  TARGET: Linux C
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include "trace.h"
+
+#define PATH_LEN 1024
+
+struct trace_event {
+        unsigned long long  ts;         /* ns */
+        unsigned long long  dur;        /* ns, for spans; flow id for flows */
+        long long           arg;
+        int                 name;
+        int                 phase;      /* 'X', 'i', 's', 't' or 'f' */
+};
+
+struct ring {
+        int                 tid;
+        char                name[TRACE_NAME_LEN];       /* of the thread */
+        unsigned long long  claimed;    /* slots claimed by the writer */
+        unsigned long long  head;       /* events completely written */
+        struct trace_event  ev[TRACE_RING];
+};
+
+static char            names[TRACE_NAMES][TRACE_NAME_LEN];
+static int             nnames;          /* published with release semantics */
+static struct ring    *rings[TRACE_THREADS];
+static int             nrings;          /* published with release semantics */
+static pthread_mutex_t reg_lock = PTHREAD_MUTEX_INITIALIZER;
+static int             enabled;
+
+static __thread struct ring *my_ring;
+static __thread int          no_ring;   /* TRACE_THREADS reached */
+
+static unsigned long long now_ns(void)
+{
+        struct timespec ts;
+
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static unsigned long long to_ns(double t)
+{
+        return (t > 0) ? (unsigned long long) (t * 1e9 + 0.5) : 0;
+}
+
+static int valid_name(const char *s)
+{
+        if (*s == '\0' || strlen(s) >= TRACE_NAME_LEN)
+                return 0;
+        for (; *s; s++)
+                if (NULL == strchr("abcdefghijklmnopqrstuvwxyz"
+                                   "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+                                   "0123456789_ .:-", *s))
+                        return 0;
+        return 1;
+}
+
+/* the ring of the calling thread, created on first use */
+static struct ring *get_ring(void)
+{
+        struct ring *r;
+
+        if (my_ring || no_ring)
+                return my_ring;
+        r = calloc(1, sizeof(*r));
+        if (NULL == r) {
+                no_ring = 1;
+                return NULL;
+        }
+        r->tid = (int) syscall(SYS_gettid);
+        snprintf(r->name, sizeof(r->name), "thread %d", r->tid);
+        pthread_mutex_lock(&reg_lock);
+        if (nrings < TRACE_THREADS) {
+                rings[nrings] = r;
+                __atomic_store_n(&nrings, nrings + 1, __ATOMIC_RELEASE);
+                my_ring = r;
+        } else {
+                free(r);
+                no_ring = 1;
+        }
+        pthread_mutex_unlock(&reg_lock);
+        return my_ring;
+}
+
+/*
+ * The slot is claimed before it is overwritten, so that trace_export()
+ * could tell which of the events it copied might have been torn.
+ */
+static void record(int phase, int name, unsigned long long ts,
+                   unsigned long long dur, long long arg)
+{
+        struct ring *r;
+        struct trace_event *e;
+        unsigned long long h;
+
+        if (!__atomic_load_n(&enabled, __ATOMIC_RELAXED) ||
+            name < 0 || name >= __atomic_load_n(&nnames, __ATOMIC_ACQUIRE))
+                return;
+        if ((r = get_ring()) == NULL)
+                return;
+        h = r->head;
+        __atomic_store_n(&r->claimed, h + 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        e = &r->ev[h % TRACE_RING];
+        __atomic_store_n(&e->ts, ts, __ATOMIC_RELAXED);
+        __atomic_store_n(&e->dur, dur, __ATOMIC_RELAXED);
+        __atomic_store_n(&e->arg, arg, __ATOMIC_RELAXED);
+        __atomic_store_n(&e->name, name, __ATOMIC_RELAXED);
+        __atomic_store_n(&e->phase, phase, __ATOMIC_RELAXED);
+        __atomic_store_n(&r->head, h + 1, __ATOMIC_RELEASE);
+}
+
+/* copy the intact events of ring 'r' to 'out', returns their number */
+static int snapshot(struct ring *r, struct trace_event *out)
+{
+        unsigned long long h, c, i, first;
+        int n = 0;
+
+        h = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+        first = (h > TRACE_RING) ? h - TRACE_RING : 0;
+        for (i = first; i < h; i++) {
+                struct trace_event *e = &r->ev[i % TRACE_RING];
+
+                out[n].ts = __atomic_load_n(&e->ts, __ATOMIC_RELAXED);
+                out[n].dur = __atomic_load_n(&e->dur, __ATOMIC_RELAXED);
+                out[n].arg = __atomic_load_n(&e->arg, __ATOMIC_RELAXED);
+                out[n].name = __atomic_load_n(&e->name, __ATOMIC_RELAXED);
+                out[n].phase = __atomic_load_n(&e->phase, __ATOMIC_RELAXED);
+                n++;
+        }
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        /* slots claimed since then may have been overwritten */
+        c = __atomic_load_n(&r->claimed, __ATOMIC_RELAXED);
+        if (c > TRACE_RING && c - TRACE_RING > first) {
+                unsigned long long torn = c - TRACE_RING - first;
+
+                if (torn >= (unsigned long long) n)
+                        return 0;
+                memmove(out, out + torn, (n - torn) * sizeof(*out));
+                n -= torn;
+        }
+        return n;
+}
+
+static void write_event(FILE *fp, int pid, int tid, const struct trace_event *e)
+{
+        const char *name = names[e->name];
+
+        fprintf(fp, ",\n{\"name\":\"%s\",\"cat\":\"dqn\",\"ph\":\"%c\","
+                    "\"ts\":%.3f,\"pid\":%d,\"tid\":%d",
+                name, e->phase, e->ts * 1e-3, pid, tid);
+        switch (e->phase) {
+        case 'X':
+                fprintf(fp, ",\"dur\":%.3f,\"args\":{\"arg\":%lld}}",
+                        e->dur * 1e-3, e->arg);
+                break;
+        case 'i':
+                fprintf(fp, ",\"s\":\"t\",\"args\":{\"arg\":%lld}}", e->arg);
+                break;
+        default:        /* flows bind to the enclosing span */
+                fprintf(fp, ",\"id\":%llu,\"bp\":\"e\"}", e->dur);
+                break;
+        }
+}
+
+/*
+ * API
+ */
+
+/* Get (or register) the id of event name 'name', -1 if it is not valid
+ * or there are too many names. */
+int trace_name(const char *name)
+{
+        int i;
+
+        if (!valid_name(name))
+                return -1;
+        pthread_mutex_lock(&reg_lock);
+        for (i = 0; i < nnames; i++) {
+                if (strcmp(names[i], name) == 0) {
+                        pthread_mutex_unlock(&reg_lock);
+                        return i;
+                }
+        }
+        if (nnames >= TRACE_NAMES) {
+                pthread_mutex_unlock(&reg_lock);
+                return -1;
+        }
+        strcpy(names[nnames], name);
+        __atomic_store_n(&nnames, nnames + 1, __ATOMIC_RELEASE);
+        pthread_mutex_unlock(&reg_lock);
+        return i;
+}
+
+void trace_enable(int on)
+{
+        __atomic_store_n(&enabled, on != 0, __ATOMIC_RELAXED);
+}
+
+int trace_enabled(void)
+{
+        return __atomic_load_n(&enabled, __ATOMIC_RELAXED);
+}
+
+/* Monotonic time in seconds. */
+double trace_now(void)
+{
+        return now_ns() * 1e-9;
+}
+
+/* Name the calling thread in the trace (e.g. "envpipe capture"). */
+void trace_thread_name(const char *name)
+{
+        struct ring *r;
+
+        if (!valid_name(name) || (r = get_ring()) == NULL)
+                return;
+        pthread_mutex_lock(&reg_lock);
+        strcpy(r->name, name);
+        pthread_mutex_unlock(&reg_lock);
+}
+
+/* A span from 't0' to 't1' (seconds, as from trace_now()). */
+void trace_span(int name, double t0, double t1, long long arg)
+{
+        unsigned long long ts = to_ns(t0), te = to_ns(t1);
+
+        record('X', name, ts, (te > ts) ? te - ts : 0, arg);
+}
+
+void trace_instant(int name, long long arg)
+{
+        record('i', name, now_ns(), 0, arg);
+}
+
+/* A point of flow 'id', at this time; it has to be inside a span of the
+ * calling thread, which is recorded afterwards. */
+void trace_flow(int name, int phase, unsigned long long id)
+{
+        static const char ph[] = { 's', 't', 'f' };
+
+        if (phase < TRACE_FLOW_START || phase > TRACE_FLOW_END)
+                return;
+        record(ph[phase], name, now_ns(), id, 0);
+}
+
+/* Write the events in all rings to 'path' as Chrome trace_event JSON
+ * (replacing the file atomically). Returns 0 on success, -1 on error. */
+int trace_export(const char *path)
+{
+        char tmp[PATH_LEN + 8];
+        struct trace_event *buf;
+        char tname[TRACE_NAME_LEN];
+        FILE *fp;
+        int pid = (int) getpid();
+        int i, j, n, nr, ok;
+
+        if (strlen(path) >= PATH_LEN)
+                return -1;
+        buf = malloc(TRACE_RING * sizeof(*buf));
+        if (NULL == buf)
+                return -1;
+        snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+        fp = fopen(tmp, "w");
+        if (NULL == fp) {
+                free(buf);
+                return -1;
+        }
+        fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+                    "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,"
+                    "\"args\":{\"name\":\"dqn\"}}", pid);
+        nr = __atomic_load_n(&nrings, __ATOMIC_ACQUIRE);
+        for (i = 0; i < nr; i++) {
+                struct ring *r = rings[i];
+
+                pthread_mutex_lock(&reg_lock);
+                strcpy(tname, r->name);
+                pthread_mutex_unlock(&reg_lock);
+                fprintf(fp, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,"
+                            "\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                        pid, r->tid, tname);
+                n = snapshot(r, buf);
+                for (j = 0; j < n; j++)
+                        write_event(fp, pid, r->tid, &buf[j]);
+        }
+        fprintf(fp, "\n]}\n");
+        free(buf);
+        ok = !ferror(fp);
+        if (fclose(fp) != 0)
+                ok = 0;
+        if (!ok || rename(tmp, path) != 0) {
+                unlink(tmp);
+                return -1;
+        }
+        return 0;
+}
@@ -0,0 +1,38 @@
+/*
+ * trace.h
+ */
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TRACE_NAMES         128     /* distinct event names */
+#define TRACE_NAME_LEN      32
+#define TRACE_THREADS       64      /* threads which could record events */
+#define TRACE_RING          8192    /* latest events kept per thread */
+
+/* flow phases, see trace_flow() */
+enum {
+        TRACE_FLOW_START = 0,
+        TRACE_FLOW_STEP = 1,
+        TRACE_FLOW_END = 2
+};
+
+extern int    trace_name(const char *name);
+extern void   trace_enable(int on);
+extern int    trace_enabled(void);
+extern double trace_now(void);
+extern void   trace_thread_name(const char *name);
+extern void   trace_span(int name, double t0, double t1, long long arg);
+extern void   trace_instant(int name, long long arg);
+extern void   trace_flow(int name, int phase, unsigned long long id);
+extern int    trace_export(const char *path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TRACE_H_ */
@@ -0,0 +1,81 @@
+--------------------------------------------------------------------------------
+--
+-- "trace" module
+--
+-- This module exposes the event tracer (libtrace.so) through FFI. Events
+-- of all threads (the native pipeline threads, the actor and the learner)
+-- go into one trace, which could be exported at any time as Chrome
+-- trace_event JSON; see trace.c for details.
+--
+-- Usage:
+--
+--   local trace = require 'trace/trace'
+--   local T_PERCEIVE = trace.name('perceive')
+--   trace.enable(true)
+--   local t = trace.now()
+--   ...
+--   trace.span(T_PERCEIVE, t)
+--   trace.export('dqn.trace.json')   -- open in chrome://tracing
+--
+--------------------------------------------------------------------------------
+-- agent, 2026-10-18
+--------------------------------------------------------------------------------
+
+require 'torch'
+
+local ffi = require 'ffi'
+local trace = {}
+local lib = ffi.load(paths.cwd() .. '/trace/libtrace.so')
+
+-- Function prototype definition
+ffi.cdef [[
+    int    trace_name(const char *name);
+    void   trace_enable(int on);
+    int    trace_enabled(void);
+    double trace_now(void);
+    void   trace_thread_name(const char *name);
+    void   trace_span(int name, double t0, double t1, long long arg);
+    void   trace_instant(int name, long long arg);
+    void   trace_flow(int name, int phase, unsigned long long id);
+    int    trace_export(const char *path);
+]]
+
+local phases = { start = 0, step = 1, ['end'] = 2 }
+
+-- Get the id of event name 'name' (letters, digits and '_ .:-' only).
+function trace.name(name)
+    local id = lib.trace_name(name)
+    assert(id >= 0, 'bad trace event name: ' .. name)
+    return id
+end
+
+-- Tracing is off until enable(true) (for all threads).
+function trace.enable(on) lib.trace_enable(on and 1 or 0) end
+function trace.enabled() return lib.trace_enabled() ~= 0 end
+
+-- Monotonic time in seconds (the same clock as metrics.now()).
+function trace.now() return lib.trace_now() end
+
+-- Name the calling thread in the trace.
+function trace.thread_name(name) lib.trace_thread_name(name) end
+
+-- Record a span which started at 't0' (and ends at 't1', default now),
+-- with an optional integer 'arg'.
+function trace.span(id, t0, t1, arg)
+    lib.trace_span(id, t0, t1 or lib.trace_now(), arg or -1)
+end
+
+function trace.instant(id, arg) lib.trace_instant(id, arg or -1) end
+
+-- Record a point of flow 'flow_id': 'phase' is 'start', 'step' or 'end'.
+-- It binds to the span of the calling thread enclosing it.
+function trace.flow(id, phase, flow_id)
+    lib.trace_flow(id, phases[phase], flow_id)
+end
+
+-- Write the recorded events to 'path'. Returns true on success.
+function trace.export(path)
+    return lib.trace_export(path) == 0
+end
+
+return trace
@@ -22,17 +22,28 @@ cmd:text()
 cmd:text('Options:')
 cmd:option('-framework', 'nintendo', 'name of game framework to use')
 cmd:option('-env', 'galaga', 'name of game environment to use')
+cmd:option('-gameenv', 'threaded', 'game environment implementation: threaded, native or sim')
+cmd:option('-envs', 1, 'number of games played side by side (more than 1 needs -gameenv sim)')
+cmd:option('-pool', 'drop', 'how the 2 video frames per step are combined: drop (1st one), max or avg (-gameenv threaded)')
 cmd:option('-display_freq', 2, 'frequency of game image display')
 cmd:option('-actrep', 2, 'how many steps to repeat an action')
 cmd:option('-name', 'DQN_galaga', 'filename for saving network and training history')
 cmd:option('-network', '', 'reload pretrained network')
 cmd:option('-agent', 'NeuralQLearner', 'name of agent file to use')
-cmd:option('-agent_params', 'lr=0.00025,ep=1,ep_end=0.1,ep_endt=100000,discount=0.99,hist_len=4,learn_start=10000,replay_memory=100000,update_freq=6,n_replay=1,network="convnet_atari3",preproc="net_downsample_2x_full_y",state_dim=7056,minibatch_size=8,rescale_r=1,ncols=1,bufferSize=8,target_q=10000,clip_delta=1,min_reward=-1,max_reward=1', 'string of agent parameters')
+cmd:option('-agent_params', 'lr=0.00025,ep=1,ep_end=0.1,ep_endt=100000,discount=0.99,hist_len=4,learn_start=10000,replay_memory=100000,n_replay=1,network="convnet_atari3",preproc="net_downsample_2x_full_y",state_dim=7056,minibatch_size=8,rescale_r=1,ncols=1,bufferSize=8,target_q=10000,clip_delta=1,min_reward=-1,max_reward=1', 'string of agent parameters')
 cmd:option('-seed', 1, 'seed for the Torch7 random number generator')
 cmd:option('-steps', 5*10^7, 'number of training steps to perform')
 cmd:option('-save_freq', 10^5, 'the model is saved every save_freq steps')
 cmd:option('-save_versions', 10^5, 'save models with versions (0: only lastest one)')
-cmd:option('-extra_train', 1600, 'how many extra training steps to do at end of each episode')
+cmd:option('-train_ratio', 0.25, 'max number of minibatch updates per agent step (0: no limit)')
+cmd:option('-train_window', 1000, 'number of latest agent steps over which -train_ratio is kept')
+cmd:option('-train_margin', 0.002, 'seconds before the next decision by which a minibatch update has to be done')
+cmd:option('-sync_freq', 100, 'number of minibatch updates between weight snapshots for the actor')
+cmd:option('-metrics_freq', 10, 'seconds between dumps of the latency metrics (0: no dump)')
+cmd:option('-metrics_format', 'prometheus', 'format of the metrics file: prometheus or csv')
+cmd:option('-demo', '', 'comma-separated list of datasets (record-demo.lua) preloaded into the replay memory')
+cmd:option('-record', '', 'record the transitions of every environment to <record>_<env>.eps (for train-offline.lua)')
+cmd:option('-trace', false, 'trace the latest events of all threads into <name>.trace.json after every game')
 cmd:option('-verbose', 10, 'higher number means more information')
 cmd:option('-gpu', 0, 'gpu flag (negative number means not using GPU)')
 cmd:option('-cudnn', true, 'use cudnn (only valid if gpu is set)')
@@ -43,14 +54,66 @@ local opt = cmd:parse(arg)
 --
 -- Initialization
 --
-game_env = require 'gameenv/gameenv-threaded'
-game_env.init(opt.env, opt.display_freq)
+assert(opt.pool == 'drop' or opt.gameenv == 'threaded',
+       '-pool ' .. opt.pool .. ' needs -gameenv threaded')
+game_env = require('gameenv/gameenv-' .. opt.gameenv)
+game_env.init(opt.env, opt.display_freq, opt.pool)
 game_actions = game_env.get_actions()
 
+-- more environments (only the first one is displayed)
+envs = { game_env }
+for i = 2, opt.envs do
+    assert(game_env.new, 'gameenv-' .. opt.gameenv .. ' supports only 1 environment')
+    envs[i] = game_env.new()
+    envs[i].init(opt.env, 0)
+end
+-- each environment feeds its own lane of the replay memory
+opt.agent_params = opt.agent_params .. ',actors=' .. opt.envs
+
 -- run setup to load agent
 package.path = package.path .. ';./dqn-deepmind/?.lua'
 require 'initenv'
 _, _, agent, opt = setup(opt, game_env, game_actions)
+ckpt = require 'ckpt/ckpt'
+metrics = require 'metrics/metrics'
+trace = require 'trace/trace'
+trace.thread_name('actor')
+trace.enable(opt.trace)
+
+-- training is done by a separate learner thread, while this (actor) thread
+-- plays the game with a periodically synced snapshot of the weights; the
+-- updates are fitted in between the actor's decisions
+learner = dqn.AsyncLearner{agent = agent, ratio = opt.train_ratio,
+                           sync_freq = opt.sync_freq,
+                           window = opt.train_window,
+                           margin = opt.train_margin}
+
+-- human demonstrations (record-demo.lua) are preloaded into the replay
+-- memory, and count as agent steps: learning starts (and exploration
+-- decays) that many steps earlier
+if opt.demo ~= '' then
+    local dataset = require 'dataset/dataset'
+    local frame = torch.ByteTensor(agent.state_dim)
+    for f in opt.demo:gmatch('[^,]+') do
+        local d = assert(dataset.open(f), f .. ' is not a dataset')
+        assert(d.frame_size == agent.state_dim and d.n_actions == #game_actions,
+               f .. ' does not match the agent')
+        for i = 1, d.count do
+            local a, r, term = d:get(i, frame)
+            agent.transitions:add(frame, a, r, term or i == d.count, 1)
+            if agent.rescale_r then agent.r_max = math.max(agent.r_max, r) end
+        end
+        agent.numSteps = agent.numSteps + d.count
+        print(string.format('%s: %d demonstration steps preloaded', f, d.count))
+        d:close()
+    end
+    learner:sync()
+end
+
+-- all environments are stepped together, and the actions for them are
+-- chosen by one batched forward of the network
+pool = dqn.ActorPool{agent = agent, envs = envs, actions = game_actions,
+                     actrep = opt.actrep, learner = learner}
 
 --c = require 'trepl.colorize'
 
@@ -58,119 +121,107 @@ _, _, agent, opt = setup(opt, game_env, game_actions)
 -- Main program
 --
 steps, games = 0, 0
-screen, reward, terminal = nil, 0, false
 ready_to_save = false
 score_history = {} 
-steps_history = {}
-stats_history = {}
-stats = torch.Tensor(#game_actions)
 
--- Outer loop, each iteration corresponds to 1 episode of full game
+-- The network structure is saved once (<name>.model.t7); checkpoints
+-- (<name>[_<version>].ckpt) are parameter snapshots written in the
+-- background, and the statistics of each game are appended to
+-- <name>.history, so no save stalls the games being played
+checkpoint = ckpt.writer(agent.network, agent.w, opt.name .. '.model.t7', opt)
+history_file = assert(io.open(opt.name .. '.history', 'a'))
+history_file:setvbuf('line')
+
+-- the transitions fed to the replay memory could also be recorded, 1 file
+-- per environment, for training offline later (train-offline.lua)
+if opt.record ~= '' then
+    local dataset = require 'dataset/dataset'
+    agent.recorders = {}
+    for i = 1, #envs do
+        agent.recorders[i] = dataset.writer(opt.record .. '_' .. i .. '.eps',
+                                            agent.state_dim, #game_actions)
+    end
+end
+
+-- latency histograms of all stages are dumped to <name>.prom (or
+-- appended to <name>_metrics.csv) periodically
+if opt.metrics_freq > 0 then
+    local file = opt.name .. (opt.metrics_format == 'csv' and '_metrics.csv' or '.prom')
+    assert(metrics.start_dumper(file, opt.metrics_format, opt.metrics_freq),
+           'failed to start dumping metrics to ' .. file)
+end
+local M_PERCEIVE = metrics.histogram('perceive')
+local M_TRAIN_STEP = metrics.histogram('train_step')
+
+local tic = torch.tic()
+local tic_updates, tic_late = learner:updates(), learner:late()
+local calls, decisions = 0, 0
+
+-- Each iteration advances all games by 1 step; the statistics of every
+-- game are printed once it is over
 while true do
-    stats:fill(0)
-    game_env.new_game()
-    screen, reward, terminal = game_env.step(0)
-
-    local tic = torch.tic()
-    local tic_steps = steps
-
-    local percv_history = {}
-    local train_history = {}
-    local skip_train = false
-
-    -- Inner loop, stepping through the game until terminal == true
-    while not terminal do
-        if steps % opt.actrep == 0 then
-            local action_index
-            local xx = torch.tic()
-            action_index = agent:perceive(reward, screen, terminal)
-            percv_history[#percv_history + 1] = torch.toc(xx)
-            -- skip next training if current agent:perceive() takes too long
-            if percv_history[#percv_history] > 0.01 then skip_train = true end
-
-            screen, reward, terminal = game_env.step(game_actions[action_index])
-            stats[action_index] = stats[action_index] + 1
-        else
-            -- step() with no argument means take same action as previous
-            screen, reward, terminal = game_env.step()
-        end
+    local finished = pool:step()
+    learner:sync()
+    if pool.decisions > 0 then
+        calls = calls + 1
+        decisions = decisions + pool.decisions
+    end
+    for i = 1, #envs do
         steps = steps + 1
         --if steps % 1000 == 1 then collectgarbage() end
         if steps % opt.save_freq == 0 then ready_to_save = true end
-
-        -- do some training if OK
-        if agent.numSteps > agent.learn_start and
-           agent.numSteps % agent.update_freq == 0 then
-            if not skip_train then
-                local yy = torch.tic()
-                for i = 1, agent.n_replay do
-                    agent:qLearnMinibatch()
-                end
-                train_history[#train_history + 1] = torch.toc(yy)
-                -- skip next training if current training takes too long
-                if train_history[#train_history] > 0.05 then skip_train = true end
-            else
-                skip_train = false
-            end
-        end
     end
 
-    -- Game is over; let the agent know about it
-    agent:perceive(reward, screen, terminal)
-    steps = steps + 1
-    game_env.step(0)  -- release all buttons
-    --assert((steps / opt.actrep) + 1 == agent.numSteps, 'trainer step: ' .. steps .. ' & agent.numSteps: ' .. agent.numSteps)
-
-    if #train_history > 1 then
-        local px = torch.Tensor(percv_history)
-        print(string.format('\n--- perceive time (ms) average = %.2f, max = %.2f, min = %.2f', px:sum() / px:numel() * 1000, px:max() * 1000, px:min() * 1000))
-        local tx = torch.Tensor(train_history)
-        print(string.format('--- training time (ms) average = %.2f, max = %.2f, min = %.2f', tx:sum() / tx:numel() * 1000, tx:max() * 1000, tx:min() * 1000))
-    end
-
-    local game_time = torch.toc(tic)
-    local diff = steps - tic_steps
-    print(string.format('\n*** %d steps (%.2f s) done in %.2f s', diff, diff / 30.0, game_time))
-
-    stats:div(stats:sum())  -- calculate percentage of each action
-    io.write('Distribution of actions: ')
-    for i = 1, stats:size(1) do io.write(string.format('%.2f, ', stats[i])) end
-    print('Score = ' .. game_env.get_score() .. '\n')
-    games = games + 1
-    score_history[games] = game_env.get_score()
-    steps_history[games] = diff
-    stats_history[games] = stats:clone()
-
-    -- do more training, before starting the next game...
-    if agent.numSteps > agent.learn_start then
-        for i = 1, opt.extra_train do agent:qLearnMinibatch() end
-    end
-
-    print('Total steps: ' .. steps)
-    agent:report()
-    collectgarbage()
-
-    -- save the model periodically
-    if ready_to_save or steps >= opt.steps then
-        local filename = opt.name
-        if opt.save_versions > 0 then
-            filename = filename .. "_" .. math.floor(steps / opt.save_versions)
+    for _, g in ipairs(finished) do
+        if calls > 1 then
+            local period = torch.toc(tic)
+            -- the quantiles are over the whole run so far
+            print(string.format('\n--- perceive time (ms) p50 = %.2f, p99 = %.2f, p99.9 = %.2f (%.1f actions per call, %.1f%% greedy memo hits)', metrics.quantile(M_PERCEIVE, 0.5) * 1000, metrics.quantile(M_PERCEIVE, 0.99) * 1000, metrics.quantile(M_PERCEIVE, 0.999) * 1000, decisions / calls, agent:memo_hit_rate() * 100))
+            print(string.format('--- learner: %d minibatch updates (%.1f per second), p99 = %.2f ms, %d past the deadline', learner:updates() - tic_updates, (learner:updates() - tic_updates) / period, metrics.quantile(M_TRAIN_STEP, 0.99) * 1000, learner:late() - tic_late))
+            tic = torch.tic()
+            tic_updates, tic_late = learner:updates(), learner:late()
+            calls, decisions = 0, 0
+        end
+        print(string.format('\n*** [env %d] %d steps (%.2f s) done in %.2f s', g.env, g.steps, g.steps / 30.0, g.time))
+
+        local stats = g.stats:div(g.stats:sum())  -- calculate percentage of each action
+        io.write('Distribution of actions: ')
+        for i = 1, stats:size(1) do io.write(string.format('%.2f, ', stats[i])) end
+        print('Score = ' .. g.score .. '\n')
+        games = games + 1
+        score_history[games] = g.score
+        -- game, total steps, score, steps of the game, action distribution
+        history_file:write(string.format('%d %d %d %d', games, steps, g.score, g.steps))
+        for i = 1, stats:size(1) do history_file:write(string.format(' %.4f', stats[i])) end
+        history_file:write('\n')
+
+        print('Total steps: ' .. steps)
+        if opt.trace then trace.export(opt.name .. '.trace.json') end
+        agent:report()
+        collectgarbage()
+
+        -- save the model periodically
+        if ready_to_save or steps >= opt.steps then
+            local filename = opt.name
+            if opt.save_versions > 0 then
+                filename = filename .. "_" .. math.floor(steps / opt.save_versions)
+            end
+            checkpoint:save(filename .. '.ckpt', steps)
+            print('Saving: ' .. filename .. '.ckpt')
+            ready_to_save = false
         end
-        torch.save(filename .. '.t7',
-                  {model = agent.network,
-                   score_history = score_history,
-                   steps_history = steps_history,
-                   stats_history = stats_history,
-                   arguments = opt})
-        print('Saved: ' .. filename .. '.t7')
-        ready_to_save = false
     end
-
-    collectgarbage()
-    if steps >= opt.steps then break end  -- the whole training is done
+    if #finished > 0 and steps >= opt.steps then break end  -- the whole training is done
 end
 
 hh = torch.Tensor(score_history)
 print('\nScore average = ' .. hh:sum() / hh:numel() .. ', min = ' .. hh:min() .. ', max = ' .. hh:max())
 
-game_env.cleanup()
+learner:stop()
+checkpoint:close()
+history_file:close()
+if agent.recorders then
+    for _, w in ipairs(agent.recorders) do w:close() end
+end
+metrics.stop_dumper()
+for i = #envs, 1, -1 do envs[i].cleanup() end
@@ -0,0 +1,159 @@
+--------------------------------------------------------------------------------
+--
+-- train-offline.lua
+--
+-- This program trains DeepMind's DQN from recorded transition datasets
+-- (train-deepmind.lua -record), without the game console: the recorded
+-- steps are streamed (memory mapped) into the replay memory, and
+-- minibatch updates run as fast as the hardware allows. It is meant for
+-- pretraining, tuning hyperparameters and measuring the throughput of
+-- the learner.
+--
+--   $ th train-offline.lua -data DQN_galaga_1.eps,DQN_galaga_2.eps [options]
+--
+-- With -train_ratio > 0, updates are interleaved with the steps fed, as
+-- in train-deepmind.lua (-train_ratio updates per step). With
+-- -train_ratio 0, the datasets are fed first (the replay memory keeps the
+-- latest replay_memory steps), then -steps updates are run.
+--
+-- The learning rate schedule and the target network follow the number of
+-- agent steps the updates correspond to, i.e. learn_start + updates /
+-- train_ratio (0.25 steps per update for -train_ratio 0), so the agent
+-- parameters mean the same as in train-deepmind.lua.
+--
+--------------------------------------------------------------------------------
+-- agent, 2026-10-18
+--------------------------------------------------------------------------------
+
+require 'torch'
+
+torch.setdefaulttensortype('torch.FloatTensor')
+
+cmd = torch.CmdLine()
+cmd:text()
+cmd:text('Train Agent offline from recorded datasets:')
+cmd:text()
+cmd:text('Options:')
+cmd:option('-data', '', 'comma-separated list of dataset files (.eps)')
+cmd:option('-epochs', 1, 'number of passes over the datasets')
+cmd:option('-name', 'DQN_offline', 'filename for saving network')
+cmd:option('-network', '', 'reload pretrained network')
+cmd:option('-agent', 'NeuralQLearner', 'name of agent file to use')
+cmd:option('-agent_params', 'lr=0.00025,ep=1,ep_end=0.1,ep_endt=100000,discount=0.99,hist_len=4,learn_start=10000,replay_memory=100000,n_replay=1,network="convnet_atari3",preproc="net_downsample_2x_full_y",state_dim=7056,minibatch_size=8,rescale_r=1,ncols=1,bufferSize=8,target_q=10000,clip_delta=1,min_reward=-1,max_reward=1', 'string of agent parameters')
+cmd:option('-seed', 1, 'seed for the Torch7 random number generator')
+cmd:option('-steps', 10^6, 'max number of minibatch updates to perform')
+cmd:option('-train_ratio', 0.25, 'minibatch updates per step fed (0: feed all datasets first)')
+cmd:option('-save_freq', 10^5, 'the model is saved every save_freq updates')
+cmd:option('-prog_freq', 10^4, 'progress is reported every prog_freq updates')
+cmd:option('-verbose', 10, 'higher number means more information')
+cmd:option('-gpu', 0, 'gpu flag (negative number means not using GPU)')
+cmd:option('-cudnn', true, 'use cudnn (only valid if gpu is set)')
+cmd:text()
+
+local opt = cmd:parse(arg)
+assert(opt.data ~= '', 'no datasets given (-data)')
+
+--
+-- Initialization
+--
+dataset = require 'dataset/dataset'
+files = {}
+local n_actions
+for f in opt.data:gmatch('[^,]+') do
+    local d = assert(dataset.open(f), f .. ' is not a dataset')
+    n_actions = n_actions or d.n_actions
+    assert(d.n_actions == n_actions, f .. ': different number of actions')
+    print(string.format('%s: %d steps', f, d.count))
+    d:close()
+    files[#files + 1] = f
+end
+game_actions = {}
+for i = 1, n_actions do game_actions[i] = i end
+
+package.path = package.path .. ';./dqn-deepmind/?.lua'
+require 'initenv'
+opt.env = 'offline'
+_, _, agent, opt = setup(opt, nil, game_actions)
+ckpt = require 'ckpt/ckpt'
+metrics = require 'metrics/metrics'
+
+local M_TRAIN_STEP = metrics.histogram('train_step')
+local trans = agent.transitions
+local frame = torch.ByteTensor(agent.state_dim)
+local steps_per_update = 1 / (opt.train_ratio > 0 and opt.train_ratio or 0.25)
+local min_entries = math.max(trans.bufferSize, agent.minibatch_size + 1)
+
+checkpoint = ckpt.writer(agent.network, agent.w, opt.name .. '.model.t7', opt)
+
+--
+-- Main program
+--
+fed, updates = 0, 0
+local last_target = agent.learn_start
+local tic, tic_fed, tic_updates = torch.tic(), 0, 0
+
+local function save()
+    checkpoint:save(opt.name .. '.ckpt', agent.numSteps)
+    print('Saving: ' .. opt.name .. '.ckpt')
+end
+
+local function report()
+    local period = torch.toc(tic)
+    print(string.format('updates %d, steps fed %d: %.1f updates/s, %.1f steps/s, ' ..
+                        'update p50 = %.2f ms, p99 = %.2f ms, lr = %.6f',
+                        updates, fed, (updates - tic_updates) / period,
+                        (fed - tic_fed) / period,
+                        metrics.quantile(M_TRAIN_STEP, 0.5) * 1000,
+                        metrics.quantile(M_TRAIN_STEP, 0.99) * 1000, agent.lr or 0))
+    tic, tic_fed, tic_updates = torch.tic(), fed, updates
+end
+
+local function update()
+    agent.numSteps = agent.learn_start + updates * steps_per_update
+    local t = metrics.now()
+    agent:qLearnMinibatch()
+    metrics.record(M_TRAIN_STEP, metrics.now() - t)
+    updates = updates + 1
+    if agent.target_w and agent.numSteps - last_target >= agent.target_q then
+        agent.target_w:copy(agent.w)
+        last_target = agent.numSteps
+    end
+    if updates % opt.prog_freq == 0 then report() end
+    if updates % opt.save_freq == 0 then save() end
+end
+
+-- feed the datasets, with updates interleaved if -train_ratio > 0
+for epoch = 1, opt.epochs do
+    for _, f in ipairs(files) do
+        local d = dataset.open(f)
+        for i = 1, d.count do
+            local a, r, term = d:get(i, frame)
+            -- an episode cut off at the end of a file ends there
+            trans:add(frame, a, r, term or i == d.count)
+            if agent.rescale_r then agent.r_max = math.max(agent.r_max, r) end
+            fed = fed + 1
+
+            if opt.train_ratio > 0 then
+                while fed > agent.learn_start and trans:size() >= min_entries and
+                      updates < (fed - agent.learn_start) * opt.train_ratio and
+                      updates < opt.steps do
+                    update()
+                end
+            end
+        end
+        d:close()
+        if updates >= opt.steps then break end
+    end
+    if updates >= opt.steps then break end
+end
+
+if opt.train_ratio == 0 then
+    assert(trans:size() >= min_entries, 'not enough steps in the datasets')
+    tic, tic_fed = torch.tic(), fed
+    while updates < opt.steps do update() end
+end
+
+if updates % opt.prog_freq ~= 0 then report() end
+save()
+checkpoint:close()
+print(string.format('\n%d steps fed, %d minibatch updates', fed, updates))
@@ -15,10 +15,17 @@
  *
  *  int   device_initialize(char *devname, int width, int height, char *format);
  *  int   device_initialize_keep_format(char *devname);
+ *  int   device_initialize_modes(char *devname, const struct device_mode *modes,
+ *                                int n, int fps);
  *  int   device_get_format(int *width, int *height, char *format);
+ *  int   device_get_bytesperline();
+ *  int   device_get_fd();
  *  int   device_start_capturing();
  *  void *device_get_next_frame(int timeout_in_msec);
- *  void  device_free_frame(void *p);
+ *  int   device_free_frame(void *p);
+ *  double device_frame_timestamp(void *p);
+ *  int   device_get_error();
+ *  int   device_reconnect(int timeout_in_msec);
  *  void  device_stop_capturing();
  *  extern void  device_cleanup();
  *
@@ -27,6 +34,30 @@
  *  mmap buffers (usally 4~32 buffers depending on the V4L2 driver
  *  implementation) are used.
  *
+ *  device_initialize_modes() negotiates the capture format: it enumerates
+ *  the pixel formats, frame sizes and frame intervals the device supports
+ *  (VIDIOC_ENUM_FMT/ENUM_FRAMESIZES/ENUM_FRAMEINTERVALS), and sets the 1st
+ *  of the given modes (in the caller's order of preference) which the
+ *  device supports at 'fps' or more. Drivers which do not enumerate frame
+ *  sizes are asked with VIDIOC_TRY_FMT instead.
+ *
+ *  device_frame_timestamp() returns when a frame was captured, in
+ *  CLOCK_MONOTONIC seconds (the clock of GPIO input events, see
+ *  gpio/monitor.c): the V4L2 buffer timestamp if the driver stamps
+ *  buffers with the monotonic clock, or else the time it was dequeued.
+ *
+ *  No error exits the process: every function returns -1 (or NULL) and
+ *  prints the reason on stderr. When the device fails while capturing
+ *  (e.g. VIDIOC_DQBUF or VIDIOC_QBUF fail with EIO or ENODEV on an HDMI
+ *  glitch), device_get_next_frame() returns NULL and device_get_error()
+ *  returns the errno of the failure, instead of 0 as on a timeout. The
+ *  caller then calls device_reconnect(), which releases the buffers,
+ *  closes the device, and reopens it with the format negotiated before
+ *  (and new buffers) until streaming restarts or the time is up. Frames
+ *  of the old buffers must not be used (nor freed) after it. Frames
+ *  which the driver flags as corrupted (V4L2_BUF_FLAG_ERROR) are
+ *  requeued and skipped.
+ *
  *  GLOBALS: none
  *
  *  REFERENCE: V4L2 specification, https://linuxtv.org/downloads/v4l-dvb-apis/
@@ -34,8 +65,8 @@
  *  LIMITATIONS: (or TO-DO)
  *
  *  1. This device module can open only 1 V4L2 device at a time.
- *  2. Error-exits would be better replaced by error-returns. But then we'd
- *     need to define error codes and re-define the API fucntions.
+ *  2. Errors are errno values, and only device_get_error() tells a
+ *     failure of the device from a timeout.
  *  3. mmap buffer count is hard-coded as 4 here.
  *
  *  REVISION HISTORY:
@@ -46,6 +77,10 @@
  *    2016-08-22       added keep-format support                     jkjung
  *    2016-08-23       fixed memcpy bug                              jkjung
  *    2016-08-26       added YUYV support                            jkjung
+ *    2026-10-18       format negotiation, GREY/NV12/YU12 support    agent
+ *    2026-10-18       added frame timestamps                        agent
+ *    2026-10-18       added device_get_fd()                         agent
+ *    2026-10-18       error returns, device_reconnect()             agent
  *
  *  TARGET: Linux C
  *
@@ -61,11 +96,14 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/time.h>
+#include <time.h>
 #include <sys/mman.h>
 #include <sys/ioctl.h>
 
 #include <linux/videodev2.h>
 
+#include "device.h"
+
 //#define DEBUG_DEVICE 1
 
 #define CLEAR(x) memset(&(x), 0, sizeof(x))
@@ -80,6 +118,7 @@ struct buffer {
         void   *start;
         size_t  length;
         struct v4l2_buffer v4l2buf;  /* saved context */
+        double  timestamp;           /* CLOCK_MONOTONIC seconds */
 };
 
 static char            *dev_name;
@@ -91,11 +130,58 @@ static __u32            pix_width;
 static __u32            pix_height;
 static __u32            pix_format;
 static enum v4l2_field  pix_field;
+static __u32            pix_bytesperline;
+static int              set_format;     /* whether the format was set (S_FMT) */
+static int              dev_error;      /* errno of a failure while capturing */
+
+/* the pixel formats this module knows, packed (2 bytes per pixel) or
+ * planar/gray (with the luma plane 1st) */
+static const struct {
+        const char *name;
+        __u32       fourcc;
+        int         packed;
+} formats[] = {
+        { "UYVY", V4L2_PIX_FMT_UYVY,   1 },
+        { "YUYV", V4L2_PIX_FMT_YUYV,   1 },
+        { "YV12", V4L2_PIX_FMT_YVU420, 0 },
+        { "YU12", V4L2_PIX_FMT_YUV420, 0 },
+        { "NV12", V4L2_PIX_FMT_NV12,   0 },
+        { "GREY", V4L2_PIX_FMT_GREY,   0 },
+};
+#define N_FORMATS  (int) (sizeof(formats) / sizeof(formats[0]))
 
-static void errno_exit(const char *s)
+static int format_index(__u32 fourcc)
+{
+        int i;
+
+        for (i = 0; i < N_FORMATS; i++)
+                if (formats[i].fourcc == fourcc)
+                        return i;
+        return -1;
+}
+
+static int format_index_by_name(const char *name)
+{
+        int i;
+
+        for (i = 0; i < N_FORMATS; i++)
+                if (strncmp(formats[i].name, name, 4) == 0)
+                        return i;
+        return -1;
+}
+
+static int errno_msg(const char *s)
 {
         fprintf(stderr, "%s error %d, %s\n", s, errno, strerror(errno));
-        exit(EXIT_FAILURE);
+        return -1;
+}
+
+static double now(void)
+{
+        struct timespec ts;
+
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec + ts.tv_nsec * 1e-9;
 }
 
 static int xioctl(int fh, int request, void *arg)
@@ -124,18 +210,30 @@ static void *read_frame(void)
                         case EAGAIN:
                                 return NULL;
 
-                        case EIO:
-                                /* Could ignore EIO, see spec. */
-
-                                /* fall through */
-
-                        default:
-                                errno_exit("VIDIOC_DQBUF");
+                        default:  /* EIO, ENODEV... */
+                                dev_error = errno;
+                                errno_msg("VIDIOC_DQBUF");
+                                return NULL;
                         }
                 }
 
                 assert(buf.index < n_buffers);
+                if (buf.flags & V4L2_BUF_FLAG_ERROR) {
+                        /* a corrupted frame: give it back and skip it */
+                        if (-1 == xioctl(fd, VIDIOC_QBUF, &buf)) {
+                                dev_error = errno;
+                                errno_msg("VIDIOC_QBUF");
+                        }
+                        return NULL;
+                }
                 memcpy(&buffers[buf.index].v4l2buf, &buf, sizeof(struct v4l2_buffer));
+                if ((buf.flags & V4L2_BUF_FLAG_TIMESTAMP_MASK) ==
+                    V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC) {
+                        buffers[buf.index].timestamp =
+                                buf.timestamp.tv_sec + buf.timestamp.tv_usec * 1e-6;
+                } else {
+                        buffers[buf.index].timestamp = now();
+                }
                 return (void *) buffers[buf.index].start;
 
         case IO_METHOD_READ:
@@ -146,7 +244,7 @@ static void *read_frame(void)
         return NULL;
 }
 
-static void free_frame(void *p)
+static int free_frame(void *p)
 {
         unsigned int i;
 
@@ -155,9 +253,14 @@ static void free_frame(void *p)
                 for (i = 0; i < n_buffers; ++i)
                         if (p == buffers[i].start)
                                 break;
-                assert(i < n_buffers);
-                if (-1 == xioctl(fd, VIDIOC_QBUF, &buffers[i].v4l2buf))
-                        errno_exit("VIDIOC_QBUF");
+                if (i == n_buffers) {
+                        fprintf(stderr, "free_frame(): %p is no frame buffer\n", p);
+                        return -1;
+                }
+                if (-1 == xioctl(fd, VIDIOC_QBUF, &buffers[i].v4l2buf)) {
+                        dev_error = errno;
+                        return errno_msg("VIDIOC_QBUF");
+                }
                 break;
 
         case IO_METHOD_READ:
@@ -165,9 +268,10 @@ static void free_frame(void *p)
                 /* Code removed */
                 break;
         }
+        return 0;
 }
 
-static void stop_capturing(void)
+static int stop_capturing(void)
 {
         enum v4l2_buf_type type;
 
@@ -175,7 +279,7 @@ static void stop_capturing(void)
         case IO_METHOD_MMAP:
                 type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
                 if (-1 == xioctl(fd, VIDIOC_STREAMOFF, &type))
-                        errno_exit("VIDIOC_STREAMOFF");
+                        return errno_msg("VIDIOC_STREAMOFF");
                 break;
 
         case IO_METHOD_READ:
@@ -183,9 +287,12 @@ static void stop_capturing(void)
                 /* Code removed */
                 break;
         }
+        return 0;
 }
 
-static void init_mmap(void)
+static void uninit_device(void);
+
+static int init_mmap(void)
 {
         struct v4l2_requestbuffers req;
 
@@ -199,9 +306,9 @@ static void init_mmap(void)
                 if (EINVAL == errno) {
                         fprintf(stderr, "%s does not support "
                                  "memory mapping\n", dev_name);
-                        exit(EXIT_FAILURE);
+                        return -1;
                 } else {
-                        errno_exit("VIDIOC_REQBUFS");
+                        return errno_msg("VIDIOC_REQBUFS");
                 }
         }
 
@@ -214,14 +321,14 @@ static void init_mmap(void)
                                 "  $ ./canny -d %s -x %d -y %d\n",
                                 dev_name, pix_width, pix_height,
                                 dev_name, pix_width, pix_height);
-                exit(EXIT_FAILURE);
+                return -1;
         }
 
         buffers = (struct buffer *) calloc(req.count, sizeof(*buffers));
 
         if (!buffers) {
                 fprintf(stderr, "Out of memory\n");
-                exit(EXIT_FAILURE);
+                return -1;
         }
 
         for (n_buffers = 0; n_buffers < req.count; ++n_buffers) {
@@ -233,8 +340,11 @@ static void init_mmap(void)
                 buf.memory      = V4L2_MEMORY_MMAP;
                 buf.index       = n_buffers;
 
-                if (-1 == xioctl(fd, VIDIOC_QUERYBUF, &buf))
-                        errno_exit("VIDIOC_QUERYBUF");
+                if (-1 == xioctl(fd, VIDIOC_QUERYBUF, &buf)) {
+                        errno_msg("VIDIOC_QUERYBUF");
+                        uninit_device();
+                        return -1;
+                }
 
                 buffers[n_buffers].length = buf.length;
                 buffers[n_buffers].start =
@@ -244,9 +354,13 @@ static void init_mmap(void)
                               MAP_SHARED /* recommended */,
                               fd, buf.m.offset);
 
-                if (MAP_FAILED == buffers[n_buffers].start)
-                        errno_exit("mmap");
+                if (MAP_FAILED == buffers[n_buffers].start) {
+                        errno_msg("mmap");
+                        uninit_device();
+                        return -1;
+                }
         }
+        return 0;
 }
 
 static int start_capturing(void)
@@ -256,7 +370,8 @@ static int start_capturing(void)
 
         switch (io) {
         case IO_METHOD_MMAP:
-                init_mmap();
+                if (init_mmap() < 0)
+                        return -1;
                 for (i = 0; i < n_buffers; ++i) {
                         struct v4l2_buffer buf;
 
@@ -266,13 +381,15 @@ static int start_capturing(void)
                         buf.index = i;
 
                         if (-1 == xioctl(fd, VIDIOC_QBUF, &buf)) {
-                                fprintf(stderr, "%s error %d, %s\n", "VIDIOC_QBUF", errno, strerror(errno));
+                                errno_msg("VIDIOC_QBUF");  /* before errno changes */
+                                uninit_device();  /* the buffers of init_mmap() */
                                 return -1;
                         }
                 }
                 type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
                 if (-1 == xioctl(fd, VIDIOC_STREAMON, &type)) {
-                        fprintf(stderr, "%s error %d, %s\n", "VIDIOC_STREAMON", errno, strerror(errno));
+                        errno_msg("VIDIOC_STREAMON");
+                        uninit_device();
                         return -1;
                 }
                 break;
@@ -293,7 +410,7 @@ static void uninit_device(void)
         case IO_METHOD_MMAP:
                 for (i = 0; i < n_buffers; ++i)
                         if (-1 == munmap(buffers[i].start, buffers[i].length))
-                                errno_exit("munmap");
+                                errno_msg("munmap");
                 break;
 
         case IO_METHOD_READ:
@@ -303,6 +420,8 @@ static void uninit_device(void)
         }
 
         free(buffers);
+        buffers = NULL;
+        n_buffers = 0;
 }
 
 static int get_current_format()
@@ -312,10 +431,13 @@ static int get_current_format()
         CLEAR(fmt);
         fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
         if (-1 == xioctl(fd, VIDIOC_G_FMT, &fmt))
-                errno_exit("VIDIOC_G_FMT");
+                return errno_msg("VIDIOC_G_FMT");
         pix_width  = fmt.fmt.pix.width;
         pix_height = fmt.fmt.pix.height;
         pix_format = fmt.fmt.pix.pixelformat;
+        pix_bytesperline = fmt.fmt.pix.bytesperline;
+        if (pix_bytesperline == 0 && format_index(pix_format) >= 0)
+                pix_bytesperline = pix_width * (formats[format_index(pix_format)].packed ? 2 : 1);
 #ifdef DEBUG_DEVICE
         printf("get_format(): width=%d, height=%d, format=0x%x\n",
                 pix_width, pix_height, pix_format);
@@ -335,16 +457,16 @@ static int init_device(int do_setfmt)
                 if (EINVAL == errno) {
                         fprintf(stderr, "%s is no V4L2 device\n",
                                  dev_name);
-                        exit(EXIT_FAILURE);
+                        return -1;
                 } else {
-                        errno_exit("VIDIOC_QUERYCAP");
+                        return errno_msg("VIDIOC_QUERYCAP");
                 }
         }
 
         if (!(cap.capabilities & V4L2_CAP_VIDEO_CAPTURE)) {
                 fprintf(stderr, "%s is no video capture device\n",
                          dev_name);
-                exit(EXIT_FAILURE);
+                return -1;
         }
 
         switch (io) {
@@ -352,14 +474,14 @@ static int init_device(int do_setfmt)
                 if (!(cap.capabilities & V4L2_CAP_STREAMING)) {
                         fprintf(stderr, "%s does not support streaming i/o\n",
                                  dev_name);
-                        exit(EXIT_FAILURE);
+                        return -1;
                 }
                 break;
 
         case IO_METHOD_READ:
         case IO_METHOD_USERPTR:
                 fprintf(stderr, "IO READ/USERPTR is not supported\n");
-                exit(EXIT_FAILURE);
+                return -1;
         }
 
         /*
@@ -398,7 +520,7 @@ static int init_device(int do_setfmt)
                 fmt.fmt.pix.field       = pix_field;
                 /* Note VIDIOC_S_FMT may change width and height. */
                 if (-1 == xioctl(fd, VIDIOC_S_FMT, &fmt))
-                        errno_exit("VIDIOC_S_FMT");
+                        return errno_msg("VIDIOC_S_FMT");
 
                 if (fmt.fmt.pix.width != pix_width || fmt.fmt.pix.height != pix_height) {
                         fprintf(stderr, "%s insists width=%d, height=%d!\n",
@@ -407,12 +529,15 @@ static int init_device(int do_setfmt)
                 }
 
                 /* Buggy driver paranoia. */
-                min = fmt.fmt.pix.width * 2;
+                min = fmt.fmt.pix.width;
+                if (format_index(pix_format) >= 0 && formats[format_index(pix_format)].packed)
+                        min *= 2;
                 if (fmt.fmt.pix.bytesperline < min)
                         fmt.fmt.pix.bytesperline = min;
                 min = fmt.fmt.pix.bytesperline * fmt.fmt.pix.height;
                 if (fmt.fmt.pix.sizeimage < min)
-                fmt.fmt.pix.sizeimage = min;
+                        fmt.fmt.pix.sizeimage = min;
+                pix_bytesperline = fmt.fmt.pix.bytesperline;
         }
 
         switch (io) {
@@ -431,24 +556,24 @@ static int init_device(int do_setfmt)
 static void close_device(void)
 {
         if (-1 == close(fd))
-                errno_exit("close");
+                errno_msg("close");
 
         fd = -1;
 }
 
-static void open_device(void)
+static int open_device(void)
 {
         struct stat st;
 
         if (-1 == stat(dev_name, &st)) {
                 fprintf(stderr, "Cannot identify '%s': %d, %s\n",
                          dev_name, errno, strerror(errno));
-                exit(EXIT_FAILURE);
+                return -1;
         }
 
         if (!S_ISCHR(st.st_mode)) {
                 fprintf(stderr, "%s is no device\n", dev_name);
-                exit(EXIT_FAILURE);
+                return -1;
         }
 
         fd = open(dev_name, O_RDWR /* required */ | O_NONBLOCK, 0);
@@ -456,8 +581,21 @@ static void open_device(void)
         if (-1 == fd) {
                 fprintf(stderr, "Cannot open '%s': %d, %s\n",
                          dev_name, errno, strerror(errno));
-                exit(EXIT_FAILURE);
+                return -1;
         }
+        dev_error = 0;
+        return 0;
+}
+
+/* keep a copy of 'devname', for device_reconnect() */
+static int set_dev_name(const char *devname)
+{
+        free(dev_name);
+        dev_name = (char *) malloc(strlen(devname) + 1);
+        if (!dev_name)
+                return errno_msg("MALLOC");
+        strcpy(dev_name, devname);
+        return 0;
 }
 
 int device_initialize(char *devname, int width, int height, char *format)
@@ -466,28 +604,19 @@ int device_initialize(char *devname, int width, int height, char *format)
                 fprintf(stderr, "device_initialize(): fd is already opened\n");
                 return -1;
         }
-        dev_name = (char *) malloc(strlen(devname) + 1);
-        if (!dev_name)  errno_exit("MALLOC");
-        strcpy(dev_name, devname);
+        if (set_dev_name(devname) < 0)
+                return -1;
         pix_width  = width;
         pix_height = height;
-        if (strncmp(format, "YV12", 4) == 0) {
-                pix_format = V4L2_PIX_FMT_YVU420;  /* YV12 */
-                pix_field  = V4L2_FIELD_NONE;      /* progressive */
-        } else
-        if (strncmp(format, "UYVY", 4) == 0) {
-                pix_format = V4L2_PIX_FMT_UYVY;
-                //pix_field  = V4L2_FIELD_INTERLACED;
-                pix_field  = V4L2_FIELD_NONE;      /* progressive */
-        } else
-        if (strncmp(format, "YUYV", 4) == 0) {
-                pix_format = V4L2_PIX_FMT_YUYV;
-                pix_field  = V4L2_FIELD_NONE;      /* progressive */
-        } else {
+        if (format_index_by_name(format) < 0)
                 return -1;
-        }
+        pix_format = formats[format_index_by_name(format)].fourcc;
+        //pix_field  = V4L2_FIELD_INTERLACED;
+        pix_field  = V4L2_FIELD_NONE;      /* progressive */
 
-        open_device();
+        if (open_device() < 0)
+                return -1;
+        set_format = 1;
         if (init_device(1) < 0) {
                 fprintf(stderr, "device_initialize(): init_device() failed\n");
                 close_device();
@@ -502,11 +631,12 @@ int device_initialize_keep_format(char *devname)
                 fprintf(stderr, "device_initialize_keep_format(): fd is already opened\n");
                 return -1;
         }
-        dev_name = (char *) malloc(strlen(devname) + 1);
-        if (!dev_name)  errno_exit("MALLOC");
-        strcpy(dev_name, devname);
+        if (set_dev_name(devname) < 0)
+                return -1;
 
-        open_device();
+        if (open_device() < 0)
+                return -1;
+        set_format = 0;
         if (init_device(0) < 0) {
                 fprintf(stderr, "device_initialize_keep_format(): init_device() failed\n");
                 close_device();
@@ -517,9 +647,7 @@ int device_initialize_keep_format(char *devname)
                 close_device();
                 return -1;
         }
-        if (pix_format != V4L2_PIX_FMT_YVU420 &&
-            pix_format != V4L2_PIX_FMT_UYVY &&
-            pix_format != V4L2_PIX_FMT_YUYV) {
+        if (format_index(pix_format) < 0) {
                 fprintf(stderr, "device_initialize_keep_format(): unsupported pixel format (%d)\n", pix_format);
                 close_device();
                 return -1;
@@ -527,26 +655,163 @@ int device_initialize_keep_format(char *devname)
         return fd;
 }
 
+/*
+ * Frame rate of 'fourcc' at width x height: the highest one enumerated,
+ * 0 if the size is not supported, or -1 if the driver does not tell.
+ */
+static int max_fps(__u32 fourcc, __u32 width, __u32 height)
+{
+        struct v4l2_frmsizeenum fsz;
+        struct v4l2_frmivalenum fiv;
+        int enumerated = 0, found = 0, fps = 0, f;
+
+        CLEAR(fsz);
+        fsz.pixel_format = fourcc;
+        for (fsz.index = 0; 0 == xioctl(fd, VIDIOC_ENUM_FRAMESIZES, &fsz); fsz.index++) {
+                enumerated = 1;
+                if (V4L2_FRMSIZE_TYPE_DISCRETE == fsz.type) {
+                        if (fsz.discrete.width == width && fsz.discrete.height == height)
+                                found = 1;
+                } else {  /* stepwise or continuous */
+                        struct v4l2_frmsize_stepwise *sw = &fsz.stepwise;
+
+                        if (width >= sw->min_width && width <= sw->max_width &&
+                            height >= sw->min_height && height <= sw->max_height &&
+                            (width - sw->min_width) % (sw->step_width ? sw->step_width : 1) == 0 &&
+                            (height - sw->min_height) % (sw->step_height ? sw->step_height : 1) == 0)
+                                found = 1;
+                        break;  /* only 1 entry for these types */
+                }
+        }
+        if (!enumerated)
+                return -1;  /* frame sizes not enumerated */
+        if (!found)
+                return 0;
+
+        enumerated = 0;
+        CLEAR(fiv);
+        fiv.pixel_format = fourcc;
+        fiv.width = width;
+        fiv.height = height;
+        for (fiv.index = 0; 0 == xioctl(fd, VIDIOC_ENUM_FRAMEINTERVALS, &fiv); fiv.index++) {
+                enumerated = 1;
+                /* the shortest interval (min for stepwise/continuous) */
+                struct v4l2_fract *t = (V4L2_FRMIVAL_TYPE_DISCRETE == fiv.type) ?
+                                       &fiv.discrete : &fiv.stepwise.min;
+
+                if (t->numerator > 0) {
+                        f = (t->denominator + t->numerator / 2) / t->numerator;
+                        if (f > fps)
+                                fps = f;
+                }
+                if (V4L2_FRMIVAL_TYPE_DISCRETE != fiv.type)
+                        break;
+        }
+        return enumerated ? fps : -1;
+}
+
+/* whether the driver would take 'fourcc' at width x height as is */
+static int try_format(__u32 fourcc, __u32 width, __u32 height)
+{
+        struct v4l2_format fmt;
+
+        CLEAR(fmt);
+        fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        fmt.fmt.pix.width       = width;
+        fmt.fmt.pix.height      = height;
+        fmt.fmt.pix.pixelformat = fourcc;
+        fmt.fmt.pix.field       = V4L2_FIELD_NONE;
+        if (-1 == xioctl(fd, VIDIOC_TRY_FMT, &fmt))
+                return 0;
+        return fmt.fmt.pix.pixelformat == fourcc &&
+               fmt.fmt.pix.width == width && fmt.fmt.pix.height == height;
+}
+
+/*
+ * Open 'devname' in the 1st of 'modes' (in order of preference) which it
+ * supports at 'fps' frames per second or more (frame rates the driver does
+ * not enumerate are assumed to be fine). Returns the index of that mode,
+ * or -1 if none is supported.
+ */
+int device_initialize_modes(char *devname, const struct device_mode *modes,
+                            int n, int fps)
+{
+        struct v4l2_fmtdesc desc;
+        int has[N_FORMATS];
+        int i, k, f;
+
+        if (fd >= 0) {
+                fprintf(stderr, "device_initialize_modes(): fd is already opened\n");
+                return -1;
+        }
+        if (set_dev_name(devname) < 0)
+                return -1;
+
+        if (open_device() < 0)
+                return -1;
+        if (init_device(0) < 0) {
+                close_device();
+                return -1;
+        }
+
+        /* the pixel formats of the device (which this module knows) */
+        memset(has, 0, sizeof(has));
+        CLEAR(desc);
+        desc.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        for (desc.index = 0; 0 == xioctl(fd, VIDIOC_ENUM_FMT, &desc); desc.index++) {
+                if ((k = format_index(desc.pixelformat)) >= 0)
+                        has[k] = 1;
+        }
+
+        for (i = 0; i < n; i++) {
+                k = format_index_by_name(modes[i].format);
+                if (k < 0 || !has[k])
+                        continue;
+                f = max_fps(formats[k].fourcc, modes[i].width, modes[i].height);
+                if (f == 0 || (f > 0 && f < fps))
+                        continue;
+                if (f < 0 && !try_format(formats[k].fourcc, modes[i].width, modes[i].height))
+                        continue;
+                pix_width  = modes[i].width;
+                pix_height = modes[i].height;
+                pix_format = formats[k].fourcc;
+                pix_field  = V4L2_FIELD_NONE;      /* progressive */
+                set_format = 1;
+                if (init_device(1) == 0)
+                        return i;
+        }
+        fprintf(stderr, "device_initialize_modes(): %s supports none of the modes\n",
+                dev_name);
+        close_device();
+        return -1;
+}
+
 int device_get_format(int *width, int *height, char *format)
 {
         if (fd < 0)
                 return -1;
         *width  = pix_width;
         *height = pix_height;
-        if (pix_format == V4L2_PIX_FMT_YVU420) {
-                strcpy(format, "YV12");
-        } else
-        if (pix_format == V4L2_PIX_FMT_UYVY) {
-                strcpy(format, "UYVY");
-        } else
-        if (pix_format == V4L2_PIX_FMT_YUYV) {
-                strcpy(format, "YUYV");
-        } else {  /* unsupported format */
+        if (format_index(pix_format) < 0)  /* unsupported format */
                 return -1;
-        }
+        strcpy(format, formats[format_index(pix_format)].name);
         return 0;
 }
 
+/* bytes per line (of the luma plane, for planar formats) */
+int device_get_bytesperline()
+{
+        if (fd < 0)
+                return -1;
+        return pix_bytesperline;
+}
+
+/* the fd of the device, to wait for frames in an event loop (evloop.c) */
+int device_get_fd()
+{
+        return fd;
+}
+
 int device_start_capturing()
 {
         if (fd < 0)
@@ -580,7 +845,9 @@ void *device_get_next_frame(int timeout)
                 if (-1 == r) {
                         if (EINTR == errno)
                                 continue;
-                        errno_exit("select");
+                        dev_error = errno;
+                        errno_msg("select");
+                        return NULL;
                 }
                 if (0 == r) {
                         //fprintf(stderr, "select timeout\n");
@@ -588,17 +855,96 @@ void *device_get_next_frame(int timeout)
                 }
 
                 ret = read_frame();
-                if (ret)
+                if (ret || dev_error)
                         return ret;
-                /* EAGAIN - continue select loop. */
+                /* EAGAIN (or a corrupted frame) - continue select loop. */
         }
 }
 
-void device_free_frame(void *p)
+int device_free_frame(void *p)
+{
+        if (fd < 0)
+                return -1;
+        return free_frame(p);
+}
+
+/* when frame 'p' (from device_get_next_frame) was captured, or -1 */
+double device_frame_timestamp(void *p)
+{
+        unsigned int i;
+
+        for (i = 0; i < n_buffers; ++i)
+                if (p == buffers[i].start)
+                        return buffers[i].timestamp;
+        return -1;
+}
+
+/*
+ * The errno of the failure of the device while capturing (after
+ * device_get_next_frame() or device_free_frame() failed), for which it
+ * should be reconnected; 0 if it has not failed (e.g. on a timeout).
+ */
+int device_get_error()
+{
+        return dev_error;
+}
+
+/* stop capturing, release the buffers and close the device, ignoring errors */
+static void teardown(void)
 {
         if (fd < 0)
                 return;
-        free_frame(p);
+        if (buffers) {
+                stop_capturing();
+                uninit_device();
+        }
+        close_device();
+}
+
+/*
+ * Close the device and reopen it (e.g. after an HDMI glitch), with the
+ * format it was initialized with, new buffers, and streaming restarted.
+ * It is retried every 50 msecs for up to 'timeout' msecs. Returns 0 once
+ * it captures again, or -1 if the time is up (or it was never
+ * initialized). Frames got before are invalid after it.
+ */
+int device_reconnect(int timeout)
+{
+        double t0 = now(), deadline = t0 + timeout / 1000.0;
+        __u32 width = pix_width, height = pix_height, format = pix_format;
+        int tries = 0;
+
+        if (NULL == dev_name)  /* not initialized */
+                return -1;
+        teardown();
+        while (1) {
+                tries++;
+                pix_width  = width;
+                pix_height = height;
+                pix_format = format;
+                if (open_device() == 0) {
+                        if (init_device(set_format) == 0 &&
+                            (set_format || (get_current_format() == 0 &&
+                                            pix_width == width &&
+                                            pix_height == height &&
+                                            pix_format == format)) &&
+                            start_capturing() == 0) {
+                                fprintf(stderr, "device_reconnect(): %s reconnected "
+                                        "in %.3f s (%d tries)\n",
+                                        dev_name, now() - t0, tries);
+                                return 0;
+                        }
+                        teardown();
+                }
+                if (now() + 0.05 > deadline)
+                        break;
+                usleep(50000);
+        }
+        if (0 == dev_error)
+                dev_error = ENODEV;
+        fprintf(stderr, "device_reconnect(): %s failed after %.3f s (%d tries)\n",
+                dev_name, now() - t0, tries);
+        return -1;
 }
 
 void device_stop_capturing()
@@ -610,6 +956,8 @@ void device_stop_capturing()
 
 void device_cleanup()
 {
+        free(dev_name);
+        dev_name = NULL;
         if (fd < 0)
                 return;
         uninit_device();
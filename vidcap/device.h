@@ -6,12 +6,25 @@
 extern "C" {
 #endif
 
+/* a capture mode, for device_initialize_modes() */
+struct device_mode {
+        char format[5];         /* "UYVY", "YUYV", "YV12", "YU12", "NV12" or "GREY" */
+        int  width, height;
+};
+
 extern int   device_initialize(char *devname, int width, int height, char *format);
 extern int   device_initialize_keep_format(char *devname);
+extern int   device_initialize_modes(char *devname, const struct device_mode *modes,
+                                     int n, int fps);
 extern int   device_get_format(int *width, int *height, char *format);
+extern int   device_get_bytesperline();
+extern int   device_get_fd();
 extern int   device_start_capturing();
 extern void *device_get_next_frame(int timeout);  /* microseconds */
-extern void  device_free_frame(void *p);
+extern int   device_free_frame(void *p);
+extern double device_frame_timestamp(void *p);  /* CLOCK_MONOTONIC seconds */
+extern int   device_get_error();                /* errno of a failure, or 0 */
+extern int   device_reconnect(int timeout);     /* milliseconds */
 extern void  device_stop_capturing();
 extern void  device_cleanup();
 
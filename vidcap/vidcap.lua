@@ -6,6 +6,25 @@
 -- interface. The actual video capture code is written in C, which calls
 -- V4L2 API.
 --
+-- get() takes 2 of the 60 frames per second. set_pool('max') or
+-- set_pool('avg') pools the 2 frames pixelwise (in the conversion, in C)
+-- instead of dropping the 1st one, so that flickering sprites are not
+-- lost.
+--
+-- timestamp() is when the frame of the last get() was captured, in
+-- CLOCK_MONOTONIC seconds, the clock of gpio.monitor_events().
+--
+-- set_roi() registers a region of interest of the frame (e.g. the
+-- playfield, or a HUD rectangle), and get_rois() converts only the
+-- registered regions, each into its own output, leaving the rest of the
+-- frame alone: a fraction of the memory traffic of get().
+--
+-- When the capture device fails (or stops delivering frames), get()
+-- reconnects it instead of exiting, and returns without a frame: 0 if it
+-- got a frame, 1 if not, -1 if the device could not be reconnected (it is
+-- retried by the next get()). outages() returns the number of
+-- reconnections and the total time without frames, in seconds.
+--
 --------------------------------------------------------------------------------
 -- jkjung, 2017-02-06
 --------------------------------------------------------------------------------
@@ -19,16 +38,87 @@ local lib = ffi.load(paths.cwd() .. '/vidcap/libvidcap.so')
 -- Function prototype definition
 ffi.cdef [[
     int  vidcap_init();
-    void vidcap_get(unsigned char *ptrFromLua);
+    int  vidcap_set_pool(int mode);
+    int  vidcap_get(unsigned char *ptrFromLua);
+    double vidcap_timestamp();
+    int  vidcap_fd();
+    int  vidcap_poll(unsigned char *ptrFromLua);
+    int  vidcap_reconnect();
+    int  vidcap_outages(double *seconds);
+    int  vidcap_set_roi(int id, int h1, int h2, int w1, int w2, int scale,
+                        unsigned char *dst, int dst_stride);
+    void vidcap_clear_rois();
     void vidcap_flush();
     void vidcap_cleanup();
 ]]
 
 function vidcap.init()    return lib.vidcap_init()        end
-function vidcap.get(img)  lib.vidcap_get(torch.data(img)) end
+function vidcap.get(img)  return lib.vidcap_get(torch.data(img)) end
 function vidcap.flush()   lib.vidcap_flush()              end
+function vidcap.timestamp() return lib.vidcap_timestamp() end
+function vidcap.fd()      return lib.vidcap_fd()          end
+
+-- poll(img) takes the frames which are ready without waiting (for event
+-- loops waiting for fd() or a timeout, see term.evloop()), and returns
+-- true once 'img' holds a new frame; and, as 2nd result, true if the
+-- device failed (or stalled) and has been reconnected, so fd() is to be
+-- added to the loop again
+function vidcap.poll(img)
+    local r = lib.vidcap_poll(torch.data(img))
+    return r == 1, r < 0
+end
+function vidcap.reconnect() return lib.vidcap_reconnect() end
 function vidcap.cleanup() lib.vidcap_cleanup()            end
 
+-- set_roi(id, loc, scale, dst): region 'id' (1 ~ 16) is 'loc' ({ h1, h2,
+-- w1, w2 }, 1-based and inclusive, as the locs of galaga_image.t7) of the
+-- 640x360 frame, scaled down by 'scale' (1 by default, pixels averaged).
+-- It is converted into 'dst', whose last 2 dimensions must be its height
+-- and width, with rows contiguous: e.g. a view of an image of
+-- create_image() at 'loc', or a new compact ByteTensor (1 x h x w) if
+-- 'dst' is not given. Returns 'dst'.
+local roi_outputs = {}  -- referenced while registered
+function vidcap.set_roi(id, loc, scale, dst)
+    scale = scale or 1
+    local h = math.floor((loc.h2 - loc.h1 + 1) / scale)
+    local w = math.floor((loc.w2 - loc.w1 + 1) / scale)
+    dst = dst or torch.ByteTensor(1, h, w)
+    local d = dst:dim()
+    assert(dst:size(d - 1) == h and dst:size(d) == w and dst:stride(d) == 1,
+           'vidcap: the output does not fit the region')
+    assert(lib.vidcap_set_roi(id - 1, loc.h1, loc.h2, loc.w1, loc.w2, scale,
+                              torch.data(dst), dst:stride(d - 1)) == 0,
+           'vidcap: bad region')
+    roi_outputs[id] = dst
+    return dst
+end
+
+function vidcap.clear_rois()
+    lib.vidcap_clear_rois()
+    roi_outputs = {}
+end
+
+-- get_rois() is get() of the regions only, poll_rois() is poll() of them
+function vidcap.get_rois() return lib.vidcap_get(nil) end
+function vidcap.poll_rois()
+    local r = lib.vidcap_poll(nil)
+    return r == 1, r < 0
+end
+
+local seconds = ffi.new('double[1]')
+function vidcap.outages()
+    local n = lib.vidcap_outages(seconds)
+    return n, seconds[0]
+end
+
+-- pooling of the 2 frames taken by get(): 'drop' (the default), 'max' or 'avg'
+local pool_modes = { drop = 0, max = 1, avg = 2 }
+function vidcap.set_pool(mode)
+    local m = pool_modes[mode or 'drop']
+    assert(m, 'vidcap: unknown pooling ' .. tostring(mode))
+    return lib.vidcap_set_pool(m)
+end
+
 -- create and return a ByteTensor which is suitable for subsequent get() calls
 function vidcap.create_image()
     local img
@@ -5,8 +5,55 @@
  *
  *  This code implements V4L2 video capture from /dev/video0, designed for
  *  Nintendo Famicom Mini with HDMI output. This code uses Lua FFI to
- *  interface with Torch 7 code. It assumes input video to be 1280x720p60
- *  in UYVY format and converts video frame to 640x360p30 in grayscale.
+ *  interface with Torch 7 code. It converts the input video (1280x720p60
+ *  from the Famicom Mini) to 640x360p30 in grayscale.
+ *
+ *  The capture format is negotiated with the device (see
+ *  device_initialize_modes() in device.c): 'converters' below lists the
+ *  modes this module could convert from, cheapest first, e.g. a 640x360
+ *  GREY or planar (luma first) format whose luma is copied as is, before
+ *  the 1280x720 UYVY of the HDMI capture on the TX1, whose luma is
+ *  averaged over 2x2 pixels. The 1st mode the device supports at 60 fps
+ *  is used, with its converter, so the cheapest path is taken on any
+ *  capture hardware.
+ *
+ *  vidcap_get() takes 2 frames of 60 per second. By default (pooling
+ *  VIDCAP_POOL_DROP) the 1st one is dropped. Since Galaga's sprites
+ *  flicker (bullets could be drawn on every other frame only), the 2
+ *  frames could instead be pooled pixelwise, by max (VIDCAP_POOL_MAX) or
+ *  average (VIDCAP_POOL_AVG), see vidcap_set_pool(). Pooling is fused
+ *  into the conversion: both frames are read in the same pass which
+ *  writes the output, so it costs another read of the source but no
+ *  extra pass over the output (nor any work in Lua).
+ *
+ *  vidcap_timestamp() is when the frame returned by the last vidcap_get()
+ *  was captured (CLOCK_MONOTONIC seconds, see device_frame_timestamp()),
+ *  to align it with GPIO input events when recording demonstrations.
+ *
+ *  Instead of blocking in vidcap_get(), an event loop (term/evloop.c)
+ *  could wait for vidcap_fd() to be readable along with its other events,
+ *  then take the ready frames with vidcap_poll() (which does not wait).
+ *  The 2 should not be mixed without a vidcap_flush() in between.
+ *
+ *  Instead of the whole frame, vidcap_get(NULL) (or vidcap_poll(NULL))
+ *  converts only the regions of interest registered by vidcap_set_roi(),
+ *  e.g. the playfield and the HUD rectangles which galaga.lua reads, each
+ *  into its own output (compact, or at its place in a frame) and at
+ *  1/'scale' of the 640x360 resolution. The rest of the source is not
+ *  read, nor any other output written, which saves most of the memory
+ *  traffic of a conversion.
+ *
+ *  An HDMI glitch does not end the process: when the device fails (see
+ *  device_get_error()), or no frame has come for VIDCAP_STALL seconds,
+ *  vidcap_get() reconnects it (device_reconnect(), for up to
+ *  VIDCAP_RECONNECT_MS) and returns without a frame; the outage, from
+ *  the 1st missed frame to the reconnection, is recorded in the
+ *  "capture_outage" metric and by vidcap_outages(). If it could not be
+ *  reconnected in time, vidcap_get() returns -1, and tries again when
+ *  called next. vidcap_poll() returns -1 when it has reconnected the
+ *  device, since vidcap_fd() is then another one; as it does not wait,
+ *  the event loop has to call it on a timeout too (a stalled device is
+ *  never readable).
  *
  *  PROCESS:
  *
@@ -20,66 +67,477 @@
  *
  *    Date             Description                                   Author
  *    2017-02-06       initial coding                                jkjung
+ *    2026-10-18       capture wait/conversion metrics               agent
+ *    2026-10-18       dequeue/convert trace events                  agent
+ *    2026-10-18       pooling of frame pairs (60 fps mode)          agent
+ *    2026-10-18       capture format negotiation, converter table   agent
+ *    2026-10-18       frame timestamps                              agent
+ *    2026-10-18       vidcap_fd()/vidcap_poll() for event loops     agent
+ *    2026-10-18       reconnects after device failures              agent
+ *    2026-10-18       conversion of regions of interest only        agent
+ *    2026-10-18       stall detection in vidcap_poll()              agent
  *
  *  TARGET: Linux C
  *
  */
 
+#include <stdio.h>
 #include <stdlib.h>
 #include "device.h"
+#include "../metrics/metrics.h"
+#include "../trace/trace.h"
 
 #if 0
 int  vidcap_init();
-void vidcap_get(unsigned char *ptrFromLua);
+int  vidcap_set_pool(int mode);
+int  vidcap_get(unsigned char *ptrFromLua);
+double vidcap_timestamp();
+int  vidcap_fd();
+int  vidcap_poll(unsigned char *ptrFromLua);
+int  vidcap_reconnect();
+int  vidcap_outages(double *seconds);
+int  vidcap_set_roi(int id, int h1, int h2, int w1, int w2, int scale,
+                    unsigned char *dst, int dst_stride);
+void vidcap_clear_rois();
 void vidcap_flush();
 void vidcap_cleanup();
 #endif /* 0 */
 
+/* pooling of the 2 frames taken by vidcap_get() */
+#define VIDCAP_POOL_DROP  0     /* drop the 1st one */
+#define VIDCAP_POOL_MAX   1     /* pixelwise max */
+#define VIDCAP_POOL_AVG   2     /* pixelwise average */
+
+#define VIDCAP_STALL         0.5   /* seconds without frames to reconnect */
+#define VIDCAP_RECONNECT_MS  2000
+
+static int m_capture_wait = -1, m_convert = -1, m_outage = -1;
+static int t_dequeue = -1, t_convert = -1, t_reconnect = -1;
+static int pool = VIDCAP_POOL_DROP;
+static double timestamp = -1;
+static void *pending;           /* 1st frame of a pair, for vidcap_poll() */
+static double down_since;       /* the 1st missed frame, 0 if capturing */
+static double polled;           /* the last frame taken by vidcap_poll() */
+static int outages;             /* reconnections */
+static double outage_seconds;   /* total */
+
+#define OUT_W   640
+#define OUT_H   360
+
+#define VIDCAP_MAX_ROIS  16
+
+/* a region of interest, in the 640x360 frame */
+static struct roi {
+        int            x, y, w, h;
+        int            scale;           /* the output is 1/scale of it */
+        unsigned char *dst;             /* NULL if not registered */
+        int            dst_stride;
+} rois[VIDCAP_MAX_ROIS];
+
 static void bye(void)
 {
+        pending = NULL;
         device_stop_capturing();
         device_cleanup();
 }
 
-static void UYVY1280x720_to_GRAY640x360(const unsigned char *src, unsigned char *dst)
+/*
+ * Luma of the source (frames 'src0' and, if pooled, 'src1'; 'stride'
+ * bytes per line) to w x h gray pixels ('dst_stride' bytes per line):
+ * 'px' is the distance between Y values (2 for packed YUV, 1 for
+ * gray/planar), and 'scale' is 2 for 1280x720 sources (average over 2x2
+ * pixels) or 1 for 640x360 ones. Inlined with constant 'px', 'scale' and
+ * 'mode' by the converters below.
+ */
+static inline __attribute__((always_inline))
+void luma_to_gray(const unsigned char *src0, const unsigned char *src1,
+                  int stride, int px, int scale, int mode,
+                  int w, int h, unsigned char *dst, int dst_stride)
 {
-        int i, j, width = 640, height = 360;
+        int i, j, a, b, height;
 
-        src += 1;  /* offset by 1 to get the 1st Y value (the byte preceding this Y is a U) */
-        while (--height >= 0) {
-                for (i = 0; i < width; i++) {
-                        j = i * 4;  /* j = (i * 1280 / 640) * 2; */
-                        *dst++ = (src[j] + src[j+2] + src[j+1280*2] + src[j+1280*2+2]) / 4;  /* take average of Y over 4 adjacent pixels */
+        for (height = 0; height < h; height++, dst += dst_stride - w) {
+                for (i = 0; i < w; i++) {
+                        j = i * scale * px;
+                        if (1 == scale)
+                                a = src0[j] * 4;
+                        else  /* take average of Y over 4 adjacent pixels */
+                                a = src0[j] + src0[j+px] + src0[j+stride] + src0[j+stride+px];
+                        if (VIDCAP_POOL_DROP == mode) {
+                                *dst++ = a / 4;
+                                continue;
+                        }
+                        if (1 == scale)
+                                b = src1[j] * 4;
+                        else
+                                b = src1[j] + src1[j+px] + src1[j+stride] + src1[j+stride+px];
+                        if (VIDCAP_POOL_MAX == mode)
+                                *dst++ = ((a > b) ? a : b) / 4;
+                        else
+                                *dst++ = (a + b) / 8;
                 }
-                src += 1280*2 * 2;  /* stride 2 lines, 1280*2 bytes per line */
+                src0 += stride * scale;
+                if (src1)  src1 += stride * scale;
         }
 }
 
+/*
+ * The converters, of w x h output pixels: 'src1' is NULL unless 2 frames
+ * are pooled by 'mode'.
+ */
+typedef void (*convert_fn)(const unsigned char *src0, const unsigned char *src1,
+                           int stride, int mode, int w, int h,
+                           unsigned char *dst, int dst_stride);
+
+#define CONVERT(px, scale, mode, w, h, dst_stride)                              \
+        luma_to_gray(src0, src1, stride, px, scale, mode, w, h, dst, dst_stride)
+
+/* whole frames (the common case) are converted with constant sizes */
+#define CONVERTER(name, px, scale)                                              \
+static void name(const unsigned char *src0, const unsigned char *src1,          \
+                 int stride, int mode, int w, int h,                            \
+                 unsigned char *dst, int dst_stride)                            \
+{                                                                               \
+        int whole = (OUT_W == w && OUT_H == h && OUT_W == dst_stride);          \
+                                                                                \
+        if (NULL == src1)                                                       \
+                mode = VIDCAP_POOL_DROP;                                        \
+        if (VIDCAP_POOL_DROP == mode && whole)                                  \
+                CONVERT(px, scale, VIDCAP_POOL_DROP, OUT_W, OUT_H, OUT_W);      \
+        else if (VIDCAP_POOL_DROP == mode)                                      \
+                CONVERT(px, scale, VIDCAP_POOL_DROP, w, h, dst_stride);         \
+        else if (VIDCAP_POOL_MAX == mode && whole)                              \
+                CONVERT(px, scale, VIDCAP_POOL_MAX, OUT_W, OUT_H, OUT_W);       \
+        else if (VIDCAP_POOL_MAX == mode)                                       \
+                CONVERT(px, scale, VIDCAP_POOL_MAX, w, h, dst_stride);          \
+        else if (whole)                                                         \
+                CONVERT(px, scale, VIDCAP_POOL_AVG, OUT_W, OUT_H, OUT_W);       \
+        else                                                                    \
+                CONVERT(px, scale, VIDCAP_POOL_AVG, w, h, dst_stride);          \
+}
+
+CONVERTER(gray_1x, 1, 1)        /* 640x360 gray or planar */
+CONVERTER(gray_2x, 1, 2)        /* 1280x720 gray or planar */
+CONVERTER(packed_1x, 2, 1)      /* 640x360 packed YUV */
+CONVERTER(packed_2x, 2, 2)      /* 1280x720 packed YUV */
+
+/*
+ * Luma of the source to 1 gray pixel per 'n' x 'n' source pixels, for
+ * regions of interest scaled down (n = the scale of the source times
+ * that of the region), so not as fast as the converters.
+ */
+static void luma_box(const unsigned char *src0, const unsigned char *src1,
+                     int stride, int px, int n, int mode, int w, int h,
+                     unsigned char *dst, int dst_stride)
+{
+        const unsigned char *s;
+        int x, y, i, j, a, b;
+
+        for (y = 0; y < h; y++) {
+                for (x = 0; x < w; x++) {
+                        a = b = 0;
+                        for (i = 0; i < n; i++) {
+                                s = src0 + (y * n + i) * stride + x * n * px;
+                                for (j = 0; j < n; j++)
+                                        a += s[j * px];
+                                if (NULL == src1)
+                                        continue;
+                                s = src1 + (y * n + i) * stride + x * n * px;
+                                for (j = 0; j < n; j++)
+                                        b += s[j * px];
+                        }
+                        if (NULL == src1)
+                                dst[x] = a / (n * n);
+                        else if (VIDCAP_POOL_MAX == mode)
+                                dst[x] = ((a > b) ? a : b) / (n * n);
+                        else
+                                dst[x] = (a + b) / (2 * n * n);
+                }
+                dst += dst_stride;
+        }
+}
+
+/* capture modes and their converters, cheapest first */
+static const struct converter {
+        struct device_mode mode;
+        int                offset;      /* of the 1st Y value */
+        int                px;          /* bytes from a Y value to the next */
+        convert_fn         convert;
+} converters[] = {
+        { { "GREY",  640, 360 }, 0, 1, gray_1x },
+        { { "NV12",  640, 360 }, 0, 1, gray_1x },
+        { { "YU12",  640, 360 }, 0, 1, gray_1x },
+        { { "YV12",  640, 360 }, 0, 1, gray_1x },
+        { { "UYVY",  640, 360 }, 1, 2, packed_1x },
+        { { "YUYV",  640, 360 }, 0, 2, packed_1x },
+        { { "GREY", 1280, 720 }, 0, 1, gray_2x },
+        { { "NV12", 1280, 720 }, 0, 1, gray_2x },
+        { { "YU12", 1280, 720 }, 0, 1, gray_2x },
+        { { "YV12", 1280, 720 }, 0, 1, gray_2x },
+        { { "UYVY", 1280, 720 }, 1, 2, packed_2x },  /* HDMI capture on the TX1 */
+        { { "YUYV", 1280, 720 }, 0, 2, packed_2x },
+};
+#define N_CONVERTERS  (int) (sizeof(converters) / sizeof(converters[0]))
+
+static const struct converter *conv = &converters[N_CONVERTERS - 2];
+static int stride = 1280 * 2;
+
 int vidcap_init()
 {
+        struct device_mode modes[N_CONVERTERS];
+        int i;
+
         atexit(bye);
-        if (device_initialize("/dev/video0", 1280, 720, "UYVY") < 0)
+        m_capture_wait = metrics_histogram("capture_wait");
+        m_convert = metrics_histogram("convert");
+        m_outage = metrics_histogram("capture_outage");
+        t_dequeue = trace_name("dequeue");
+        t_convert = trace_name("convert");
+        t_reconnect = trace_name("reconnect");
+        for (i = 0; i < N_CONVERTERS; i++)
+                modes[i] = converters[i].mode;
+        /* 60 fps: vidcap_get() takes 2 frames per 30 fps step */
+        if ((i = device_initialize_modes("/dev/video0", modes, N_CONVERTERS, 60)) < 0)
                 return -1;
+        conv = &converters[i];
+        stride = device_get_bytesperline();
+        fprintf(stderr, "vidcap: /dev/video0 %dx%d %s\n",
+                conv->mode.width, conv->mode.height, conv->mode.format);
         if (device_start_capturing() < 0)
                 return -1;
         return 0;
 }
 
-/* Get 1 video frame (grayscale 640x360) */
-void vidcap_get(unsigned char *ptrFromLua)
+/*
+ * Set how the 2 frames taken by vidcap_get() are combined: 0 - drop the
+ * 1st one (30 fps, the default), 1 - max, 2 - average. Returns 0, or -1
+ * for an unknown mode.
+ */
+int vidcap_set_pool(int mode)
 {
-        void *p;
+        if (mode < VIDCAP_POOL_DROP || mode > VIDCAP_POOL_AVG)
+                return -1;
+        pool = mode;
+        return 0;
+}
 
-        p = device_get_next_frame(100000);  /* timeout = 0.1 second */
-        if (NULL == p)  return;  /* abort here if get image data fails */
-        device_free_frame(p);    /* otherwise drop 1 frame (intentionally) */
+/*
+ * Register region of interest 'id' (0 ~ VIDCAP_MAX_ROIS - 1): rows h1 ~
+ * h2 and columns w1 ~ w2 (1-based and inclusive, as the locs of
+ * galaga_image.t7) of the 640x360 frame, converted by vidcap_get(NULL)
+ * at 1/'scale' into 'dst' ('dst_stride' bytes per line), or removed if
+ * 'dst' is NULL. Returns 0, or -1 if the region is out of the frame.
+ */
+int vidcap_set_roi(int id, int h1, int h2, int w1, int w2, int scale,
+                   unsigned char *dst, int dst_stride)
+{
+        struct roi *r;
 
-        p = device_get_next_frame(100000);  /* timeout = 0.1 second */
-        if (NULL == p)  return;  /* abort if fail, no data is written to Lua */
-        UYVY1280x720_to_GRAY640x360((const unsigned char *) p, ptrFromLua);
+        if (id < 0 || id >= VIDCAP_MAX_ROIS)
+                return -1;
+        r = &rois[id];
+        r->dst = NULL;
+        if (NULL == dst)
+                return 0;
+        if (h1 < 1 || h2 > OUT_H || h1 > h2 || w1 < 1 || w2 > OUT_W || w1 > w2 ||
+            scale < 1 || (w2 - w1 + 1) / scale < 1 || (h2 - h1 + 1) / scale < 1 ||
+            dst_stride < (w2 - w1 + 1) / scale)
+                return -1;
+        r->x = w1 - 1;
+        r->y = h1 - 1;
+        r->w = (w2 - w1 + 1) / scale;
+        r->h = (h2 - h1 + 1) / scale;
+        r->scale = scale;
+        r->dst_stride = dst_stride;
+        r->dst = dst;
+        return 0;
+}
+
+void vidcap_clear_rois()
+{
+        int i;
+
+        for (i = 0; i < VIDCAP_MAX_ROIS; i++)
+                rois[i].dst = NULL;
+}
+
+/* convert the regions of interest of 'src0' (pooled with 'src1') */
+static void convert_rois(const unsigned char *src0, const unsigned char *src1)
+{
+        const struct roi *r;
+        int n = conv->mode.width / OUT_W;       /* source pixels per pixel */
+        int i, off;
+
+        for (i = 0; i < VIDCAP_MAX_ROIS; i++) {
+                r = &rois[i];
+                if (NULL == r->dst)
+                        continue;
+                off = r->y * n * stride + r->x * n * conv->px;
+                if (1 == r->scale)
+                        conv->convert(src0 + off, src1 ? src1 + off : NULL, stride,
+                                      pool, r->w, r->h, r->dst, r->dst_stride);
+                else
+                        luma_box(src0 + off, src1 ? src1 + off : NULL, stride,
+                                 conv->px, n * r->scale, pool, r->w, r->h,
+                                 r->dst, r->dst_stride);
+        }
+}
+
+/*
+ * Convert frame 'p' (pooled with 'p0', if not NULL) into 'dst', or the
+ * regions of interest if 'dst' is NULL, and free them.
+ */
+static void convert_pair(void *p0, void *p, unsigned char *dst)
+{
+        const unsigned char *src0 = (const unsigned char *) p + conv->offset;
+        const unsigned char *src1 = p0 ? (const unsigned char *) p0 + conv->offset : NULL;
+        double t = metrics_now(), t1;
+
+        timestamp = device_frame_timestamp(p);
+        if (dst)
+                conv->convert(src0, src1, stride, pool, OUT_W, OUT_H, dst, OUT_W);
+        else
+                convert_rois(src0, src1);
+        t1 = metrics_now();
+        metrics_record(m_convert, t1 - t);
+        trace_span(t_convert, t, t1, -1);
+        if (p0)  device_free_frame(p0);
         device_free_frame(p);
 }
 
+/*
+ * Reconnect the device (which has failed, or stalled, since 'down_since').
+ * Returns 0, or -1 if it could not be reconnected in time.
+ */
+int vidcap_reconnect()
+{
+        double t = metrics_now(), t1;
+        int r;
+
+        if (0 == down_since)
+                down_since = t;
+        pending = NULL;  /* its buffer is gone */
+        r = device_reconnect(VIDCAP_RECONNECT_MS);
+        t1 = metrics_now();
+        trace_span(t_reconnect, t, t1, -1);
+        if (r < 0)
+                return -1;
+        stride = device_get_bytesperline();
+        outages++;
+        outage_seconds += t1 - down_since;
+        metrics_record(m_outage, t1 - down_since);
+        fprintf(stderr, "vidcap: capturing again after %.3f s\n", t1 - down_since);
+        down_since = 0;
+        return 0;
+}
+
+/* no frame was got: reconnect if the device failed or has stalled */
+static int no_frame(void)
+{
+        double t = metrics_now();
+
+        if (0 == down_since)
+                down_since = t;
+        if (device_get_error() || t - down_since >= VIDCAP_STALL)
+                return vidcap_reconnect() < 0 ? -1 : 1;
+        return 1;
+}
+
+/*
+ * Get 1 video frame (grayscale 640x360), or only its regions of interest
+ * if ptrFromLua is NULL (see vidcap_set_roi). Returns 0, 1 if no frame
+ * was got (nothing is written), or -1 if the device has failed and could
+ * not be reconnected.
+ */
+int vidcap_get(unsigned char *ptrFromLua)
+{
+        void *p0, *p;
+        double t = metrics_now(), t1;
+
+        if (device_get_error() && vidcap_reconnect() < 0)
+                return -1;
+        p0 = device_get_next_frame(100000);  /* timeout = 0.1 second */
+        if (NULL == p0)  return no_frame();  /* abort here if get image data fails */
+        if (VIDCAP_POOL_DROP == pool) {
+                device_free_frame(p0);  /* drop 1 frame (intentionally) */
+                p0 = NULL;
+        }
+
+        p = device_get_next_frame(100000);  /* timeout = 0.1 second */
+        if (NULL == p) {  /* abort if fail, no data is written to Lua */
+                if (p0)  device_free_frame(p0);
+                return no_frame();
+        }
+        down_since = 0;
+        t1 = metrics_now();
+        metrics_record(m_capture_wait, t1 - t);
+        trace_span(t_dequeue, t, t1, -1);
+        convert_pair(p0, p, ptrFromLua);
+        return 0;
+}
+
+/* the number of reconnections, and the total outage in 'seconds' */
+int vidcap_outages(double *seconds)
+{
+        if (seconds)
+                *seconds = outage_seconds;
+        return outages;
+}
+
+/* the fd of /dev/video0, readable when a frame is ready (see vidcap_poll) */
+int vidcap_fd()
+{
+        return device_get_fd();
+}
+
+/*
+ * Take the frames which are ready, without waiting: once 2 frames are
+ * taken (pooled as by vidcap_get), 1 video frame (grayscale 640x360) is
+ * written to ptrFromLua (or the regions of interest, if it is NULL), and
+ * 1 is returned; otherwise 0. For event loops which wait for vidcap_fd()
+ * to be readable, or for a timeout (so that a stall is noticed). If the
+ * device has failed, or no frame has come for VIDCAP_STALL seconds, it
+ * is reconnected, and -1 is returned: vidcap_fd() is another one (or -1,
+ * if the device could not be reconnected; see vidcap_reconnect()).
+ */
+int vidcap_poll(unsigned char *ptrFromLua)
+{
+        double t = metrics_now();
+        void *p;
+
+        while ((p = device_get_next_frame(0)) != NULL) {
+                polled = t;
+                if (NULL == pending) {
+                        pending = p;
+                        continue;
+                }
+                if (VIDCAP_POOL_DROP == pool) {
+                        device_free_frame(pending);
+                        pending = NULL;
+                }
+                down_since = 0;
+                convert_pair(pending, p, ptrFromLua);
+                pending = NULL;
+                return 1;
+        }
+        if (0 == polled)
+                polled = t;
+        if (device_get_error() || t - polled >= VIDCAP_STALL) {
+                if (0 == down_since)
+                        down_since = polled;
+                polled = 0;
+                vidcap_reconnect();
+                return -1;
+        }
+        return 0;
+}
+
+/* capture time of the last frame, CLOCK_MONOTONIC seconds (-1 if none) */
+double vidcap_timestamp()
+{
+        return timestamp;
+}
+
 /*
  * Flush old video frames (so that the immediate subsequent vidcap_get()
  * call would get the latest video frame, without too much latency)
@@ -92,6 +550,11 @@ void vidcap_flush()
          * read and discard up to 32 frames (since the V4L2 device driver
          * might buffer up to this many frames)
          */
+        if (pending) {
+                device_free_frame(pending);
+                pending = NULL;
+        }
+        polled = 0;
         for (i = 0; i < 32; i++) {
                 void *p = device_get_next_frame(1000);
                 if (NULL == p)  break;  /* Fail to get image data */